@@ -0,0 +1,480 @@
+﻿// benchmark.cpp : headless throughput/scaling/accuracy runs of the mean curvature pipeline over procedural meshes
+//
+// Benchmark [--shapes uv_sphere,icosphere,torus,noise_grid] [--sizes 1000,10000,...] [--max-vertices N]
+//           [--threads 1,2,4,...] [--repeat N] [--max-load-vertices N] [--out results.json]
+//           [--gpu] [--max-gpu-vertices N]
+// --gpu also runs the compute shader path (hidden window for the context) against the CPU kernel on every mesh,
+// the exit code is non-zero when any of them is outside MeanCurvatureGPUValidation::Tolerance or can't run at all.
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <limits>
+#include <Utilities/utility.h>
+#include <GLFW/glfw3.h>
+#include "mean_curvature.h"
+#include "mean_curvature_gpu.h"
+#include "procedural_meshes.h"
+using namespace GLCore;
+using namespace GLCore::Utils;
+
+struct BenchmarkOptions
+{
+	std::vector<Procedural::SHAPE> Shapes = { Procedural::SHAPE::UV_SPHERE, Procedural::SHAPE::ICOSPHERE, Procedural::SHAPE::TORUS, Procedural::SHAPE::NOISE_GRID };
+	std::vector<size_t> Sizes = { 1'000, 10'000, 100'000, 1'000'000, 10'000'000, 50'000'000 };
+	std::vector<uint32_t> Threads; // empty -> 1, 2, 4 .. hardware_concurrency
+	size_t MaxVertices = 50'000'000;
+	size_t MaxLoadVertices = 2'000'000; // OBJ round trip gets slow (and big on disk) past this
+	uint32_t Repeat = 3;
+	std::string OutPath = "benchmark_results.json";
+	bool GPU = false;
+	size_t MaxGPUVertices = 10'000'000; // adjacency + results have to fit in video memory
+};
+
+struct PhaseTimings
+{
+	double Load = -1; // < 0 when skipped
+	double Adjacency = 0, Kernel = 0, Statistics = 0, ColorMapping = 0;
+
+	double Compute () const { return Adjacency + Kernel + Statistics + ColorMapping; }
+	void KeepFastest (const PhaseTimings &other)
+	{
+		Adjacency = MIN (Adjacency, other.Adjacency), Kernel = MIN (Kernel, other.Kernel);
+		Statistics = MIN (Statistics, other.Statistics), ColorMapping = MIN (ColorMapping, other.ColorMapping);
+	}
+};
+
+struct Accuracy
+{
+	bool Available = false; // only for surfaces with an analytic H
+	double MeanRelativeError = 0, MaxRelativeError = 0, RMSRelativeError = 0;
+};
+
+struct BenchmarkResult
+{
+	Procedural::SHAPE Shape;
+	size_t Vertices, Triangles;
+	uint32_t Threads;
+	PhaseTimings Timings;
+	double Speedup; // against the first thread count of the same mesh
+	size_t CurrentRSS, PeakRSS;
+	MeanCurvatureStatistics Stats;
+	Accuracy Error;
+	double GridKernel = -1;        // HeightfieldMeanCurvature on the same surface (noise_grid only), replaces adjacency + kernel
+	double GridMaxDifference = 0;  // largest |K_h| difference against the generic kernel
+	bool GPUChecked = false;       // --gpu, on the last thread count of every mesh
+	double GPUKernel = 0, GPUColorMapping = 0;
+	MeanCurvatureGPUValidation GPUValidation;
+};
+
+using clock_type = std::chrono::steady_clock;
+static double ElapsedMs (clock_type::time_point since)
+{
+	return std::chrono::duration<double, std::milli> (clock_type::now () - since).count ();
+}
+
+template<typename T>
+static bool ParseList (const char *arg, std::vector<T> &out)
+{
+	out.clear ();
+	std::stringstream ss (arg);
+	std::string item;
+	while (std::getline (ss, item, ',')) {
+		if (item.empty ())
+			continue;
+		char *end = nullptr;
+		unsigned long long value = strtoull (item.c_str (), &end, 10);
+		if (end == item.c_str ())
+			return false;
+		// allow 10K, 1M style suffixes
+		if (*end == 'k' || *end == 'K') value *= 1'000;
+		else if (*end == 'm' || *end == 'M') value *= 1'000'000;
+		out.push_back (T (value));
+	}
+	return !out.empty ();
+}
+
+static bool ParseOptions (int argc, char **argv, BenchmarkOptions &options)
+{
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+		auto take_value = [&]() -> const char * {
+			if (value == nullptr)
+				LOG_ERROR ("missing value for {0}", arg);
+			i++;
+			return value;
+		};
+		if (strcmp (arg, "--shapes") == 0) {
+			const char *list = take_value ();
+			if (!list) return false;
+			options.Shapes.clear ();
+			std::stringstream ss (list);
+			std::string name;
+			while (std::getline (ss, name, ',')) {
+				Procedural::SHAPE shape;
+				if (!Procedural::ShapeFromName (name, shape)) {
+					LOG_ERROR ("unknown shape '{0}'", name);
+					return false;
+				}
+				options.Shapes.push_back (shape);
+			}
+		} else if (strcmp (arg, "--sizes") == 0) {
+			const char *list = take_value ();
+			if (!list || !ParseList (list, options.Sizes)) return false;
+		} else if (strcmp (arg, "--threads") == 0) {
+			const char *list = take_value ();
+			if (!list || !ParseList (list, options.Threads)) return false;
+		} else if (strcmp (arg, "--max-vertices") == 0) {
+			std::vector<size_t> max;
+			const char *list = take_value ();
+			if (!list || !ParseList (list, max)) return false;
+			options.MaxVertices = max[0];
+		} else if (strcmp (arg, "--max-load-vertices") == 0) {
+			std::vector<size_t> max;
+			const char *list = take_value ();
+			if (!list || !ParseList (list, max)) return false;
+			options.MaxLoadVertices = max[0];
+		} else if (strcmp (arg, "--max-gpu-vertices") == 0) {
+			std::vector<size_t> max;
+			const char *list = take_value ();
+			if (!list || !ParseList (list, max)) return false;
+			options.MaxGPUVertices = max[0];
+		} else if (strcmp (arg, "--gpu") == 0) {
+			options.GPU = true;
+		} else if (strcmp (arg, "--repeat") == 0) {
+			std::vector<uint32_t> repeat;
+			const char *list = take_value ();
+			if (!list || !ParseList (list, repeat)) return false;
+			options.Repeat = MAX (repeat[0], 1u);
+		} else if (strcmp (arg, "--out") == 0) {
+			const char *path = take_value ();
+			if (!path) return false;
+			options.OutPath = path;
+		} else {
+			LOG_ERROR ("unknown option '{0}'", arg);
+			return false;
+		}
+	}
+	if (options.Threads.empty ()) {
+		uint32_t hardware = MAX (std::thread::hardware_concurrency (), 1u);
+		for (uint32_t t = 1; t < hardware; t *= 2)
+			options.Threads.push_back (t);
+		options.Threads.push_back (hardware);
+	}
+	return true;
+}
+
+// fixed parameters, analytic H depends on them
+static constexpr float SphereRadius = 1.0f;
+static constexpr float TorusMajorRadius = 1.0f, TorusMinorRadius = 0.4f;
+static constexpr float NoiseGridSize = 10.0f, NoiseGridAmplitude = 0.5f;
+
+static Procedural::Mesh Generate (Procedural::SHAPE shape, size_t target_vertices)
+{
+	switch (shape) {
+		case Procedural::SHAPE::UV_SPHERE:  return Procedural::UVSphere (target_vertices, SphereRadius);
+		case Procedural::SHAPE::ICOSPHERE:  return Procedural::Icosphere (target_vertices, SphereRadius);
+		case Procedural::SHAPE::TORUS:      return Procedural::Torus (target_vertices, TorusMajorRadius, TorusMinorRadius);
+		case Procedural::SHAPE::NOISE_GRID: return Procedural::NoiseGrid (target_vertices, NoiseGridSize, NoiseGridAmplitude);
+	}
+	return {};
+}
+
+static Accuracy MeasureAccuracy (Procedural::SHAPE shape, const Procedural::Mesh &mesh, const std::vector<float> &K_h, const VertexRings &rings)
+{
+	Accuracy accuracy;
+	if (shape == Procedural::SHAPE::NOISE_GRID)
+		return accuracy;
+
+	double sum = 0, sum_of_squares = 0, max = 0;
+	size_t counted = 0;
+	for (size_t v = 0; v < mesh.Vertices.size (); v++) {
+		if (rings.RingSize (v) == 0)
+			continue;
+		float H = shape == Procedural::SHAPE::TORUS
+			? Procedural::TorusMeanCurvature (mesh.Vertices[v].first, TorusMajorRadius, TorusMinorRadius)
+			: Procedural::SphereMeanCurvature (SphereRadius);
+		double error = std::abs (double (K_h[v]) - std::abs (H))/std::abs (H);
+		sum += error, sum_of_squares += error*error, max = MAX (max, error);
+		counted++;
+	}
+	if (counted > 0) {
+		accuracy.Available = true;
+		accuracy.MeanRelativeError = sum/counted;
+		accuracy.RMSRelativeError = std::sqrt (sum_of_squares/counted);
+		accuracy.MaxRelativeError = max;
+	}
+	return accuracy;
+}
+
+static double TimeLoad (const Procedural::Mesh &mesh)
+{
+	const char *path = "benchmark_tmp_mesh.obj";
+	if (!Procedural::WriteOBJ (path, mesh)) {
+		LOG_ERROR ("cannot write {0}, skipping load phase", path);
+		return -1;
+	}
+	std::vector<std::pair<glm::vec3, glm::vec3>> loaded_vertices;
+	std::vector<uint32_t> loaded_indices;
+	auto start = clock_type::now ();
+	bool loaded = Helper::ASSET_LOADER::LoadOBJ_meshOnly (path, loaded_vertices, loaded_indices);
+	double elapsed = ElapsedMs (start);
+	std::remove (path);
+	if (!loaded || loaded_vertices.size () != mesh.Vertices.size ()) {
+		LOG_ERROR ("OBJ round trip failed, skipping load phase");
+		return -1;
+	}
+	return elapsed;
+}
+
+// only for its context, nothing is ever shown
+static GLFWwindow *CreateHiddenContext ()
+{
+	if (!glfwInit ()) {
+		LOG_ERROR ("--gpu: could not initialize GLFW");
+		return nullptr;
+	}
+	glfwWindowHint (GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow *window = glfwCreateWindow (1, 1, "Benchmark", nullptr, nullptr);
+	if (!window) {
+		LOG_ERROR ("--gpu: could not create an OpenGL context");
+		glfwTerminate ();
+		return nullptr;
+	}
+	glfwMakeContextCurrent (window);
+	if (!gladLoadGLLoader ((GLADloadproc)glfwGetProcAddress)) {
+		LOG_ERROR ("--gpu: failed to initialize Glad");
+		glfwDestroyWindow (window);
+		glfwTerminate ();
+		return nullptr;
+	}
+	LOG_INFO ("--gpu: {0}, OpenGL {1}", glGetString (GL_RENDERER), glGetString (GL_VERSION));
+	return window;
+}
+
+// the same buffers the Sandbox hands the compute path: interleaved float {position, normal} and float3 colors
+static void CheckGPU (MeanCurvatureGPU &gpu, uint64_t mesh_generation, const Procedural::Mesh &mesh, const VertexRings &rings
+					  , const std::vector<glm::vec3> &cpu_normals, const std::vector<float> &cpu_values, float max_mean_curvature
+					  , const std::vector<glm::vec3> &blend_betweencolors, BenchmarkResult &result)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const MeshVertexFormat format;
+	GLuint buffers[2];
+	glGenBuffers (2, buffers);
+	glBindBuffer (GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData (GL_ARRAY_BUFFER, mesh.Vertices.size ()*sizeof (mesh.Vertices[0]), mesh.Vertices.data (), GL_STATIC_DRAW);
+	glBindBuffer (GL_ARRAY_BUFFER, buffers[1]);
+	glBufferData (GL_ARRAY_BUFFER, MAX (mesh.Vertices.size ()*format.ColorStride (), size_t (4)), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer (GL_ARRAY_BUFFER, 0);
+	gpu.UploadAdjacency (rings, mesh_generation);
+	gpu.SetVertexFormat (format, mesh.Vertices);
+
+	MeanCurvaturePhaseTimings timings;
+	std::vector<float> gpu_values;
+	std::vector<glm::vec3> gpu_normals;
+	if (gpu.Calculate (buffers[0], buffers[1], 0, blend_betweencolors, nullptr, nullptr, &timings)) {
+		gpu.ReadBack (gpu_values, gpu_normals);
+		result.GPUKernel = timings.Kernel, result.GPUColorMapping = timings.ColorMapping;
+	}
+	result.GPUChecked = true;
+	result.GPUValidation = ValidateMeanCurvatureGPU (mesh.Vertices, rings, cpu_values, cpu_normals, gpu_values, gpu_normals, max_mean_curvature);
+	glDeleteBuffers (2, buffers);
+}
+
+static void WriteJSON (const std::string &path, const BenchmarkOptions &options, const std::vector<BenchmarkResult> &results)
+{
+	std::ofstream ofs (path);
+	if (!ofs) {
+		LOG_ERROR ("File creation error - {0}", path);
+		return;
+	}
+	auto number = [](double value) -> std::string { // JSON has no inf/nan
+		if (!std::isfinite (value))
+			return "null";
+		std::ostringstream ss;
+		ss << std::setprecision (9) << value;
+		return ss.str ();
+	};
+	ofs << "{\n";
+#if MODE_DEBUG
+	ofs << "  \"configuration\": \"Debug\",\n";
+#else
+	ofs << "  \"configuration\": \"Release\",\n";
+#endif
+	ofs << "  \"hardware_concurrency\": " << std::thread::hardware_concurrency () << ",\n";
+	ofs << "  \"repeat\": " << options.Repeat << ",\n";
+	ofs << "  \"peak_rss_bytes\": " << Memory::PeakResidentBytes () << ",\n";
+	ofs << "  \"results\": [";
+	for (size_t i = 0; i < results.size (); i++) {
+		const BenchmarkResult &r = results[i];
+		ofs << (i ? ",\n" : "\n") << "    {\n";
+		ofs << "      \"shape\": \"" << Procedural::ShapeName (r.Shape) << "\", \"vertices\": " << r.Vertices << ", \"triangles\": " << r.Triangles << ", \"threads\": " << r.Threads << ",\n";
+		ofs << "      \"phases_ms\": { \"load\": " << (r.Timings.Load < 0 ? "null" : number (r.Timings.Load))
+			<< ", \"adjacency\": " << number (r.Timings.Adjacency) << ", \"kernel\": " << number (r.Timings.Kernel)
+			<< ", \"statistics\": " << number (r.Timings.Statistics) << ", \"color_mapping\": " << number (r.Timings.ColorMapping)
+			<< ", \"compute_total\": " << number (r.Timings.Compute ()) << " },\n";
+		if (r.GPUChecked)
+			ofs << "      \"gpu\": { \"kernel_ms\": " << number (r.GPUKernel) << ", \"color_mapping_ms\": " << number (r.GPUColorMapping)
+				<< ", \"max_value_error\": " << number (r.GPUValidation.MaxValueError) << ", \"max_normal_error\": " << number (r.GPUValidation.MaxNormalError)
+				<< ", \"ill_conditioned\": " << r.GPUValidation.IllConditioned
+				<< ", \"passed\": " << (r.GPUValidation.Passed () ? "true" : "false") << " },\n";
+		if (r.GridKernel >= 0)
+			ofs << "      \"grid_kernel_ms\": " << number (r.GridKernel) << ", \"grid_max_difference\": " << number (r.GridMaxDifference) << ",\n";
+		ofs << "      \"vertices_per_second\": " << number (r.Vertices/(r.Timings.Compute ()*1e-3)) << ", \"speedup\": " << number (r.Speedup) << ",\n";
+		ofs << "      \"current_rss_bytes\": " << r.CurrentRSS << ", \"peak_rss_bytes\": " << r.PeakRSS << ",\n";
+		ofs << "      \"curvature\": { \"min\": " << number (r.Stats.Min) << ", \"max\": " << number (r.Stats.Max) << ", \"mean\": " << number (r.Stats.Mean)
+			<< ", \"std_dev\": " << number (r.Stats.StdDev) << ", \"valid_vertices\": " << r.Stats.ValidVertices << " },\n";
+		if (r.Error.Available)
+			ofs << "      \"accuracy\": { \"mean_relative_error\": " << number (r.Error.MeanRelativeError) << ", \"max_relative_error\": " << number (r.Error.MaxRelativeError)
+				<< ", \"rms_relative_error\": " << number (r.Error.RMSRelativeError) << " }\n";
+		else
+			ofs << "      \"accuracy\": null\n";
+		ofs << "    }";
+	}
+	ofs << "\n  ]\n}\n";
+	LOG_INFO ("results written to {0}", path);
+}
+
+int main (int argc, char **argv)
+{
+	Log::Init (LogOverflow::Block); // results are printed, none may be dropped
+	GLCORE_PROFILE_BEGIN_SESSION ("Benchmark", "GLCoreProfile-Benchmark.json");
+	GLCORE_PROFILE_THREAD_NAME ("Main");
+
+	BenchmarkOptions options;
+	if (!ParseOptions (argc, argv, options))
+		return 1;
+
+	const std::vector<glm::vec3> blend_betweencolors = { glm::vec3 (0, 0, 1), glm::vec3 (0, 1, 0), glm::vec3 (1, 0, 0) };
+	std::vector<BenchmarkResult> results;
+
+	GLFWwindow *gpu_context = nullptr;
+	MeanCurvatureGPU gpu;
+	if (options.GPU) {
+		gpu_context = CreateHiddenContext ();
+		if (!gpu_context || !gpu.Init ()) {
+			LOG_ERROR ("--gpu: compute shaders unavailable, nothing to validate");
+			if (gpu_context) {
+				glfwDestroyWindow (gpu_context);
+				glfwTerminate ();
+			}
+			return 1;
+		}
+	}
+	uint64_t mesh_generation = 0;
+	size_t gpu_failures = 0;
+
+	for (Procedural::SHAPE shape : options.Shapes) {
+		for (size_t target_vertices : options.Sizes) {
+			if (target_vertices > options.MaxVertices)
+				continue;
+
+			JobSystem::Init (0); // generate at full width
+			auto start = clock_type::now ();
+			Procedural::Mesh mesh = Generate (shape, target_vertices);
+			LOG_INFO ("{0}: {1} vertices, {2} triangles (generated in {3:.1f}ms)", Procedural::ShapeName (shape), mesh.Vertices.size (), mesh.Indices.size ()/3, ElapsedMs (start));
+
+			const double load_ms = mesh.Vertices.size () <= options.MaxLoadVertices ? TimeLoad (mesh) : -1.0;
+			Heightfield heightfield;
+			if (shape == Procedural::SHAPE::NOISE_GRID)
+				heightfield = Procedural::NoiseHeightfield (target_vertices, NoiseGridSize, NoiseGridAmplitude);
+			double baseline_ms = 0;
+			for (size_t t = 0; t < options.Threads.size (); t++) {
+				JobSystem::Init (options.Threads[t]);
+
+				VertexRings rings;
+				std::vector<glm::vec3> normals, colors;
+				std::vector<float> values;
+				MeanCurvatureStatistics stats;
+				PhaseTimings best;
+				for (uint32_t run = 0; run < options.Repeat; run++) {
+					PhaseTimings timings;
+					auto phase_start = clock_type::now ();
+					BuildVertexRings (mesh.Vertices.size (), mesh.Indices, rings);
+					timings.Adjacency = ElapsedMs (phase_start);
+
+					phase_start = clock_type::now ();
+					MeanCurvatureKernel (mesh.Vertices, rings, normals, values);
+					timings.Kernel = ElapsedMs (phase_start);
+
+					phase_start = clock_type::now ();
+					stats = MeanCurvatureComputeStatistics (values, rings);
+					timings.Statistics = ElapsedMs (phase_start);
+
+					phase_start = clock_type::now ();
+					MeanCurvatureColorMap (values, stats.Min, stats.Max, blend_betweencolors, colors);
+					timings.ColorMapping = ElapsedMs (phase_start);
+
+					if (run == 0)
+						best = timings;
+					else
+						best.KeepFastest (timings);
+				}
+				best.Load = load_ms;
+
+				BenchmarkResult result;
+				result.Shape = shape;
+				result.Vertices = mesh.Vertices.size (), result.Triangles = mesh.Indices.size ()/3;
+				result.Threads = JobSystem::Concurrency ();
+				result.Timings = best;
+				if (t == 0)
+					baseline_ms = best.Compute ();
+				result.Speedup = baseline_ms/best.Compute ();
+				result.CurrentRSS = Memory::CurrentResidentBytes (), result.PeakRSS = Memory::PeakResidentBytes ();
+				result.Stats = stats;
+				result.Error = MeasureAccuracy (shape, mesh, values, rings);
+
+				if (options.GPU && t + 1 == options.Threads.size () && mesh.Vertices.size () <= options.MaxGPUVertices) {
+					CheckGPU (gpu, ++mesh_generation, mesh, rings, normals, values, stats.Max, blend_betweencolors, result);
+					gpu_failures += result.GPUValidation.Passed () ? 0 : 1;
+				}
+				if (!heightfield.Heights.empty ()) {
+					std::vector<glm::vec3> grid_normals;
+					std::vector<float> grid_values;
+					for (uint32_t run = 0; run < options.Repeat; run++) {
+						auto phase_start = clock_type::now ();
+						HeightfieldMeanCurvature (heightfield, grid_normals, grid_values);
+						result.GridKernel = run == 0 ? ElapsedMs (phase_start) : MIN (result.GridKernel, ElapsedMs (phase_start));
+					}
+					for (size_t v = 0; v < values.size (); v++)
+						result.GridMaxDifference = MAX (result.GridMaxDifference, double (std::abs (grid_values[v] - values[v])));
+				}
+				results.push_back (result);
+
+				LOG_INFO ("  threads {0:2}: adjacency {1:.2f}ms, kernel {2:.2f}ms, stats {3:.2f}ms, color {4:.2f}ms -> {5:.3e} vertices/s (x{6:.2f}), mean rel. error {7:.2e}"
+						  , result.Threads, best.Adjacency, best.Kernel, best.Statistics, best.ColorMapping
+						  , result.Vertices/(best.Compute ()*1e-3), result.Speedup, result.Error.MeanRelativeError);
+				if (result.GPUChecked) {
+					if (result.GPUValidation.Passed ())
+						LOG_INFO ("              gpu kernel {0:.2f}ms, color {1:.2f}ms: PASS, K_h max rel. error {2:.2e}, K(Xi) max rel. error {3:.2e} ({4} ill-conditioned)"
+								  , result.GPUKernel, result.GPUColorMapping, result.GPUValidation.MaxValueError, result.GPUValidation.MaxNormalError, result.GPUValidation.IllConditioned);
+					else LOG_ERROR ("              gpu: FAIL ({0} values compared), K_h max rel. error {1:.2e}, K(Xi) max rel. error {2:.2e} (tolerance {3})"
+									, result.GPUValidation.SizesMatch ? values.size () : size_t (0), result.GPUValidation.MaxValueError, result.GPUValidation.MaxNormalError
+									, MeanCurvatureGPUValidation::Tolerance);
+				}
+				if (result.GridKernel >= 0)
+					LOG_INFO ("              grid kernel {0:.2f}ms (x{1:.1f} against adjacency + kernel), max |K_h| difference {2:.2e}"
+							  , result.GridKernel, (best.Adjacency + best.Kernel)/result.GridKernel, result.GridMaxDifference);
+			}
+		}
+	}
+	JobSystem::Shutdown ();
+	if (gpu_context) {
+		gpu.Release (); // needs the context
+		glfwDestroyWindow (gpu_context);
+		glfwTerminate ();
+	}
+	GLCORE_PROFILE_END_SESSION ();
+
+	WriteJSON (options.OutPath, options, results);
+	if (gpu_failures > 0)
+		LOG_ERROR ("--gpu: {0} mesh(es) outside the tolerance", gpu_failures);
+	Log::Shutdown ();
+	return gpu_failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,246 @@
+﻿#include "procedural_meshes.h"
+#include <cmath>
+#include <cstdio>
+#include <array>
+#include <map>
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+#include <Utilities/utility.h>
+using namespace GLCore::Utils;
+
+namespace Procedural
+{
+	static constexpr float Pi = 3.14159265358979323846f;
+	static constexpr size_t RowsPerJob = 16;
+
+	const char *ShapeName (SHAPE shape)
+	{
+		switch (shape) {
+			case SHAPE::UV_SPHERE:  return "uv_sphere";
+			case SHAPE::ICOSPHERE:  return "icosphere";
+			case SHAPE::TORUS:      return "torus";
+			case SHAPE::NOISE_GRID: return "noise_grid";
+		}
+		return "unknown";
+	}
+	bool ShapeFromName (const std::string &name, SHAPE &out_shape)
+	{
+		for (SHAPE shape : { SHAPE::UV_SPHERE, SHAPE::ICOSPHERE, SHAPE::TORUS, SHAPE::NOISE_GRID }) {
+			if (name == ShapeName (shape)) {
+				out_shape = shape;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// quad {a, b, d, c} -> triangles {a, b, d}, {a, d, c}, same winding everywhere so every fan chains up
+	//  a---b
+	//  | \ |
+	//  c---d
+	static inline void PushQuad (GLuint *out, GLuint a, GLuint b, GLuint c, GLuint d)
+	{
+		out[0] = a, out[1] = b, out[2] = d;
+		out[3] = a, out[4] = d, out[5] = c;
+	}
+
+	Mesh UVSphere (size_t target_vertices, float radius)
+	{
+		// (rings - 1) latitude rows of 'segments' vertices + 2 poles, segments = 2*rings
+		const uint32_t rings = std::max (3u, uint32_t (std::round (std::sqrt (double (target_vertices)/2.0))));
+		const uint32_t segments = 2*rings;
+		const uint32_t rows = rings - 1;
+		const GLuint north = 0, south = rows*segments + 1;
+		auto vertex = [segments](uint32_t row, uint32_t col) -> GLuint { return 1 + row*segments + (col%segments); };
+
+		Mesh mesh;
+		mesh.Vertices.resize (size_t (rows)*segments + 2);
+		mesh.Indices.resize ((size_t (segments)*2 + size_t (rows - 1)*segments*2)*3);
+
+		mesh.Vertices[north] = { glm::vec3 (0, radius, 0), glm::vec3 (0, 1, 0) };
+		mesh.Vertices[south] = { glm::vec3 (0, -radius, 0), glm::vec3 (0, -1, 0) };
+		JobSystem::ParallelFor (rows, RowsPerJob, [&](size_t begin, size_t end) {
+			for (size_t row = begin; row < end; row++) {
+				float theta = Pi*float (row + 1)/rings;
+				for (uint32_t col = 0; col < segments; col++) {
+					float phi = 2*Pi*float (col)/segments;
+					glm::vec3 normal (sinf (theta)*cosf (phi), cosf (theta), sinf (theta)*sinf (phi));
+					mesh.Vertices[vertex (row, col)] = { normal*radius, normal };
+				}
+			}
+		});
+
+		GLuint *out = mesh.Indices.data ();
+		for (uint32_t col = 0; col < segments; col++, out += 3) // north cap
+			out[0] = north, out[1] = vertex (0, col + 1), out[2] = vertex (0, col);
+		JobSystem::ParallelFor (rows - 1, RowsPerJob, [&](size_t begin, size_t end) {
+			for (size_t row = begin; row < end; row++) {
+				GLuint *quads = out + row*segments*6;
+				for (uint32_t col = 0; col < segments; col++, quads += 6)
+					PushQuad (quads, vertex (row, col), vertex (row, col + 1), vertex (row + 1, col), vertex (row + 1, col + 1));
+			}
+		});
+		out += size_t (rows - 1)*segments*6;
+		for (uint32_t col = 0; col < segments; col++, out += 3) // south cap
+			out[0] = vertex (rows - 1, col), out[1] = vertex (rows - 1, col + 1), out[2] = south;
+		return mesh;
+	}
+
+	Mesh Icosphere (size_t target_vertices, float radius)
+	{
+		// every icosahedron face is split into f*f triangles, corner and edge vertices are shared between faces
+		const uint32_t f = std::max (1u, uint32_t (std::round (std::sqrt (std::max (0.0, double (target_vertices) - 2.0)/10.0))));
+
+		const float t = (1.0f + std::sqrt (5.0f))/2.0f;
+		const std::array<glm::vec3, 12> corners = {
+			glm::vec3 (-1, t, 0), glm::vec3 (1, t, 0), glm::vec3 (-1, -t, 0), glm::vec3 (1, -t, 0),
+			glm::vec3 (0, -1, t), glm::vec3 (0, 1, t), glm::vec3 (0, -1, -t), glm::vec3 (0, 1, -t),
+			glm::vec3 (t, 0, -1), glm::vec3 (t, 0, 1), glm::vec3 (-t, 0, -1), glm::vec3 (-t, 0, 1)
+		};
+		const std::array<std::array<uint32_t, 3>, 20> faces = { {
+			{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+			{1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+			{3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+			{4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
+		} };
+		std::map<std::pair<uint32_t, uint32_t>, uint32_t> edge_ids;
+		std::vector<std::pair<uint32_t, uint32_t>> edges;
+		for (auto &face : faces) {
+			for (uint32_t k = 0; k < 3; k++) {
+				auto key = std::minmax (face[k], face[(k + 1)%3]);
+				if (edge_ids.emplace (key, uint32_t (edges.size ())).second)
+					edges.push_back (key);
+			}
+		}
+
+		const size_t edge_base = 12, per_edge = f - 1;
+		const size_t face_base = edge_base + 30*per_edge, per_face = size_t (f - 1)*(f - 2)/2;
+		auto on_edge = [&](uint32_t from, uint32_t to, uint32_t steps_from_from) -> GLuint {
+			uint32_t k = from < to ? steps_from_from : f - steps_from_from;
+			return GLuint (edge_base + edge_ids.at (std::minmax (from, to))*per_edge + (k - 1));
+		};
+		// (i, j) steps along a->b and a->c of face
+		auto face_vertex = [&](uint32_t face, uint32_t i, uint32_t j) -> GLuint {
+			const auto &abc = faces[face];
+			if (i == 0 && j == 0) return abc[0];
+			if (j == 0 && i == f) return abc[1];
+			if (i == 0 && j == f) return abc[2];
+			if (j == 0)     return on_edge (abc[0], abc[1], i);
+			if (i == 0)     return on_edge (abc[0], abc[2], j);
+			if (i + j == f) return on_edge (abc[1], abc[2], j);
+			size_t row_start = size_t (j - 1)*(f - 1) - size_t (j - 1)*j/2;
+			return GLuint (face_base + face*per_face + row_start + (i - 1));
+		};
+		auto place = [radius](glm::vec3 position) -> std::pair<glm::vec3, glm::vec3> {
+			glm::vec3 normal = glm::normalize (position);
+			return { normal*radius, normal };
+		};
+
+		Mesh mesh;
+		mesh.Vertices.resize (size_t (10)*f*f + 2);
+		mesh.Indices.resize (size_t (20)*f*f*3);
+		for (uint32_t c = 0; c < 12; c++)
+			mesh.Vertices[c] = place (corners[c]);
+		for (uint32_t e = 0; e < 30; e++)
+			for (uint32_t k = 1; k < f; k++)
+				mesh.Vertices[edge_base + e*per_edge + (k - 1)] = place (glm::mix (corners[edges[e].first], corners[edges[e].second], float (k)/f));
+
+		JobSystem::ParallelFor (20, 1, [&](size_t begin, size_t end) {
+			for (uint32_t face = uint32_t (begin); face < end; face++) {
+				const glm::vec3 a = corners[faces[face][0]], b = corners[faces[face][1]], c = corners[faces[face][2]];
+				for (uint32_t j = 1; j + 1 < f; j++)
+					for (uint32_t i = 1; i + j < f; i++)
+						mesh.Vertices[face_vertex (face, i, j)] = place (a + (b - a)*(float (i)/f) + (c - a)*(float (j)/f));
+
+				GLuint *out = mesh.Indices.data () + size_t (face)*f*f*3;
+				for (uint32_t j = 0; j < f; j++) {
+					for (uint32_t i = 0; i + j < f; i++) {
+						out[0] = face_vertex (face, i, j), out[1] = face_vertex (face, i + 1, j), out[2] = face_vertex (face, i, j + 1);
+						out += 3;
+						if (i + j + 1 < f) {
+							out[0] = face_vertex (face, i + 1, j), out[1] = face_vertex (face, i + 1, j + 1), out[2] = face_vertex (face, i, j + 1);
+							out += 3;
+						}
+					}
+				}
+			}
+		});
+		return mesh;
+	}
+
+	Mesh Torus (size_t target_vertices, float major_radius, float minor_radius)
+	{
+		// major_segments around Y, minor_segments around the tube, both wrap
+		const uint32_t minor_segments = std::max (3u, uint32_t (std::round (std::sqrt (double (target_vertices)/2.0))));
+		const uint32_t major_segments = 2*minor_segments;
+		auto vertex = [=](uint32_t major, uint32_t minor) -> GLuint { return (minor%minor_segments)*major_segments + (major%major_segments); };
+
+		Mesh mesh;
+		mesh.Vertices.resize (size_t (major_segments)*minor_segments);
+		mesh.Indices.resize (size_t (major_segments)*minor_segments*6);
+		JobSystem::ParallelFor (minor_segments, RowsPerJob, [&](size_t begin, size_t end) {
+			for (uint32_t minor = uint32_t (begin); minor < end; minor++) {
+				float theta = 2*Pi*float (minor)/minor_segments;
+				GLuint *quads = mesh.Indices.data () + size_t (minor)*major_segments*6;
+				for (uint32_t major = 0; major < major_segments; major++, quads += 6) {
+					float phi = 2*Pi*float (major)/major_segments;
+					glm::vec3 normal (cosf (theta)*cosf (phi), sinf (theta), cosf (theta)*sinf (phi));
+					glm::vec3 center (major_radius*cosf (phi), 0, major_radius*sinf (phi));
+					mesh.Vertices[vertex (major, minor)] = { center + normal*minor_radius, normal };
+					PushQuad (quads, vertex (major, minor), vertex (major + 1, minor), vertex (major, minor + 1), vertex (major + 1, minor + 1));
+				}
+			}
+		});
+		return mesh;
+	}
+
+	Heightfield NoiseHeightfield (size_t target_vertices, float size, float amplitude)
+	{
+		const uint32_t n = std::max (2u, uint32_t (std::round (std::sqrt (double (target_vertices)))));
+		const float spacing = size/(n - 1);
+		Helper::Noise::NoiseSettings noise;
+		noise.Type = Helper::Noise::NOISE_TYP::FRACTAL_BROWNIM_MOTION;
+		// same features at every resolution, so timings of different sizes compare the same surface
+		noise.Freq = 4.0f/(n*spacing);
+		noise.Lac = 2.0f, noise.Gain = 0.5f, noise.Octaves = 5;
+		// Snoise2 is un-scaled simplex (~[-1/40, 1/40])
+		return HeightfieldFromNoise (noise, n, n, spacing, amplitude*40.0f);
+	}
+
+	Mesh NoiseGrid (size_t target_vertices, float size, float amplitude)
+	{
+		Mesh mesh;
+		HeightfieldToMesh (NoiseHeightfield (target_vertices, size, amplitude), mesh.Vertices, &mesh.Indices);
+		return mesh;
+	}
+
+	float SphereMeanCurvature (float radius)
+	{
+		return 1.0f/radius;
+	}
+	float TorusMeanCurvature (glm::vec3 position, float major_radius, float minor_radius)
+	{
+		// H = (R + 2r cos(theta)) / (2r (R + r cos(theta))), theta measured around the tube from it's outer equator
+		glm::vec2 radial = glm::vec2 (position.x, position.z);
+		float cos_theta = (glm::length (radial) - major_radius)/minor_radius;
+		return (major_radius + 2*minor_radius*cos_theta)/(2*minor_radius*(major_radius + minor_radius*cos_theta));
+	}
+
+	bool WriteOBJ (const char *path, const Mesh &mesh)
+	{
+		FILE *file = fopen (path, "w");
+		if (file == NULL)
+			return false;
+		for (auto &[position, normal] : mesh.Vertices)
+			fprintf (file, "v %f %f %f\n", position.x, position.y, position.z);
+		fprintf (file, "vt 0.000000 0.000000\n");
+		for (auto &[position, normal] : mesh.Vertices)
+			fprintf (file, "vn %f %f %f\n", normal.x, normal.y, normal.z);
+		for (size_t i = 0; i + 2 < mesh.Indices.size (); i += 3) {
+			GLuint a = mesh.Indices[i] + 1, b = mesh.Indices[i + 1] + 1, c = mesh.Indices[i + 2] + 1;
+			fprintf (file, "f %u/1/%u %u/1/%u %u/1/%u\n", a, a, b, b, c, c);
+		}
+		fclose (file);
+		return true;
+	}
+}
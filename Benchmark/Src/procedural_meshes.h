@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+#include "heightfield.h"
+
+// Closed form test surfaces, vertices are shared (no seams) so one-rings are complete everywhere except grid borders
+namespace Procedural
+{
+	enum class SHAPE
+	{
+		UV_SPHERE = 0,
+		ICOSPHERE,
+		TORUS,
+		NOISE_GRID
+	};
+	const char *ShapeName (SHAPE shape);
+	bool ShapeFromName (const std::string &name, SHAPE &out_shape);
+
+	struct Mesh
+	{
+		std::vector<std::pair<glm::vec3, glm::vec3>> Vertices; // {vertex_position, vertex_normal}, same as MainLayer
+		std::vector<GLuint> Indices;
+	};
+
+	// Every generator gets as close to target_vertices as it's topology allows
+	Mesh UVSphere  (size_t target_vertices, float radius);
+	Mesh Icosphere (size_t target_vertices, float radius); // geodesic, 10*f^2 + 2 vertices
+	Mesh Torus     (size_t target_vertices, float major_radius, float minor_radius); // around Y axis
+	Mesh NoiseGrid (size_t target_vertices, float size, float amplitude); // XZ plane displaced along Y by Fbm2
+	Heightfield NoiseHeightfield (size_t target_vertices, float size, float amplitude); // NoiseGrid before it's turned into a mesh
+
+	// Analytic mean curvature H (the kernel's K_h = |K(Xi)|/2 should converge to |H|)
+	float SphereMeanCurvature (float radius);
+	float TorusMeanCurvature  (glm::vec3 position, float major_radius, float minor_radius);
+
+	bool WriteOBJ (const char *path, const Mesh &mesh); // in the only format ASSET_LOADER::LoadOBJ_meshOnly accepts
+}
@@ -0,0 +1,56 @@
+-- Benchmark
+project "Benchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++17"
+	staticruntime "on"
+
+	targetdir ("../builds/bin/" .. outputdir .. "/%{prj.name}")
+	objdir ("../builds/bin-int/" .. outputdir .. "/%{prj.name}")
+
+	files
+	{
+		"src/**.h",
+		"src/**.cpp",
+		-- the pipeline under test, shared with Sandbox
+		"../Sandbox/src/mean_curvature.h",
+		"../Sandbox/src/mean_curvature.cpp",
+		"../Sandbox/src/mean_curvature_gpu.h", -- --gpu
+		"../Sandbox/src/mean_curvature_gpu.cpp",
+		"../Sandbox/src/heightfield.h",
+		"../Sandbox/src/heightfield.cpp",
+		"../Sandbox/src/Utilities/**.h",
+		"../Sandbox/src/Utilities/**.cpp"
+	}
+    
+	includedirs
+	{
+        "../%{IncludeDir.ImGui}",
+        "../%{IncludeDir.GLM}",
+        "../%{IncludeDir.spdlog}",
+        "../%{IncludeDir.Glad}",
+        "../%{IncludeDir.Glad}/khr",
+        "../%{IncludeDir.GLFW}",
+        "../OpenGL-Laboratory/src",
+        "../Sandbox/Src",
+        "./Src",
+        "../~vendor"
+	}
+
+	links
+	{
+		"OpenGL-Laboratory"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "configurations:Debug"
+		defines "MODE_DEBUG"
+		runtime "Debug"
+		symbols "on"
+
+	filter "configurations:Release"
+		defines "MODE_RELEASE"
+		runtime "Release"
+        optimize "on"
@@ -8,5 +8,6 @@
 #include <glm/glm/gtc/matrix_transform.hpp>
 #include <imgui/imgui.h>
 
+#include "GLCore/Debug/Instrumentor.h"
 #include "GLCore/Core/Application.h"
 #include "GLCore/Core/TestBase.h"
\ No newline at end of file
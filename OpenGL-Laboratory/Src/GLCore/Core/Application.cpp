@@ -2,6 +2,9 @@
 #include "Application.h"
 #include "Log.h"
 #include "Input.h"
+#include "GLCore/Util/JobSystem.h"
+#include "GLCore/Util/ShaderCompiler.h"
+#include "imgui/imgui.h"
 
 #include <glfw/glfw3.h>
 
@@ -22,17 +25,43 @@ namespace GLCore {
 		{
 			// Initialize core
 			Log::Init();
+			GLCORE_PROFILE_BEGIN_SESSION ("Runtime", "GLCoreProfile-Runtime.json");
+			GLCORE_PROFILE_THREAD_NAME ("Main");
+			Utils::JobSystem::Init ();
 		}
 
 		LOG_ASSERT(!s_Instance, "Application already exists!");
 		s_Instance = this;
 
 		m_Window = std::unique_ptr<Window>(Window::Create({ name, width, height }));
-		m_Window->SetEventCallback(BIND_EVENT_FN(OnEvent));
+		m_Window->SetEventCallback([this](Event &e) {
+			if (!m_EventBus.Post (e))
+				OnEvent (e);
+		});
+
+		// shader builds get a worker with its own context, unless the driver compiles in parallel by itself
+		m_ShaderContext = m_Window->CreateSharedContext ();
+		std::function<void(bool)> bind_shader_context;
+		if (m_ShaderContext)
+			bind_shader_context = [this](bool bind) { m_Window->MakeContextCurrent (bind ? m_ShaderContext : nullptr); };
+		Utils::ShaderCompiler::Init ((void *(*)(const char *))glfwGetProcAddress, bind_shader_context);
+		if (Utils::ShaderCompiler::HasParallelCompile ()) {
+			m_Window->DestroySharedContext (m_ShaderContext);
+			m_ShaderContext = nullptr;
+		}
 
 		m_ImGuiLayer.OnAttach ();
 	}
 
+	Application::~Application ()
+	{
+		Utils::ShaderCompiler::Shutdown ();
+		m_Window->DestroySharedContext (m_ShaderContext);
+		Utils::JobSystem::Shutdown ();
+		GLCORE_PROFILE_END_SESSION ();
+		Log::Shutdown ();
+	}
+
 	void Application::OnEvent(Event &e)
 	{
 		EventDispatcher dispatcher(e);
@@ -45,24 +74,50 @@ namespace GLCore {
 
 	void Application::Run ()
 	{
+		GLCORE_PROFILE_FUNCTION ();
 		while (m_Running)
 		{
+			GLCORE_PROFILE_SCOPE ("RunLoop");
 			// TODO: Handle Minimizing, Handle Framebuffer accordingly
 
 			float time = GetTimeInSeconds ();
 			Timestep timestep = time - m_LastFrameTime;
 			m_LastFrameTime = time;
 
-			m_TestsManager.UpdateActiveLayers (timestep);
-
-			m_ImGuiLayer.Begin();
-			m_TestsManager.ImGuiRender ();
-			m_ImGuiLayer.End();
-
-			m_Window->OnUpdate();
+			if (m_EventBus.Queued () || m_FrameRequested.exchange (false))
+				m_ActiveFrames = SettleFrames;
+			m_EventBus.Dispatch (BIND_EVENT_FN(OnEvent));
+			// idle layers keep the image they rendered last, unless they asked to be redrawn
+			m_TestsManager.UpdateActiveLayers (timestep, !m_OnDemand || m_ActiveFrames > 0);
+
+			{
+				GLCORE_PROFILE_SCOPE ("ImGuiLayer Begin/End");
+				m_ImGuiLayer.Begin();
+				m_TestsManager.ImGuiRender ();
+				if (ImGui::IsAnyItemActive ())
+					m_ActiveFrames = SettleFrames;
+				m_ImGuiLayer.End();
+			}
+			{
+				GLCORE_PROFILE_SCOPE ("Window::OnUpdate");
+				m_Window->OnUpdate();
+			}
+
+			if (m_ActiveFrames > 0)
+				m_ActiveFrames--;
+			if (m_OnDemand && m_ActiveFrames == 0 && !m_EventBus.Queued () && !m_FrameRequested && !m_TestsManager.RedrawRequested ()) {
+				GLCORE_PROFILE_SCOPE ("Idle");
+				m_Window->WaitEvents (IdleTimeout);
+			}
 		}
 	}
 
+	void Application::RequestFrame ()
+	{
+		m_FrameRequested = true;
+		m_Window->Wake ();
+	}
+
 	bool Application::OnWindowClose (WindowCloseEvent &e)
 	{
 		return ApplicationClose ();
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "Core.h"
+#include <atomic>
 
 #include "Window.h"
 #include "../Events/Event.h"
 #include "../Events/ApplicationEvent.h"
+#include "../Events/EventBus.h"
 
 #include "Timestep.h"
 
@@ -17,7 +19,7 @@ namespace GLCore {
 	{
 	public:
 		Application(const std::string& name = "OpenGL Sandbox", uint32_t width = 1280, uint32_t height = 720);
-		virtual ~Application() = default;
+		virtual ~Application();
 
 		static float GetTimeInSeconds ();
 		void Run();
@@ -33,12 +35,21 @@ namespace GLCore {
 
 		inline Window& GetWindow() { return *m_Window; }
 
+		// On-demand: once nothing changed for a few frames the loop sleeps in WaitEvents and layers keep their last image,
+		// any input, ImGui interaction or RequestFrame brings it back
+		void SetOnDemandRendering (bool enabled) { m_OnDemand = enabled; }
+		bool IsOnDemandRendering () const { return m_OnDemand; }
+		// Wakes the loop for at least one more frame, callable from any thread (background jobs finishing, etc.)
+		void RequestFrame ();
+
 		inline static Application& Get() { return *s_Instance; }
 	private:
 		bool OnWindowClose(WindowCloseEvent &e);
 		friend class ImGuiLayer;
 	private:
 		std::unique_ptr<Window> m_Window;
+		EventBus m_EventBus; // window events wait here for the next frame
+		void* m_ShaderContext = nullptr; // shared with the window's, owned by the ShaderCompiler worker
 
 		// Layer's
 		ImGuiLayer m_ImGuiLayer;
@@ -46,6 +57,12 @@ namespace GLCore {
 
 		bool m_Running = true;
 		float m_LastFrameTime = 0.0f;
+
+		bool m_OnDemand = true;
+		uint32_t m_ActiveFrames = 0; // frames still to run since the last activity, ImGui needs a couple to settle hover/animations
+		std::atomic<bool> m_FrameRequested{ false };
+		static constexpr uint32_t SettleFrames = 3;
+		static constexpr double IdleTimeout = 0.5; // seconds, ImGui still gets the odd frame while idle
 	private:
 		static Application* s_Instance;
 	};
@@ -1,16 +1,37 @@
 #include "pch.h"
 #include "Log.h"
 
+#include "spdlog/async.h"
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 namespace GLCore {
 
 	std::shared_ptr<spdlog::logger> Log::s_Logger;
+	static const char* s_Pattern = "%^[%T] %n: %v%$";
 
-	void Log::Init()
+	void Log::Init(LogOverflow overflow, size_t queue_size)
 	{
-		spdlog::set_pattern("%^[%T] %n: %v%$");
-		s_Logger = spdlog::stdout_color_mt("GLCORE");
+		if (spdlog::thread_pool()) // already running
+			return;
+		spdlog::init_thread_pool(queue_size, 1);
+		auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+		s_Logger = std::make_shared<spdlog::async_logger>("GLCORE", sink, spdlog::thread_pool()
+			, overflow == LogOverflow::Block ? spdlog::async_overflow_policy::block : spdlog::async_overflow_policy::overrun_oldest);
+		s_Logger->set_pattern(s_Pattern);
+		s_Logger->set_level(spdlog::level::trace);
+		spdlog::register_logger(s_Logger);
+	}
+
+	void Log::Shutdown()
+	{
+		if (!s_Logger)
+			return;
+		std::vector<spdlog::sink_ptr> sinks = s_Logger->sinks();
+		spdlog::shutdown(); // writes out the queue, joins the backend thread
+
+		// whatever still logs during teardown (layer destructors, etc.) goes out synchronously
+		s_Logger = std::make_shared<spdlog::logger>("GLCORE", sinks.begin(), sinks.end());
+		s_Logger->set_pattern(s_Pattern);
 		s_Logger->set_level(spdlog::level::trace);
 	}
 
@@ -7,26 +7,113 @@
 #include <spdlog/fmt/ostr.h>
 #pragma warning(pop)
 
+#include <atomic>
+#include <chrono>
+
+// Calls below this level compile to nothing (arguments aren't evaluated either), one of spdlog's SPDLOG_LEVEL_*.
+// Can be overridden per project (defines "GLCORE_LOG_MIN_LEVEL=SPDLOG_LEVEL_WARN").
+#ifndef GLCORE_LOG_MIN_LEVEL
+	#ifdef MODE_DEBUG
+		#define GLCORE_LOG_MIN_LEVEL SPDLOG_LEVEL_TRACE
+	#else
+		#define GLCORE_LOG_MIN_LEVEL SPDLOG_LEVEL_INFO
+	#endif
+#endif
+
 namespace GLCore {
 
+	// What a full log queue does to the thread logging
+	enum class LogOverflow
+	{
+		Block,     // waits for the backend, nothing is lost
+		DropOldest // never waits, the oldest queued message is overwritten
+	};
+
+	// Asynchronous: calls only format and queue the message, one backend thread writes to the console.
 	class Log
 	{
 	public:
-		static void Init();
+		static void Init(LogOverflow overflow = LogOverflow::DropOldest, size_t queue_size = 8192);
+		// Writes out what's still queued and stops the backend thread
+		static void Shutdown();
 
 		inline static std::shared_ptr<spdlog::logger>& GetLogger() { return s_Logger; }
 	private:
 		static std::shared_ptr<spdlog::logger> s_Logger;
 	};
 
+	// One per call site (see LOG_WARN_LIMITED): lets a message through at most every 'interval', counts the rest
+	class LogRateLimiter
+	{
+	public:
+		LogRateLimiter(std::chrono::milliseconds interval)
+			: m_Interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval).count())
+		{}
+
+		// true: log now, out_suppressed = calls swallowed since the last one that got through
+		bool Allow(uint32_t& out_suppressed)
+		{
+			const int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+			int64_t next = m_NextAllowed.load(std::memory_order_relaxed);
+			if (now < next || !m_NextAllowed.compare_exchange_strong(next, now + m_Interval, std::memory_order_relaxed)) {
+				m_Suppressed.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			out_suppressed = m_Suppressed.exchange(0, std::memory_order_relaxed);
+			return true;
+		}
+	private:
+		const int64_t m_Interval;
+		std::atomic<int64_t> m_NextAllowed{ 0 };
+		std::atomic<uint32_t> m_Suppressed{ 0 };
+	};
+
 }
 
+#define LOG_INTERNAL_LIMITED(level, interval_ms, ...) do { \
+		static ::GLCore::LogRateLimiter log_rate_limiter_(std::chrono::milliseconds(interval_ms)); \
+		uint32_t log_suppressed_ = 0; \
+		if (log_rate_limiter_.Allow(log_suppressed_)) { \
+			if (log_suppressed_) \
+				::GLCore::Log::GetLogger()->log(level, "{0} ({1} more suppressed)", fmt::format(__VA_ARGS__), log_suppressed_); \
+			else \
+				::GLCore::Log::GetLogger()->log(level, __VA_ARGS__); \
+		} \
+	} while (0)
+
 // Client log macros
-#define LOG_TRACE(...)         ::GLCore::Log::GetLogger()->trace(__VA_ARGS__)
-#define LOG_INFO(...)          ::GLCore::Log::GetLogger()->info(__VA_ARGS__)
-#define LOG_WARN(...)          ::GLCore::Log::GetLogger()->warn(__VA_ARGS__)
-#define LOG_ERROR(...)         ::GLCore::Log::GetLogger()->error(__VA_ARGS__)
-#define LOG_CRITICAL(...)      ::GLCore::Log::GetLogger()->critical(__VA_ARGS__)
+// *_LIMITED: for lines that can fire per element (parallel loops) or per frame, at most one message per 'interval_ms'
+// from that line, the next one that gets through tells how many were suppressed in between
+//   LOG_WARN_LIMITED (1000, "vertex {0} has an empty ring", i);
+#if GLCORE_LOG_MIN_LEVEL <= SPDLOG_LEVEL_TRACE
+	#define LOG_TRACE(...)                      ::GLCore::Log::GetLogger()->trace(__VA_ARGS__)
+	#define LOG_TRACE_LIMITED(interval_ms, ...) LOG_INTERNAL_LIMITED(::spdlog::level::trace, interval_ms, __VA_ARGS__)
+#else
+	#define LOG_TRACE(...)                      (void)0
+	#define LOG_TRACE_LIMITED(interval_ms, ...) (void)0
+#endif
+#if GLCORE_LOG_MIN_LEVEL <= SPDLOG_LEVEL_INFO
+	#define LOG_INFO(...)                       ::GLCore::Log::GetLogger()->info(__VA_ARGS__)
+	#define LOG_INFO_LIMITED(interval_ms, ...)  LOG_INTERNAL_LIMITED(::spdlog::level::info, interval_ms, __VA_ARGS__)
+#else
+	#define LOG_INFO(...)                       (void)0
+	#define LOG_INFO_LIMITED(interval_ms, ...)  (void)0
+#endif
+#if GLCORE_LOG_MIN_LEVEL <= SPDLOG_LEVEL_WARN
+	#define LOG_WARN(...)                       ::GLCore::Log::GetLogger()->warn(__VA_ARGS__)
+	#define LOG_WARN_LIMITED(interval_ms, ...)  LOG_INTERNAL_LIMITED(::spdlog::level::warn, interval_ms, __VA_ARGS__)
+#else
+	#define LOG_WARN(...)                       (void)0
+	#define LOG_WARN_LIMITED(interval_ms, ...)  (void)0
+#endif
+#if GLCORE_LOG_MIN_LEVEL <= SPDLOG_LEVEL_ERROR
+	#define LOG_ERROR(...)                      ::GLCore::Log::GetLogger()->error(__VA_ARGS__)
+	#define LOG_ERROR_LIMITED(interval_ms, ...) LOG_INTERNAL_LIMITED(::spdlog::level::err, interval_ms, __VA_ARGS__)
+#else
+	#define LOG_ERROR(...)                      (void)0
+	#define LOG_ERROR_LIMITED(interval_ms, ...) (void)0
+#endif
+#define LOG_CRITICAL(...)                       ::GLCore::Log::GetLogger()->critical(__VA_ARGS__)
 
 
 #include <filesystem>
@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "PerformancePanel.h"
+#include "GLCore/Core/TestBase.h"
+#include "GLCore/Util/PlatformUtils.h"
+
+#include "imgui/imgui.h"
+
+namespace GLCore
+{
+	void PerformancePanel::PushFrame (Timestep frame_time)
+	{
+		m_MemorySampleAge += frame_time.GetSeconds ();
+		if (m_Paused)
+			return;
+		m_FrameTimes[m_FrameHead] = frame_time.GetMilliseconds ();
+		m_FrameHead = (m_FrameHead + 1)%HistorySize;
+		m_FrameCount = std::min (m_FrameCount + 1, HistorySize);
+	}
+
+	void PerformancePanel::OnImGuiRender (TestBase *const *active_tests, uint32_t max_tests, bool *p_open)
+	{
+		if (m_MemorySampleAge > 0.25f) {
+			m_WorkingSet = Utils::Memory::CurrentResidentBytes ();
+			m_PeakWorkingSet = Utils::Memory::PeakResidentBytes ();
+			m_PrivateBytes = Utils::Memory::PrivateBytes ();
+			m_MemorySampleAge = 0;
+		}
+
+		ImGui::Begin ("Performance", p_open);
+
+		{ // frame times
+			std::array<float, HistorySize> sorted;
+			std::copy_n (m_FrameTimes.begin (), m_FrameCount, sorted.begin ());
+			auto percentile = [&](float p) -> float {
+				if (m_FrameCount == 0)
+					return 0;
+				auto nth = sorted.begin () + std::min<uint32_t> (uint32_t (p*m_FrameCount), m_FrameCount - 1);
+				std::nth_element (sorted.begin (), nth, sorted.begin () + m_FrameCount);
+				return *nth;
+			};
+			float sum = 0, max = 0;
+			for (uint32_t i = 0; i < m_FrameCount; i++)
+				sum += m_FrameTimes[i], max = std::max (max, m_FrameTimes[i]);
+			const float average = m_FrameCount ? sum/m_FrameCount : 0;
+			const float p50 = percentile (0.50f), p95 = percentile (0.95f), p99 = percentile (0.99f);
+
+			ImGui::Text ("%.1f FPS, %.3f ms/frame (avg of %u)", average > 0 ? 1000.0f/average : 0.0f, average, m_FrameCount);
+			ImGui::Text ("p50 %.3f  p95 %.3f  p99 %.3f  max %.3f ms", p50, p95, p99, max);
+
+			char overlay[32];
+			snprintf (overlay, sizeof (overlay), "p95 %.2f ms", p95);
+			const int offset = m_FrameCount == HistorySize ? int (m_FrameHead) : 0; // oldest sample
+			ImGui::PlotLines ("##FrameTimes", m_FrameTimes.data (), int (m_FrameCount), offset, overlay, 0.0f, std::max (max*1.1f, 1.0f), ImVec2 (-1, 80));
+			ImGui::Checkbox ("Pause history", &m_Paused);
+		}
+		ImGui::Text ("ImGui build: %.3f ms", m_ImGuiBuildMs);
+
+		ImGui::Separator ();
+		constexpr double MB = 1024.0*1024.0;
+		ImGui::Text ("Working set: %.1f MB (peak %.1f MB)", m_WorkingSet/MB, m_PeakWorkingSet/MB);
+		ImGui::Text ("Private bytes: %.1f MB", m_PrivateBytes/MB);
+
+		for (uint32_t i = 0; i < max_tests && active_tests[i]; i++) {
+			const TestBase *test = active_tests[i];
+			const LayerPerformanceData &data = test->m_PerformanceData;
+			ImGui::PushID (i);
+			if (ImGui::CollapsingHeader (test->GetName ().c_str (), ImGuiTreeNodeFlags_DefaultOpen)) {
+				ImGui::Text ("OnUpdate: %.3f ms, OnImGuiRender: %.3f ms", data.UpdateMs, data.ImGuiMs);
+				ImGui::Text ("OnSimulate: %.3f ms", data.SimulateMs);
+				for (const auto &counter : data.Counters) {
+					ImGui::TextUnformatted (counter.Name.c_str ());
+					ImGui::SameLine (ImGui::GetContentRegionAvail ().x*0.5f);
+					ImGui::Text (counter.Format, counter.Value);
+				}
+				if (!data.LastJobPhases.empty ()) {
+					double total = 0;
+					for (const auto &phase : data.LastJobPhases)
+						total += phase.Milliseconds;
+					ImGui::Text ("Last %s: %.3f ms", data.LastJobName.c_str (), total);
+					if (ImGui::BeginTable ("##Phases", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+						for (const auto &phase : data.LastJobPhases) {
+							ImGui::TableNextRow ();
+							ImGui::TableNextColumn (); ImGui::TextUnformatted (phase.Name.c_str ());
+							ImGui::TableNextColumn (); ImGui::Text ("%.3f ms", phase.Milliseconds);
+							ImGui::TableNextColumn (); ImGui::ProgressBar (total > 0 ? float (phase.Milliseconds/total) : 0.0f, ImVec2 (-1, 0));
+						}
+						ImGui::EndTable ();
+					}
+				}
+			}
+			ImGui::PopID ();
+		}
+		ImGui::End ();
+	}
+}
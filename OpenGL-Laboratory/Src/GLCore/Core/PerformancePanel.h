@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include "Timestep.h"
+
+namespace GLCore
+{
+	class TestBase;
+
+	// What the Performance panel shows per layer, timings are filled in by TestsLayerManager, counters/jobs by the layer itself
+	struct LayerPerformanceData
+	{
+		struct Counter
+		{
+			std::string Name;
+			double Value;
+			const char *Format; // printf style, must be a literal
+		};
+		struct Phase
+		{
+			std::string Name;
+			double Milliseconds;
+		};
+
+		float UpdateMs = 0, ImGuiMs = 0; // CPU time of the last OnUpdate/OnImGuiRender
+		float SimulateMs = 0; // last OnSimulate, worker or main thread
+		std::vector<Counter> Counters;  // in registration order
+		std::string LastJobName;
+		std::vector<Phase> LastJobPhases;
+	};
+
+	class PerformancePanel
+	{
+	public:
+		static constexpr uint32_t HistorySize = 512;
+
+		void PushFrame (Timestep frame_time);
+		void SetImGuiBuildTime (float milliseconds) { m_ImGuiBuildMs = milliseconds; }
+
+		void OnImGuiRender (TestBase *const *active_tests, uint32_t max_tests, bool *p_open);
+	private:
+		std::array<float, HistorySize> m_FrameTimes = {}; // ms, ring buffer
+		uint32_t m_FrameHead = 0, m_FrameCount = 0;
+		float m_ImGuiBuildMs = 0;
+		bool m_Paused = false;
+
+		// process memory is sampled a few times a second, not every frame
+		float m_MemorySampleAge = 1e9f;
+		size_t m_WorkingSet = 0, m_PeakWorkingSet = 0, m_PrivateBytes = 0;
+	};
+}
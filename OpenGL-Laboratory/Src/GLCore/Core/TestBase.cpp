@@ -3,6 +3,7 @@
 #include "GLCore/Events/MouseEvent.h"
 #include "GLCore/Events/KeyEvent.h"
 #include "GLCore/Events/LayerEvent.h"
+#include "GLCore/Core/Application.h"
 
 namespace GLCore
 {
@@ -34,8 +35,15 @@ namespace GLCore
 		}
 	}
 
+	void TestBase::RequestRedraw ()
+	{
+		m_RedrawRequested = true;
+		Application::Get ().RequestFrame ();
+	}
+
 	void TestBase::FilteredEvent (Event &event)
 	{
+		m_RedrawRequested = true;
 		bool event_dispatched = false;
 		EventDispatcher dispatcher (event);
 		// Input
@@ -74,6 +82,25 @@ namespace GLCore
 		}
 	}
 
+	void TestBase::SetPerformanceCounter (const std::string &name, double value, const char *format)
+	{
+		for (auto &counter : m_PerformanceData.Counters) {
+			if (counter.Name == name) {
+				counter.Value = value, counter.Format = format;
+				return;
+			}
+		}
+		m_PerformanceData.Counters.push_back ({ name, value, format });
+	}
+
+	void TestBase::SetLastJobTimings (const std::string &job_name, std::initializer_list<std::pair<const char *, double>> phases_ms)
+	{
+		m_PerformanceData.LastJobName = job_name;
+		m_PerformanceData.LastJobPhases.clear ();
+		for (auto &[phase, milliseconds] : phases_ms)
+			m_PerformanceData.LastJobPhases.push_back ({ phase, milliseconds });
+	}
+
 	bool TestBase::This_ViewportSize (float x, float y)
 	{
 		if (m_ViewPortSize.x != x || m_ViewPortSize.y != y)
@@ -82,6 +109,7 @@ namespace GLCore
 			
 			LayerViewportResizeEvent event (x, y);
 			OnEvent (event);
+			m_RedrawRequested = true;
 			m_ViewPortSize.x = x, m_ViewPortSize.y = y;
 			return true;
 		}
@@ -1,7 +1,9 @@
 ﻿#pragma once
 #include "GLCore/Core/Layer.h"
 #include <glm/glm.hpp>
+#include <atomic>
 #include "GLCore/Events/LayerEvent.h"
+#include "GLCore/Core/PerformancePanel.h"
 
 namespace GLCore
 {
@@ -14,6 +16,10 @@ namespace GLCore
 		virtual ~TestBase () = default;
 
 		virtual void ImGuiMenuOptions() {}
+		// CPU only part of the frame, runs on a JobSystem worker alongside the other active tests, or on the main thread
+		// when no worker got to it by the time its OnUpdate is due. No GL calls in here: GL work goes into OnUpdate,
+		// which runs once this returned and may use whatever it produced.
+		virtual void OnSimulate (Timestep ts) {}
 
 		const std::string &GetDiscription () { return m_TestDiscription; }
 	protected:
@@ -31,11 +37,19 @@ namespace GLCore
 		constexpr float This_ViewportAspectRatio () { return m_ViewPortSize.x/m_ViewPortSize.y; }
 		// Relative to window
 		constexpr glm::vec2 This_ViewportPosition () { return m_ViewportPosnRelativeToMain; };
+
+		// Shown under this layer in the Performance panel, a counter keeps it's first registration's position
+		void SetPerformanceCounter (const std::string &name, double value, const char *format = "%.3f");
+		void SetLastJobTimings (const std::string &job_name, std::initializer_list<std::pair<const char *, double>> phases_ms);
+
+		// Another frame for this test even when the app is idle (on-demand rendering), callable from any thread
+		void RequestRedraw ();
 	private:
 		void FlagSetter (Flags, bool);
 		void FilteredEvent (Event &event);
 		bool This_ViewportSize (float x, float y);
 		friend class TestsLayerManager;
+		friend class PerformancePanel;
 	private:
 		static glm::vec2 s_MainViewportPosn;
 	private:
@@ -47,5 +61,8 @@ namespace GLCore
 
 		glm::vec2 m_ViewportPosnRelativeToMain = { 0,0 };
 		std::string m_TestDiscription;
+
+		LayerPerformanceData m_PerformanceData;
+		std::atomic<bool> m_RedrawRequested{ true };
 	};
 }
\ No newline at end of file
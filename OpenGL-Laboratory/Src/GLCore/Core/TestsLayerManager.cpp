@@ -4,11 +4,20 @@
 #include "TestsLayerManager.h"
 
 #include "GLCore/Core/Application.h"
+#include "GLCore/Util/JobSystem.h"
 #include "imgui/imgui.h"
 #include "imgui/imgui_internal.h"
 
+#include <chrono>
+
 namespace GLCore
 {
+	using timer_clock = std::chrono::steady_clock;
+	static float MillisecondsSince (timer_clock::time_point start)
+	{
+		return std::chrono::duration<float, std::milli> (timer_clock::now () - start).count ();
+	}
+
 	TestsLayerManager::~TestsLayerManager ()
 	{
 		for (uint16_t i = 0; i < g_MaxNumOfAllowedTests; i++) {
@@ -40,24 +49,70 @@ namespace GLCore
 		m_AllTests.emplace_back (test);
 	}
 
-	void TestsLayerManager::UpdateActiveLayers (Timestep deltatime)
+	void TestsLayerManager::UpdateActiveLayers (Timestep deltatime, bool redraw_all)
 	{
+		GLCORE_PROFILE_FUNCTION ();
+		m_PerformancePanel.PushFrame (deltatime);
+
+		// CPU side of every active test at once, GL stays on this thread (it owns the context, ImGui's platform windows too).
+		// Whoever claims a simulation first runs it: a free worker, or this thread once the test's OnUpdate is due,
+		// so a frame never waits behind jobs queued before it (BVH builds, ParallelFor chunks, ...)
+		auto simulate = [deltatime](TestBase *test) {
+			GLCORE_PROFILE_SCOPE ("OnSimulate");
+			auto start = timer_clock::now ();
+			test->OnSimulate (deltatime);
+			test->m_PerformanceData.SimulateMs = MillisecondsSince (start);
+		};
+		std::shared_ptr<std::atomic<bool>> claimed[g_MaxNumOfAllowedTests]; // shared, an unclaimed job outlives this frame
+		std::future<void> simulations[g_MaxNumOfAllowedTests];
+		bool redraw[g_MaxNumOfAllowedTests] = {};
+		for (uint8_t i = 0; i < g_MaxNumOfAllowedTests && m_ActiveTests[i]; i++) {
+			redraw[i] = m_ActiveTests[i]->m_RedrawRequested.exchange (false) || redraw_all;
+			if (!redraw[i])
+				continue;
+			claimed[i] = std::make_shared<std::atomic<bool>> (false);
+			simulations[i] = Utils::JobSystem::Submit ([claimed = claimed[i], test = m_ActiveTests[i], simulate]() {
+				if (!claimed->exchange (true))
+					simulate (test);
+			});
+		}
+
 		uint8_t testIndex = 0;
 		for (TestBase *test : m_ActiveTests) 	{
 			if (test)
 			{
-				////
-				// Here Will be code for frame buffer
-				////
+				if (!redraw[testIndex]) {
+					testIndex++;
+					continue;
+				}
+				GLCORE_PROFILE_SCOPE (test->GetName ().c_str ());
+				if (!claimed[testIndex]->exchange (true))
+					simulate (test); // still queued, the job finds it claimed and does nothing
+				else {
+					GLCORE_PROFILE_SCOPE ("Wait OnSimulate"); // a worker is running it
+					simulations[testIndex].get ();
+				}
+
 				m_ActiveTestFramebuffers[testIndex]->Bind ();
+				auto start = timer_clock::now ();
 				test->OnUpdate (deltatime);
 				m_ActiveTestFramebuffers[testIndex]->Unbind ();
+				test->m_PerformanceData.UpdateMs = MillisecondsSince (start);
 			} else break;
 			testIndex++;
 		}
 	}
+	bool TestsLayerManager::RedrawRequested () const
+	{
+		for (const TestBase *test : m_ActiveTests)
+			if (test && test->m_RedrawRequested)
+				return true;
+		return false;
+	}
 	void TestsLayerManager::ImGuiRender ()
 	{
+		GLCORE_PROFILE_FUNCTION ();
+		auto build_start = timer_clock::now ();
 		{// DockSpace
 
 			static bool dockspaceOpen = true;
@@ -116,6 +171,9 @@ namespace GLCore
 					if (ImGui::MenuItem ("Show Demo Window")) showImGuiDemoWindow = true;
 					ImGui::Separator ();
 					if (ImGui::MenuItem ("Show Tests Menu")) m_ShowTestMenu = true;
+					if (ImGui::MenuItem ("Show Performance Panel", NULL, m_ShowPerformancePanel)) m_ShowPerformancePanel = !m_ShowPerformancePanel;
+					if (ImGui::MenuItem ("On-demand rendering", NULL, Application::Get ().IsOnDemandRendering ()))
+						Application::Get ().SetOnDemandRendering (!Application::Get ().IsOnDemandRendering ());
 					ImGui::Separator ();
 					if (ImGui::MenuItem ("Exit")) Application::Get ().ApplicationClose ();
 
@@ -141,11 +199,15 @@ namespace GLCore
 
 			ShowTestMenu ();
 
+			if (m_ShowPerformancePanel)
+				m_PerformancePanel.OnImGuiRender (m_ActiveTests, g_MaxNumOfAllowedTests, &m_ShowPerformancePanel);
+
 			// Here goes Stuff that will be put inside DockSpace
 			OnImGuiRenderAll ();
 
 			ImGui::End ();
 		}
+		m_PerformancePanel.SetImGuiBuildTime (MillisecondsSince (build_start)); // shows up next frame
 	}
 	void TestsLayerManager::OnImGuiRenderAll ()
 	{
@@ -203,7 +265,10 @@ namespace GLCore
 					ImGui::PopStyleVar ();
 		
 					ImGui::SetNextWindowDockID (dockspace_id, ImGuiCond_FirstUseEver);
+					GLCORE_PROFILE_SCOPE (test->GetName ().c_str ());
+					auto start = timer_clock::now ();
 					test->OnImGuiRender ();
+					test->m_PerformanceData.ImGuiMs = MillisecondsSince (start);
 					ImGui::PopID ();
 				}
 				ImGui::End ();
@@ -239,6 +304,7 @@ namespace GLCore
 			}
 			m_ActiveTests[i] = m_AllTests[posn];
 			m_ActiveTests[i]->OnAttach ();
+			m_ActiveTests[i]->m_RedrawRequested = true;
 			if (m_ActiveTestFramebuffers[i])
 				m_ActiveTestFramebuffers[i]->Resize ((uint32_t)m_ActiveTests[i]->m_ViewPortSize.x, (uint32_t)m_ActiveTests[i]->m_ViewPortSize.y);
 			else	
@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include "GLCore/Core/PerformancePanel.h"
 
 namespace GLCore
 {
@@ -15,7 +16,9 @@ namespace GLCore
 
 		void PushTest (TestBase* test);
 
-		void UpdateActiveLayers (Timestep deltatime);
+		// with redraw_all false only tests that called RequestRedraw (or got an event) are updated
+		void UpdateActiveLayers (Timestep deltatime, bool redraw_all = true);
+		bool RedrawRequested () const;
 		void ImGuiRender ();
 		void OnImGuiRenderAll ();
 		void ProcessEvent (Event &event);
@@ -25,6 +28,8 @@ namespace GLCore
 	private:
 		void ShowTestMenu ();
 		bool m_ShowTestMenu = false;
+		PerformancePanel m_PerformancePanel;
+		bool m_ShowPerformancePanel = false;
 	private:
 		uint32_t m_DockspaceID;
 		static const uint8_t g_MaxNumOfAllowedTests = 2;
@@ -29,6 +29,10 @@ namespace GLCore {
 		virtual ~Window() = default;
 
 		virtual void OnUpdate() = 0;
+		// Sleeps until an event arrives, Wake () is called or the timeout passes (instead of polling in OnUpdate)
+		virtual void WaitEvents (double timeout_seconds) = 0;
+		// Ends a WaitEvents early, callable from any thread
+		virtual void Wake () = 0;
 
 		virtual uint32_t GetWidth() const = 0;
 		virtual uint32_t GetHeight() const = 0;
@@ -40,6 +44,12 @@ namespace GLCore {
 
 		virtual void MouseCursor (bool show) const = 0;
 
+		// Hidden context sharing objects with this window's, for worker threads (nullptr if it couldn't be created).
+		// Create/destroy on the main thread, bind with MakeContextCurrent on the thread using it (nullptr unbinds).
+		virtual void* CreateSharedContext () = 0;
+		virtual void DestroySharedContext (void* context) = 0;
+		virtual void MakeContextCurrent (void* context) = 0;
+
 		virtual void* GetNativeWindow() const = 0;
 
 		static Window* Create(const WindowProps& props = WindowProps());
@@ -0,0 +1,189 @@
+#include "pch.h"
+#include "Instrumentor.h"
+
+#include <mutex>
+#include <fstream>
+#include <iomanip>
+
+namespace GLCore::Debug
+{
+	// Fixed size so a block never moves once other threads may be reading it
+	struct EventBlock
+	{
+		static constexpr uint32_t Capacity = 4096;
+		InstrumentationEvent Events[Capacity];
+		std::atomic<uint32_t> Count = 0;         // published by the owner thread (release)
+		std::atomic<EventBlock *> Next = nullptr;
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t ThreadID;
+		std::string Name;                        // guarded by s_RegistryMutex
+		std::atomic<uint32_t> SessionID = 0;     // session the events belong to, stale buffers are recycled by their owner
+		EventBlock *Head = nullptr, *Tail = nullptr; // Tail is only touched by the owner
+
+		~ThreadBuffer ()
+		{
+			for (EventBlock *block = Head; block;) {
+				EventBlock *next = block->Next.load ();
+				delete block;
+				block = next;
+			}
+		}
+	};
+
+	std::atomic<bool> Instrumentor::s_Recording = false;
+
+	static std::mutex s_RegistryMutex; // thread registration, thread names
+	static std::vector<std::unique_ptr<ThreadBuffer>> s_ThreadBuffers; // outlive their threads, so late flushes stay valid
+	static std::mutex s_SessionMutex; // Begin/EndSession
+	static std::atomic<uint32_t> s_SessionID = 0;
+	static int64_t s_SessionStart = 0;
+	static std::string s_SessionName, s_SessionFilepath;
+
+	static thread_local ThreadBuffer *t_Buffer = nullptr;
+
+	static ThreadBuffer &GetThreadBuffer ()
+	{
+		if (!t_Buffer) {
+			std::lock_guard lock (s_RegistryMutex);
+			auto buffer = std::make_unique<ThreadBuffer> ();
+			buffer->ThreadID = uint32_t (s_ThreadBuffers.size () + 1);
+			buffer->Head = buffer->Tail = new EventBlock ();
+			t_Buffer = buffer.get ();
+			s_ThreadBuffers.push_back (std::move (buffer));
+		}
+		return *t_Buffer;
+	}
+
+	static void Append (const InstrumentationEvent &event)
+	{
+		ThreadBuffer &buffer = GetThreadBuffer ();
+
+		const uint32_t session = s_SessionID.load (std::memory_order_acquire);
+		if (buffer.SessionID.load (std::memory_order_relaxed) != session) { // previous session was flushed, reuse the blocks
+			for (EventBlock *block = buffer.Head; block; block = block->Next.load (std::memory_order_relaxed))
+				block->Count.store (0, std::memory_order_relaxed);
+			buffer.Tail = buffer.Head;
+			buffer.SessionID.store (session, std::memory_order_release);
+		}
+
+		EventBlock *tail = buffer.Tail;
+		uint32_t count = tail->Count.load (std::memory_order_relaxed);
+		if (count == EventBlock::Capacity) {
+			EventBlock *next = tail->Next.load (std::memory_order_relaxed);
+			if (!next) {
+				next = new EventBlock ();
+				tail->Next.store (next, std::memory_order_release);
+			}
+			buffer.Tail = tail = next;
+			count = 0;
+		}
+		tail->Events[count] = event;
+		tail->Count.store (count + 1, std::memory_order_release);
+	}
+
+	static void WriteEscaped (std::ostream &os, const char *str)
+	{
+		for (; *str; str++) {
+			if (*str == '"' || *str == '\\')
+				os << '\\' << *str;
+			else if (uint8_t (*str) < 0x20)
+				os << ' ';
+			else
+				os << *str;
+		}
+	}
+
+	void Instrumentor::BeginSession (const char *name, const char *filepath)
+	{
+		std::lock_guard lock (s_SessionMutex);
+		if (s_Recording.load ()) {
+			LOG_ERROR ("Instrumentor::BeginSession('{0}') when session '{1}' already open.", name, s_SessionName);
+			return;
+		}
+		s_SessionName = name, s_SessionFilepath = filepath;
+		s_SessionStart = Now ();
+		s_SessionID.fetch_add (1, std::memory_order_release);
+		s_Recording.store (true);
+	}
+
+	void Instrumentor::EndSession ()
+	{
+		std::lock_guard lock (s_SessionMutex);
+		if (!s_Recording.exchange (false))
+			return;
+
+		std::ofstream ofs (s_SessionFilepath);
+		if (!ofs) {
+			LOG_ERROR ("Instrumentor: cannot write {0}", s_SessionFilepath);
+			return;
+		}
+		ofs << std::fixed << std::setprecision (3);
+		ofs << "{\"otherData\": {\"session\": \"";
+		WriteEscaped (ofs, s_SessionName.c_str ());
+		ofs << "\"}, \"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+		const uint32_t session = s_SessionID.load ();
+		bool first = true;
+		auto separator = [&first]() -> const char * { const char *sep = first ? "\n" : ",\n"; first = false; return sep; };
+
+		std::lock_guard registry_lock (s_RegistryMutex);
+		for (auto &buffer : s_ThreadBuffers) {
+			if (!buffer->Name.empty ()) {
+				ofs << separator () << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->ThreadID << ", \"args\": {\"name\": \"";
+				WriteEscaped (ofs, buffer->Name.c_str ());
+				ofs << "\"}}";
+			}
+			if (buffer->SessionID.load (std::memory_order_acquire) != session)
+				continue;
+			for (EventBlock *block = buffer->Head; block; block = block->Next.load (std::memory_order_acquire)) {
+				const uint32_t count = block->Count.load (std::memory_order_acquire);
+				for (uint32_t i = 0; i < count; i++) {
+					const InstrumentationEvent &event = block->Events[i];
+					if (event.Start < s_SessionStart) // timer began before this session
+						continue;
+					ofs << separator () << "{\"name\": \"";
+					WriteEscaped (ofs, event.Name);
+					ofs << "\", \"pid\": 0, \"tid\": " << buffer->ThreadID << ", \"ts\": " << (event.Start - s_SessionStart)*1e-3;
+					if (event.Type == InstrumentationEvent::TYPE::SCOPE)
+						ofs << ", \"ph\": \"X\", \"cat\": \"scope\", \"dur\": " << event.Duration*1e-3 << '}';
+					else
+						ofs << ", \"ph\": \"C\", \"args\": {\"value\": " << event.Value << "}}";
+				}
+				if (count < EventBlock::Capacity)
+					break;
+			}
+		}
+		ofs << "\n]}\n";
+		LOG_INFO ("Profile session '{0}' written to {1}", s_SessionName, s_SessionFilepath);
+	}
+
+	void Instrumentor::WriteScope (const char *name, int64_t start, int64_t duration)
+	{
+		if (!IsRecording ())
+			return;
+		InstrumentationEvent event;
+		event.Name = name, event.Type = InstrumentationEvent::TYPE::SCOPE;
+		event.Start = start, event.Duration = duration;
+		Append (event);
+	}
+
+	void Instrumentor::WriteCounter (const char *name, double value)
+	{
+		if (!IsRecording ())
+			return;
+		InstrumentationEvent event;
+		event.Name = name, event.Type = InstrumentationEvent::TYPE::COUNTER;
+		event.Start = Now (), event.Value = value;
+		Append (event);
+	}
+
+	void Instrumentor::SetThreadName (const char *name)
+	{
+		ThreadBuffer &buffer = GetThreadBuffer ();
+		std::lock_guard lock (s_RegistryMutex);
+		buffer.Name = name;
+	}
+}
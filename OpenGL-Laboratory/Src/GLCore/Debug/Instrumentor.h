@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Build with GLCORE_PROFILE=1 (premake --profile) to record, otherwise every GLCORE_PROFILE_* macro is empty
+#ifndef GLCORE_PROFILE
+	#define GLCORE_PROFILE 0
+#endif
+
+namespace GLCore::Debug
+{
+	struct InstrumentationEvent
+	{
+		enum class TYPE : uint8_t
+		{
+			SCOPE = 0, // chrome "X" (complete) event
+			COUNTER    // chrome "C" event
+		};
+		const char *Name; // must outlive the session, string literals or long lived names only
+		TYPE Type;
+		int64_t Start; // nano-seconds on steady_clock
+		union
+		{
+			int64_t Duration; // nano-seconds
+			double Value;
+		};
+	};
+
+	// Every thread appends to it's own buffer (no locks, no sharing), Instrumentor::EndSession collects them into a
+	// chrome://tracing (or ui.perfetto.dev) JSON file.
+	class Instrumentor
+	{
+	public:
+		static void BeginSession (const char *name, const char *filepath = "GLCoreProfile.json");
+		static void EndSession ();
+
+		static bool IsRecording () { return s_Recording.load (std::memory_order_relaxed); }
+
+		static void WriteScope (const char *name, int64_t start, int64_t duration);
+		static void WriteCounter (const char *name, double value);
+		// Name shows up as the track's title, can be set before any session begins
+		static void SetThreadName (const char *name);
+
+		static int64_t Now () { return std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now ().time_since_epoch ()).count (); }
+	private:
+		static std::atomic<bool> s_Recording;
+	};
+
+	class InstrumentationTimer
+	{
+	public:
+		InstrumentationTimer (const char *name)
+			: m_Name (name), m_Start (Instrumentor::IsRecording () ? Instrumentor::Now () : -1)
+		{}
+		~InstrumentationTimer ()
+		{
+			if (m_Start >= 0)
+				Instrumentor::WriteScope (m_Name, m_Start, Instrumentor::Now () - m_Start);
+		}
+	private:
+		const char *m_Name;
+		int64_t m_Start;
+	};
+}
+
+#if GLCORE_PROFILE
+	#if defined(__GNUC__) || defined(__clang__)
+		#define GLCORE_FUNC_SIG __PRETTY_FUNCTION__
+	#elif defined(_MSC_VER)
+		#define GLCORE_FUNC_SIG __FUNCSIG__
+	#else
+		#define GLCORE_FUNC_SIG __func__
+	#endif
+
+	#define GLCORE_PROFILE_CONCAT_IMPL(x, y) x##y
+	#define GLCORE_PROFILE_CONCAT(x, y) GLCORE_PROFILE_CONCAT_IMPL(x, y)
+
+	#define GLCORE_PROFILE_BEGIN_SESSION(name, filepath) ::GLCore::Debug::Instrumentor::BeginSession (name, filepath)
+	#define GLCORE_PROFILE_END_SESSION()                 ::GLCore::Debug::Instrumentor::EndSession ()
+	#define GLCORE_PROFILE_SCOPE(name)                   ::GLCore::Debug::InstrumentationTimer GLCORE_PROFILE_CONCAT(timer, __LINE__) (name)
+	#define GLCORE_PROFILE_FUNCTION()                    GLCORE_PROFILE_SCOPE (GLCORE_FUNC_SIG)
+	#define GLCORE_PROFILE_COUNTER(name, value)          ::GLCore::Debug::Instrumentor::WriteCounter (name, double (value))
+	#define GLCORE_PROFILE_THREAD_NAME(name)             ::GLCore::Debug::Instrumentor::SetThreadName (name)
+#else
+	#define GLCORE_PROFILE_BEGIN_SESSION(name, filepath)
+	#define GLCORE_PROFILE_END_SESSION()
+	#define GLCORE_PROFILE_SCOPE(name)
+	#define GLCORE_PROFILE_FUNCTION()
+	#define GLCORE_PROFILE_COUNTER(name, value)
+	#define GLCORE_PROFILE_THREAD_NAME(name)
+#endif
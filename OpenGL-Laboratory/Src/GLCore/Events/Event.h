@@ -5,10 +5,9 @@
 
 namespace GLCore {
 
-	// Events in Hazel are currently blocking, meaning when an event occurs it
-	// immediately gets dispatched and must be dealt with right then an there.
-	// For the future, a better strategy might be to buffer events in an event
-	// bus and process them during the "event" part of the update stage.
+	// Window events are buffered in the EventBus (coalesced, dispatched once per
+	// frame before the layers update), everything else (layer events) is still
+	// blocking: it gets dispatched and must be dealt with right then and there.
 
 	enum class EventType
 	{
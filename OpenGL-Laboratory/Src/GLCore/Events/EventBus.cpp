@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "EventBus.h"
+
+namespace GLCore {
+
+	bool EventBus::Post (const Event &event)
+	{
+		m_Posted++;
+		switch (event.GetEventType ()) {
+			case EventType::MouseMoved:
+				if (last_is<MouseMovedEvent> ()) {
+					m_Queue.back () = static_cast<const MouseMovedEvent &> (event);
+					m_Coalesced++;
+				} else m_Queue.emplace_back (static_cast<const MouseMovedEvent &> (event));
+				return true;
+			case EventType::MouseScrolled: {
+				const MouseScrolledEvent &scrolled = static_cast<const MouseScrolledEvent &> (event);
+				if (last_is<MouseScrolledEvent> ()) {
+					const MouseScrolledEvent &last = std::get<MouseScrolledEvent> (m_Queue.back ());
+					m_Queue.back () = MouseScrolledEvent (last.GetXOffset () + scrolled.GetXOffset (), last.GetYOffset () + scrolled.GetYOffset ());
+					m_Coalesced++;
+				} else m_Queue.emplace_back (scrolled);
+				return true;
+			}
+			case EventType::WindowResize: { // nothing depends on the order of resizes vs input, the latest size replaces the queued one
+				const WindowResizeEvent &resized = static_cast<const WindowResizeEvent &> (event);
+				for (QueuedEvent &queued : m_Queue) {
+					if (std::holds_alternative<WindowResizeEvent> (queued)) {
+						queued = resized;
+						m_Coalesced++;
+						return true;
+					}
+				}
+				m_Queue.emplace_back (resized);
+				return true;
+			}
+			case EventType::WindowClose:         m_Queue.emplace_back (static_cast<const WindowCloseEvent &> (event)); return true;
+			case EventType::KeyPressed:          m_Queue.emplace_back (static_cast<const KeyPressedEvent &> (event)); return true;
+			case EventType::KeyReleased:         m_Queue.emplace_back (static_cast<const KeyReleasedEvent &> (event)); return true;
+			case EventType::KeyTyped:            m_Queue.emplace_back (static_cast<const KeyTypedEvent &> (event)); return true;
+			case EventType::MouseButtonPressed:  m_Queue.emplace_back (static_cast<const MouseButtonPressedEvent &> (event)); return true;
+			case EventType::MouseButtonReleased: m_Queue.emplace_back (static_cast<const MouseButtonReleasedEvent &> (event)); return true;
+			default:
+				m_Posted--;
+				return false;
+		}
+	}
+
+	void EventBus::Dispatch (const std::function<void (Event &)> &handler)
+	{
+		GLCORE_PROFILE_FUNCTION ();
+		GLCORE_PROFILE_COUNTER ("Events posted", m_Posted);
+		GLCORE_PROFILE_COUNTER ("Events coalesced", m_Coalesced);
+		m_Posted = m_Coalesced = 0;
+
+		std::swap (m_Queue, m_Dispatching);
+		for (QueuedEvent &queued : m_Dispatching)
+			std::visit ([&handler](Event &event) { handler (event); }, queued);
+		m_Dispatching.clear ();
+	}
+
+}
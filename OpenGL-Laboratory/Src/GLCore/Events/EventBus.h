@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Event.h"
+#include "ApplicationEvent.h"
+#include "KeyEvent.h"
+#include "MouseEvent.h"
+
+#include <variant>
+
+namespace GLCore {
+
+	// Window events are queued here as glfwPollEvents delivers them and dispatched once per frame, before the layers update.
+	// Runs of MouseMoved collapse into the latest position, runs of MouseScrolled into one summed offset, and only the last
+	// WindowResize of a frame survives, so a 1000 Hz mouse costs one camera update per frame instead of dozens.
+	// Key/button events are never merged and keep their order relative to the motion around them.
+	class EventBus
+	{
+	public:
+		// Copies the event, false for types the bus doesn't carry (dispatch those directly)
+		bool Post (const Event &event);
+		// Hands every queued event to 'handler' in arrival order, events posted meanwhile wait for the next frame
+		void Dispatch (const std::function<void (Event &)> &handler);
+
+		size_t Queued () const { return m_Queue.size (); }
+	private:
+		using QueuedEvent = std::variant<WindowResizeEvent, WindowCloseEvent, KeyPressedEvent, KeyReleasedEvent, KeyTypedEvent
+									   , MouseButtonPressedEvent, MouseButtonReleasedEvent, MouseMovedEvent, MouseScrolledEvent>;
+		template<typename T>
+		bool last_is () const { return !m_Queue.empty () && std::holds_alternative<T> (m_Queue.back ()); }
+	private:
+		std::vector<QueuedEvent> m_Queue, m_Dispatching; // swapped every Dispatch, capacity is kept
+		uint32_t m_Posted = 0, m_Coalesced = 0;          // this frame, for the profiler
+	};
+
+}
@@ -0,0 +1,253 @@
+#include "pch.h"
+#include "FrameCapture.h"
+
+#include <array>
+#include <fstream>
+#include <filesystem>
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		static uint32_t crc32 (uint32_t crc, const uint8_t *data, size_t size)
+		{
+			static const auto table = [] {
+				std::array<uint32_t, 256> t{};
+				for (uint32_t n = 0; n < 256; n++) {
+					uint32_t c = n;
+					for (int k = 0; k < 8; k++)
+						c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					t[n] = c;
+				}
+				return t;
+			}();
+			crc = ~crc;
+			for (size_t i = 0; i < size; i++)
+				crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		static void push_u32_be (std::vector<uint8_t> &out, uint32_t value)
+		{
+			const uint8_t bytes[4] = { uint8_t (value >> 24), uint8_t (value >> 16), uint8_t (value >> 8), uint8_t (value) };
+			out.insert (out.end (), bytes, bytes + 4);
+		}
+
+		static void write_png_chunk (std::ofstream &file, const char type[4], const std::vector<uint8_t> &data)
+		{
+			std::vector<uint8_t> header;
+			push_u32_be (header, uint32_t (data.size ()));
+			header.insert (header.end (), type, type + 4);
+			uint32_t crc = crc32 (0, header.data () + 4, 4);
+			crc = crc32 (crc, data.data (), data.size ());
+			std::vector<uint8_t> footer;
+			push_u32_be (footer, crc);
+
+			file.write ((const char *)header.data (), header.size ());
+			file.write ((const char *)data.data (), data.size ());
+			file.write ((const char *)footer.data (), footer.size ());
+		}
+
+		static bool write_png (std::ofstream &file, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, bool flip_vertically)
+		{
+			static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+			static const uint8_t color_types[4] = { 0 /*gray*/, 4 /*gray + alpha*/, 2 /*RGB*/, 6 /*RGBA*/ };
+			file.write ((const char *)signature, sizeof (signature));
+
+			std::vector<uint8_t> ihdr;
+			push_u32_be (ihdr, width);
+			push_u32_be (ihdr, height);
+			ihdr.insert (ihdr.end (), { 8 /*bit depth*/, color_types[channels - 1], 0, 0, 0 /*no interlace*/ });
+			write_png_chunk (file, "IHDR", ihdr);
+
+			// zlib stream of stored blocks (<= 65535 bytes each), every scanline starts with filter type 0
+			const size_t row_size = size_t (width)*channels, raw_size = (row_size + 1)*height;
+			constexpr size_t max_block = 65535;
+			std::vector<uint8_t> idat;
+			idat.reserve (2 + raw_size + (raw_size/max_block + 1)*5 + 4);
+			idat.push_back (0x78), idat.push_back (0x01);
+
+			uint32_t adler_a = 1, adler_b = 0;
+			size_t block_left = 0, raw_left = raw_size;
+			auto put = [&](const uint8_t *data, size_t size) {
+				while (size) {
+					if (block_left == 0) {
+						block_left = std::min (raw_left, max_block);
+						raw_left -= block_left;
+						const uint16_t len = uint16_t (block_left), nlen = uint16_t (~len);
+						idat.insert (idat.end (), { uint8_t (raw_left == 0), uint8_t (len), uint8_t (len >> 8), uint8_t (nlen), uint8_t (nlen >> 8) });
+					}
+					const size_t n = std::min (size, block_left);
+					idat.insert (idat.end (), data, data + n);
+					for (size_t i = 0; i < n; i++) { // modulo deferred, safe for runs up to 5552 bytes
+						adler_a += data[i], adler_b += adler_a;
+						if ((i & 4095) == 4095)
+							adler_a %= 65521, adler_b %= 65521;
+					}
+					adler_a %= 65521, adler_b %= 65521;
+					data += n, size -= n, block_left -= n;
+				}
+			};
+			const uint8_t filter_none = 0;
+			for (uint32_t y = 0; y < height; y++) {
+				const uint32_t row = flip_vertically ? height - 1 - y : y;
+				put (&filter_none, 1);
+				put (pixels + row*row_size, row_size);
+			}
+			push_u32_be (idat, (adler_b << 16) | adler_a);
+			write_png_chunk (file, "IDAT", idat);
+			write_png_chunk (file, "IEND", {});
+			return bool (file);
+		}
+
+		static bool write_ppm (std::ofstream &file, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, bool flip_vertically)
+		{
+			const std::string header = "P6\n" + std::to_string (width) + " " + std::to_string (height) + "\n255\n";
+			file.write (header.data (), header.size ());
+			std::vector<uint8_t> row_rgb (size_t (width)*3);
+			for (uint32_t y = 0; y < height; y++) {
+				const uint8_t *row = pixels + size_t (flip_vertically ? height - 1 - y : y)*width*channels;
+				for (uint32_t x = 0; x < width; x++)
+					for (uint32_t c = 0; c < 3; c++)
+						row_rgb[x*3 + c] = row[x*channels + (channels >= 3 ? c : 0)];
+				file.write ((const char *)row_rgb.data (), row_rgb.size ());
+			}
+			return bool (file);
+		}
+
+		bool WriteImage (const std::string &path, ImageFileFormat format, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, bool flip_vertically)
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			if (!pixels || width == 0 || height == 0 || channels < 1 || channels > 4)
+				return false;
+			std::ofstream file (path, std::ios::binary);
+			if (!file) {
+				LOG_ERROR ("WriteImage: cannot open '{0}'", path);
+				return false;
+			}
+			return format == ImageFileFormat::PPM ? write_ppm (file, width, height, channels, pixels, flip_vertically)
+												  : write_png (file, width, height, channels, pixels, flip_vertically);
+		}
+
+		FrameCapture::FrameCapture (uint32_t max_queued_frames)
+			: m_MaxQueued (std::max (max_queued_frames, 1u))
+		{
+			m_Encoder = std::thread (&FrameCapture::encoder_loop, this);
+		}
+
+		FrameCapture::~FrameCapture ()
+		{
+			{
+				std::lock_guard lock (m_QueueMutex);
+				m_Quit = true;
+			}
+			m_WakeUp.notify_one ();
+			m_Encoder.join ();
+		}
+
+		void FrameCapture::Release ()
+		{
+			if (!m_InFlight.empty ()) {
+				glFinish ();
+				Update ();
+			}
+			m_Readback.Release ();
+			m_InFlight.clear ();
+		}
+
+		bool FrameCapture::Capture (Framebuffer &framebuffer, uint32_t attachment_index, const std::string &path)
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			const FramebufferSpecification &spec = framebuffer.GetSpecification ();
+			LOG_ASSERT (attachment_index < spec.Attachments.Attachments.size () && spec.Attachments.Attachments[attachment_index].TextureFormat == FramebufferTextureFormat::RGBA8
+						, "FrameCapture: only RGBA8 attachments can be captured");
+			if (Pending () >= m_MaxQueued)
+				return false;
+
+			const size_t bytes = size_t (spec.Width)*spec.Height*4;
+			if (bytes > m_Readback.MaxBytes ()) {
+				if (!m_InFlight.empty ()) // grows once the old size is drained
+					return false;
+				m_Readback.Allocate (bytes, 3);
+			}
+			if (!framebuffer.ReadPixelsAsync (attachment_index, 0, 0, int (spec.Width), int (spec.Height), m_Readback))
+				return false;
+			m_InFlight.push_back (Frame{ path, spec.Width, spec.Height, {} });
+			return true;
+		}
+
+		void FrameCapture::Update ()
+		{
+			while (!m_InFlight.empty ()) {
+				Frame &frame = m_InFlight.front ();
+				if (frame.Pixels.empty ()) { // stays with the frame until its readback finished
+					std::lock_guard lock (m_QueueMutex);
+					if (!m_SpareBuffers.empty ()) {
+						frame.Pixels = std::move (m_SpareBuffers.back ());
+						m_SpareBuffers.pop_back ();
+					}
+				}
+				frame.Pixels.resize (size_t (frame.Width)*frame.Height*4);
+				if (!m_Readback.PollOldest (frame.Pixels.data (), frame.Pixels.size ()))
+					return;
+				{
+					std::lock_guard lock (m_QueueMutex);
+					m_Queue.push_back (std::move (frame));
+				}
+				m_WakeUp.notify_one ();
+				m_InFlight.pop_front ();
+			}
+		}
+
+		uint32_t FrameCapture::Pending () const
+		{
+			std::lock_guard lock (m_QueueMutex);
+			return uint32_t (m_InFlight.size () + m_Queue.size ()) + m_Encoding;
+		}
+
+		ImageFileFormat FrameCapture::FormatFromPath (const std::string &path)
+		{
+			std::string extension = std::filesystem::path (path).extension ().string ();
+			std::transform (extension.begin (), extension.end (), extension.begin (), [](char c) { return char (tolower (c)); });
+			return extension == ".ppm" ? ImageFileFormat::PPM : ImageFileFormat::PNG;
+		}
+
+		void FrameCapture::encoder_loop ()
+		{
+			GLCORE_PROFILE_THREAD_NAME ("FrameCapture Encoder");
+			while (true) {
+				Frame frame;
+				{
+					std::unique_lock lock (m_QueueMutex);
+					m_WakeUp.wait (lock, [this] { return m_Quit || !m_Queue.empty (); });
+					if (m_Queue.empty ()) // only quits once everything queued is written
+						return;
+					frame = std::move (m_Queue.front ());
+					m_Queue.pop_front ();
+					m_Encoding++;
+				}
+
+				// GL rows are bottom up, alpha is whatever blending left behind so it's dropped
+				uint8_t *pixels = frame.Pixels.data ();
+				const size_t pixel_count = size_t (frame.Width)*frame.Height;
+				for (size_t i = 0; i < pixel_count; i++)
+					pixels[i*3 + 0] = pixels[i*4 + 0], pixels[i*3 + 1] = pixels[i*4 + 1], pixels[i*3 + 2] = pixels[i*4 + 2];
+
+				std::error_code error;
+				const std::filesystem::path directory = std::filesystem::path (frame.Path).parent_path ();
+				if (!directory.empty ())
+					std::filesystem::create_directories (directory, error);
+				if (WriteImage (frame.Path, FormatFromPath (frame.Path), frame.Width, frame.Height, 3, pixels, true))
+					m_Written++;
+				else {
+					LOG_ERROR ("FrameCapture: writing '{0}' failed", frame.Path);
+					m_Failed++;
+				}
+
+				std::lock_guard lock (m_QueueMutex);
+				m_SpareBuffers.push_back (std::move (frame.Pixels));
+				m_Encoding--;
+			}
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "GLCore/Core/Core.h"
+#include "Framebuffer.h"
+#include "PixelReadback.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		enum class ImageFileFormat { PNG, PPM };
+
+		// 8 bit per channel pixels, 1-4 channels for PNG, PPM takes the first 3 (1 channel is written as gray)
+		// PNG data goes out in stored (uncompressed) deflate blocks, so encoding costs about as much as a memcpy
+		bool WriteImage (const std::string &path, ImageFileFormat format, uint32_t width, uint32_t height, uint32_t channels, const uint8_t *pixels, bool flip_vertically = false);
+
+		// Screenshots/image sequences without stalling the frame: the color attachment is read into a PBO ring (PixelReadback),
+		// finished readbacks are copied out in order and written to disk by one encoder thread.
+		//   capture.Capture (*framebuffer, 0, "captures/frame_0000.png"); // after drawing, false while the queue is full
+		//   capture.Update ();                                            // every frame
+		// Nothing accepted is ever dropped, the queue is bounded by refusing new captures instead.
+		class FrameCapture
+		{
+		public:
+			FrameCapture (uint32_t max_queued_frames = 8);
+			~FrameCapture ();
+			FrameCapture (const FrameCapture &) = delete;
+			FrameCapture &operator= (const FrameCapture &) = delete;
+
+			// Waits for the readbacks still on the GPU and frees the PBOs, call while the context is still current.
+			// Frames already queued keep being written, the destructor waits for them.
+			void Release ();
+
+			// Reads the whole RGBA8 attachment, the file format follows the extension (.ppm, anything else is PNG)
+			bool Capture (Framebuffer &framebuffer, uint32_t attachment_index, const std::string &path);
+			// Hands finished readbacks to the encoder, never waits on the GPU
+			void Update ();
+
+			// readbacks in flight + frames waiting for/being encoded
+			uint32_t Pending () const;
+			uint32_t Written () const { return m_Written; }
+			uint32_t Failed () const { return m_Failed; }
+
+			static ImageFileFormat FormatFromPath (const std::string &path);
+		private:
+			struct Frame
+			{
+				std::string Path;
+				uint32_t Width = 0, Height = 0;
+				std::vector<uint8_t> Pixels; // RGBA, bottom up
+			};
+			void encoder_loop ();
+		private:
+			const uint32_t m_MaxQueued;
+			PixelReadback m_Readback;
+			std::deque<Frame> m_InFlight; // same order as the readbacks, pixels are still on the GPU
+
+			mutable std::mutex m_QueueMutex;
+			std::condition_variable m_WakeUp;
+			std::deque<Frame> m_Queue;
+			std::vector<std::vector<uint8_t>> m_SpareBuffers; // pixel buffers handed back by the encoder
+			uint32_t m_Encoding = 0;
+			bool m_Quit = false;
+
+			std::atomic<uint32_t> m_Written{ 0 }, m_Failed{ 0 };
+			std::thread m_Encoder;
+		};
+	}
+}
@@ -204,8 +204,34 @@ namespace GLCore
 		{
 			LOG_ASSERT (attachmentIndex < m_ColorAttachments.size ());
 
+			GLenum format, type;
+			if (!read_format (attachmentIndex, format, type))
+				return;
 			glReadBuffer (GL_COLOR_ATTACHMENT0 + attachmentIndex);
-			
+			glReadPixels (x, y, 1, 1, format, type, cantainer);
+		}
+
+		bool Framebuffer::ReadPixelAsync (uint32_t attachmentIndex, int x, int y, PixelReadback &readback, uint64_t tag)
+		{
+			return ReadPixelsAsync (attachmentIndex, x, y, 1, 1, readback, tag);
+		}
+
+		bool Framebuffer::ReadPixelsAsync (uint32_t attachmentIndex, int x, int y, int width, int height, PixelReadback &readback, uint64_t tag)
+		{
+			LOG_ASSERT (attachmentIndex < m_ColorAttachments.size ());
+			if (x < 0 || y < 0 || width <= 0 || height <= 0 || x + width > int (m_Specification.Width) || y + height > int (m_Specification.Height))
+				return false;
+
+			GLenum format, type;
+			if (!read_format (attachmentIndex, format, type))
+				return false;
+			glBindFramebuffer (GL_READ_FRAMEBUFFER, m_RendererID);
+			glReadBuffer (GL_COLOR_ATTACHMENT0 + attachmentIndex);
+			return readback.Request (x, y, width, height, format, type, tag);
+		}
+
+		bool Framebuffer::read_format (uint32_t attachmentIndex, GLenum &format, GLenum &type) const
+		{
 			FramebufferTextureFormat curr;
 			if (attachmentIndex < m_ColorAttachmentSpecifications.size ())
 			{
@@ -216,18 +242,19 @@ namespace GLCore
 			switch (curr)
 			{
 			case FramebufferTextureFormat::RED_INTEGER:
-				glReadPixels (x, y, 1, 1, GL_RED_INTEGER, GL_INT, &cantainer); break;
+				format = GL_RED_INTEGER, type = GL_INT; return true;
 			case FramebufferTextureFormat::RED_FLOAT:
-				glReadPixels (x, y, 1, 1, GL_RED, GL_FLOAT, &cantainer); break;
+				format = GL_RED, type = GL_FLOAT; return true;
 			case FramebufferTextureFormat::RGBA8 :
-				glReadPixels (x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &cantainer); break;
+				format = GL_RGBA, type = GL_UNSIGNED_BYTE; return true;
 			case FramebufferTextureFormat::RGBA32F :
-				glReadPixels (x, y, 1, 1, GL_RGBA, GL_FLOAT, &cantainer); break;
+				format = GL_RGBA, type = GL_FLOAT; return true;
 			//case FramebufferTextureFormat::DEPTH24STENCIL8:
-			//	glReadPixels (x, y, 1, 1, GL_RED, GL_UNSIGNED_BYTE, &cantainer); break;
+			//	format = GL_RED, type = GL_UNSIGNED_BYTE; return true;
 			default:
 				LOG_WARN ("Tried ReadPixel on Non Specified TextureFormat");
 			}
+			return false;
 		}
 		
 		void Framebuffer::ClearAttachment (uint32_t attachmentIndex, int value)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLCore/Core/Core.h"
+#include "PixelReadback.h"
 
 namespace GLCore
 {
@@ -65,16 +66,22 @@ namespace GLCore
 			virtual void Resize (uint32_t width, uint32_t height);
 
 			void ReadPixel (uint32_t attachmentIndex, int x, int y, void* cantainer);
+			// queued into 'readback', pick the value up later with readback.Poll (), doesn't stall like ReadPixel
+			bool ReadPixelAsync (uint32_t attachmentIndex, int x, int y, PixelReadback &readback, uint64_t tag = 0);
+			// same for a whole rectangle, rows come back bottom up
+			bool ReadPixelsAsync (uint32_t attachmentIndex, int x, int y, int width, int height, PixelReadback &readback, uint64_t tag = 0);
 
 			virtual void ClearAttachment (uint32_t attachmentIndex, int value);
 
 			virtual uint32_t GetColorAttachmentRendererID (uint32_t index = 0) const;
+			uint32_t GetRendererID () const { return m_RendererID; }
 
 			virtual const FramebufferSpecification &GetSpecification () const { return m_Specification; };
 
 			static std::shared_ptr<Framebuffer> Create (const FramebufferSpecification &spec);
 		private:
 			void Invalidate ();
+			bool read_format (uint32_t attachmentIndex, GLenum &format, GLenum &type) const;
 		private:
 			uint32_t m_RendererID = 0;
 			FramebufferSpecification m_Specification;
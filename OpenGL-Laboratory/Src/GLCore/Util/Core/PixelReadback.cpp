@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "PixelReadback.h"
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		static size_t pixel_size (GLenum format, GLenum type)
+		{
+			size_t components = 4;
+			switch (format) {
+				case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: components = 1; break;
+				case GL_RG: case GL_RG_INTEGER: components = 2; break;
+				case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+			}
+			switch (type) {
+				case GL_UNSIGNED_BYTE: case GL_BYTE: return components;
+				case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return components*2;
+				default: return components*4;
+			}
+		}
+
+		void PixelReadback::Allocate (size_t max_bytes, uint32_t buffer_count)
+		{
+			Release ();
+			m_BufferCount = std::clamp<uint32_t> (buffer_count, 1, MaxBuffers);
+			m_MaxBytes = std::max<size_t> (max_bytes, 1);
+			glGenBuffers (m_BufferCount, m_Buffers);
+			for (uint32_t i = 0; i < m_BufferCount; i++) {
+				glBindBuffer (GL_PIXEL_PACK_BUFFER, m_Buffers[i]);
+				glBufferData (GL_PIXEL_PACK_BUFFER, GLsizeiptr (m_MaxBytes), nullptr, GL_STREAM_READ);
+			}
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+			m_Next = 0;
+		}
+
+		void PixelReadback::Release ()
+		{
+			for (uint32_t i = 0; i < m_BufferCount; i++) {
+				if (m_Fences[i])
+					glDeleteSync (m_Fences[i]);
+				m_Fences[i] = nullptr;
+			}
+			if (m_BufferCount)
+				glDeleteBuffers (m_BufferCount, m_Buffers);
+			m_BufferCount = 0, m_MaxBytes = 0;
+		}
+
+		bool PixelReadback::Request (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, uint64_t tag)
+		{
+			const size_t bytes = size_t (width)*height*pixel_size (format, type);
+			if (!m_BufferCount || bytes > m_MaxBytes || m_Fences[m_Next])
+				return false;
+
+			GLint previous_alignment;
+			glGetIntegerv (GL_PACK_ALIGNMENT, &previous_alignment);
+			glPixelStorei (GL_PACK_ALIGNMENT, 1);
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, m_Buffers[m_Next]);
+			glReadPixels (x, y, width, height, format, type, nullptr);
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+			glPixelStorei (GL_PACK_ALIGNMENT, previous_alignment);
+
+			m_Fences[m_Next] = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_Tags[m_Next] = tag, m_Sizes[m_Next] = bytes, m_Sequence[m_Next] = ++m_Issued;
+			m_Next = (m_Next + 1)%m_BufferCount;
+			return true;
+		}
+
+		bool PixelReadback::Poll (void *out, size_t bytes, uint64_t *out_tag)
+		{
+			int32_t newest = -1;
+			for (uint32_t i = 0; i < m_BufferCount; i++) {
+				if (!m_Fences[i])
+					continue;
+				GLint status = GL_UNSIGNALED;
+				glGetSynciv (m_Fences[i], GL_SYNC_STATUS, 1, nullptr, &status);
+				if (status == GL_SIGNALED && (newest < 0 || m_Sequence[i] > m_Sequence[newest]))
+					newest = int32_t (i);
+			}
+			if (newest < 0)
+				return false;
+
+			copy_out (uint32_t (newest), out, bytes, out_tag);
+
+			// the GPU finishes in order, everything issued before is done (and stale) too
+			const uint64_t consumed = m_Sequence[newest];
+			for (uint32_t i = 0; i < m_BufferCount; i++) {
+				if (m_Fences[i] && m_Sequence[i] <= consumed) {
+					glDeleteSync (m_Fences[i]);
+					m_Fences[i] = nullptr;
+				}
+			}
+			return true;
+		}
+
+		bool PixelReadback::PollOldest (void *out, size_t bytes, uint64_t *out_tag)
+		{
+			int32_t oldest = -1;
+			for (uint32_t i = 0; i < m_BufferCount; i++)
+				if (m_Fences[i] && (oldest < 0 || m_Sequence[i] < m_Sequence[oldest]))
+					oldest = int32_t (i);
+			if (oldest < 0)
+				return false;
+
+			GLint status = GL_UNSIGNALED;
+			glGetSynciv (m_Fences[oldest], GL_SYNC_STATUS, 1, nullptr, &status);
+			if (status != GL_SIGNALED)
+				return false;
+
+			copy_out (uint32_t (oldest), out, bytes, out_tag);
+			glDeleteSync (m_Fences[oldest]);
+			m_Fences[oldest] = nullptr;
+			return true;
+		}
+
+		uint32_t PixelReadback::InFlight () const
+		{
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < m_BufferCount; i++)
+				count += m_Fences[i] != nullptr;
+			return count;
+		}
+
+		void PixelReadback::copy_out (uint32_t index, void *out, size_t bytes, uint64_t *out_tag)
+		{
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, m_Buffers[index]);
+			const size_t size = std::min (bytes, m_Sizes[index]);
+			if (const void *mapped = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr (size), GL_MAP_READ_BIT)) {
+				memcpy (out, mapped, size);
+				glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+			}
+			glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+			if (out_tag)
+				*out_tag = m_Tags[index];
+		}
+	}
+}
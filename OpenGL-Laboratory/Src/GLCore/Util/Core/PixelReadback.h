@@ -0,0 +1,51 @@
+#pragma once
+
+#include "GLCore/Core/Core.h"
+#include <glad/glad.h>
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		// Ring of pixel pack buffers: glReadPixels into a PBO returns right away (the copy is queued on the GPU),
+		// the result is picked up a frame or two later, once its fence signaled, so reading back never stalls.
+		//   readback.Request (x, y, 1, 1, GL_RED_INTEGER, GL_INT); // after drawing, reads the bound read framebuffer
+		//   if (readback.Poll (&value, sizeof (value))) ...        // any later frame, false while nothing new finished
+		class PixelReadback
+		{
+		public:
+			PixelReadback () = default;
+			PixelReadback (size_t max_bytes, uint32_t buffer_count = 3) { Allocate (max_bytes, buffer_count); }
+			~PixelReadback () { Release (); }
+			PixelReadback (const PixelReadback &) = delete;
+			PixelReadback &operator= (const PixelReadback &) = delete;
+
+			// max_bytes is the largest single request
+			void Allocate (size_t max_bytes, uint32_t buffer_count = 3);
+			void Release ();
+
+			// false (request dropped) when every buffer is still in flight or the pixels don't fit
+			bool Request (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, uint64_t tag = 0);
+			// Copies the newest finished request into 'out', older finished ones are dropped, never waits
+			bool Poll (void *out, size_t bytes, uint64_t *out_tag = nullptr);
+			// Copies the oldest request into 'out' once it finished, nothing is dropped (captures, where every frame counts)
+			bool PollOldest (void *out, size_t bytes, uint64_t *out_tag = nullptr);
+
+			bool IsAllocated () const { return m_BufferCount != 0; }
+			size_t MaxBytes () const { return m_MaxBytes; }
+			uint32_t InFlight () const;
+
+			static constexpr uint32_t MaxBuffers = 4;
+		private:
+			void copy_out (uint32_t index, void *out, size_t bytes, uint64_t *out_tag);
+		private:
+			GLuint m_Buffers[MaxBuffers] = {};
+			GLsync m_Fences[MaxBuffers] = {}; // null = free
+			uint64_t m_Tags[MaxBuffers] = {}, m_Sequence[MaxBuffers] = {};
+			size_t m_Sizes[MaxBuffers] = {};
+			size_t m_MaxBytes = 0;
+			uint32_t m_BufferCount = 0, m_Next = 0;
+			uint64_t m_Issued = 0;
+		};
+	}
+}
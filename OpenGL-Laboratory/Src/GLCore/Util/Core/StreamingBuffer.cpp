@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "StreamingBuffer.h"
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		void StreamingBuffer::Allocate (size_t region_size, uint32_t region_count)
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			Release ();
+			m_RegionCount = std::clamp<uint32_t> (region_count, 1, MaxRegions);
+			m_RegionSize = std::max<size_t> (region_size, 1);
+			m_RegionStride = (m_RegionSize + RegionAlignment - 1)/RegionAlignment*RegionAlignment;
+			m_Persistent = GLAD_GL_VERSION_4_4 != 0;
+			const GLsizeiptr total_size = GLsizeiptr (m_RegionStride*m_RegionCount);
+
+			// GL_COPY_WRITE_BUFFER so the currently bound VAO/array buffer aren't disturbed
+			glGenBuffers (1, &m_RendererID);
+			glBindBuffer (GL_COPY_WRITE_BUFFER, m_RendererID);
+			if (m_Persistent) {
+				constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				glBufferStorage (GL_COPY_WRITE_BUFFER, total_size, nullptr, flags);
+				m_Mapped = (uint8_t *)glMapBufferRange (GL_COPY_WRITE_BUFFER, 0, total_size, flags);
+				if (!m_Mapped) {
+					LOG_ERROR ("StreamingBuffer: persistent mapping of {0} bytes failed", total_size);
+					m_Persistent = false;
+					glDeleteBuffers (1, &m_RendererID);
+					glGenBuffers (1, &m_RendererID);
+					glBindBuffer (GL_COPY_WRITE_BUFFER, m_RendererID);
+				}
+			}
+			if (!m_Persistent)
+				glBufferData (GL_COPY_WRITE_BUFFER, total_size, nullptr, GL_STREAM_DRAW);
+			glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+			m_Current = m_Writing = 0;
+		}
+
+		void StreamingBuffer::Release ()
+		{
+			for (GLsync &fence : m_Fences) {
+				if (fence)
+					glDeleteSync (fence);
+				fence = nullptr;
+			}
+			if (m_RendererID) {
+				if (m_Mapped) {
+					glBindBuffer (GL_COPY_WRITE_BUFFER, m_RendererID);
+					glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+					glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+				}
+				glDeleteBuffers (1, &m_RendererID);
+			}
+			m_RendererID = 0, m_Mapped = nullptr;
+			m_RegionSize = m_RegionStride = 0;
+			m_RegionCount = m_Current = m_Writing = 0;
+		}
+
+		void *StreamingBuffer::BeginWrite ()
+		{
+			if (!m_RendererID)
+				return nullptr;
+			m_Writing = (m_Current + 1)%m_RegionCount;
+
+			if (GLsync &fence = m_Fences[m_Writing]) {
+				GLCORE_PROFILE_SCOPE ("StreamingBuffer fence wait");
+				GLbitfield wait_flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+				while (true) {
+					GLenum status = glClientWaitSync (fence, wait_flags, 1000000000 /*ns*/);
+					if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED)
+						break;
+					wait_flags = 0; // already flushed once
+				}
+				glDeleteSync (fence);
+				fence = nullptr;
+			}
+
+			if (m_Persistent)
+				return m_Mapped + WriteOffset ();
+
+			// region is known to be idle, no need for the driver to sync
+			glBindBuffer (GL_COPY_WRITE_BUFFER, m_RendererID);
+			void *mapped = glMapBufferRange (GL_COPY_WRITE_BUFFER, WriteOffset (), GLsizeiptr (m_RegionSize)
+											 , GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+			return mapped;
+		}
+
+		void StreamingBuffer::EndWrite ()
+		{
+			if (!m_RendererID)
+				return;
+			if (!m_Persistent) {
+				glBindBuffer (GL_COPY_WRITE_BUFFER, m_RendererID);
+				glUnmapBuffer (GL_COPY_WRITE_BUFFER);
+				glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+			}
+			m_Current = m_Writing;
+		}
+
+		void StreamingBuffer::Fence ()
+		{
+			if (!m_RendererID)
+				return;
+			GLsync &fence = m_Fences[m_Current];
+			if (fence)
+				glDeleteSync (fence);
+			fence = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "GLCore/Core/Core.h"
+#include <glad/glad.h>
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		// Ring of 'region_count' equally sized regions inside one persistently mapped buffer (glBufferStorage, GL 4.4),
+		// CPU writes go straight into mapped memory while the GPU may still be reading the previous regions.
+		// Every region is guarded by a fence, so a write only waits if the GPU is 'region_count' uploads behind.
+		//   void *dst = buffer.BeginWrite (); /* fill dst */ buffer.EndWrite ();
+		//   /* source buffer.GetRendererID () at buffer.CurrentOffset () */ draw (); buffer.Fence ();
+		// Without GL 4.4 the same ring is mapped per write with GL_MAP_UNSYNCHRONIZED_BIT, fences still do the syncing.
+		class StreamingBuffer
+		{
+		public:
+			StreamingBuffer () = default;
+			StreamingBuffer (size_t region_size, uint32_t region_count = 3) { Allocate (region_size, region_count); }
+			~StreamingBuffer () { Release (); }
+			StreamingBuffer (const StreamingBuffer &) = delete;
+			StreamingBuffer &operator= (const StreamingBuffer &) = delete;
+
+			// (re)creates the buffer, regions start at RegionAlignment boundaries so they can be bound as SSBO ranges too
+			void Allocate (size_t region_size, uint32_t region_count = 3);
+			void Release ();
+
+			// Advances to the next region, waits for its fence (if any) and returns its mapped memory
+			void *BeginWrite ();
+			// Makes the written region current, it stays current (for drawing) until the next BeginWrite/EndWrite
+			void EndWrite ();
+			// Place after the last GL command that reads the current region
+			void Fence ();
+
+			// Region the GPU should read (or write through glBindBufferRange) from now on
+			GLintptr CurrentOffset () const { return GLintptr (m_Current)*m_RegionStride; }
+			GLintptr WriteOffset () const { return GLintptr (m_Writing)*m_RegionStride; }
+			size_t RegionSize () const { return m_RegionSize; }
+			GLuint GetRendererID () const { return m_RendererID; }
+			bool IsPersistent () const { return m_Persistent; }
+			bool IsAllocated () const { return m_RendererID != 0; }
+
+			static constexpr size_t RegionAlignment = 256; // >= GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT on desktop GPUs
+			static constexpr uint32_t MaxRegions = 4;
+		private:
+			GLuint m_RendererID = 0;
+			uint8_t *m_Mapped = nullptr; // whole buffer, persistent mapping only
+			size_t m_RegionSize = 0, m_RegionStride = 0;
+			uint32_t m_RegionCount = 0, m_Current = 0, m_Writing = 0;
+			GLsync m_Fences[MaxRegions] = {};
+			bool m_Persistent = false;
+		};
+	}
+}
@@ -0,0 +1,361 @@
+#include "pch.h"
+#include "TextureStreamer.h"
+#include "GLCore/Util/JobSystem.h"
+
+#include <stb_image/stb_image.h>
+#include <glm/gtc/packing.hpp>
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		static constexpr size_t PieceAlignment = 8; // GL wants PBO offsets to be a multiple of the pixel size
+
+		static size_t align_up (size_t size, size_t alignment) { return (size + alignment - 1)/alignment*alignment; }
+
+		// 2x2 box filter, odd sizes repeat their last row/column
+		template<typename T>
+		static void downsample (const T *src, uint32_t src_width, uint32_t src_height, T *dst, uint32_t dst_width, uint32_t dst_height)
+		{
+			for (uint32_t y = 0; y < dst_height; y++) {
+				const T *row0 = src + size_t (std::min (y*2, src_height - 1))*src_width*4, *row1 = src + size_t (std::min (y*2 + 1, src_height - 1))*src_width*4;
+				for (uint32_t x = 0; x < dst_width; x++) {
+					const uint32_t x0 = std::min (x*2, src_width - 1)*4, x1 = std::min (x*2 + 1, src_width - 1)*4;
+					for (uint32_t c = 0; c < 4; c++) {
+						const float sum = float (row0[x0 + c]) + float (row0[x1 + c]) + float (row1[x0 + c]) + float (row1[x1 + c]);
+						if constexpr (std::is_same<T, uint8_t>::value)
+							dst[(size_t (y)*dst_width + x)*4 + c] = uint8_t (sum*0.25f + 0.5f);
+						else
+							dst[(size_t (y)*dst_width + x)*4 + c] = sum*0.25f;
+					}
+				}
+			}
+		}
+
+		// Decode job: file -> (transform) -> mip chain, RGBA8 or half float RGBA, levels back to back
+		template<typename T>
+		static void build_levels (const std::vector<T> &base, uint32_t width, uint32_t height, bool mipmaps, std::vector<std::vector<T>> &out_levels)
+		{
+			out_levels.push_back (base);
+			while (mipmaps && (width > 1 || height > 1)) {
+				const uint32_t next_width = std::max (width/2, 1u), next_height = std::max (height/2, 1u);
+				std::vector<T> next (size_t (next_width)*next_height*4);
+				downsample (out_levels.back ().data (), width, height, next.data (), next_width, next_height);
+				out_levels.push_back (std::move (next));
+				width = next_width, height = next_height;
+			}
+		}
+
+		static bool decode_file (const std::string &path, const DecodeTransform &transform, bool mipmaps, DecodedImage &image, std::vector<uint8_t> &out_pixels, std::vector<std::pair<uint32_t, uint32_t>> &out_sizes)
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			stbi_set_flip_vertically_on_load_thread (1); // the global flag belongs to whoever calls stbi_load on the main thread
+			int width, height, channels;
+			if (stbi_is_hdr (path.c_str ())) {
+				float *data = stbi_loadf (path.c_str (), &width, &height, &channels, 4);
+				if (!data)
+					return false;
+				image.HDR.assign (data, data + size_t (width)*height*4);
+				stbi_image_free (data);
+			} else {
+				stbi_uc *data = stbi_load (path.c_str (), &width, &height, &channels, 4);
+				if (!data)
+					return false;
+				image.LDR.assign (data, data + size_t (width)*height*4);
+				stbi_image_free (data);
+			}
+			image.Width = uint32_t (width), image.Height = uint32_t (height);
+			if (transform && !transform (image))
+				return false;
+			const size_t texels = size_t (image.Width)*image.Height*4;
+			if (texels == 0 || (image.IsHDR () ? image.HDR.size () : image.LDR.size ()) != texels)
+				return false;
+
+			auto append_sizes = [&]() {
+				for (uint32_t w = image.Width, h = image.Height;; w = std::max (w/2, 1u), h = std::max (h/2, 1u)) {
+					out_sizes.push_back ({ w, h });
+					if (!mipmaps || (w == 1 && h == 1))
+						break;
+				}
+			};
+			append_sizes ();
+			if (image.IsHDR ()) {
+				std::vector<std::vector<float>> levels;
+				build_levels (image.HDR, image.Width, image.Height, mipmaps, levels);
+				for (const std::vector<float> &level : levels) {
+					const size_t offset = align_up (out_pixels.size (), PieceAlignment);
+					out_pixels.resize (offset + level.size ()*sizeof (uint16_t));
+					uint16_t *half = reinterpret_cast<uint16_t *> (out_pixels.data () + offset);
+					for (size_t i = 0; i < level.size (); i++)
+						half[i] = glm::packHalf1x16 (level[i]);
+				}
+			} else {
+				std::vector<std::vector<uint8_t>> levels;
+				build_levels (image.LDR, image.Width, image.Height, mipmaps, levels);
+				for (const std::vector<uint8_t> &level : levels) {
+					const size_t offset = align_up (out_pixels.size (), PieceAlignment);
+					out_pixels.resize (offset + level.size ());
+					memcpy (out_pixels.data () + offset, level.data (), level.size ());
+				}
+			}
+			return true;
+		}
+
+		TextureStreamer::TextureStreamer (const Settings &settings)
+			: m_Settings (settings), m_Decoded (std::make_shared<DecodeQueue> ())
+		{}
+
+		TextureStreamer::~TextureStreamer ()
+		{
+			Release ();
+		}
+
+		void TextureStreamer::Release ()
+		{
+			{
+				std::lock_guard lock (m_Decoded->Mutex);
+				m_Decoded->Closed = true;
+			}
+			m_Decoded = std::make_shared<DecodeQueue> ();
+			m_Decoding = 0;
+
+			for (auto &[key, entry] : m_Entries)
+				if (entry.RendererID)
+					glDeleteTextures (1, &entry.RendererID);
+			for (Upload &upload : m_Uploads)
+				if (upload.RendererID)
+					glDeleteTextures (1, &upload.RendererID);
+			if (m_Placeholder)
+				glDeleteTextures (1, &m_Placeholder);
+			m_Entries.clear (), m_Recent.clear (), m_Uploads.clear ();
+			m_Placeholder = 0, m_CachedBytes = 0;
+			m_Staging.Release ();
+		}
+
+		GLuint TextureStreamer::Acquire (const std::string &path, const std::string &variant, const DecodeTransform &transform)
+		{
+			ensure_placeholder ();
+			const std::string key = make_key (path, variant);
+			const clock_type::time_point now = clock_type::now ();
+			auto [it, inserted] = m_Entries.try_emplace (key);
+			Entry &entry = it->second;
+			std::error_code error;
+			if (inserted) {
+				entry.Path = path, entry.Transform = transform;
+				entry.ModificationTime = std::filesystem::last_write_time (path, error);
+				entry.LastChecked = now;
+				m_Recent.push_front (key);
+				entry.Recent = m_Recent.begin ();
+				start_decode (key, entry);
+			} else {
+				m_Recent.splice (m_Recent.begin (), m_Recent, entry.Recent);
+				if (std::chrono::duration<double> (now - entry.LastChecked).count () >= m_Settings.RecheckSeconds) {
+					entry.LastChecked = now;
+					const std::filesystem::file_time_type modified = std::filesystem::last_write_time (path, error);
+					if (!error && modified != entry.ModificationTime) {
+						entry.ModificationTime = modified;
+						start_decode (key, entry);
+					}
+				}
+			}
+			entry.LastUsedFrame = m_Frame;
+			return entry.RendererID ? entry.RendererID : m_Placeholder;
+		}
+
+		TextureStreamer::TextureInfo TextureStreamer::Info (const std::string &path, const std::string &variant) const
+		{
+			TextureInfo info;
+			info.RendererID = m_Placeholder;
+			auto it = m_Entries.find (make_key (path, variant));
+			if (it == m_Entries.end ())
+				return info;
+			const Entry &entry = it->second;
+			info.Status = entry.Status;
+			if (entry.RendererID)
+				info.RendererID = entry.RendererID, info.Width = entry.Width, info.Height = entry.Height;
+			return info;
+		}
+
+		bool TextureStreamer::Busy () const
+		{
+			return m_Decoding > 0 || !m_Uploads.empty ();
+		}
+
+		void TextureStreamer::start_decode (const std::string &key, Entry &entry)
+		{
+			entry.Generation = ++m_Generation;
+			if (!entry.RendererID)
+				entry.Status = State::Loading;
+			m_Decoding++;
+			JobSystem::Submit ([queue = m_Decoded, key, generation = entry.Generation, path = entry.Path, transform = entry.Transform, mipmaps = m_Settings.Mipmaps]() {
+				GLCORE_PROFILE_SCOPE ("TextureStreamer decode");
+				Decoded decoded;
+				decoded.Key = key, decoded.Generation = generation;
+				DecodedImage image;
+				std::vector<std::pair<uint32_t, uint32_t>> sizes;
+				decoded.Failed = !decode_file (path, transform, mipmaps, image, decoded.Pixels, sizes);
+				if (!decoded.Failed) {
+					decoded.HDR = image.IsHDR ();
+					const size_t pixel_size = decoded.HDR ? 8 : 4;
+					size_t offset = 0;
+					for (auto [width, height] : sizes) {
+						offset = align_up (offset, PieceAlignment);
+						decoded.Levels.push_back ({ width, height, offset });
+						offset += size_t (width)*height*pixel_size;
+					}
+				}
+				std::lock_guard lock (queue->Mutex);
+				if (!queue->Closed)
+					queue->Done.push_back (std::move (decoded));
+			});
+		}
+
+		void TextureStreamer::ensure_placeholder ()
+		{
+			if (m_Placeholder)
+				return;
+			const uint8_t checker[2*2*4] = { 96, 96, 96, 255,  160, 160, 160, 255,  160, 160, 160, 255,  96, 96, 96, 255 };
+			GLint last_texture;
+			glGetIntegerv (GL_TEXTURE_BINDING_2D, &last_texture);
+			glGenTextures (1, &m_Placeholder);
+			glBindTexture (GL_TEXTURE_2D, m_Placeholder);
+			glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+			glBindTexture (GL_TEXTURE_2D, GLuint (last_texture));
+		}
+
+		void TextureStreamer::Update ()
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			m_Frame++;
+
+			std::deque<Decoded> done;
+			{
+				std::lock_guard lock (m_Decoded->Mutex);
+				done.swap (m_Decoded->Done);
+			}
+			for (Decoded &decoded : done) {
+				m_Decoding--;
+				auto it = m_Entries.find (decoded.Key);
+				if (it == m_Entries.end () || it->second.Generation != decoded.Generation) // evicted or reloaded since
+					continue;
+				if (decoded.Failed) {
+					LOG_ERROR ("TextureStreamer: cannot load '{0}'", it->second.Path);
+					if (!it->second.RendererID)
+						it->second.Status = State::Failed;
+					continue;
+				}
+				Upload upload;
+				upload.Image = std::move (decoded);
+				m_Uploads.push_back (std::move (upload));
+			}
+
+			if (!m_Uploads.empty ()) {
+				// a single row always has to fit
+				const Level &widest = m_Uploads.front ().Image.Levels[0];
+				const size_t region_size = std::max (m_Settings.UploadBytesPerFrame, size_t (widest.Width)*(m_Uploads.front ().Image.HDR ? 8 : 4) + PieceAlignment);
+				if (!m_Staging.IsAllocated () || m_Staging.RegionSize () < region_size)
+					m_Staging.Allocate (region_size, 3);
+
+				GLint last_texture, last_unpack_alignment;
+				glGetIntegerv (GL_TEXTURE_BINDING_2D, &last_texture);
+				glGetIntegerv (GL_UNPACK_ALIGNMENT, &last_unpack_alignment);
+				glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+
+				m_StagingWrite = (uint8_t *)m_Staging.BeginWrite ();
+				m_StagingUsed = 0;
+				while (!m_Uploads.empty () && upload_chunk ()) {}
+				m_Staging.EndWrite ();
+
+				glBindBuffer (GL_PIXEL_UNPACK_BUFFER, m_Staging.GetRendererID ());
+				for (const Piece &piece : m_Pieces) {
+					glBindTexture (GL_TEXTURE_2D, piece.RendererID);
+					glTexSubImage2D (GL_TEXTURE_2D, GLint (piece.Level), 0, GLint (piece.Row), GLsizei (piece.Width), GLsizei (piece.Rows)
+									 , GL_RGBA, piece.HDR ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE, (const void *)(m_Staging.CurrentOffset () + piece.Offset));
+				}
+				glBindBuffer (GL_PIXEL_UNPACK_BUFFER, 0);
+				m_Staging.Fence ();
+				m_Pieces.clear ();
+				m_StagingWrite = nullptr;
+
+				glBindTexture (GL_TEXTURE_2D, GLuint (last_texture));
+				glPixelStorei (GL_UNPACK_ALIGNMENT, last_unpack_alignment);
+
+				for (Upload &upload : m_Finished) {
+					auto it = m_Entries.find (upload.Image.Key);
+					if (it == m_Entries.end () || it->second.Generation != upload.Image.Generation) {
+						glDeleteTextures (1, &upload.RendererID);
+						continue;
+					}
+					Entry &entry = it->second;
+					if (entry.RendererID) // replaced by the file's newer version
+						glDeleteTextures (1, &entry.RendererID);
+					m_CachedBytes -= entry.Bytes;
+					entry.RendererID = upload.RendererID;
+					entry.Width = upload.Image.Levels[0].Width, entry.Height = upload.Image.Levels[0].Height;
+					entry.Bytes = upload.Image.Pixels.size ();
+					entry.Status = State::Ready;
+					m_CachedBytes += entry.Bytes;
+				}
+				m_Finished.clear ();
+			}
+			evict ();
+		}
+
+		bool TextureStreamer::upload_chunk ()
+		{
+			Upload &upload = m_Uploads.front ();
+			const Decoded &image = upload.Image;
+			const size_t pixel_size = image.HDR ? 8 : 4;
+			if (!upload.RendererID) { // every level is defined up front, so the texture is complete once the last chunk landed
+				glGenTextures (1, &upload.RendererID);
+				glBindTexture (GL_TEXTURE_2D, upload.RendererID);
+				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.Levels.size () > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+				glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint (image.Levels.size () - 1));
+				for (uint32_t level = 0; level < image.Levels.size (); level++)
+					glTexImage2D (GL_TEXTURE_2D, GLint (level), image.HDR ? GL_RGBA16F : GL_RGBA8, GLsizei (image.Levels[level].Width), GLsizei (image.Levels[level].Height), 0
+								  , GL_RGBA, image.HDR ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE, nullptr);
+			}
+
+			const Level &level = image.Levels[upload.Level];
+			const size_t row_size = size_t (level.Width)*pixel_size;
+			const size_t offset = align_up (m_StagingUsed, PieceAlignment);
+			const size_t room = m_Staging.RegionSize () > offset ? m_Staging.RegionSize () - offset : 0;
+			const uint32_t rows = uint32_t (std::min<size_t> (room/row_size, level.Height - upload.Row));
+			if (rows == 0)
+				return false;
+
+			memcpy (m_StagingWrite + offset, image.Pixels.data () + level.Offset + upload.Row*row_size, rows*row_size);
+			m_Pieces.push_back ({ upload.RendererID, upload.Level, upload.Row, level.Width, rows, image.HDR, offset });
+			m_StagingUsed = offset + rows*row_size;
+
+			upload.Row += rows;
+			if (upload.Row == level.Height)
+				upload.Level++, upload.Row = 0;
+			if (upload.Level == image.Levels.size ()) {
+				m_Finished.push_back (std::move (upload));
+				m_Uploads.pop_front ();
+			}
+			return true;
+		}
+
+		void TextureStreamer::evict ()
+		{
+			while (m_CachedBytes > m_Settings.CacheBytes && !m_Recent.empty ()) {
+				auto it = m_Entries.find (m_Recent.back ());
+				Entry &entry = it->second;
+				if (entry.LastUsedFrame + 1 >= m_Frame) // everything else was used more recently too
+					break;
+				if (entry.RendererID)
+					glDeleteTextures (1, &entry.RendererID);
+				m_CachedBytes -= entry.Bytes;
+				m_Recent.pop_back ();
+				m_Entries.erase (it);
+			}
+		}
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "GLCore/Core/Core.h"
+#include "StreamingBuffer.h"
+
+#include <list>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+
+namespace GLCore
+{
+	namespace Utils
+	{
+		// Freshly decoded file, 4 channels, bottom row first (GL's order). HDR files (stbi_is_hdr) fill HDR, everything else LDR.
+		struct DecodedImage
+		{
+			uint32_t Width = 0, Height = 0;
+			std::vector<uint8_t> LDR;
+			std::vector<float> HDR;
+
+			bool IsHDR () const { return !HDR.empty (); }
+		};
+		// Runs on the decode worker before mip levels are built (projection changes and such), false fails the load
+		using DecodeTransform = std::function<bool(DecodedImage &image)>;
+
+		// Textures loaded from disk without stalling the frame:
+		//  - decoding (stb_image) and the mip chain are built on the JobSystem
+		//  - uploads go through a StreamingBuffer bound as GL_PIXEL_UNPACK_BUFFER, at most UploadBytesPerFrame every Update
+		//  - until then Acquire hands out a small placeholder, a file changed on disk keeps its old texture until the new one is in
+		//  - textures are cached by path (+ variant) and modification time, least recently used ones go past CacheBytes
+		//   GLuint texture = streamer.Acquire ("assets/env.hdr"); // every frame, GL thread
+		//   streamer.Update ();                                   // once a frame, GL thread
+		// LDR files become RGBA8 textures, HDR ones RGBA16F.
+		class TextureStreamer
+		{
+		public:
+			struct Settings
+			{
+				size_t UploadBytesPerFrame = 4 << 20;
+				size_t CacheBytes = 512 << 20; // textures in use this frame are never evicted
+				bool Mipmaps = true;
+				double RecheckSeconds = 1.0;   // how often Acquire looks at a file's modification time
+			};
+			enum class State { Loading, Ready, Failed };
+			struct TextureInfo
+			{
+				GLuint RendererID = 0; // placeholder while not Ready
+				uint32_t Width = 0, Height = 0;
+				State Status = State::Loading;
+			};
+
+			TextureStreamer () : TextureStreamer (Settings ()) {}
+			TextureStreamer (const Settings &settings);
+			~TextureStreamer ();
+			TextureStreamer (const TextureStreamer &) = delete;
+			TextureStreamer &operator= (const TextureStreamer &) = delete;
+
+			// Deletes every texture and the staging buffer, call while the context is still current. Decodes in flight are dropped.
+			void Release ();
+
+			// 'variant' tells apart entries of the same file that differ by 'transform' (which is only used when the file gets (re)loaded)
+			GLuint Acquire (const std::string &path, const std::string &variant = {}, const DecodeTransform &transform = {});
+			TextureInfo Info (const std::string &path, const std::string &variant = {}) const;
+			// Picks up finished decodes, uploads the next chunk, evicts past CacheBytes
+			void Update ();
+
+			// Decodes/uploads outstanding, keep frames coming while true (on-demand rendering sleeps otherwise)
+			bool Busy () const;
+			size_t CachedBytes () const { return m_CachedBytes; }
+			size_t CachedCount () const { return m_Entries.size (); }
+		private:
+			using clock_type = std::chrono::steady_clock;
+			struct Level
+			{
+				uint32_t Width, Height;
+				size_t Offset; // into Decoded::Pixels
+			};
+			struct Decoded
+			{
+				std::string Key;
+				uint64_t Generation = 0;
+				bool Failed = false;
+				bool HDR = false; // RGBA16F as half floats, RGBA8 otherwise
+				std::vector<uint8_t> Pixels;
+				std::vector<Level> Levels;
+			};
+			// handed to the decode jobs, so they may outlive the streamer
+			struct DecodeQueue
+			{
+				std::mutex Mutex;
+				std::deque<Decoded> Done;
+				bool Closed = false;
+			};
+			struct Entry
+			{
+				std::string Path;
+				std::filesystem::file_time_type ModificationTime;
+				GLuint RendererID = 0; // last complete upload
+				uint32_t Width = 0, Height = 0;
+				size_t Bytes = 0;
+				State Status = State::Loading;
+				uint64_t Generation = 0, LastUsedFrame = 0;
+				clock_type::time_point LastChecked;
+				DecodeTransform Transform;
+				std::list<std::string>::iterator Recent;
+			};
+			struct Upload
+			{
+				Decoded Image;
+				GLuint RendererID = 0;
+				uint32_t Level = 0, Row = 0; // next rows to copy
+			};
+			// rows copied into this frame's staging region, glTexSubImage2D'd once the region is written
+			struct Piece
+			{
+				GLuint RendererID;
+				uint32_t Level, Row, Width, Rows;
+				bool HDR;
+				size_t Offset; // in the region
+			};
+			void start_decode (const std::string &key, Entry &entry);
+			void ensure_placeholder ();
+			bool upload_chunk (); // copies rows of the front upload, false once the staging region is full
+			void evict ();
+			static std::string make_key (const std::string &path, const std::string &variant) { return variant.empty () ? path : path + "|" + variant; }
+		private:
+			const Settings m_Settings;
+			std::unordered_map<std::string, Entry> m_Entries;
+			std::list<std::string> m_Recent; // most recently acquired first
+			std::shared_ptr<DecodeQueue> m_Decoded;
+			uint32_t m_Decoding = 0;
+
+			std::deque<Upload> m_Uploads; // front is being uploaded
+			std::vector<Upload> m_Finished;
+			std::vector<Piece> m_Pieces;
+			StreamingBuffer m_Staging;
+			uint8_t *m_StagingWrite = nullptr; // region mapped this Update
+			size_t m_StagingUsed = 0;
+
+			GLuint m_Placeholder = 0;
+			size_t m_CachedBytes = 0;
+			uint64_t m_Frame = 0, m_Generation = 0;
+		};
+	}
+}
@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "JobSystem.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+
+namespace GLCore::Utils
+{
+	struct WorkerPool
+	{
+		std::vector<std::thread> Workers;
+		std::deque<std::function<void()>> Queue;
+		std::mutex QueueMutex;
+		std::condition_variable WakeUp;
+		bool Quit = false;
+	};
+	static WorkerPool *s_Pool = nullptr;
+	static std::mutex s_PoolMutex;
+
+	static void WorkerLoop (WorkerPool *pool, uint32_t index)
+	{
+		GLCORE_PROFILE_THREAD_NAME (("JobSystem Worker " + std::to_string (index)).c_str ());
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock lock (pool->QueueMutex);
+				pool->WakeUp.wait (lock, [pool] { return pool->Quit || !pool->Queue.empty (); });
+				if (pool->Quit && pool->Queue.empty ())
+					return;
+				task = std::move (pool->Queue.front ());
+				pool->Queue.pop_front ();
+			}
+			task ();
+		}
+	}
+
+	// expects s_PoolMutex to be held
+	static WorkerPool *CreatePool (uint32_t num_threads)
+	{
+		if (num_threads == 0)
+			num_threads = std::max (std::thread::hardware_concurrency (), 1u);
+		const uint32_t num_workers = num_threads - 1; // calling thread does the rest
+		WorkerPool *pool = new WorkerPool ();
+		pool->Workers.reserve (num_workers);
+		for (uint32_t i = 0; i < num_workers; i++)
+			pool->Workers.emplace_back (WorkerLoop, pool, i);
+		return pool;
+	}
+
+	// Lazily brings the pool up, so tools that never call Init (benchmarks, etc.) still work
+	static WorkerPool &GetPool ()
+	{
+		std::lock_guard lock (s_PoolMutex);
+		if (!s_Pool)
+			s_Pool = CreatePool (0);
+		return *s_Pool;
+	}
+
+	static void Enqueue (WorkerPool &pool, std::function<void()> task, uint32_t copies = 1)
+	{
+		{
+			std::lock_guard lock (pool.QueueMutex);
+			for (uint32_t i = 1; i < copies; i++)
+				pool.Queue.push_back (task);
+			pool.Queue.push_back (std::move (task));
+		}
+		if (copies > 1)
+			pool.WakeUp.notify_all ();
+		else
+			pool.WakeUp.notify_one ();
+	}
+
+	void JobSystem::Init (uint32_t num_threads)
+	{
+		Shutdown ();
+
+		std::lock_guard lock (s_PoolMutex);
+		if (!s_Pool)
+			s_Pool = CreatePool (num_threads);
+	}
+
+	void JobSystem::Shutdown ()
+	{
+		WorkerPool *pool;
+		{
+			std::lock_guard lock (s_PoolMutex);
+			pool = s_Pool;
+			s_Pool = nullptr;
+		}
+		if (!pool)
+			return;
+		{
+			std::lock_guard lock (pool->QueueMutex);
+			pool->Quit = true;
+		}
+		pool->WakeUp.notify_all ();
+		for (std::thread &worker : pool->Workers)
+			worker.join ();
+		delete pool;
+	}
+
+	uint32_t JobSystem::Concurrency ()
+	{
+		return uint32_t (GetPool ().Workers.size ()) + 1;
+	}
+
+	void JobSystem::ParallelFor (size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &func)
+	{
+		if (count == 0)
+			return;
+		WorkerPool &pool = GetPool ();
+
+		const size_t threads = pool.Workers.size () + 1;
+		// at most ~8 chunks per thread, keeps claiming overhead low while still balancing uneven work
+		size_t chunk = std::max<size_t> (std::max<size_t> (grain, 1), (count + threads*8 - 1)/(threads*8));
+		size_t num_chunks = (count + chunk - 1)/chunk;
+		if (threads == 1 || num_chunks == 1) {
+			func (0, count);
+			return;
+		}
+
+		// Shared with helpers, late helpers (that start after all chunks are taken) only touch the counters
+		struct LoopState
+		{
+			std::atomic<size_t> NextChunk = 0;
+			std::atomic<size_t> ChunksDone = 0;
+			size_t Count, ChunkSize, NumChunks;
+			const std::function<void(size_t, size_t)> *Func;
+			std::mutex DoneMutex;
+			std::condition_variable Done;
+		};
+		auto state = std::make_shared<LoopState> ();
+		state->Count = count, state->ChunkSize = chunk, state->NumChunks = num_chunks, state->Func = &func;
+
+		auto work = [state]() {
+			size_t chunk_index;
+			while ((chunk_index = state->NextChunk.fetch_add (1)) < state->NumChunks) {
+				size_t begin = chunk_index*state->ChunkSize;
+				size_t end = std::min (begin + state->ChunkSize, state->Count);
+				{
+					GLCORE_PROFILE_SCOPE ("ParallelFor chunk");
+					(*state->Func) (begin, end);
+				}
+				if (state->ChunksDone.fetch_add (1) + 1 == state->NumChunks) {
+					std::lock_guard lock (state->DoneMutex);
+					state->Done.notify_all ();
+				}
+			}
+		};
+
+		Enqueue (pool, work, uint32_t (std::min (threads, num_chunks) - 1));
+		work ();
+
+		std::unique_lock lock (state->DoneMutex);
+		state->Done.wait (lock, [&] { return state->ChunksDone.load () == state->NumChunks; });
+	}
+
+	std::future<void> JobSystem::Submit (std::function<void()> task)
+	{
+		WorkerPool &pool = GetPool ();
+		auto packaged = std::make_shared<std::packaged_task<void()>> (std::move (task));
+		std::future<void> future = packaged->get_future ();
+		if (pool.Workers.empty ()) { // nothing to hand it to, run in place
+			(*packaged) ();
+			return future;
+		}
+		Enqueue (pool, [packaged]() { (*packaged) (); });
+		return future;
+	}
+}
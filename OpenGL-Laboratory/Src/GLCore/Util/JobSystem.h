@@ -0,0 +1,25 @@
+#pragma once
+
+#include <functional>
+#include <future>
+
+namespace GLCore::Utils
+{
+	// Process wide worker pool, parallel loops should go through here instead of spawning their own std::thread's.
+	// Calling thread always takes part in a ParallelFor, so nesting ParallelFor inside a job can't dead-lock.
+	class JobSystem
+	{
+	public:
+		// num_threads counts the calling thread too, 0 -> std::thread::hardware_concurrency ()
+		static void Init (uint32_t num_threads = 0);
+		static void Shutdown ();
+
+		// Threads a ParallelFor can run on, including the calling thread
+		static uint32_t Concurrency ();
+
+		// Runs func (begin, end) over [0, count), chunks are never smaller than 'grain' elements (except the last one)
+		static void ParallelFor (size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &func);
+
+		static std::future<void> Submit (std::function<void()> task);
+	};
+}
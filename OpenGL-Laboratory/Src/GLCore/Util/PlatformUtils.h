@@ -11,4 +11,14 @@ namespace GLCore::Utils
 		// returns Empty string if canceled
 		static std::string SaveFile (const char *filter);
 	};
+
+	class Memory
+	{
+	public:
+		// Physical memory (working set) used by this process, now and at its peak
+		static size_t CurrentResidentBytes ();
+		static size_t PeakResidentBytes ();
+		// Committed memory private to this process (heaps, stacks), unlike the working set it doesn't shrink when paged out
+		static size_t PrivateBytes ();
+	};
 }
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Shader.h"
+#include "ShaderCompiler.h"
 
 #include <fstream>
 
@@ -30,34 +31,6 @@ namespace GLCore::Utils {
 		glDeleteProgram(m_RendererID);
 	}
 
-	GLuint Shader::CompileShader(GLenum type, const std::string& source)
-	{
-		GLuint shader = glCreateShader(type);
-
-		const GLchar* sourceCStr = source.c_str();
-		glShaderSource(shader, 1, &sourceCStr, 0);
-
-		glCompileShader(shader);
-
-		GLint isCompiled = 0;
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
-		if (isCompiled == GL_FALSE)
-		{
-			GLint maxLength = 0;
-			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
-
-			std::vector<GLchar> infoLog(maxLength);
-			glGetShaderInfoLog(shader, maxLength, &maxLength, &infoLog[0]);
-
-			glDeleteShader(shader);
-
-			LOG_ERROR("{0}", infoLog.data());
-			// HZ_CORE_ASSERT(false, "Shader compilation failure!");
-		}
-
-		return shader;
-	}
-
 	Shader* Shader::FromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath)
 	{
 		Shader* shader = new Shader();
@@ -70,41 +43,11 @@ namespace GLCore::Utils {
 		std::string vertexSource = ReadFileAsString(vertexShaderPath);
 		std::string fragmentSource = ReadFileAsString(fragmentShaderPath);
 
-		GLuint program = glCreateProgram();
-		int glShaderIDIndex = 0;
-			
-		GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexSource);
-		glAttachShader(program, vertexShader);
-		GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentSource);
-		glAttachShader(program, fragmentShader);
-
-		glLinkProgram(program);
-
-		GLint isLinked = 0;
-		glGetProgramiv(program, GL_LINK_STATUS, (int*)&isLinked);
-		if (isLinked == GL_FALSE)
-		{
-			GLint maxLength = 0;
-			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
-
-			std::vector<GLchar> infoLog(maxLength);
-			glGetProgramInfoLog(program, maxLength, &maxLength, &infoLog[0]);
-
-			glDeleteProgram(program);
-
-			glDeleteShader(vertexShader);
-			glDeleteShader(fragmentShader);
-
-			LOG_ERROR("{0}", infoLog.data());
-			// HZ_CORE_ASSERT(false, "Shader link failure!");
-		}
-		
-		glDetachShader(program, vertexShader);
-		glDetachShader(program, fragmentShader);
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
-
-		m_RendererID = program;
+		// through the program binary cache, unchanged sources skip compiling
+		std::string log;
+		m_RendererID = ShaderCompiler::BuildNow({ { GL_VERTEX_SHADER, vertexSource }, { GL_FRAGMENT_SHADER, fragmentSource } }, &log);
+		if (!m_RendererID)
+			LOG_ERROR("{0}", log);
 	}
 
 }
\ No newline at end of file
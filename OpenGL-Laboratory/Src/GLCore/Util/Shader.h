@@ -18,7 +18,6 @@ namespace GLCore::Utils {
 		Shader() = default;
 
 		void LoadFromGLSLTextFiles(const std::string& vertexShaderPath, const std::string& fragmentShaderPath);
-		GLuint CompileShader(GLenum type, const std::string& source);
 	private:
 		GLuint m_RendererID;
 	};
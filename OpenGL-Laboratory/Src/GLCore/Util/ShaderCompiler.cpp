@@ -0,0 +1,453 @@
+#include "pch.h"
+#include "ShaderCompiler.h"
+#include "JobSystem.h"
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <condition_variable>
+
+// KHR_parallel_shader_compile, the bundled glad is generated without extensions
+#define GLCORE_COMPLETION_STATUS_KHR 0x91B1
+
+namespace GLCore::Utils
+{
+	using Status = ShaderCompiler::Status;
+
+	struct BuildJob
+	{
+		std::vector<ShaderStage> Stages;
+		uint64_t Key = 0;
+		GLuint Program = 0;
+		std::vector<GLuint> Shaders; // KHR path, until the link completed
+		Status State = Status::Compiling;
+		std::string Log;
+		bool Cancelled = false;
+	};
+
+	struct CompilerState
+	{
+		std::string CacheDirectory = "shader_cache";
+		bool DriverQueried = false;
+		uint64_t DriverHash = 0;              // vendor/renderer/version, binaries don't survive driver changes
+		std::vector<GLint> BinaryFormats;     // empty -> no program binaries, nothing gets cached
+		bool ParallelCompile = false;
+
+		std::function<void(bool)> BindWorkerContext;
+		std::thread Worker;
+		std::mutex Mutex;                     // Queue, Quit and the State/Program/Log of jobs on the worker
+		std::condition_variable WakeUp;
+		std::deque<std::shared_ptr<BuildJob>> Queue;
+		bool Quit = false;
+
+		std::unordered_map<uint64_t, std::shared_ptr<BuildJob>> Jobs; // main thread only
+		uint64_t NextTicket = 1;
+		std::atomic<uint32_t> Hits{ 0 }, Misses{ 0 };
+	};
+	static CompilerState s_Compiler;
+
+	static uint64_t fnv1a (uint64_t hash, const void *data, size_t size)
+	{
+		const uint8_t *bytes = static_cast<const uint8_t *> (data);
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i])*0x100000001B3ull;
+		return hash;
+	}
+
+	// GL thread, the first time a key is needed
+	static void query_driver ()
+	{
+		if (s_Compiler.DriverQueried)
+			return;
+		s_Compiler.DriverQueried = true;
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			const char *value = (const char *)glGetString (name);
+			if (value)
+				hash = fnv1a (hash, value, strlen (value) + 1);
+		}
+		s_Compiler.DriverHash = hash;
+
+		GLint num_formats = 0;
+		glGetIntegerv (GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+		s_Compiler.BinaryFormats.resize (size_t (std::max (num_formats, 0)));
+		if (num_formats > 0)
+			glGetIntegerv (GL_PROGRAM_BINARY_FORMATS, s_Compiler.BinaryFormats.data ());
+	}
+
+	static uint64_t cache_key (const std::vector<ShaderStage> &stages)
+	{
+		uint64_t hash = s_Compiler.DriverHash;
+		for (const ShaderStage &stage : stages) {
+			const uint64_t size = stage.Source.size ();
+			hash = fnv1a (hash, &stage.Type, sizeof (stage.Type));
+			hash = fnv1a (hash, &size, sizeof (size));
+			hash = fnv1a (hash, stage.Source.data (), stage.Source.size ());
+		}
+		return hash;
+	}
+
+	// <cache directory>/<key>.bin: header followed by what glGetProgramBinary returned
+	struct CacheHeader
+	{
+		char Magic[4] = { 'G', 'L', 'P', 'B' };
+		uint32_t Version = 1;
+		uint64_t Key = 0;
+		uint32_t Format = 0, Size = 0;
+	};
+
+	static std::filesystem::path cache_path (uint64_t key)
+	{
+		char name[24];
+		snprintf (name, sizeof (name), "%016llx.bin", (unsigned long long)key);
+		return std::filesystem::path (s_Compiler.CacheDirectory) / name;
+	}
+
+	// 0 on a miss, a binary the driver doesn't take anymore is deleted
+	static GLuint load_cached (uint64_t key)
+	{
+		if (s_Compiler.BinaryFormats.empty ())
+			return 0;
+		GLCORE_PROFILE_FUNCTION ();
+		const std::filesystem::path path = cache_path (key);
+		std::ifstream file (path, std::ios::binary);
+		if (!file)
+			return 0;
+
+		CacheHeader header, expected;
+		std::vector<char> binary;
+		file.read ((char *)&header, sizeof (header));
+		bool valid = file && memcmp (header.Magic, expected.Magic, 4) == 0 && header.Version == expected.Version && header.Key == key
+			&& std::find (s_Compiler.BinaryFormats.begin (), s_Compiler.BinaryFormats.end (), GLint (header.Format)) != s_Compiler.BinaryFormats.end ();
+		if (valid) {
+			binary.resize (header.Size);
+			file.read (binary.data (), binary.size ());
+			valid = bool (file);
+		}
+		file.close ();
+
+		GLuint program = 0;
+		if (valid) {
+			program = glCreateProgram ();
+			glProgramBinary (program, header.Format, binary.data (), GLsizei (binary.size ()));
+			GLint linked = GL_FALSE;
+			glGetProgramiv (program, GL_LINK_STATUS, &linked);
+			if (linked == GL_FALSE) {
+				glDeleteProgram (program);
+				program = 0;
+			}
+		}
+		if (!program) {
+			LOG_WARN ("ShaderCompiler: cached binary '{0}' rejected, rebuilding from source", path.string ());
+			std::error_code error;
+			std::filesystem::remove (path, error);
+		}
+		return program;
+	}
+
+	static void write_cached (uint64_t key, GLenum format, std::vector<char> binary)
+	{
+		const std::filesystem::path path = cache_path (key);
+		std::error_code error;
+		std::filesystem::create_directories (path.parent_path (), error);
+
+		// written next to it and renamed, a build racing for the same key never sees half a file
+		const std::filesystem::path temp_path = path.string () + "." + std::to_string (std::hash<std::thread::id> () (std::this_thread::get_id ())) + ".tmp";
+		{
+			std::ofstream file (temp_path, std::ios::binary);
+			CacheHeader header;
+			header.Key = key, header.Format = format, header.Size = uint32_t (binary.size ());
+			file.write ((const char *)&header, sizeof (header));
+			file.write (binary.data (), binary.size ());
+			if (!file) {
+				LOG_WARN ("ShaderCompiler: could not write '{0}'", temp_path.string ());
+				file.close ();
+				std::filesystem::remove (temp_path, error);
+				return;
+			}
+		}
+		std::filesystem::rename (temp_path, path, error);
+		if (error)
+			std::filesystem::remove (temp_path, error);
+	}
+
+	// GL thread, 'write_async' hands the file write to the JobSystem
+	static void save_binary (uint64_t key, GLuint program, bool write_async)
+	{
+		if (s_Compiler.BinaryFormats.empty ())
+			return;
+		GLint length = 0;
+		glGetProgramiv (program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary (length);
+		GLenum format = 0;
+		glGetProgramBinary (program, length, &length, &format, binary.data ());
+		binary.resize (size_t (length));
+		if (write_async)
+			JobSystem::Submit ([key, format, binary = std::move (binary)]() mutable { write_cached (key, format, std::move (binary)); });
+		else
+			write_cached (key, format, std::move (binary));
+	}
+
+	// Only issues the work, with KHR_parallel_shader_compile nothing in here waits for the compiler
+	static GLuint create_program (const std::vector<ShaderStage> &stages, std::vector<GLuint> &out_shaders)
+	{
+		GLuint program = glCreateProgram ();
+		for (const ShaderStage &stage : stages) {
+			GLuint shader = glCreateShader (stage.Type);
+			const GLchar *source = stage.Source.c_str ();
+			glShaderSource (shader, 1, &source, NULL);
+			glCompileShader (shader);
+			glAttachShader (program, shader);
+			out_shaders.push_back (shader);
+		}
+		glProgramParameteri (program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram (program);
+		return program;
+	}
+
+	// Link result, logs of whatever failed, deletes the shaders (and the program if it didn't link)
+	static bool finish_program (GLuint &program, std::vector<GLuint> &shaders, std::string &out_log)
+	{
+		GLint linked = GL_FALSE;
+		glGetProgramiv (program, GL_LINK_STATUS, &linked);
+		auto append_log = [&out_log](GLint length, auto get_log) {
+			if (length <= 1)
+				return;
+			std::string log (size_t (length), '\0');
+			get_log (length, log.data ());
+			out_log += log.c_str ();
+		};
+		if (linked == GL_FALSE) {
+			for (GLuint shader : shaders) {
+				GLint compiled = GL_FALSE, length = 0;
+				glGetShaderiv (shader, GL_COMPILE_STATUS, &compiled);
+				glGetShaderiv (shader, GL_INFO_LOG_LENGTH, &length);
+				if (compiled == GL_FALSE)
+					append_log (length, [shader](GLint size, char *log) { glGetShaderInfoLog (shader, size, nullptr, log); });
+			}
+			GLint length = 0;
+			glGetProgramiv (program, GL_INFO_LOG_LENGTH, &length);
+			append_log (length, [program](GLint size, char *log) { glGetProgramInfoLog (program, size, nullptr, log); });
+		}
+		for (GLuint shader : shaders) {
+			glDetachShader (program, shader);
+			glDeleteShader (shader);
+		}
+		shaders.clear ();
+		if (linked == GL_FALSE) {
+			glDeleteProgram (program);
+			program = 0;
+		}
+		return linked != GL_FALSE;
+	}
+
+	// Cache first, then a full compile, blocks until the program is linked
+	static GLuint build_blocking (const std::vector<ShaderStage> &stages, uint64_t key, std::string &out_log, bool write_async)
+	{
+		if (GLuint program = load_cached (key)) {
+			s_Compiler.Hits++;
+			return program;
+		}
+		s_Compiler.Misses++;
+		std::vector<GLuint> shaders;
+		GLuint program = create_program (stages, shaders);
+		if (finish_program (program, shaders, out_log))
+			save_binary (key, program, write_async);
+		return program;
+	}
+
+	static void worker_loop ()
+	{
+		GLCORE_PROFILE_THREAD_NAME ("ShaderCompiler Worker");
+		s_Compiler.BindWorkerContext (true);
+		while (true) {
+			std::shared_ptr<BuildJob> job;
+			{
+				std::unique_lock lock (s_Compiler.Mutex);
+				s_Compiler.WakeUp.wait (lock, [] { return s_Compiler.Quit || !s_Compiler.Queue.empty (); });
+				if (s_Compiler.Quit)
+					break;
+				job = std::move (s_Compiler.Queue.front ());
+				s_Compiler.Queue.pop_front ();
+				if (job->Cancelled)
+					continue;
+			}
+
+			// Stages/Key don't change after Build, the rest of the job is only touched under the lock
+			GLuint program;
+			std::string log;
+			{
+				GLCORE_PROFILE_SCOPE ("ShaderCompiler Build");
+				program = build_blocking (job->Stages, job->Key, log, false);
+				glFinish (); // the program is used from the main context next, everything on this one has to be done by then
+			}
+
+			std::lock_guard lock (s_Compiler.Mutex);
+			if (job->Cancelled) {
+				glDeleteProgram (program);
+				continue;
+			}
+			job->Program = program;
+			job->Log = std::move (log);
+			job->State = program ? Status::Ready : Status::Failed;
+		}
+		s_Compiler.BindWorkerContext (false);
+	}
+
+	void ShaderCompiler::Init (void *(*loader)(const char *name), std::function<void(bool bind)> bind_worker_context, const std::string &cache_directory)
+	{
+		Shutdown ();
+		s_Compiler.CacheDirectory = cache_directory;
+		query_driver ();
+
+		bool parallel_compile = false;
+		GLint num_extensions = 0;
+		glGetIntegerv (GL_NUM_EXTENSIONS, &num_extensions);
+		for (GLint i = 0; i < num_extensions && !parallel_compile; i++)
+			parallel_compile = strcmp ((const char *)glGetStringi (GL_EXTENSIONS, i), "GL_KHR_parallel_shader_compile") == 0;
+
+		using MaxShaderCompilerThreadsFn = void (APIENTRYP)(GLuint count);
+		MaxShaderCompilerThreadsFn max_compiler_threads = parallel_compile && loader ? (MaxShaderCompilerThreadsFn)loader ("glMaxShaderCompilerThreadsKHR") : nullptr;
+		s_Compiler.ParallelCompile = max_compiler_threads != nullptr;
+		if (s_Compiler.ParallelCompile)
+			max_compiler_threads (0xFFFFFFFF); // as many as the driver likes
+		else if (bind_worker_context) {
+			s_Compiler.BindWorkerContext = std::move (bind_worker_context);
+			s_Compiler.Quit = false;
+			s_Compiler.Worker = std::thread (worker_loop);
+		}
+		LOG_INFO ("ShaderCompiler: {0}, {1} program binary formats", s_Compiler.ParallelCompile ? "KHR_parallel_shader_compile" : (s_Compiler.Worker.joinable () ? "worker context" : "synchronous")
+				  , s_Compiler.BinaryFormats.size ());
+	}
+
+	void ShaderCompiler::Shutdown ()
+	{
+		if (s_Compiler.Worker.joinable ()) {
+			{
+				std::lock_guard lock (s_Compiler.Mutex);
+				s_Compiler.Quit = true;
+				s_Compiler.Queue.clear ();
+			}
+			s_Compiler.WakeUp.notify_one ();
+			s_Compiler.Worker.join ();
+			s_Compiler.BindWorkerContext = nullptr;
+		}
+		for (auto &[ticket, job] : s_Compiler.Jobs) {
+			for (GLuint shader : job->Shaders)
+				glDeleteShader (shader);
+			if (job->Program)
+				glDeleteProgram (job->Program);
+		}
+		s_Compiler.Jobs.clear ();
+		s_Compiler.ParallelCompile = false;
+	}
+
+	uint64_t ShaderCompiler::Build (std::vector<ShaderStage> stages)
+	{
+		GLCORE_PROFILE_FUNCTION ();
+		query_driver ();
+		auto job = std::make_shared<BuildJob> ();
+		job->Stages = std::move (stages);
+		job->Key = cache_key (job->Stages);
+		const uint64_t ticket = s_Compiler.NextTicket++;
+		s_Compiler.Jobs[ticket] = job;
+
+		if (s_Compiler.Worker.joinable () && !s_Compiler.ParallelCompile) {
+			{
+				std::lock_guard lock (s_Compiler.Mutex);
+				s_Compiler.Queue.push_back (job);
+			}
+			s_Compiler.WakeUp.notify_one ();
+			return ticket;
+		}
+
+		if ((job->Program = load_cached (job->Key))) {
+			s_Compiler.Hits++;
+			job->State = Status::Ready;
+		} else if (s_Compiler.ParallelCompile) {
+			s_Compiler.Misses++;
+			job->Program = create_program (job->Stages, job->Shaders); // finished in Poll
+		} else {
+			job->Program = build_blocking (job->Stages, job->Key, job->Log, true);
+			job->State = job->Program ? Status::Ready : Status::Failed;
+		}
+		return ticket;
+	}
+
+	Status ShaderCompiler::Poll (uint64_t ticket, GLuint &out_program, std::string *out_log)
+	{
+		auto found = s_Compiler.Jobs.find (ticket);
+		if (found == s_Compiler.Jobs.end ()) {
+			if (out_log)
+				*out_log = "unknown ticket";
+			return Status::Failed;
+		}
+		BuildJob &job = *found->second;
+
+		if (!job.Shaders.empty ()) { // KHR path, still compiling until the driver says otherwise
+			GLint done = GL_FALSE;
+			glGetProgramiv (job.Program, GLCORE_COMPLETION_STATUS_KHR, &done);
+			if (done == GL_FALSE)
+				return Status::Compiling;
+			if (finish_program (job.Program, job.Shaders, job.Log))
+				save_binary (job.Key, job.Program, true);
+			job.State = job.Program ? Status::Ready : Status::Failed;
+		}
+
+		Status state;
+		{
+			std::lock_guard lock (s_Compiler.Mutex);
+			state = job.State;
+		}
+		if (state == Status::Compiling)
+			return state;
+		out_program = job.Program;
+		if (out_log)
+			*out_log = std::move (job.Log);
+		s_Compiler.Jobs.erase (found);
+		return state;
+	}
+
+	void ShaderCompiler::Cancel (uint64_t ticket)
+	{
+		auto found = s_Compiler.Jobs.find (ticket);
+		if (found == s_Compiler.Jobs.end ())
+			return;
+		BuildJob &job = *found->second;
+		{
+			std::lock_guard lock (s_Compiler.Mutex);
+			job.Cancelled = true;
+			if (job.State == Status::Compiling && !s_Compiler.ParallelCompile) { // on the worker, it deletes the program
+				s_Compiler.Jobs.erase (found);
+				return;
+			}
+		}
+		for (GLuint shader : job.Shaders)
+			glDeleteShader (shader);
+		if (job.Program)
+			glDeleteProgram (job.Program);
+		s_Compiler.Jobs.erase (found);
+	}
+
+	GLuint ShaderCompiler::BuildNow (const std::vector<ShaderStage> &stages, std::string *out_log)
+	{
+		GLCORE_PROFILE_FUNCTION ();
+		query_driver ();
+		std::string log;
+		GLuint program = build_blocking (stages, cache_key (stages), log, false);
+		if (out_log)
+			*out_log = std::move (log);
+		return program;
+	}
+
+	bool ShaderCompiler::HasParallelCompile () { return s_Compiler.ParallelCompile; }
+	uint32_t ShaderCompiler::CacheHits () { return s_Compiler.Hits; }
+	uint32_t ShaderCompiler::CacheMisses () { return s_Compiler.Misses; }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <glad/glad.h>
+
+namespace GLCore::Utils
+{
+	struct ShaderStage
+	{
+		GLenum Type;
+		std::string Source;
+	};
+
+	// Program builds that don't stall the frame, backed by a program binary cache:
+	//  - linked programs are saved with glGetProgramBinary, keyed by a hash of the sources + GL vendor/renderer/version,
+	//    later builds of the same sources are a glProgramBinary (a binary the driver rejects is deleted and rebuilt from source)
+	//  - with KHR_parallel_shader_compile compile/link are only issued, the driver's threads do the work and Poll checks completion
+	//  - otherwise compile/link run on a worker thread that owns a context shared with the window's
+	//   uint64_t ticket = ShaderCompiler::Build ({ { GL_VERTEX_SHADER, vert }, { GL_FRAGMENT_SHADER, frag } });
+	//   if (ShaderCompiler::Poll (ticket, program) != ShaderCompiler::Status::Compiling) ... // every frame
+	class ShaderCompiler
+	{
+	public:
+		enum class Status { Compiling, Ready, Failed };
+
+		// Call with the window's context current. 'loader' resolves extension entry points (glfwGetProcAddress),
+		// bind_worker_context (true/false) binds/unbinds a shared context on the calling thread, empty -> builds without
+		// KHR_parallel_shader_compile finish right away on the calling thread
+		static void Init (void *(*loader)(const char *name), std::function<void(bool bind)> bind_worker_context, const std::string &cache_directory = "shader_cache");
+		// Waits for the worker, builds never polled are deleted
+		static void Shutdown ();
+
+		// Main (GL) thread only, the ticket is never 0
+		static uint64_t Build (std::vector<ShaderStage> stages);
+		// Ready: 'out_program' is the linked program, owned by the caller from now on. Failed: 'out_log' gets compiler/linker output.
+		// The ticket is forgotten once it isn't Compiling anymore.
+		static Status Poll (uint64_t ticket, GLuint &out_program, std::string *out_log = nullptr);
+		// Drops a build nobody waits for anymore (its program is deleted when it finishes)
+		static void Cancel (uint64_t ticket);
+
+		// Blocking build through the same cache, for code that needs the program right away. 0 on failure.
+		// Works without Init (tools, benchmarks), the cache directory then is the default one.
+		static GLuint BuildNow (const std::vector<ShaderStage> &stages, std::string *out_log = nullptr);
+
+		static bool HasParallelCompile ();
+		static uint32_t CacheHits ();
+		static uint32_t CacheMisses ();
+	};
+}
@@ -3,7 +3,13 @@
 // Utility header file - include into application for access to utility classes/functions
 
 #include "GLCore/Util/Shader.h"
+#include "GLCore/Util/ShaderCompiler.h"
 #include "GLCore/Util/OrthographicCamera.h"
 #include "GLCore/Util/OrthographicCameraController.h"
 #include "GLCore/Util/OpenGLDebug.h"
-#include "GLCore/Util/PlatformUtils.h"
\ No newline at end of file
+#include "GLCore/Util/PlatformUtils.h"
+#include "GLCore/Util/JobSystem.h"
+#include "GLCore/Util/Core/StreamingBuffer.h"
+#include "GLCore/Util/Core/PixelReadback.h"
+#include "GLCore/Util/Core/FrameCapture.h"
+#include "GLCore/Util/Core/TextureStreamer.h"
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "GLCore/Util/PlatformUtils.h"
 
 #include <commdlg.h>
+#include <psapi.h>
 #include <GLFW/glfw3.h>
 #define  GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
@@ -58,4 +59,28 @@ namespace GLCore::Utils
 		return std::string ();
 	}
 
+	size_t Memory::CurrentResidentBytes ()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo (GetCurrentProcess (), &counters, sizeof (counters)))
+			return counters.WorkingSetSize;
+		return 0;
+	}
+
+	size_t Memory::PeakResidentBytes ()
+	{
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo (GetCurrentProcess (), &counters, sizeof (counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+	}
+
+	size_t Memory::PrivateBytes ()
+	{
+		PROCESS_MEMORY_COUNTERS_EX counters;
+		if (GetProcessMemoryInfo (GetCurrentProcess (), (PROCESS_MEMORY_COUNTERS *)&counters, sizeof (counters)))
+			return counters.PrivateUsage;
+		return 0;
+	}
+
 }
\ No newline at end of file
@@ -170,6 +170,16 @@ namespace GLCore {
 		glfwSwapBuffers(m_Window);
 	}
 
+	void WindowsWindow::WaitEvents (double timeout_seconds)
+	{
+		glfwWaitEventsTimeout (timeout_seconds);
+	}
+
+	void WindowsWindow::Wake ()
+	{
+		glfwPostEmptyEvent ();
+	}
+
 	void WindowsWindow::SetVSync(bool enabled)
 	{
 		if (enabled)
@@ -185,6 +195,25 @@ namespace GLCore {
 		glfwSetInputMode (m_Window, GLFW_CURSOR, show ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_DISABLED);
 	}
 
+	void* WindowsWindow::CreateSharedContext ()
+	{
+		glfwWindowHint (GLFW_VISIBLE, GLFW_FALSE);
+		GLFWwindow* context = glfwCreateWindow (1, 1, "Shared Context", nullptr, m_Window);
+		glfwWindowHint (GLFW_VISIBLE, GLFW_TRUE);
+		return context;
+	}
+
+	void WindowsWindow::DestroySharedContext (void* context)
+	{
+		if (context)
+			glfwDestroyWindow ((GLFWwindow*)context);
+	}
+
+	void WindowsWindow::MakeContextCurrent (void* context)
+	{
+		glfwMakeContextCurrent ((GLFWwindow*)context);
+	}
+
 	bool WindowsWindow::IsVSync() const
 	{
 		return m_Data.VSync;
@@ -13,6 +13,8 @@ namespace GLCore {
 		virtual ~WindowsWindow();
 
 		void OnUpdate() override;
+		void WaitEvents (double timeout_seconds) override;
+		void Wake () override;
 
 		inline uint32_t GetWidth () const override { return m_Data.Width; }
 		inline uint32_t GetHeight() const override { return m_Data.Height; }
@@ -24,6 +26,10 @@ namespace GLCore {
 
 		void MouseCursor(bool show) const override;
 
+		void* CreateSharedContext () override;
+		void DestroySharedContext (void* context) override;
+		void MakeContextCurrent (void* context) override;
+
 		inline virtual void* GetNativeWindow() const { return m_Window; }
 	private:
 		virtual void Init(const WindowProps& props);
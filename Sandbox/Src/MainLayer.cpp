@@ -1,6 +1,11 @@
 ﻿#include "MainLayer.h"
 #include "mean_curvature.h"
+#include "mesh_formats.h"
+#include "meshlets.h"
+#include <glm/gtc/packing.hpp>
 #include <iomanip>
+#include <filesystem>
+#include <chrono>
 #include <string>
 #include <glm/gtx/norm.hpp>
 #include <GLCore/Core/Input.h>
@@ -13,71 +18,260 @@ const char *ViewProjectionIdentifierInShader = "u_ViewProjectionMat4";
 const char *ModelMatrixIdentifierInShader = "u_ModelMat4";
 // Static data end
 
+static void fill_default_colors (void *colors, size_t count, ColorFormat format)
+{
+	const glm::vec3 default_color (0.7, 0.3, 0.05);
+	for (size_t i = 0; i < count; i++) {
+		switch (format) {
+			case ColorFormat::FLOAT3:
+				((glm::vec3 *)colors)[i] = default_color; break;
+			case ColorFormat::UNORM8:
+				((uint32_t *)colors)[i] = glm::packUnorm4x8 (glm::vec4 (default_color, 1.0f)); break;
+			case ColorFormat::HALF_SCALAR: // no color to show until the first calculation, lowest blend color
+				((uint16_t *)colors)[i] = 0; break;
+		}
+	}
+}
+
 bool MainLayer::load_model (std::string filePath){
+	GLCORE_PROFILE_FUNCTION ();
 	std::vector<std::pair<glm::vec3, glm::vec3>> meshVertices;
 	std::vector<uint32_t> meshIndices;
-	bool meshloaded = Helper::ASSET_LOADER::LoadOBJ_meshOnly(filePath.c_str (), meshVertices, meshIndices);
+	const std::string extension = std::filesystem::path (filePath).extension ().string ();
+	bool meshloaded = extension == ".xyz" || extension == ".XYZ"
+		? Helper::ASSET_LOADER::LoadPointCloud (filePath.c_str (), meshVertices)
+		: Helper::ASSET_LOADER::LoadOBJ_meshOnly (filePath.c_str (), meshVertices, meshIndices);
+	meshloaded = meshloaded && !meshVertices.empty ();
 	if (meshloaded) {
 		{ // load to memory
 			std::vector<std::pair<glm::vec3, glm::vec3>> posn_and_normal;
 			std::vector<GLuint> indices;
 			posn_and_normal = std::move(meshVertices);
 			indices = std::move(meshIndices);
-			m_MeshColorData.clear ();
 			// transfer mesh
 			m_StaticMeshData = std::move (posn_and_normal);
-			m_MeshColorData.resize (m_StaticMeshData.size ());
-			for (auto &ele : m_MeshColorData)
-				ele = glm::vec3 (0.7, 0.3, 0.05);
 			m_MeshIndicesData = std::move (indices);
+			m_MeshGeneration++;
 		}
 
-		// Upload Mesh
-		if(m_MeshVA)
-			glDeleteVertexArrays (1, &m_MeshVA);
-		if(m_MeshSVB)
-			glDeleteBuffers (1, &m_MeshSVB);
-		if(m_MeshCVB)
-			glDeleteBuffers (1, &m_MeshCVB);
-		if(m_MeshIB)
-			glDeleteBuffers (1, &m_MeshIB);
+		GLCORE_PROFILE_COUNTER ("Mesh vertices", m_StaticMeshData.size ());
+		SetPerformanceCounter ("Vertices", double (m_StaticMeshData.size ()), "%.0f");
+		SetPerformanceCounter ("Triangles", double (m_MeshIndicesData.size ()/3), "%.0f");
+		glm::vec3 min (m_StaticMeshData[0].first), max (m_StaticMeshData[0].first);
+		for (const auto &[posn, normal] : m_StaticMeshData)
+			min = glm::min (min, posn), max = glm::max (max, posn);
+		m_MeshCenter = (min + max)*0.5f;
+		m_MeshRadius = glm::length (max - min)*0.5f;
 
-		glGenVertexArrays (1, &m_MeshVA);
-		glBindVertexArray (m_MeshVA);
+		m_PickRings = VertexRings ();
+		m_Picked.Vertex = -1;
+		m_PointTree = PointKDTree ();
+		m_Result_GaussianCurvatureValue.clear ();
+		m_ScaleNormals.clear (), m_ScaleValues.clear ();
+		m_Lines.Clear ();
+		m_Principal = PrincipalCurvatures ();
+		m_GlyphMeshUploaded = m_GlyphVectorsUploaded = m_ResultsOnGPU = false;
+		m_LineFirsts.clear (), m_LineCounts.clear ();
 
-		glGenBuffers (1, &m_MeshSVB);
-		glBindBuffer (GL_ARRAY_BUFFER, m_MeshSVB);
-		{
-			size_t size = m_StaticMeshData.size ()*sizeof (glm::vec3[2]);
-			glBufferData (GL_ARRAY_BUFFER, size, m_StaticMeshData.data (), GL_STATIC_DRAW);
-		}
-		
-		glGenBuffers (1, &m_MeshCVB);
-		glBindBuffer (GL_ARRAY_BUFFER, m_MeshCVB);
-		glBufferData (GL_ARRAY_BUFFER, m_MeshColorData.size ()*sizeof (glm::vec3), m_MeshColorData.data(), GL_DYNAMIC_DRAW);
-		
-		{
-			glEnableVertexAttribArray (0); // position
-			glEnableVertexAttribArray (1); // normal
-			glEnableVertexAttribArray (2); // color
-
-			// glVertexAttribPointer (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)
-			uint32_t stride = sizeof (float) * 3 * 2;
-			uint32_t offset1 = 0;
-			uint32_t offset2 = sizeof (float) * 3;
-			glBindBuffer (GL_ARRAY_BUFFER, m_MeshSVB);
-			glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset1));
-			glVertexAttribPointer (1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset2));
-
-			glBindBuffer (GL_ARRAY_BUFFER, m_MeshCVB);
-			glVertexAttribPointer (2, 3, GL_FLOAT, GL_FALSE, sizeof (float) * 3, 0);
+		if (is_point_cloud ()) { // (an .obj without faces too) nothing to optimize, simplify or ray cast, drawn as points
+			m_Meshlets = MeshletMesh ();
+			m_LODs.clear ();
+			m_BVH = MeshBVH ();
+			m_BVHBuilding.reset ();
+			m_BVHBuild = std::future<void> ();
+			m_FileOrderCacheStats = m_UploadedCacheStats = VertexCacheStats ();
+			m_ForcedLOD = MIN (m_ForcedLOD, 0);
+			m_CurvatureLOD = 0;
+			SetPerformanceCounter ("Meshlets", 0.0, "%.0f");
+			SetPerformanceCounter ("LOD levels", 0.0, "%.0f");
+			upload_mesh ();
+			return true;
 		}
-		glGenBuffers (1, &m_MeshIB);
-		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, m_MeshIB);
-		glBufferData (GL_ELEMENT_ARRAY_BUFFER, m_MeshIndicesData.size ()*sizeof (GLuint), &m_MeshIndicesData[0], GL_STATIC_DRAW);
+
+		m_FileOrderCacheStats = SimulateVertexCache (m_MeshIndicesData, m_StaticMeshData.size ());
+		if (m_OptimizeMesh)
+			optimize_mesh (filePath);
+		else BuildMeshlets (m_StaticMeshData, m_MeshIndicesData, m_Meshlets);
+		m_UploadedCacheStats = SimulateVertexCache (m_Meshlets.Indices, m_StaticMeshData.size ());
+		LOG_INFO ("Post-transform cache ({0} entries): ACMR {1} -> {2}, ATVR {3} -> {4}", VertexCacheSize
+				  , m_FileOrderCacheStats.ACMR, m_UploadedCacheStats.ACMR, m_FileOrderCacheStats.ATVR, m_UploadedCacheStats.ATVR);
+		SetPerformanceCounter ("ACMR (file order)", m_FileOrderCacheStats.ACMR, "%.3f");
+		SetPerformanceCounter ("ACMR (uploaded)", m_UploadedCacheStats.ACMR, "%.3f");
+		SetPerformanceCounter ("ATVR (file order)", m_FileOrderCacheStats.ATVR, "%.3f");
+		SetPerformanceCounter ("ATVR (uploaded)", m_UploadedCacheStats.ATVR, "%.3f");
+		SetPerformanceCounter ("Meshlets", double (m_Meshlets.Meshlets.size ()), "%.0f");
+
+		start_bvh_build ();
+		BuildLODChain (m_StaticMeshData, m_MeshIndicesData, m_LODs);
+		SetPerformanceCounter ("LOD levels", double (m_LODs.size ()), "%.0f");
+		m_ForcedLOD = MIN (m_ForcedLOD, int (m_LODs.size ()));
+		m_CurvatureLOD = MIN (m_CurvatureLOD, int (m_LODs.size ()));
+		upload_mesh ();
 	}
 	return meshloaded;
 }
+void MainLayer::optimize_mesh (const std::string &filePath)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	// anything that changes the result is part of the cache key
+	const uint32_t options = uint32_t (m_OptimizeOverdraw) | VertexCacheSize << 8 | MeshletMesh::MaxVertices << 16 | MeshletMesh::MaxTriangles << 24;
+	const uint64_t mesh_hash = HashMesh (m_StaticMeshData, m_MeshIndicesData, options);
+	const std::string cache_path = filePath + ".opt";
+	std::vector<uint32_t> vertex_remap;
+	if (LoadMeshOptimization (cache_path, mesh_hash, m_StaticMeshData.size (), m_MeshIndicesData.size (), vertex_remap, m_Meshlets)) {
+		ApplyVertexRemap (m_StaticMeshData, vertex_remap);
+		LOG_INFO ("Mesh optimization loaded from {0}", cache_path);
+	} else {
+		// spatially coherent input for the meshlet builder, cache order inside meshlets, then vertices in first use order
+		SortTrianglesSpatially (m_StaticMeshData, m_MeshIndicesData);
+		BuildMeshlets (m_StaticMeshData, m_MeshIndicesData, m_Meshlets);
+		OptimizeMeshletVertexCache (m_Meshlets);
+		if (m_OptimizeOverdraw)
+			OptimizeMeshletOverdraw (m_Meshlets, m_MeshCenter);
+		OptimizeVertexFetch (m_StaticMeshData, m_Meshlets.Indices, vertex_remap);
+		SaveMeshOptimization (cache_path, mesh_hash, vertex_remap, m_Meshlets);
+	}
+	// same triangles, the CPU kernel benefits from the order just as much
+	m_MeshIndicesData = m_Meshlets.Indices;
+}
+void MainLayer::upload_mesh ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	if(m_MeshVA)
+		glDeleteVertexArrays (1, &m_MeshVA);
+	if(m_MeshSVB)
+		glDeleteBuffers (1, &m_MeshSVB);
+	if(m_MeshIB)
+		glDeleteBuffers (1, &m_MeshIB);
+
+	glGenVertexArrays (1, &m_MeshVA);
+	glBindVertexArray (m_MeshVA);
+
+	std::vector<uint8_t> packed;
+	glGenBuffers (1, &m_MeshSVB);
+	glBindBuffer (GL_ARRAY_BUFFER, m_MeshSVB);
+	m_PositionDequantize = PackStaticVertices (m_StaticMeshData, m_VertexFormat, packed);
+	glBufferData (GL_ARRAY_BUFFER, packed.size (), packed.data (), GL_STATIC_DRAW);
+	size_t gpu_bytes = packed.size ();
+
+	m_MeshColors.Allocate (m_StaticMeshData.size ()*m_VertexFormat.ColorStride ());
+	fill_default_colors (m_MeshColors.BeginWrite (), m_StaticMeshData.size (), m_VertexFormat.Color);
+	m_MeshColors.EndWrite ();
+	gpu_bytes += m_StaticMeshData.size ()*m_VertexFormat.ColorStride (); // one region, the ring keeps 3
+
+	{
+		glEnableVertexAttribArray (0); // position
+		glEnableVertexAttribArray (1); // normal
+		glEnableVertexAttribArray (2); // color
+
+		glBindBuffer (GL_ARRAY_BUFFER, m_MeshSVB);
+		SetStaticVertexAttributes (m_VertexFormat);
+
+		glBindBuffer (GL_ARRAY_BUFFER, m_MeshColors.GetRendererID ());
+		SetColorVertexAttribute (m_VertexFormat, m_MeshColors.CurrentOffset ());
+	}
+	glGenBuffers (1, &m_MeshIB);
+	glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, m_MeshIB);
+	// meshlet order, every meshlet is a contiguous range the culled draws can point at
+	m_MeshIndexType = PackIndices (m_Meshlets.Indices, m_StaticMeshData.size (), m_VertexFormat, packed);
+	glBufferData (GL_ELEMENT_ARRAY_BUFFER, packed.size (), packed.data (), GL_STATIC_DRAW);
+	gpu_bytes += packed.size ();
+	SetPerformanceCounter ("Mesh GPU memory (KB)", gpu_bytes/1024.0, "%.1f");
+
+	if (GLAD_GL_VERSION_4_3) // worst case every meshlet is its own command
+		m_DrawCommands.Allocate (m_Meshlets.Meshlets.size ()*sizeof (DrawElementsIndirectCommand));
+	m_CulledCommands.resize (m_Meshlets.Meshlets.size ());
+
+	if (m_CurvatureGPU.IsReady ()) { // topology changed, so does adjacency
+		VertexRings rings;
+		BuildVertexRings (m_StaticMeshData.size (), m_MeshIndicesData, rings);
+		m_CurvatureGPU.UploadAdjacency (rings, m_MeshGeneration);
+		m_CurvatureGPU.UploadLODs (m_LODs);
+		m_CurvatureGPU.SetVertexFormat (m_VertexFormat, m_StaticMeshData);
+	}
+	upload_lods ();
+}
+void MainLayer::upload_lods ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	release_lods ();
+	m_LODBuffers.resize (m_LODs.size ());
+	std::vector<uint8_t> packed;
+	for (size_t l = 0; l < m_LODs.size (); l++) {
+		const MeshLOD &lod = m_LODs[l];
+		LODBuffers &buffers = m_LODBuffers[l];
+		glGenVertexArrays (1, &buffers.VA);
+		glBindVertexArray (buffers.VA);
+		glEnableVertexAttribArray (0);
+		glEnableVertexAttribArray (1);
+		glEnableVertexAttribArray (2);
+
+		glGenBuffers (1, &buffers.SVB);
+		glBindBuffer (GL_ARRAY_BUFFER, buffers.SVB);
+		buffers.Dequantize = PackStaticVertices (lod.Vertices, m_VertexFormat, packed);
+		glBufferData (GL_ARRAY_BUFFER, packed.size (), packed.data (), GL_STATIC_DRAW);
+		SetStaticVertexAttributes (m_VertexFormat);
+
+		// rewritten only when curvature is recalculated, no need for a ring; padded to whole words for the compute path
+		packed.resize ((lod.Vertices.size ()*m_VertexFormat.ColorStride () + 3)/4*4);
+		fill_default_colors (packed.data (), lod.Vertices.size (), m_VertexFormat.Color);
+		glGenBuffers (1, &buffers.CVB);
+		glBindBuffer (GL_ARRAY_BUFFER, buffers.CVB);
+		glBufferData (GL_ARRAY_BUFFER, packed.size (), packed.data (), GL_DYNAMIC_DRAW);
+		SetColorVertexAttribute (m_VertexFormat, 0);
+
+		glGenBuffers (1, &buffers.IB);
+		glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, buffers.IB);
+		buffers.IndexType = PackIndices (lod.Indices, lod.Vertices.size (), m_VertexFormat, packed);
+		glBufferData (GL_ELEMENT_ARRAY_BUFFER, packed.size (), packed.data (), GL_STATIC_DRAW);
+	}
+	glBindVertexArray (m_MeshVA);
+}
+void MainLayer::release_lods ()
+{
+	for (LODBuffers &buffers : m_LODBuffers) {
+		glDeleteVertexArrays (1, &buffers.VA);
+		GLuint vbos[] = { buffers.SVB, buffers.CVB, buffers.IB };
+		glDeleteBuffers (3, vbos);
+	}
+	m_LODBuffers.clear ();
+}
+void MainLayer::write_lod_colors (const std::vector<float> &full_mean_curvature_values)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	std::vector<float> lod_values;
+	std::vector<uint8_t> colors;
+	for (uint32_t l = 0; l < m_LODBuffers.size (); l++) {
+		AverageFullToLOD (m_LODs, l + 1, full_mean_curvature_values, lod_values);
+		colors.resize (lod_values.size ()*m_VertexFormat.ColorStride ());
+		MeanCurvatureColorMap (lod_values, m_MinMaxMeanCurvature.x, m_MinMaxMeanCurvature.y, m_BlendKhToColors, CurvatureColorOutput (colors.data (), m_VertexFormat.Color));
+		glBindBuffer (GL_COPY_WRITE_BUFFER, m_LODBuffers[l].CVB);
+		glBufferSubData (GL_COPY_WRITE_BUFFER, 0, colors.size (), colors.data ());
+	}
+	glBindBuffer (GL_COPY_WRITE_BUFFER, 0);
+}
+void MainLayer::write_lod_colors_from_gpu ()
+{
+	if (m_LODBuffers.empty ())
+		return;
+	std::vector<GLuint> lod_colors (m_LODBuffers.size ());
+	for (size_t l = 0; l < m_LODBuffers.size (); l++)
+		lod_colors[l] = m_LODBuffers[l].CVB;
+	if (m_CurvatureGPU.CalculateLODColors (lod_colors))
+		return;
+	std::vector<float> values;
+	std::vector<glm::vec3> normals;
+	m_CurvatureGPU.ReadBack (values, normals);
+	write_lod_colors (values);
+}
+uint32_t MainLayer::select_lod ()
+{
+	if (m_ForcedLOD >= 0)
+		return uint32_t (MIN (m_ForcedLOD, int (m_LODBuffers.size ())));
+	// nearest point of the bounding sphere decides, the whole mesh is drawn at one level
+	const float distance = MAX (glm::distance (m_Camera.Position, m_MeshCenter) - m_MeshRadius, m_Camera.Near);
+	return MIN (SelectLOD (m_LODs, distance, glm::radians (m_Camera.FOV_y), This_ViewportSize ().y, m_LODPixelError), uint32_t (m_LODBuffers.size ()));
+}
 void MainLayer::calculate_my_curvature ()
 {
 	auto debugFile = std::string ();
@@ -89,13 +283,294 @@ void MainLayer::calculate_my_curvature ()
 		debugFile = std::string (&m_LoadedMeshPath[i]) + std::string (".txt");
 	}
 #endif
-	if (m_MeshCVB && MeanCurvatureCalculate (debugFile.c_str (), m_StaticMeshData, m_MeshIndicesData, m_MeshColorData
-											 , m_Result_MeanCurvatureNormal, m_Result_MeanCurvatureValue
-											 , m_BlendKhToColors
-											 , m_DebugOutput, &m_MinMaxMeanCurvature.x, &m_MinMaxMeanCurvature.y)) {
-		glBindBuffer (GL_ARRAY_BUFFER, m_MeshCVB);
-		glBufferSubData (GL_ARRAY_BUFFER, 0, m_MeshColorData.size ()*sizeof (glm::vec3), m_MeshColorData.data ());
+	m_GlyphVectorsUploaded = m_ResultsOnGPU = false;
+	m_Picked.Vertex = -1; // tooltip shows the new results
+	if (is_point_cloud ()) {
+		calculate_point_cloud_curvature ();
+		return;
+	}
+	if (m_MultiScale && m_MeshColors.IsAllocated ()) {
+		calculate_multiscale_curvature ();
+		return;
+	}
+	if (m_MeshColors.IsAllocated () && m_CurvatureLOD > 0 && m_CurvatureLOD <= int (m_LODs.size ())) {
+		calculate_curvature_on_lod (uint32_t (m_CurvatureLOD), debugFile.c_str ());
+		return;
+	}
+	MeanCurvaturePhaseTimings timings;
+	if (m_UseComputeShader && m_CurvatureGPU.IsReady ()) {
+		if (!m_CurvatureGPU.HasAdjacencyFor (m_MeshGeneration)) {
+			VertexRings rings;
+			BuildVertexRings (m_StaticMeshData.size (), m_MeshIndicesData, rings);
+			m_CurvatureGPU.UploadAdjacency (rings, m_MeshGeneration);
+			m_CurvatureGPU.UploadLODs (m_LODs);
+			m_CurvatureGPU.SetVertexFormat (m_VertexFormat, m_StaticMeshData);
+		}
+		// GPU writes are ordered after the draws already queued, so the current region is overwritten in place
+		if (m_CurvatureGPU.Calculate (m_MeshSVB, m_MeshColors.GetRendererID (), m_MeshColors.CurrentOffset (), m_BlendKhToColors, &m_MinMaxMeanCurvature.x, &m_MinMaxMeanCurvature.y, &timings)) {
+			m_ResultsOnGPU = true;
+			SetLastJobTimings ("mean curvature (compute)", { { "Kernel", timings.Kernel }, { "Color mapping", timings.ColorMapping } });
+			double total_ms = timings.Kernel + timings.ColorMapping;
+			SetPerformanceCounter ("Vertices/sec (last run)", total_ms > 0 ? m_StaticMeshData.size ()/(total_ms*1e-3) : 0.0, "%.4g");
+			write_lod_colors_from_gpu ();
+		}
+		return;
+	}
+	if (!m_MeshColors.IsAllocated ())
+		return;
+	// colors go straight into the next (fenced) region of the mapped buffer, the GPU may still be drawing the current one
+	void *colors = m_MeshColors.BeginWrite ();
+	bool calculated = colors && MeanCurvatureCalculate (debugFile.c_str (), m_StaticMeshData, m_MeshIndicesData, CurvatureColorOutput (colors, m_VertexFormat.Color)
+														, m_Result_MeanCurvatureNormal, m_Result_MeanCurvatureValue
+														, m_BlendKhToColors
+														, m_DebugOutput, &m_MinMaxMeanCurvature.x, &m_MinMaxMeanCurvature.y, &timings);
+	m_MeshColors.EndWrite ();
+	if (calculated) {
+		SetLastJobTimings ("mean curvature", { { "Adjacency", timings.Adjacency }, { "Kernel", timings.Kernel }, { "Statistics", timings.Statistics }, { "Color mapping", timings.ColorMapping } });
+		double total_ms = timings.Adjacency + timings.Kernel + timings.Statistics + timings.ColorMapping;
+		SetPerformanceCounter ("Vertices/sec (last run)", total_ms > 0 ? m_StaticMeshData.size ()/(total_ms*1e-3) : 0.0, "%.4g");
+		write_lod_colors (m_Result_MeanCurvatureValue);
+	}
+}
+void MainLayer::draw_curvature_glyphs (glm::uvec2 viewport_size)
+{
+	if (!m_ShowGlyphs || !m_Glyphs.IsReady () || m_StaticMeshData.empty ())
+		return;
+	GLuint vectors = 0;
+	if (m_ResultsOnGPU)
+		vectors = m_CurvatureGPU.MeanCurvatureNormalsBuffer ();
+	else if (m_Result_MeanCurvatureNormal.size () != m_StaticMeshData.size ())
+		return; // nothing calculated yet
+	if (!m_GlyphMeshUploaded) {
+		m_Glyphs.UploadMesh (m_StaticMeshData);
+		m_GlyphMeshUploaded = true;
+	}
+	if (!m_ResultsOnGPU && !m_GlyphVectorsUploaded) {
+		m_Glyphs.UploadVectors (m_Result_MeanCurvatureNormal);
+		m_GlyphVectorsUploaded = true;
+	}
+	// |K(Xi)| = 2|K_h|
+	const float max_magnitude = 2*MAX (std::abs (m_MinMaxMeanCurvature.x), std::abs (m_MinMaxMeanCurvature.y));
+	const uint32_t instances = m_Glyphs.Draw (m_ViewProjection, m_Camera.Position, viewport_size, vectors, max_magnitude
+											  , m_GlyphLength*m_MeshRadius, m_BlendKhToColors, m_GlyphSettings);
+	SetPerformanceCounter ("Glyph instances", double (instances), "%.0f");
+}
+void MainLayer::calculate_curvature_on_lod (uint32_t level, const char *debug_filename)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const MeshLOD &lod = m_LODs[level - 1];
+	MeanCurvaturePhaseTimings timings;
+	std::vector<glm::vec3> lod_normals;
+	std::vector<float> lod_values;
+	std::vector<uint8_t> lod_colors (lod.Vertices.size ()*m_VertexFormat.ColorStride ());
+	if (!MeanCurvatureCalculate (debug_filename, lod.Vertices, lod.Indices, CurvatureColorOutput (lod_colors.data (), m_VertexFormat.Color)
+								 , lod_normals, lod_values, m_BlendKhToColors
+								 , m_DebugOutput, &m_MinMaxMeanCurvature.x, &m_MinMaxMeanCurvature.y, &timings))
+		return;
+
+	// every full mesh vertex takes the values of the LOD vertex it was merged into
+	auto transfer_start = std::chrono::steady_clock::now ();
+	TransferLODToFull (m_LODs, level, lod_values, m_StaticMeshData.size (), m_Result_MeanCurvatureValue);
+	TransferLODToFull (m_LODs, level, lod_normals, m_StaticMeshData.size (), m_Result_MeanCurvatureNormal);
+	MeanCurvatureColorMap (m_Result_MeanCurvatureValue, m_MinMaxMeanCurvature.x, m_MinMaxMeanCurvature.y, m_BlendKhToColors
+						   , CurvatureColorOutput (m_MeshColors.BeginWrite (), m_VertexFormat.Color));
+	m_MeshColors.EndWrite ();
+	write_lod_colors (m_Result_MeanCurvatureValue);
+	const double transfer_ms = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - transfer_start).count ();
+
+	SetLastJobTimings ("mean curvature (LOD " + std::to_string (level) + ")"
+					   , { { "Adjacency", timings.Adjacency }, { "Kernel", timings.Kernel }, { "Statistics", timings.Statistics }, { "Color mapping", timings.ColorMapping }, { "Transfer to full mesh", transfer_ms } });
+	double total_ms = timings.Adjacency + timings.Kernel + timings.Statistics + timings.ColorMapping + transfer_ms;
+	SetPerformanceCounter ("Vertices/sec (last run)", total_ms > 0 ? m_StaticMeshData.size ()/(total_ms*1e-3) : 0.0, "%.4g");
+}
+void MainLayer::calculate_point_cloud_curvature ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	if (!m_MeshColors.IsAllocated ())
+		return;
+	using clock = std::chrono::steady_clock;
+	auto elapsed_ms = [](clock::time_point since) { return std::chrono::duration<double, std::milli> (clock::now () - since).count (); };
+
+	auto phase_start = clock::now ();
+	if (m_PointTree.Points.size () != m_StaticMeshData.size ())
+		BuildPointKDTree (m_StaticMeshData, m_PointTree);
+	const double tree_ms = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	const size_t fitted = PointCloudCurvature (m_StaticMeshData, m_PointTree, m_PointCloudSettings, m_Result_MeanCurvatureNormal, m_Result_MeanCurvatureValue, &m_Result_GaussianCurvatureValue);
+	const double fit_ms = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	MeanCurvatureStatistics stats = MeanCurvatureComputeStatistics (m_Result_MeanCurvatureValue);
+	m_MinMaxMeanCurvature = { stats.Min, stats.Max };
+	const double statistics_ms = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	MeanCurvatureColorMap (m_Result_MeanCurvatureValue, stats.Min, stats.Max, m_BlendKhToColors, CurvatureColorOutput (m_MeshColors.BeginWrite (), m_VertexFormat.Color));
+	m_MeshColors.EndWrite ();
+	const double color_ms = elapsed_ms (phase_start);
+
+	if (fitted < m_StaticMeshData.size ())
+		LOG_WARN ("{0} of {1} points have degenerate neighbourhoods, their curvature is 0", m_StaticMeshData.size () - fitted, m_StaticMeshData.size ());
+	SetLastJobTimings ("mean curvature (point cloud)", { { "k-d tree", tree_ms }, { "kNN + fit", fit_ms }, { "Statistics", statistics_ms }, { "Color mapping", color_ms } });
+	const double total_ms = tree_ms + fit_ms + statistics_ms + color_ms;
+	SetPerformanceCounter ("Vertices/sec (last run)", total_ms > 0 ? m_StaticMeshData.size ()/(total_ms*1e-3) : 0.0, "%.4g");
+}
+void MainLayer::calculate_multiscale_curvature ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	using clock = std::chrono::steady_clock;
+	auto elapsed_ms = [](clock::time_point since) { return std::chrono::duration<double, std::milli> (clock::now () - since).count (); };
+
+	auto phase_start = clock::now ();
+	VertexRings rings;
+	BuildVertexRings (m_StaticMeshData.size (), m_MeshIndicesData, rings);
+	const double adjacency_ms = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	std::vector<glm::vec3> one_ring_normals;
+	std::vector<float> one_ring_values, A_mixed;
+	MeanCurvatureKernel (m_StaticMeshData, rings, one_ring_normals, one_ring_values, &A_mixed);
+	const double kernel_ms = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	const float mean_edge_length = MeanCurvatureMultiScale (m_StaticMeshData, rings, one_ring_normals, A_mixed, m_ScaleSettings, m_ScaleNormals, m_ScaleValues);
+	const double neighbourhood_ms = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	show_curvature_scale (m_ShownScale);
+	const double color_ms = elapsed_ms (phase_start);
+
+	LOG_INFO ("{0} scales over {1} vertices, mean edge length {2}", m_ScaleValues.size (), m_StaticMeshData.size (), mean_edge_length);
+	SetLastJobTimings ("mean curvature (multi-scale)", { { "Adjacency", adjacency_ms }, { "Kernel", kernel_ms }, { "Neighbourhoods", neighbourhood_ms }, { "Statistics + color mapping", color_ms } });
+	const double total_ms = adjacency_ms + kernel_ms + neighbourhood_ms + color_ms;
+	SetPerformanceCounter ("Vertices/sec (last run)", total_ms > 0 ? m_StaticMeshData.size ()/(total_ms*1e-3) : 0.0, "%.4g");
+}
+void MainLayer::show_curvature_scale (int scale)
+{
+	m_ShownScale = MAX (0, MIN (scale, int (m_ScaleValues.size ()) - 1));
+	if (m_ScaleValues.empty () || m_ScaleValues[m_ShownScale].size () != m_StaticMeshData.size () || !m_MeshColors.IsAllocated ())
+		return;
+	m_Result_MeanCurvatureNormal = m_ScaleNormals[m_ShownScale];
+	m_Result_MeanCurvatureValue = m_ScaleValues[m_ShownScale];
+	m_GlyphVectorsUploaded = m_ResultsOnGPU = false; // the scale slider may follow a compute run, m_Result_* are current again
+	m_Picked.Vertex = -1;
+	// every scale gets its own range, wider neighbourhoods flatten the extremes
+	MeanCurvatureStatistics stats = MeanCurvatureComputeStatistics (m_Result_MeanCurvatureValue);
+	m_MinMaxMeanCurvature = { stats.Min, stats.Max };
+	MeanCurvatureColorMap (m_Result_MeanCurvatureValue, stats.Min, stats.Max, m_BlendKhToColors, CurvatureColorOutput (m_MeshColors.BeginWrite (), m_VertexFormat.Color));
+	m_MeshColors.EndWrite ();
+	write_lod_colors (m_Result_MeanCurvatureValue);
+}
+void MainLayer::read_back_gpu_results ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	if (!m_ResultsOnGPU)
+		return;
+	m_CurvatureGPU.ReadBack (m_Result_MeanCurvatureValue, m_Result_MeanCurvatureNormal);
+	m_GlyphVectorsUploaded = m_ResultsOnGPU = false; // glyphs take the CPU copy from here on, same vectors
+}
+void MainLayer::extract_curvature_lines ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	auto start = std::chrono::steady_clock::now ();
+	m_Lines.Clear ();
+	if (!is_point_cloud ()) { // isolines and ridges need triangles
+		if (m_LineSettings.IsoCount > 0)
+			read_back_gpu_results (); // the sliders call this every change, only the first one after a compute run stalls
+		if (m_LineSettings.IsoCount > 0 && m_Result_MeanCurvatureValue.size () == m_StaticMeshData.size ()) {
+			std::vector<float> levels (m_LineSettings.IsoCount);
+			for (int i = 0; i < m_LineSettings.IsoCount; i++)
+				levels[i] = m_LineSettings.IsoLevel + i*m_LineSettings.IsoSpacing;
+			ExtractIsolines (m_StaticMeshData, m_MeshIndicesData, m_Result_MeanCurvatureValue, levels, m_Lines);
+		}
+		if (m_LineSettings.Ridges || m_LineSettings.Valleys) {
+			if (m_Principal.VertexCount () != m_StaticMeshData.size ()) {
+				VertexRings rings;
+				BuildVertexRings (m_StaticMeshData.size (), m_MeshIndicesData, rings);
+				ComputePrincipalCurvatures (m_StaticMeshData, rings, m_Principal);
+			}
+			ExtractRidgesAndValleys (m_StaticMeshData, m_MeshIndicesData, m_Principal, m_LineSettings.RidgeStrength, m_LineSettings.Ridges, m_LineSettings.Valleys, m_Lines);
+		}
+	}
+
+	if (!m_LinesVA) {
+		glGenVertexArrays (1, &m_LinesVA);
+		glGenBuffers (1, &m_LinesVB);
+		glBindVertexArray (m_LinesVA);
+		glBindBuffer (GL_ARRAY_BUFFER, m_LinesVB);
+		glEnableVertexAttribArray (0); // position only, normal and color are constant per draw
+		glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, sizeof (glm::vec3), nullptr);
+	}
+	glBindBuffer (GL_ARRAY_BUFFER, m_LinesVB);
+	glBufferData (GL_ARRAY_BUFFER, m_Lines.Points.size ()*sizeof (glm::vec3), m_Lines.Points.data (), GL_DYNAMIC_DRAW);
+	m_LineFirsts.resize (m_Lines.Polylines.size ()), m_LineCounts.resize (m_Lines.Polylines.size ());
+	for (size_t i = 0; i < m_Lines.Polylines.size (); i++)
+		m_LineFirsts[i] = GLint (m_Lines.Polylines[i].First), m_LineCounts[i] = GLsizei (m_Lines.Polylines[i].Count);
+
+	SetPerformanceCounter ("Curvature lines (ms)", std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - start).count ());
+	SetPerformanceCounter ("Curvature line points", double (m_Lines.Points.size ()), "%.0f");
+}
+void MainLayer::draw_curvature_lines ()
+{
+	if (!m_LineSettings.Show || m_LineFirsts.empty ())
+		return;
+	const glm::mat4 identity (1);
+	glUniformMatrix4fv (m_Uniform.Mat4_ModelMatrix, 1, GL_FALSE, glm::value_ptr (identity));
+	glUniform1i (m_Uniform.Int_OctahedralNormals, 0);
+	glUniform1i (m_Uniform.Int_ColorIsScalar, 0);
+	glUniform1i (m_Uniform.Int_PickableVertices, 0);
+	glBindVertexArray (m_LinesVA);
+	glVertexAttrib3f (1, 0, 0, 1);
+	// the lines lie on the surface, a slightly nearer depth range keeps them in front of the triangles they cross
+	glDepthRange (0.0, 0.9999);
+	const glm::vec3 colors[] = { { 1, 1, 1 }, { 1, 0.1f, 0.1f }, { 0.1f, 0.4f, 1 } }; // isolines, ridges, valleys
+	for (size_t begin = 0, end; begin < m_Lines.Polylines.size (); begin = end) {
+		const CurvatureLineType type = m_Lines.Polylines[begin].Type;
+		for (end = begin + 1; end < m_Lines.Polylines.size () && m_Lines.Polylines[end].Type == type; end++);
+		const glm::vec3 &color = colors[uint32_t (type)];
+		glVertexAttrib3f (2, color.r, color.g, color.b);
+		glMultiDrawArrays (GL_LINE_STRIP, m_LineFirsts.data () + begin, m_LineCounts.data () + begin, GLsizei (end - begin));
 	}
+	glDepthRange (0.0, 1.0);
+}
+void MainLayer::validate_compute_curvature ()
+{
+	if (!m_CurvatureGPU.IsReady () || m_StaticMeshData.empty () || is_point_cloud ())
+		return;
+	VertexRings rings;
+	BuildVertexRings (m_StaticMeshData.size (), m_MeshIndicesData, rings);
+	if (!m_CurvatureGPU.HasAdjacencyFor (m_MeshGeneration)) {
+		m_CurvatureGPU.UploadAdjacency (rings, m_MeshGeneration);
+		m_CurvatureGPU.UploadLODs (m_LODs);
+		m_CurvatureGPU.SetVertexFormat (m_VertexFormat, m_StaticMeshData);
+	}
+
+	glm::vec2 gpu_min_max;
+	std::vector<glm::vec3> cpu_normals, gpu_normals;
+	std::vector<float> cpu_values, gpu_values;
+	if (!m_CurvatureGPU.Calculate (m_MeshSVB, m_MeshColors.GetRendererID (), m_MeshColors.CurrentOffset (), m_BlendKhToColors, &gpu_min_max.x, &gpu_min_max.y)) {
+		LOG_ERROR ("compute vs CPU: FAIL, the compute path did not run");
+		return;
+	}
+	m_ResultsOnGPU = true; // colors and the K(Xi) buffer now hold the compute results
+	m_Picked.Vertex = -1;
+	write_lod_colors_from_gpu ();
+	m_CurvatureGPU.ReadBack (gpu_values, gpu_normals);
+	MeanCurvatureKernel (m_StaticMeshData, rings, cpu_normals, cpu_values);
+	MeanCurvatureStatistics stats = MeanCurvatureComputeStatistics (cpu_values, rings);
+	const MeanCurvatureGPUValidation validation = ValidateMeanCurvatureGPU (m_StaticMeshData, rings, cpu_values, cpu_normals, gpu_values, gpu_normals, stats.Max);
+	if (!validation.SizesMatch) {
+		LOG_ERROR ("compute vs CPU: FAIL, read back {0} values for {1} vertices", gpu_values.size (), cpu_values.size ());
+		return;
+	}
+	if (validation.Passed ())
+		LOG_INFO ("compute vs CPU over {0} vertices: PASS, K_h max rel. error {1}, K(Xi) max rel. error {2} (tolerance {3}, {4} ill-conditioned), min {5}/{6}, max {7}/{8}"
+				  , cpu_values.size (), validation.MaxValueError, validation.MaxNormalError, MeanCurvatureGPUValidation::Tolerance, validation.IllConditioned
+				  , gpu_min_max.x, stats.Min, gpu_min_max.y, stats.Max);
+	else LOG_ERROR ("compute vs CPU over {0} vertices: FAIL, K_h max rel. error {1}, K(Xi) max rel. error {2} (tolerance {3}), min {4}/{5}, max {6}/{7}"
+					, cpu_values.size (), validation.MaxValueError, validation.MaxNormalError, MeanCurvatureGPUValidation::Tolerance, gpu_min_max.x, stats.Min, gpu_min_max.y, stats.Max);
+	m_MinMaxMeanCurvature = gpu_min_max;
 }
 void MainLayer::OnAttach()
 {
@@ -106,7 +581,11 @@ void MainLayer::OnAttach()
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	ReloadSquareShader ();
+	ReloadSquareShader (true);
+	m_PickReadback.Allocate (sizeof (GLint));
+	if (!m_CurvatureGPU.Init ())
+		m_UseComputeShader = false;
+	m_Glyphs.Init ();
 
 	if (m_LoadedMeshPath.empty ()) {
 		std::string filepath = "./assets/torus.obj";
@@ -123,29 +602,279 @@ void MainLayer::OnDetach()
 		glDeleteVertexArrays (1, &m_MeshVA);
 	if (m_MeshSVB)
 		glDeleteBuffers (1, &m_MeshSVB);
-	if (m_MeshCVB)
-		glDeleteBuffers (1, &m_MeshCVB);
+	m_MeshColors.Release ();
+	m_DrawCommands.Release ();
 	if (m_MeshIB)
 		glDeleteBuffers (1, &m_MeshIB);
+	release_lods ();
+	m_CurvatureGPU.Release ();
+	m_Glyphs.Release ();
+	if (m_LinesVA)
+		glDeleteVertexArrays (1, &m_LinesVA);
+	if (m_LinesVB)
+		glDeleteBuffers (1, &m_LinesVB);
+	m_PickReadback.Release ();
+	m_Capture.Release ();
+	m_SceneFramebuffer.reset ();
 
 	DeleteSquareShader ();
 }
-void MainLayer::OnUpdate(Timestep ts)
+void MainLayer::OnSimulate (Timestep ts)
 {
+	// worker thread, no GL: everything here only depends on the camera, OnUpdate draws with the result
+	if (m_Recording.Frame >= 0)
+		step_orbit_recording ();
 	m_Camera.Update ();
+	m_ViewProjection = m_Camera.GetProjection ()*m_Camera.GetView ();
+	m_DrawnLOD = select_lod ();
+	if (m_DrawnLOD == 0 && m_MeshletCulling && !m_Meshlets.Meshlets.empty ())
+		cull_meshlets ();
+}
+void MainLayer::OnUpdate(Timestep ts)
+{
+	PollSquareShader ();
+	poll_bvh_build ();
+	if (m_Picking && !m_BVH.Empty ()) {
+		if (CheckFlags (Viewport_Hovered))
+			pick_vertex_on_cpu ();
+	} else if (m_Picking)
+		poll_picked_vertex ();
 
-	glClearColor (0.1f, 0.1f, 0.1f, 1.0f);
-	glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	GLint viewport_framebuffer = 0;
+	glGetIntegerv (GL_DRAW_FRAMEBUFFER_BINDING, &viewport_framebuffer);
+	const glm::uvec2 size = glm::max (glm::uvec2 (This_ViewportSize ()), glm::uvec2 (1));
+	if (!m_SceneFramebuffer) {
+		m_SceneFramebuffer = Framebuffer::Create (FramebufferSpecification{ size.x, size.y, { FramebufferTextureFormat::RGBA8, FramebufferTextureFormat::RED_INTEGER, FramebufferTextureFormat::Depth } });
+	} else if (m_SceneFramebuffer->GetSpecification ().Width != size.x || m_SceneFramebuffer->GetSpecification ().Height != size.y)
+		m_SceneFramebuffer->Resize (size.x, size.y);
+	m_SceneFramebuffer->Bind ();
+
+	// glClear would write float into the integer attachment
+	const GLfloat clear_color[] = { 0.1f, 0.1f, 0.1f, 1.0f };
+	const GLint no_vertex = -1;
+	glClearBufferfv (GL_COLOR, 0, clear_color);
+	glClearBufferiv (GL_COLOR, 1, &no_vertex);
+	glClear (GL_DEPTH_BUFFER_BIT);
 
 	glUseProgram (m_SquareShaderProgID); // You can find shader inside base.cpp as a static c_str
-	glm::mat4 viewProjMat = m_Camera.GetProjection ()*m_Camera.GetView ();
-	glUniformMatrix4fv (m_Uniform.Mat4_ViewProjection, 1, GL_FALSE, glm::value_ptr (viewProjMat));
+	glUniformMatrix4fv (m_Uniform.Mat4_ViewProjection, 1, GL_FALSE, glm::value_ptr (m_ViewProjection));
+	// model matrix also de-quantizes positions, the rest tells the shader how normals/colors are stored
+	glUniformMatrix4fv (m_Uniform.Mat4_ModelMatrix, 1, GL_FALSE, glm::value_ptr (m_PositionDequantize.Matrix ()));
+	glUniform1i (m_Uniform.Int_OctahedralNormals, m_VertexFormat.Normal == NormalFormat::OCTAHEDRAL16);
+	glUniform1i (m_Uniform.Int_ColorIsScalar, m_VertexFormat.Color == ColorFormat::HALF_SCALAR);
+	if (m_VertexFormat.Color == ColorFormat::HALF_SCALAR) {
+		const GLsizei blend_count = GLsizei (MIN (m_BlendKhToColors.size (), size_t (MaxBlendColors)));
+		glUniform1i (m_Uniform.Int_BlendColorCount, blend_count);
+		glUniform3fv (m_Uniform.Vec3_BlendColors, blend_count, &m_BlendKhToColors[0][0]);
+	}
+	draw_mesh ();
+	draw_curvature_lines ();
+	draw_curvature_glyphs (size);
+
+	if (m_Picking && m_BVH.Empty () && CheckFlags (Viewport_Hovered)) { // picked up by poll_picked_vertex a frame or two later
+		auto [mouse_x, mouse_y] = Input::GetMousePosn ();
+		const glm::vec2 pixel = glm::vec2 (mouse_x, mouse_y) - This_ViewportPosition ();
+		m_SceneFramebuffer->ReadPixelAsync (1, int (pixel.x), int (size.y) - 1 - int (pixel.y), m_PickReadback); // GL origin is bottom left
+	}
+	capture_scene ();
+
+	glBindFramebuffer (GL_READ_FRAMEBUFFER, m_SceneFramebuffer->GetRendererID ());
+	glReadBuffer (GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer (GL_DRAW_FRAMEBUFFER, viewport_framebuffer);
+	glBlitFramebuffer (0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer (GL_FRAMEBUFFER, viewport_framebuffer);
 
+	// readbacks/recordings still need frames to finish, even when nothing else changes (on-demand rendering)
+	if (m_Recording.Frame >= 0 || m_Recording.ScreenshotRequested || m_Capture.Pending () || m_PickReadback.InFlight ())
+		RequestRedraw ();
+}
+void MainLayer::draw_mesh ()
+{
+	const uint32_t level = m_DrawnLOD;
+	SetPerformanceCounter ("LOD drawn", double (level), "%.0f");
+	if (level > 0) { // LODs are small, no culling
+		const LODBuffers &buffers = m_LODBuffers[level - 1];
+		glUniformMatrix4fv (m_Uniform.Mat4_ModelMatrix, 1, GL_FALSE, glm::value_ptr (buffers.Dequantize.Matrix ()));
+		glUniform1i (m_Uniform.Int_PickableVertices, 0);
+		glBindVertexArray (buffers.VA);
+		glDrawElements (GL_TRIANGLES, GLsizei (m_LODs[level - 1].Indices.size ()), buffers.IndexType, nullptr);
+		SetPerformanceCounter ("Triangles drawn", double (m_LODs[level - 1].Indices.size ()/3), "%.0f");
+		return;
+	}
+
+	glUniform1i (m_Uniform.Int_PickableVertices, 1);
 	glBindVertexArray (m_MeshVA);
 	glEnableVertexAttribArray (0);
 	glEnableVertexAttribArray (1);
 	glEnableVertexAttribArray (2);
-	glDrawElements (GL_TRIANGLES, m_MeshIndicesData.size (), GL_UNSIGNED_INT, nullptr);
+	if (m_MeshColors.IsAllocated ()) { // colors live in whichever region was written last
+		glBindBuffer (GL_ARRAY_BUFFER, m_MeshColors.GetRendererID ());
+		SetColorVertexAttribute (m_VertexFormat, m_MeshColors.CurrentOffset ());
+	}
+	if (is_point_cloud ()) {
+		glPointSize (m_PointSize);
+		glDrawArrays (GL_POINTS, 0, GLsizei (m_StaticMeshData.size ()));
+		SetPerformanceCounter ("Points drawn", double (m_StaticMeshData.size ()), "%.0f");
+	} else if (m_MeshletCulling && !m_Meshlets.Meshlets.empty ())
+		draw_culled_meshlets ();
+	else glDrawElements (GL_TRIANGLES, m_MeshIndicesData.size (), m_MeshIndexType, nullptr);
+	m_MeshColors.Fence ();
+}
+void MainLayer::step_orbit_recording ()
+{
+	// frames are placed by index, not by time: a frame the capture queue refused is simply retried from the same spot
+	const float angle = glm::radians (360.0f)*float (m_Recording.Frame)/float (m_Recording.OrbitFrames);
+	const glm::vec3 &start = m_Recording.OrbitStart;
+	m_Camera.Position = { start.x*cos (angle) + start.z*sin (angle), start.y, start.z*cos (angle) - start.x*sin (angle) };
+	m_Camera.LookAt ({ 0,0,0 });
+}
+void MainLayer::capture_scene ()
+{
+	m_Capture.Update ();
+	SetPerformanceCounter ("Captures pending", double (m_Capture.Pending ()), "%.0f");
+	if (m_Recording.Frame < 0 && !m_Recording.ScreenshotRequested)
+		return;
+
+	const char *extensions[] = { "png", "ppm" };
+	const std::string mesh_name = std::filesystem::path (m_LoadedMeshPath).stem ().string ();
+	std::ostringstream path;
+	path << m_Recording.Directory << '/' << (mesh_name.empty () ? "scene" : mesh_name) << '_' << std::setfill ('0') << std::setw (3) << m_Recording.Take;
+	if (m_Recording.Frame >= 0)
+		path << '_' << std::setw (4) << m_Recording.Frame;
+	path << '.' << extensions[m_Recording.Format];
+	if (!m_Capture.Capture (*m_SceneFramebuffer, 0, path.str ()))
+		return; // queue full, same frame again next time
+
+	if (m_Recording.ScreenshotRequested) {
+		m_Recording.ScreenshotRequested = false;
+		m_Recording.Take++;
+	} else if (++m_Recording.Frame == m_Recording.OrbitFrames) {
+		LOG_INFO ("Recorded {0} frames into '{1}'", m_Recording.OrbitFrames, m_Recording.Directory);
+		m_Recording.Frame = -1;
+		m_Recording.Take++;
+		m_Camera.Position = m_Recording.OrbitStart;
+		m_Camera.LookAt ({ 0,0,0 });
+	}
+}
+void MainLayer::poll_picked_vertex ()
+{
+	GLint vertex;
+	if (m_PickReadback.Poll (&vertex, sizeof (vertex)))
+		set_picked_vertex (vertex);
+}
+void MainLayer::pick_vertex_on_cpu ()
+{
+	auto [mouse_x, mouse_y] = Input::GetMousePosn ();
+	const glm::vec2 size = glm::max (This_ViewportSize (), glm::vec2 (1));
+	const glm::vec2 pixel = glm::vec2 (mouse_x, mouse_y) - This_ViewportPosition () + 0.5f;
+	const glm::vec2 ndc = { 2*pixel.x/size.x - 1, 1 - 2*pixel.y/size.y };
+	// same camera the frame was drawn with, distances 0..1 span near to far plane
+	const glm::mat4 clip_to_world = glm::inverse (m_ViewProjection);
+	const glm::vec4 near = clip_to_world*glm::vec4 (ndc, -1, 1), far = clip_to_world*glm::vec4 (ndc, 1, 1);
+	const glm::vec3 origin = glm::vec3 (near)/near.w, direction = glm::vec3 (far)/far.w - origin;
+
+	auto start = std::chrono::steady_clock::now ();
+	MeshBVHHit hit;
+	int32_t vertex = -1;
+	if (RaycastMeshBVH (m_BVH, origin, direction, hit, 1.0f)) { // corner nearest to where the ray hit
+		const glm::vec3 point = origin + direction*hit.Distance;
+		float nearest = FLT_MAX;
+		for (int corner = 0; corner < 3; corner++) {
+			const float distance = glm::length2 (m_BVH.Positions[hit.Vertices[corner]] - point);
+			if (distance < nearest)
+				nearest = distance, vertex = int32_t (hit.Vertices[corner]);
+		}
+	}
+	SetPerformanceCounter ("Hover pick (us)", std::chrono::duration<double, std::micro> (std::chrono::steady_clock::now () - start).count ());
+	set_picked_vertex (vertex);
+}
+void MainLayer::set_picked_vertex (int32_t vertex)
+{
+	if (vertex == m_Picked.Vertex)
+		return;
+	m_Picked.Vertex = vertex >= 0 && size_t (vertex) < m_StaticMeshData.size () ? vertex : -1;
+	if (m_Picked.Vertex < 0)
+		return;
+	if (is_point_cloud ()) { // no rings to evaluate on, whatever the last run left
+		const bool calculated = m_Result_GaussianCurvatureValue.size () == m_StaticMeshData.size ();
+		m_Picked.MeanCurvature = calculated ? m_Result_MeanCurvatureValue[vertex] : 0;
+		m_Picked.MeanCurvatureNormal = calculated ? m_Result_MeanCurvatureNormal[vertex] : glm::vec3 (0);
+		m_Picked.GaussianCurvature = calculated ? m_Result_GaussianCurvatureValue[vertex] : 0;
+		m_Picked.A_mixed = 0;
+		return;
+	}
+	// per vertex A_mixed isn't kept by either curvature path, it's evaluated on the spot (one-ring, like the kernels)
+	if (m_PickRings.VertexCount () != m_StaticMeshData.size ())
+		BuildVertexRings (m_StaticMeshData.size (), m_MeshIndicesData, m_PickRings);
+	m_Picked.MeanCurvature = MeanCurvatureAtVertex (m_StaticMeshData, m_PickRings, size_t (vertex), m_Picked.MeanCurvatureNormal, m_Picked.A_mixed);
+	// K_h/K(Xi) are what the colors show (LOD transfer, scale, compute), the one-ring values only until the first run
+	if (m_ResultsOnGPU)
+		m_CurvatureGPU.ReadBackVertex (size_t (vertex), m_Picked.MeanCurvature, m_Picked.MeanCurvatureNormal);
+	else if (m_Result_MeanCurvatureValue.size () == m_StaticMeshData.size () && m_Result_MeanCurvatureNormal.size () == m_StaticMeshData.size ()) {
+		m_Picked.MeanCurvature = m_Result_MeanCurvatureValue[vertex];
+		m_Picked.MeanCurvatureNormal = m_Result_MeanCurvatureNormal[vertex];
+	}
+}
+void MainLayer::start_bvh_build ()
+{
+	m_BVH = MeshBVH ();
+	m_BVHBuilding = std::make_shared<MeshBVH> ();
+	// the job works on copies, the mesh may be reloaded (or the layer detached) before it finishes
+	m_BVHBuild = JobSystem::Submit ([bvh = m_BVHBuilding, posn_and_normals = m_StaticMeshData, indices = m_MeshIndicesData]() {
+		auto start = std::chrono::steady_clock::now ();
+		BuildMeshBVH (posn_and_normals, indices, *bvh);
+		LOG_INFO ("BVH over {0} triangles built in {1} ms, {2} nodes", indices.size ()/3
+				  , std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - start).count (), bvh->Nodes.size ());
+		// wakes on-demand rendering for its settle frames, poll_bvh_build picks the result up in one of them
+		// (RequestRedraw would need the layer, which may be gone by now)
+		Application::Get ().RequestFrame ();
+	});
+}
+void MainLayer::poll_bvh_build ()
+{
+	if (!m_BVHBuild.valid () || m_BVHBuild.wait_for (std::chrono::seconds (0)) != std::future_status::ready)
+		return;
+	m_BVHBuild.get ();
+	m_BVH = std::move (*m_BVHBuilding);
+	m_BVHBuilding.reset ();
+	SetPerformanceCounter ("BVH nodes", double (m_BVH.Nodes.size ()), "%.0f");
+	SetPerformanceCounter ("BVH memory (KB)", (m_BVH.Nodes.size ()*sizeof (MeshBVH::Node) + m_BVH.Triangles.size ()*(sizeof (glm::uvec3) + sizeof (uint32_t))
+											   + m_BVH.Positions.size ()*sizeof (glm::vec3))/1024.0, "%.1f");
+}
+void MainLayer::cull_meshlets ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	MeshletCullParams params;
+	params.ViewProjection = m_ViewProjection;
+	params.CameraPosition = m_Camera.Position;
+	params.Frustum = true;
+	params.BackfaceCones = m_ConeCulling;
+	m_CullStats = CullMeshlets (m_Meshlets, params, m_MeshletVisibility, m_CulledCommands.data ());
+}
+void MainLayer::draw_culled_meshlets ()
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const MeshletCullStats &stats = m_CullStats;
+	const size_t index_size = m_MeshIndexType == GL_UNSIGNED_SHORT ? sizeof (uint16_t) : sizeof (uint32_t);
+	if (m_DrawCommands.IsAllocated ()) { // culled on a worker in OnSimulate, only copied into the fenced indirect ring here
+		DrawElementsIndirectCommand *commands = (DrawElementsIndirectCommand *)m_DrawCommands.BeginWrite ();
+		memcpy (commands, m_CulledCommands.data (), stats.Commands*sizeof (DrawElementsIndirectCommand));
+		m_DrawCommands.EndWrite ();
+		glBindBuffer (GL_DRAW_INDIRECT_BUFFER, m_DrawCommands.GetRendererID ());
+		glMultiDrawElementsIndirect (GL_TRIANGLES, m_MeshIndexType, (void *)m_DrawCommands.CurrentOffset (), GLsizei (stats.Commands), 0);
+		glBindBuffer (GL_DRAW_INDIRECT_BUFFER, 0);
+		m_DrawCommands.Fence ();
+	} else {
+		m_DrawCounts.resize (stats.Commands), m_DrawOffsets.resize (stats.Commands);
+		for (size_t i = 0; i < stats.Commands; i++) {
+			m_DrawCounts[i] = GLsizei (m_CulledCommands[i].Count);
+			m_DrawOffsets[i] = (const void *)(m_CulledCommands[i].FirstIndex*index_size);
+		}
+		glMultiDrawElements (GL_TRIANGLES, m_DrawCounts.data (), m_MeshIndexType, m_DrawOffsets.data (), GLsizei (stats.Commands));
+	}
+	SetPerformanceCounter ("Meshlets drawn", double (stats.VisibleMeshlets), "%.0f");
+	SetPerformanceCounter ("Triangles drawn", double (stats.VisibleTriangles), "%.0f");
+	SetPerformanceCounter ("Draw commands", double (stats.Commands), "%.0f");
 }
 std::array<int, 10> just_an_arr = my_std::make_array<10> (23);
 void MainLayer::OnImGuiRender()
@@ -160,6 +889,21 @@ void MainLayer::OnImGuiRender()
 		}
 	};
 
+	if (m_Picking && CheckFlags (Viewport_Hovered)) {
+		if (m_Picked.Vertex >= 0) {
+			const glm::vec3 &posn = m_StaticMeshData[m_Picked.Vertex].first, &K_Xi = m_Picked.MeanCurvatureNormal;
+			ImGui::BeginTooltip ();
+			ImGui::Text ("vertex %d {%.4f, %.4f, %.4f}", m_Picked.Vertex, posn.x, posn.y, posn.z);
+			ImGui::Text ("K_h     %g", m_Picked.MeanCurvature);
+			ImGui::Text ("K(Xi)   {%g, %g, %g}", K_Xi.x, K_Xi.y, K_Xi.z);
+			if (is_point_cloud ())
+				ImGui::Text ("K_g     %g", m_Picked.GaussianCurvature);
+			else ImGui::Text ("A_mixed %g", m_Picked.A_mixed);
+			ImGui::EndTooltip ();
+		} else if (m_DrawnLOD > 0 && m_BVH.Empty ())
+			ImGui::SetTooltip ("LOD %u drawn, picking needs the full mesh (Force LOD 0)", m_DrawnLOD);
+	}
+
 	ImGui::Begin(ImGuiLayer::UniqueName("Controls"));
 
 	if (ImGui::BeginTabBar (GLCore::ImGuiLayer::UniqueName ("Shaders Content"))) {
@@ -183,13 +927,170 @@ void MainLayer::OnImGuiRender()
 				m_Camera.LookAt ({ 0,0,0 });
 			Tooltip ("Messed up your camera, just click me to face it towards object");
 			
-			if (ImGui::Button ("Calculate mean curvature", ImVec2{ -1,ImGui::GetFontSize () + 5 }))
+			if (ImGui::Button ("Calculate mean curvature", ImVec2{ -1,ImGui::GetFontSize () + 5 })) {
 				calculate_my_curvature ();
+				if (m_LineSettings.Show)
+					extract_curvature_lines ();
+			}
 			Tooltip ("Calculates Mean curvature, Meat of the program (I'm a vegetarian though)\nVisualzer, maps data to min to max val\n");
+
+			if (m_CurvatureGPU.IsReady ()) {
+				ImGui::Checkbox ("Use compute shader", &m_UseComputeShader);
+				Tooltip ("Runs curvature + color mapping in compute shaders straight on the mesh buffers,\nonly min/max are read back (debug output is CPU only)");
+				ImGui::SameLine ();
+				if (ImGui::Button ("Validate vs CPU"))
+					validate_compute_curvature ();
+				Tooltip ("Runs both paths, PASS when the max difference stays within 0.1% of the K_h range");
+			} else ImGui::TextDisabled ("Compute shaders unavailable (needs OpenGL 4.3)");
+
+			ImGui::Checkbox ("Hover picking", &m_Picking);
+			Tooltip ("Shows K_h, K(Xi) and A_mixed of the vertex under the cursor,\nvertex ids are rendered alongside the colors and read back asynchronously");
+
+			ImGui::Checkbox ("Meshlet culling", &m_MeshletCulling);
+			Tooltip ("Draws only the meshlets (clusters of <= 124 triangles) inside the view frustum,\nsee the Performance panel for how many");
+			ImGui::SameLine ();
+			ImGui::Checkbox ("Back-face cones", &m_ConeCulling);
+			Tooltip ("Also skips meshlets facing entirely away from the camera,\nonly for closed, counter clock-wise wound meshes (open meshes lose their back side)");
+
+			if (ImGui::CollapsingHeader ("Capture")) {
+				ImGui::InputText ("Directory", m_Recording.Directory, sizeof (m_Recording.Directory));
+				ImGui::Combo ("Format", &m_Recording.Format, "png\0ppm\0");
+				Tooltip ("png is written uncompressed, both are about width*height*3 bytes per frame");
+				if (ImGui::Button ("Screenshot") && m_Recording.Frame < 0)
+					m_Recording.ScreenshotRequested = true;
+				ImGui::SameLine ();
+				if (m_Recording.Frame < 0) {
+					if (ImGui::Button ("Record orbit")) {
+						m_Recording.OrbitStart = m_Camera.Position;
+						m_Recording.Frame = 0;
+					}
+					Tooltip ("Captures 'Frames' images while the camera turns once around the Y axis,\nframes are read back asynchronously and written on a background thread");
+				} else if (ImGui::Button ("Stop")) {
+					m_Recording.Frame = -1;
+					m_Recording.Take++;
+				}
+				ImGui::SameLine ();
+				ImGui::SetNextItemWidth (ImGui::GetFontSize ()*6);
+				if (m_Recording.Frame < 0)
+					ImGui::DragInt ("Frames", &m_Recording.OrbitFrames, 1, 1, 10000);
+				else ImGui::Text ("frame %d/%d", m_Recording.Frame, m_Recording.OrbitFrames);
+				ImGui::Text ("%u written, %u pending, %u failed", m_Capture.Written (), m_Capture.Pending (), m_Capture.Failed ());
+			}
+			if (ImGui::CollapsingHeader ("Index order")) {
+				ImGui::Checkbox ("Optimize on load", &m_OptimizeMesh);
+				Tooltip ("Spatial sort + meshlets + Tipsify inside every meshlet + vertices renumbered in first use order,\ncached next to the mesh as <mesh>.opt (vertex indices in the debug output no longer match the file)");
+				ImGui::SameLine ();
+				ImGui::Checkbox ("Overdraw order", &m_OptimizeOverdraw);
+				Tooltip ("Outward facing meshlets first, fewer hidden fragments shaded\nbut culling merges fewer meshlets into one draw");
+				ImGui::Text ("ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (%u entry FIFO)", m_FileOrderCacheStats.ACMR, m_UploadedCacheStats.ACMR
+							 , m_FileOrderCacheStats.ATVR, m_UploadedCacheStats.ATVR, VertexCacheSize);
+				if (ImGui::Button ("Reload mesh") && !m_LoadedMeshPath.empty () && !load_model (m_LoadedMeshPath))
+					LOG_ERROR ("Cannot Load Mesh");
+			}
+			if (ImGui::CollapsingHeader ("Level of detail")) {
+				const int level_count = int (m_LODs.size ());
+				ImGui::Text ("Full mesh: %zu triangles", m_MeshIndicesData.size ()/3);
+				for (int l = 0; l < level_count; l++)
+					ImGui::Text ("LOD %d: %zu triangles, error %g", l + 1, m_LODs[l].Indices.size ()/3, m_LODs[l].GeometricError);
+				ImGui::SliderInt ("Force LOD", &m_ForcedLOD, -1, level_count);
+				Tooltip ("-1 picks the coarsest level whose error stays below the pixel threshold, 0 is the full mesh");
+				ImGui::DragFloat ("Max error (px)", &m_LODPixelError, 0.1f, 0.1f, 64.0f);
+				ImGui::SliderInt ("Curvature on LOD", &m_CurvatureLOD, 0, level_count);
+				Tooltip ("Computes curvature on a coarser level (CPU only) and copies K_h/K(Xi) back\nto every full mesh vertex merged into it, much faster on huge meshes");
+			}
+			if (!is_point_cloud () && ImGui::CollapsingHeader ("Curvature scale")) {
+				ImGui::Checkbox ("Multi-scale", &m_MultiScale);
+				Tooltip ("Averages the integrated K(Xi) over neighbourhoods wider than the one-ring (CPU, full mesh),\nfor noisy scans: every scale is computed in one pass, the slider below switches between them");
+				ImGui::Combo ("Neighbourhood", (int *)&m_ScaleSettings.Neighbourhood, "k-ring\0Euclidean radius (mean edge lengths)\0");
+				int scale_count = int (m_ScaleSettings.Scales.size ());
+				if (ImGui::SliderInt ("Scales", &scale_count, 1, int (MultiScaleCurvatureSettings::MaxScales)))
+					m_ScaleSettings.Scales.resize (scale_count, m_ScaleSettings.Scales.empty () ? 0.0f : m_ScaleSettings.Scales.back ()*2);
+				for (int s = 0; s < scale_count; s++)
+					ImGui::DragFloat (("Scale " + std::to_string (s)).c_str (), &m_ScaleSettings.Scales[s], 0.1f, 0.0f, 64.0f
+									  , m_ScaleSettings.Neighbourhood == CurvatureNeighbourhood::Rings ? "%.0f rings" : "%.1f edges");
+				if (!m_ScaleValues.empty () && ImGui::SliderInt ("Shown scale", &m_ShownScale, 0, int (m_ScaleValues.size ()) - 1)) {
+					show_curvature_scale (m_ShownScale);
+					if (m_LineSettings.Show)
+						extract_curvature_lines ();
+				}
+				Tooltip ("Results of the last run, switching doesn't recompute");
+			}
+			if (!is_point_cloud () && ImGui::CollapsingHeader ("Isolines and ridges")) {
+				bool changed = false;
+				if (ImGui::Checkbox ("Show lines", &m_LineSettings.Show) && m_LineSettings.Show) {
+					if (m_LineSettings.IsoSpacing == 0) { // spread over the current range the first time
+						const float step = (m_MinMaxMeanCurvature.y - m_MinMaxMeanCurvature.x)/float (m_LineSettings.IsoCount + 1);
+						m_LineSettings.IsoLevel = m_MinMaxMeanCurvature.x + step, m_LineSettings.IsoSpacing = step;
+					}
+					changed = true;
+				}
+				Tooltip ("Contours of K_h (white) from the last run (compute results are read back once), ridges (red) and valleys (blue) where the principal curvature\npeaks along its own direction, drawn over the full mesh");
+				changed |= ImGui::SliderInt ("Iso-levels", &m_LineSettings.IsoCount, 0, 32);
+				changed |= ImGui::SliderFloat ("First level", &m_LineSettings.IsoLevel, m_MinMaxMeanCurvature.x, m_MinMaxMeanCurvature.y, "%.4g");
+				changed |= ImGui::DragFloat ("Spacing", &m_LineSettings.IsoSpacing, (m_MinMaxMeanCurvature.y - m_MinMaxMeanCurvature.x)*0.001f, 0.0f, FLT_MAX, "%.4g");
+				changed |= ImGui::Checkbox ("Ridges", &m_LineSettings.Ridges);
+				ImGui::SameLine ();
+				changed |= ImGui::Checkbox ("Valleys", &m_LineSettings.Valleys);
+				changed |= ImGui::DragFloat ("Strength", &m_LineSettings.RidgeStrength, 0.05f, 0.0f, 100.0f, "%.2f x mean |kappa|");
+				Tooltip ("Ridges/valleys whose curvature is below this are dropped, the first one computes the curvature tensor");
+				if (changed && m_LineSettings.Show)
+					extract_curvature_lines (); // cheap enough to follow the sliders
+				ImGui::Text ("%zu polylines, %zu points", m_Lines.Polylines.size (), m_Lines.Points.size ());
+				ImGui::InputText ("Export to", m_LineSettings.ExportPath, sizeof (m_LineSettings.ExportPath));
+				ImGui::SameLine ();
+				if (ImGui::Button ("Export")) {
+					if (WriteCurvatureLinesOBJ (m_LineSettings.ExportPath, m_Lines))
+						LOG_INFO ("{0} polylines written to {1}", m_Lines.Polylines.size (), m_LineSettings.ExportPath);
+					else LOG_ERROR ("Cannot write {0}", m_LineSettings.ExportPath);
+				}
+				Tooltip ("Wavefront OBJ, one object of 'l' elements per polyline");
+			}
+			if (m_Glyphs.IsReady () && ImGui::CollapsingHeader ("Curvature vectors")) {
+				ImGui::Checkbox ("Show vectors", &m_ShowGlyphs);
+				Tooltip ("One arrow per sampled vertex along K(Xi) = 2*K_h*n, length and color follow |K(Xi)|,\nread on the GPU straight from the compute path's buffer (or the last CPU run)");
+				ImGui::Combo ("Sampling", (int *)&m_GlyphSettings.Mode, "Every n-th vertex\0Screen density\0");
+				if (m_GlyphSettings.Mode == CurvatureGlyphs::Sampling::Stride)
+					ImGui::SliderInt ("Stride", &m_GlyphSettings.Stride, 1, 256);
+				else ImGui::SliderFloat ("Cell size", &m_GlyphSettings.CellPixels, 2.0f, 64.0f, "%.0f px");
+				Tooltip ("Screen density: at most one arrow per cell, the lowest visible front facing vertex in it");
+				ImGui::SliderFloat ("Length", &m_GlyphLength, 0.01f, 1.0f, "%.2f x mesh radius");
+			}
+			if (is_point_cloud () && ImGui::CollapsingHeader ("Point cloud")) {
+				int neighbours = int (m_PointCloudSettings.Neighbours);
+				if (ImGui::SliderInt ("Neighbours", &neighbours, 6, int (PointCloudCurvatureSettings::MaxNeighbours)))
+					m_PointCloudSettings.Neighbours = uint32_t (neighbours);
+				Tooltip ("k nearest points every surface fit is made over, more smooths out noise and small features");
+				ImGui::Combo ("Fit", (int *)&m_PointCloudSettings.Fit, "Quadric (3 unknowns, trusts normals)\0Osculating jet (6 unknowns)\0");
+				ImGui::Checkbox ("Estimate normals", &m_PointCloudSettings.EstimateNormals);
+				Tooltip ("PCA normals of every neighbourhood instead of the file's, points without one always get estimated");
+				ImGui::SliderFloat ("Point size", &m_PointSize, 1.0f, 16.0f);
+				ImGui::Text ("k-d tree: %zu points, depth %u", m_PointTree.Points.size (), m_PointTree.Depth);
+			}
+			if (ImGui::CollapsingHeader ("Vertex format")) {
+				MeshVertexFormat format = m_VertexFormat;
+				const char *position_formats[] = { "float3 (12 B)", "unorm16, AABB relative (8 B)" };
+				const char *normal_formats[] = { "float3 (12 B)", "int 2_10_10_10 (4 B)", "octahedral snorm16 (4 B)" };
+				const char *color_formats[] = { "float3 (12 B)", "rgba8 unorm (4 B)", "half float K_h, shader blends (2 B)" };
+				ImGui::Combo ("Positions", (int *)&format.Position, position_formats, IM_ARRAYSIZE (position_formats));
+				ImGui::Combo ("Normals", (int *)&format.Normal, normal_formats, IM_ARRAYSIZE (normal_formats));
+				ImGui::Combo ("Colors", (int *)&format.Color, color_formats, IM_ARRAYSIZE (color_formats));
+				ImGui::Checkbox ("16-bit indices when possible", &format.SmallIndices);
+				if (ImGui::Button ("Compact preset"))
+					format = MeshVertexFormat::Compact ();
+				ImGui::SameLine ();
+				if (ImGui::Button ("Full precision"))
+					format = MeshVertexFormat ();
+				ImGui::Text ("%u + %u bytes/vertex, %s indices", format.StaticStride (), format.ColorStride ()
+							 , m_MeshIndexType == GL_UNSIGNED_SHORT ? "16-bit" : "32-bit");
+				if (format != m_VertexFormat && !m_StaticMeshData.empty ()) {
+					m_VertexFormat = format;
+					upload_mesh (); // colors start over, recalculate to see curvature again
+				}
+			}
 			
 			ImGui::Separator ();
 			if (ImGui::Button ("Load Another Model", ImVec2{ -1,ImGui::GetFontSize () + 5 })) {
-				std::string filePath = GLCore::Utils::FileDialogs::OpenFile ("Model\0*.obj\0");
+				std::string filePath = GLCore::Utils::FileDialogs::OpenFile ("Model\0*.obj\0Point cloud\0*.xyz\0");
 				if (!filePath.empty ()) {
 					std::string temp = filePath; // copy
 					if (!load_model (std::move (filePath)))
@@ -197,7 +1098,7 @@ void MainLayer::OnImGuiRender()
 					else
 						m_LoadedMeshPath = std::move (temp);
 				}
-			}; Tooltip ("Only Accepts .OBJ, as it was written in haste (to avoid vertex duplication),\nso the file should be triangulated mesh, with\n  v {vertex_position vec3}\n  vn{vertex_normal vec3}\n  vt{vertex_tex_co vec3}\n  f {triangle_face f/f/f f/f/f f/f/f}");
+			}; Tooltip ("Only Accepts .OBJ, as it was written in haste (to avoid vertex duplication),\nso the file should be triangulated mesh, with\n  v {vertex_position vec3}\n  vn{vertex_normal vec3}\n  vt{vertex_tex_co vec3}\n  f {triangle_face f/f/f f/f/f f/f/f}\nor a point cloud .xyz (x y z [nx ny nz] per line), curvature comes from local surface fits");
 
 			ImGui::Text ("------------------\n| (?) Hover Over |\n------------------");
 			Tooltip ("To use the visualizer, import a model, (there will be a default one).\nClick button \"Calculate mean curvature\",it will calculate mean curvature{Kh}\nand mean_curvature_normal_operaor{K(Xi)} for you and display it over screen.\nFor controls -\n  Up    Arrow | Mouse Drag Up = moves camera up, while looking at object\n  Down  Arrow | Mouse Drag Dn = moves camera Dn, while looking at object\n  D | Right Arrow | Mouse Drag Rt = moves camera right, while looking at object\n  A | Left  Arrow | Mouse Drag Lt = moves camera left,  while looking at object\n  W = moves camera closer ( forward (non-linearly))\n  D = moves camera farther(backward (non-linearly))");
@@ -210,7 +1111,7 @@ void MainLayer::OnImGuiRender()
 				int size = m_BlendKhToColors.size ();
 				
 				if (ImGui::InputInt (": Size", &size)) {
-					m_BlendKhToColors.resize (MAX (2, size));
+					m_BlendKhToColors.resize (MIN (MAX (2, size), int (MaxBlendColors))); // shader side ramp is fixed size
 				}
 				for (uint32_t i = 0; i < m_BlendKhToColors.size (); i++)
 					ImGui::ColorPicker3 (std::to_string (i).c_str (), &m_BlendKhToColors[i][0]);
@@ -302,10 +1203,15 @@ void MainLayer::OnSquareShaderReload ()
 {
 	m_Uniform.Mat4_ViewProjection = glGetUniformLocation (m_SquareShaderProgID, ViewProjectionIdentifierInShader);
 	m_Uniform.Mat4_ModelMatrix    = glGetUniformLocation (m_SquareShaderProgID, ModelMatrixIdentifierInShader);
+	// -1 (ignored by glUniform*) when an edited shader doesn't declare them
+	m_Uniform.Int_OctahedralNormals = glGetUniformLocation (m_SquareShaderProgID, "u_OctahedralNormals");
+	m_Uniform.Int_ColorIsScalar     = glGetUniformLocation (m_SquareShaderProgID, "u_ColorIsScalar");
+	m_Uniform.Int_BlendColorCount   = glGetUniformLocation (m_SquareShaderProgID, "u_BlendColorCount");
+	m_Uniform.Vec3_BlendColors      = glGetUniformLocation (m_SquareShaderProgID, "u_BlendColors");
+	m_Uniform.Int_PickableVertices  = glGetUniformLocation (m_SquareShaderProgID, "u_PickableVertices");
 
 	glUseProgram (m_SquareShaderProgID); // You can find shader inside base.cpp as a static c_str
-	glm::mat4 modelMatrix = glm::mat4 (1.0f);
-	glUniformMatrix4fv (m_Uniform.Mat4_ModelMatrix, 1, GL_FALSE, glm::value_ptr (modelMatrix));
+	glUniformMatrix4fv (m_Uniform.Mat4_ModelMatrix, 1, GL_FALSE, glm::value_ptr (m_PositionDequantize.Matrix ()));
 }
 
 
@@ -1,8 +1,17 @@
-#pragma once
+﻿#pragma once
 
 #include <GLCore.h>
 #include <GLCoreUtils.h>
 #include "base.h"
+#include "mean_curvature_gpu.h"
+#include "meshlets.h"
+#include "mesh_lod.h"
+#include "mesh_optimize.h"
+#include "mesh_bvh.h"
+#include "point_cloud.h"
+#include "curvature_lines.h"
+#include "curvature_glyphs.h"
+#include "GLCore/Util/Core/Framebuffer.h"
 
 class MainLayer : public SqrShader_Base
 {
@@ -15,13 +24,41 @@ public:
 	virtual void OnAttach() override;
 	virtual void OnDetach() override;
 	virtual void OnEvent(GLCore::Event& event) override;
+	virtual void OnSimulate (GLCore::Timestep ts) override;
 	virtual void OnUpdate(GLCore::Timestep ts) override;
 	virtual void OnImGuiRender() override;
 	virtual void ImGuiMenuOptions() override;
 	virtual void OnSquareShaderReload () override;
 private:
 	bool load_model (std::string filePath);
+	void optimize_mesh (const std::string &filePath); // fills m_Meshlets, reorders m_StaticMeshData/m_MeshIndicesData
+	void upload_mesh (); // (re)creates the GL buffers from m_StaticMeshData/m_MeshIndicesData in m_VertexFormat
+	void upload_lods ();
+	void release_lods ();
+	void write_lod_colors (const std::vector<float> &full_mean_curvature_values);
+	void write_lod_colors_from_gpu (); // compute path's K_h averaged per LOD on the GPU, read back only if the chain isn't uploaded
+	uint32_t select_lod ();
 	void calculate_my_curvature ();
+	void calculate_curvature_on_lod (uint32_t level, const char *debug_filename);
+	void calculate_point_cloud_curvature (); // k-d tree + local surface fits, no topology needed
+	void calculate_multiscale_curvature (); // every scale of m_ScaleSettings in one pass over the full mesh
+	void show_curvature_scale (int scale); // m_Result_* and colors from an already computed scale
+	void read_back_gpu_results (); // compute path's results into m_Result_*, once per run, for what only works on the CPU copy
+	void extract_curvature_lines (); // from m_Result_MeanCurvatureValue (+ m_Principal), uploads m_LinesVB
+	void draw_curvature_lines ();
+	void draw_curvature_glyphs (glm::uvec2 viewport_size); // K(Xi) arrows, from the compute path's SSBO or the last CPU run
+	bool is_point_cloud () const { return !m_StaticMeshData.empty () && m_MeshIndicesData.empty (); }
+	void draw_mesh (); // m_DrawnLOD with m_ViewProjection, both from OnSimulate
+	void cull_meshlets (); // OnSimulate, fills m_CulledCommands/m_CullStats
+	void draw_culled_meshlets ();
+	void poll_picked_vertex ();
+	void pick_vertex_on_cpu (); // hover ray against m_BVH, no readback
+	void set_picked_vertex (int32_t vertex);
+	void start_bvh_build (); // on the job system, m_BVH stays empty until poll_bvh_build picks the result up
+	void poll_bvh_build ();
+	void step_orbit_recording (); // places the camera for the next sequence frame, before m_Camera.Update
+	void capture_scene (); // after drawing, queues the screenshot/sequence frame
+	void validate_compute_curvature ();
 public:
 	struct Camera
 	{
@@ -60,23 +97,92 @@ public:
 private:
 	bool m_DebugOutput = false;
 	Camera m_Camera;
+	glm::mat4 m_ViewProjection = glm::mat4 (1); // updated in OnSimulate
 	
-	GLuint m_MeshVA = 0, m_MeshSVB = 0, m_MeshCVB = 0, m_MeshIB = 0;
-	// vertexArray, vertexBuff(posn & nrml), vertexColorsBuff, indices
+	GLuint m_MeshVA = 0, m_MeshSVB = 0, m_MeshIB = 0;
+	// vertexArray, vertexBuff(posn & nrml), indices
+	GLCore::Utils::StreamingBuffer m_MeshColors; // vertex colors, written in place by the CPU/compute path, attribute 2 follows its current region
+	MeshVertexFormat m_VertexFormat;
+	PositionDequantize m_PositionDequantize;
+	GLenum m_MeshIndexType = GL_UNSIGNED_INT;
+
+	MeshletMesh m_Meshlets; // built at load, the index buffer is uploaded in meshlet order
+	GLCore::Utils::StreamingBuffer m_DrawCommands; // DrawElementsIndirectCommand's, refilled every frame
+	std::vector<DrawElementsIndirectCommand> m_CulledCommands; // written by OnSimulate, copied into m_DrawCommands (or glMultiDrawElements without GL 4.3)
+	MeshletCullStats m_CullStats;
+	std::vector<GLsizei> m_DrawCounts;
+	std::vector<const void *> m_DrawOffsets;
+	std::vector<uint8_t> m_MeshletVisibility;
+	bool m_MeshletCulling = true, m_ConeCulling = false;
+	bool m_OptimizeMesh = true, m_OptimizeOverdraw = false; // applied on (re)load
+	VertexCacheStats m_FileOrderCacheStats, m_UploadedCacheStats;
+
+	std::vector<MeshLOD> m_LODs; // level i+1 in m_LODs[i], level 0 is the full mesh above
+	struct LODBuffers
+	{
+		GLuint VA = 0, SVB = 0, CVB = 0, IB = 0;
+		GLenum IndexType = GL_UNSIGNED_INT;
+		PositionDequantize Dequantize;
+	};
+	std::vector<LODBuffers> m_LODBuffers; // same vertex format as the full mesh, colors are the full mesh K_h averaged per LOD vertex
+	glm::vec3 m_MeshCenter = { 0,0,0 };
+	float m_MeshRadius = 0;
+	int m_ForcedLOD = -1;      // -1 = pick by screen space error
+	float m_LODPixelError = 1; // max allowed error in pixels
+	int m_CurvatureLOD = 0;    // level curvature is computed on, results are transferred back to the full mesh
 	struct
 	{
 		GLuint Mat4_ViewProjection;
 		GLuint Mat4_ModelMatrix;
+		GLint Int_OctahedralNormals = -1, Int_ColorIsScalar = -1, Int_BlendColorCount = -1, Vec3_BlendColors = -1;
+		GLint Int_PickableVertices = -1;
 
 	}m_Uniform;
 
 	std::vector<std::pair<glm::vec3, glm::vec3>> m_StaticMeshData; // {vertex_position, vertex_normal}, static VBO
-	std::vector<glm::vec3> m_MeshColorData; // Dynamic VBO
 	std::vector<GLuint> m_MeshIndicesData;
+	uint64_t m_MeshGeneration = 0; // bumped by every load, keys data derived from the mesh (GPU adjacency)
 
 	std::vector<glm::vec3> m_Result_MeanCurvatureNormal;
 	std::vector<float> m_Result_MeanCurvatureValue;
+	std::vector<float> m_Result_GaussianCurvatureValue; // point clouds only, the fits give it for free
+
+	bool m_MultiScale = false; // CPU only, full mesh
+	MultiScaleCurvatureSettings m_ScaleSettings;
+	int m_ShownScale = 0;
+	std::vector<std::vector<glm::vec3>> m_ScaleNormals; // [scale][vertex], from the last run
+	std::vector<std::vector<float>> m_ScaleValues;
+
+	struct
+	{
+		bool Show = false;
+		int IsoCount = 4;
+		float IsoLevel = 0, IsoSpacing = 0; // levels are IsoLevel + i*IsoSpacing, both follow the curvature range when it changes
+		bool Ridges = false, Valleys = false;
+		float RidgeStrength = 2.0f; // times the mean |kappa|
+		char ExportPath[256] = "curvature_lines.obj";
+	}m_LineSettings;
+	CurvatureLines m_Lines;
+	PrincipalCurvatures m_Principal; // computed the first time ridges/valleys are asked for
+	GLuint m_LinesVA = 0, m_LinesVB = 0;
+	std::vector<GLint> m_LineFirsts;
+	std::vector<GLsizei> m_LineCounts;
+
+	CurvatureGlyphs m_Glyphs;
+	CurvatureGlyphs::Settings m_GlyphSettings;
+	bool m_ShowGlyphs = false;
+	float m_GlyphLength = 0.1f; // longest arrow, in mesh radii
+	bool m_GlyphMeshUploaded = false, m_GlyphVectorsUploaded = false;
+	bool m_ResultsOnGPU = false; // the last run was the compute path, m_Result_* are stale until read_back_gpu_results
 
+	PointKDTree m_PointTree; // built by the first curvature run on a point cloud
+	PointCloudCurvatureSettings m_PointCloudSettings;
+	float m_PointSize = 2.0f;
+
+	MeanCurvatureGPU m_CurvatureGPU; // results stay on the GPU, m_Result_* are only filled by the CPU path
+	bool m_UseComputeShader = false;
+
+	static constexpr uint32_t MaxBlendColors = 16; // u_BlendColors[] in the default vertex shader
 	std::vector<glm::vec3> m_BlendKhToColors{
 												glm::vec3{0,0,85},
 												glm::vec3{0.0f,0.15f,0.65f},
@@ -86,6 +192,35 @@ private:
 												glm::vec3{0.85f,0.15f,0},
 												glm::vec3{1.0f,0,0}
 	};
+	// scene is drawn here (color + vertex ids), then blitted into the viewport, ids are read back without stalling
+	std::shared_ptr<GLCore::Utils::Framebuffer> m_SceneFramebuffer;
+	GLCore::Utils::PixelReadback m_PickReadback;
+	bool m_Picking = true;
+	uint32_t m_DrawnLOD = 0;
+	struct
+	{
+		int32_t Vertex = -1; // hover ray against m_BVH, or the latest finished readback (1-2 frames behind the cursor)
+		glm::vec3 MeanCurvatureNormal;
+		float MeanCurvature = 0, A_mixed = 0;
+		float GaussianCurvature = 0; // point clouds, they have no A_mixed
+	}m_Picked;
+	VertexRings m_PickRings; // built when the first vertex of a mesh is picked
+	MeshBVH m_BVH; // full mesh, picks at any LOD, the id buffer readback covers the time it takes to build
+	std::shared_ptr<MeshBVH> m_BVHBuilding; // owned by the build job too, a reload simply drops the stale one
+	std::future<void> m_BVHBuild;
+
+	GLCore::Utils::FrameCapture m_Capture; // PBO readback, files are written on its own thread
+	struct
+	{
+		char Directory[256] = "captures";
+		int Format = 0; // index into {"png", "ppm"}
+		bool ScreenshotRequested = false;
+		int OrbitFrames = 120; // one full turn around the Y axis
+		int Frame = -1;        // sequence frame being captured, -1 = not recording
+		glm::vec3 OrbitStart = { 0,0,0 };
+		uint32_t Take = 0;     // numbers screenshots and sequences so nothing gets overwritten
+	}m_Recording;
+
 	glm::vec2 m_LastMousePosns = { 0,0 };
 	glm::vec2 m_MinMaxMeanCurvature = { 0,0 };
 
@@ -8,143 +8,40 @@
 #include <vector>
 #include <stb_image/stb_image.h>
 #include <imgui/imgui_internal.h>
+#include <mutex>
+#include <memory>
+#include <cstring>
+#include <cfloat>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+	#define HELPER_SSE2
+	#include <emmintrin.h>
+#endif
 
 namespace Helper
 {
-	static GLuint CompileShaderFrom_cstr (const char *source, GLenum shaderTyp)
+	// Sources go through the program binary cache, an unchanged shader is a glProgramBinary instead of a compile
+	static std::optional<GLuint> CreateProgramCached (std::vector<GLCore::Utils::ShaderStage> stages)
 	{
-		GLuint shader = glCreateShader (shaderTyp);
-
-		glShaderSource (shader, 1, &source, NULL);
-		glCompileShader (shader);
-
-		GLint isCompiled = 0;
-		glGetShaderiv (shader, GL_COMPILE_STATUS, &isCompiled);
-		if (isCompiled == GL_FALSE) {
-			GLint maxLength = 0;
-			glGetShaderiv (shader, GL_INFO_LOG_LENGTH, &maxLength);
-
-			std::vector<GLchar> infoLog (maxLength);
-			glGetShaderInfoLog (shader, maxLength, &maxLength, &infoLog[0]);
-
-			glDeleteShader (shader);
-
-			LOG_ERROR ("{0}", infoLog.data ());
-			// HZ_CORE_ASSERT(false, "Shader compilation failure!");
+		std::string log;
+		GLuint program = GLCore::Utils::ShaderCompiler::BuildNow (stages, &log);
+		if (!program) {
+			LOG_ERROR ("{0}", log);
+			return {};
 		}
-
-		return shader;
+		return { program };
 	}
 	std::optional<GLuint> SHADER::CreateProgram (const char *source, GLenum shaderTyp)
 	{
-		GLuint program = glCreateProgram ();
-
-		GLuint theShader = CompileShaderFrom_cstr (source, shaderTyp);
-		glAttachShader (program, theShader);
-
-		glLinkProgram (program);
-
-		GLint isLinked = 0;
-		glGetProgramiv (program, GL_LINK_STATUS, (int *)&isLinked);
-		if (isLinked == GL_FALSE) {
-			GLint maxLength = 0;
-			glGetProgramiv (program, GL_INFO_LOG_LENGTH, &maxLength);
-
-			std::vector<GLchar> infoLog (maxLength);
-			glGetProgramInfoLog (program, maxLength, &maxLength, &infoLog[0]);
-
-			glDeleteProgram (program);
-
-			glDeleteShader (theShader);
-
-			LOG_ASSERT (false, infoLog.data ());
-			// HZ_CORE_ASSERT(false, "Shader link failure!");
-			return {};
-		}
-
-		glDetachShader (program, theShader);
-		glDeleteShader (theShader);
-
-		return { program };
+		return CreateProgramCached ({ { shaderTyp, source } });
 	}
 	std::optional<GLuint> SHADER::CreateProgram (const char *source1, GLenum shaderTyp1, const char *source2, GLenum shaderTyp2)
 	{
-		GLuint program = glCreateProgram ();
-
-		GLuint theShader_1 = CompileShaderFrom_cstr (source1, shaderTyp1);
-		glAttachShader (program, theShader_1);
-		GLuint theShader_2 = CompileShaderFrom_cstr (source2, shaderTyp2);
-		glAttachShader (program, theShader_2);
-
-		glLinkProgram (program);
-
-		GLint isLinked = 0;
-		glGetProgramiv (program, GL_LINK_STATUS, (int *)&isLinked);
-		if (isLinked == GL_FALSE) {
-			GLint maxLength = 0;
-			glGetProgramiv (program, GL_INFO_LOG_LENGTH, &maxLength);
-
-			std::vector<GLchar> infoLog (maxLength);
-			glGetProgramInfoLog (program, maxLength, &maxLength, &infoLog[0]);
-
-			glDeleteProgram (program);
-
-			glDeleteShader (theShader_1);
-			glDeleteShader (theShader_2);
-
-			LOG_ERROR ("{0}", infoLog.data ());
-			// HZ_CORE_ASSERT(false, "Shader link failure!");
-			return {};
-		}
-
-		glDetachShader (program, theShader_1);
-		glDetachShader (program, theShader_2);
-		glDeleteShader (theShader_1);
-		glDeleteShader (theShader_2);
-
-		return { program };
+		return CreateProgramCached ({ { shaderTyp1, source1 }, { shaderTyp2, source2 } });
 	}
 	std::optional<GLuint> SHADER::CreateProgram (const char *source1, GLenum shaderTyp1, const char *source2, GLenum shaderTyp2, const char *source3, GLenum shaderTyp3)
 	{
-		GLuint program = glCreateProgram ();
-
-		GLuint theShader_1 = CompileShaderFrom_cstr (source1, shaderTyp1);
-		glAttachShader (program, theShader_1);
-		GLuint theShader_2 = CompileShaderFrom_cstr (source2, shaderTyp2);
-		glAttachShader (program, theShader_2);
-		GLuint theShader_3 = CompileShaderFrom_cstr (source3, shaderTyp3);
-		glAttachShader (program, theShader_3);
-
-		glLinkProgram (program);
-
-		GLint isLinked = 0;
-		glGetProgramiv (program, GL_LINK_STATUS, (int *)&isLinked);
-		if (isLinked == GL_FALSE) {
-			GLint maxLength = 0;
-			glGetProgramiv (program, GL_INFO_LOG_LENGTH, &maxLength);
-
-			std::vector<GLchar> infoLog (maxLength);
-			glGetProgramInfoLog (program, maxLength, &maxLength, &infoLog[0]);
-
-			glDeleteProgram (program);
-
-			glDeleteShader (theShader_1);
-			glDeleteShader (theShader_2);
-			glDeleteShader (theShader_3);
-
-			LOG_ERROR ("{0}", infoLog.data ());
-			// HZ_CORE_ASSERT(false, "Shader link failure!");
-			return {};
-		}
-
-		glDetachShader (program, theShader_1);
-		glDetachShader (program, theShader_2);
-		glDetachShader (program, theShader_3);
-		glDeleteShader (theShader_1);
-		glDeleteShader (theShader_2);
-		glDeleteShader (theShader_3);
-
-		return { program };
+		return CreateProgramCached ({ { shaderTyp1, source1 }, { shaderTyp2, source2 }, { shaderTyp3, source3 } });
 	}
 
 	static std::pair<GLenum, GLenum> NumOfIncomingChannelsToIncomingAndInternalFormat (uint8_t numOfChannels)
@@ -250,235 +147,341 @@ namespace Helper
 			return {};
 		}
 	}
-	std::optional<std::tuple<GLuint, glm::uint32_t, glm::uint32_t>> TEXTURE_2D::LoadFromDiskToGPU (const char *location, const MAPPING loadAs, const MAPPING mapTo)
+	/*FOR MERCATOR scale u, v ∈ [0 1]; u goes from -Y to +Y, v goes from -X to +Z to +X to -Z back to -X*/
+	/*FOR CUBIC scale x = face + _x; _x, y ∈ [0 1]; face: [+y = 0, +x, +z, -x, -z, -y]*/
+	static void CubicXYToMercatorUV (const float X, const float Y, float &U, float &V)
 	{
-		stbi_uc *texData; int width, height, channels;
-		stbi_set_flip_vertically_on_load (1);
-		texData = stbi_load (location, &width, &height, &channels, 0);
-		if (!texData)
-		{
-			texData = stbi_load (GLCore::Utils::FileDialogs::OpenFile ("Image\0*.jpeg\0*.png\0*.bmp\0*.hdr\0*.psd\0*.tga\0*.gif\0*.pic\0*.psd\0*.pgm\0").c_str (), &width, &height, &channels, 0);
-			if (!texData) {
-				LOG_ERROR ("Failed to load Image");
-				return {};
-			}
+		float x = X - int(X);
+		glm::vec3 front;
+		switch (int (X)) {
+			case 0:// +y
+			// texCoord = vec2 (front.x, 1.0 - front.z);
+				front.x = x, front.z = 1.0 - Y;
+				front.y = 1.0;
+				break;
+			case 1:// +x
+			// texCoord = vec2 (1.0 - front.y, 1.0 - front.z);
+				front.y = 1.0 - x, front.z = 1.0 - Y;
+				front.x = 1.0;
+				break;
+			case 2:// +z
+			// texCoord = vec2 (front.x, front.y); 
+				front.x = x, front.y = Y;
+				front.z = 1.0;
+				break;
+			case 3:// -x
+			// texCoord = vec2 (front.z, front.y);
+				front.z = x, front.y = Y;
+				front.x = 0.0;
+				break;
+			case 4:// -z
+			// texCoord = vec2 (1.0 - front.y, 1.0 - front.x);
+				front.y = 1.0 - x, front.x = 1.0 - Y;
+				front.z = 0.0;
+				break;
+			case 5:// -y
+			// texCoord = vec2 (front.z, 1.0 - front.x);
+				front.z = x, front.x = 1.0 - Y;
+				front.y = 0.0;
+				break;
+			default:
+				LOG_ASSERT (false);
 		}
+		front -= glm::vec3 (0.5f);
+		front = glm::normalize (front); // multiplying vector doesn't makes a difference
+
+		V = acosf (-front.y)/glm::pi<float> (), U = atan2f (front.z, front.x)/float(2*glm::pi<double> ());
+		if (U < 0) {
+			U += 1.0; // (-0.5 0] -> (0.5 1.0]
+		}
+	}
+	static uint32_t MercatorUVToCubicXY (float U, float V, float &X, float &Y)
+	{
+		float pitch = glm::radians (V*180.0f - 90);
+		float yaw = glm::radians (U*360.0f);
+		glm::vec3 front;
+		front.x = cos (yaw) * cos (pitch);
+		front.y = sin (pitch);
+		front.z = sin (yaw) * cos (pitch);
+
 		
-		if (loadAs != mapTo) {
-			// NOTE: I'm using float for lerp-ing and transforming data from one projection to another, also in order to minimize dynamic allocation an already created container is to be used
-			stbi_uc *newTexData = new stbi_uc[width * height * channels];
-			
-			/*FOR MERCATOR scale u, v ∈ [0 1]; u goes from -Y to +Y, v goes from -X to +Z to +X to -Z back to -X*/
-			/*FOR CUBIC scale x = face + _x; _x, y ∈ [0 1]; face: [+y = 0, +x, +z, -x, -z, -y]*/
-			auto pixelLoad  = [&](float _x, float _y, float* cantainer) {
-				uint32_t X = _x*width;
-				uint32_t Y = _y*height;
-				uint32_t index = X + Y*width;
-			#if MODE_DEBUG
-				if (X >= width || Y >= height) {
-					LOG_WARN ("(X >= width || Y >= height) with X = {0}, Y = {1}", X, Y);
-					LOG_ASSERT (X == width && Y == height);
-				}
-			#endif
-				for (uint32_t i = 0; i < channels; i++)
-				{
-					cantainer[i] = float (texData[index*channels + i])/255;
-				}
-			};
+		float max = front[0];
+		uint32_t face = max > 0 ? 1 : 3; // +y = 0, +x = 1, +z = 2, -x = 3, -z = 4, -y = 5
+		glm::vec3 faceDirn = glm::vec3 (1, 0, 0); 
+		faceDirn *= (max > 0 ? 1 : -1);
+
+		for (uint32_t i = 1; i < 3; i++) {
+			if (abs (max) < abs (front[i])) {
+				max = front[i];
+				face = max > 0 ? (i == 1 ? 0 : 2) : (i == 1 ? 5 : 4);
+				// max > 0 -> +y & +z, if i = 1 i.e +y == 0 orif i = 2 i.e +z == 2; 
+				//		  !-> -y & -z, if i = 1 i.e -y == 5 orif i = 2 i.e -z == 4;
+
+				faceDirn = glm::vec3 (0, int (i == 1), int (i == 2)); 
+				faceDirn *= (max > 0 ? 1 : -1);
+			}
+		}
 
-			auto pixelStore = [&](float _x, float _y, float *cantainer) {
-				uint32_t X = _x*width;
-				uint32_t Y = _y*height;
-				uint32_t index = X + Y*width;
-			#if MODE_DEBUG
-				if (X >= width || Y >= height) {
-					LOG_WARN ("(X >= width || Y >= height) with X = {0}, Y = {1}", X, Y);
-					LOG_ASSERT (X <= width && Y <= height);
-				}
-			#endif
-				for (uint32_t i = 0; i < channels; i++) {
-					newTexData[index*channels + i] = (cantainer[i]*255.9999);
-				}
-			};
-			
-			constexpr uint32_t NumOfThreads = 4;
-			if (loadAs == MAPPING::MERCATOR && mapTo == MAPPING::CUBIC) {
-				auto XYtoUVCoord = [](const float X, const float Y, float &U, float &V) {
-					float x = X - int(X);
-					glm::vec3 front;
-					switch (int (X)) {
-						case 0:// +y
-						// texCoord = vec2 (front.x, 1.0 - front.z);
-							front.x = x, front.z = 1.0 - Y;
-							front.y = 1.0;
-							break;
-						case 1:// +x
-						// texCoord = vec2 (1.0 - front.y, 1.0 - front.z);
-							front.y = 1.0 - x, front.z = 1.0 - Y;
-							front.x = 1.0;
-							break;
-						case 2:// +z
-						// texCoord = vec2 (front.x, front.y); 
-							front.x = x, front.y = Y;
-							front.z = 1.0;
-							break;
-						case 3:// -x
-						// texCoord = vec2 (front.z, front.y);
-							front.z = x, front.y = Y;
-							front.x = 0.0;
-							break;
-						case 4:// -z
-						// texCoord = vec2 (1.0 - front.y, 1.0 - front.x);
-							front.y = 1.0 - x, front.x = 1.0 - Y;
-							front.z = 0.0;
-							break;
-						case 5:// -y
-						// texCoord = vec2 (front.z, 1.0 - front.x);
-							front.z = x, front.x = 1.0 - Y;
-							front.y = 0.0;
-							break;
-						default:
-							LOG_ASSERT (false);
-					}
-					front -= glm::vec3 (0.5f);
-					front = glm::normalize (front); // multiplying vector doesn't makes a difference
+		front /= glm::dot (front, faceDirn);
+		front *= 0.5; // (-1, 1) -> (-0.5, 0.5)
+		front += glm::vec3 (0.5); // (-0.5, 0.5) -> (0, 1)
+		// find transition, +y(x, invert(z)) -> +x(invert(y), invert(z)) -> +z(invert(y), x) -> -x(invert(y), z) -> -z(invert(y), invert(x)) -> -y(z, invert(x))
+
+		glm::vec2 texCoord;
+		switch (face) {
+			case 0: texCoord = glm::vec2 (front.x, 1.0 - front.z);
+				break;
+			case 1: texCoord = glm::vec2 (1.0 - front.y, 1.0 - front.z);
+				break;
+			case 2: texCoord = glm::vec2 (front.x, front.y);
+				break;
+			case 3: texCoord = glm::vec2 (front.z, front.y);
+				break;
+			case 4: texCoord = glm::vec2 (1.0 - front.y, 1.0 - front.x);
+				break;
+			case 5: texCoord = glm::vec2 (front.z, 1.0 - front.x);
+				break;
+		}
 
-					V = acosf (-front.y)/glm::pi<float> (), U = atan2f (front.z, front.x)/float(2*glm::pi<double> ());
-					if (U < 0) {
-						U += 1.0; // (-0.5 0] -> (0.5 1.0]
-					}
-				};
-				auto MercatorToCubic = [&](const uint32_t batch_num) {
-					const uint32_t total_batches = NumOfThreads;
-
-					uint32_t wid_x = width/total_batches + 1;
-					const uint32_t offset = batch_num*wid_x;
-					if (batch_num == total_batches-1)
-						wid_x -= (total_batches*wid_x) % width;
-
-					float *cantainer = new float[channels];
-					for (uint32_t posY = 0; posY < height; posY++) {
-						float y = double (posY)/height;
-						for (uint32_t posX = 0; posX < wid_x; posX++) {
-							float x = double (6*(posX + offset))/width;
-							//LOG_ASSERT (MOD(y, 1.0f) < 0.75);
-							float U, V;
-							XYtoUVCoord (x, y, U, V);
-							x /= 6.0;
-							pixelLoad (U, V, cantainer);
-							pixelStore (x, y, cantainer);
-						}
-					}
-					delete[] cantainer;
-					return 0;
-				};
-				std::vector<std::future<int>> futures;
-				futures.resize (NumOfThreads);
-
-				for (uint32_t i = 0; i < NumOfThreads; i++)
-				{
-					futures[i] = std::async (MercatorToCubic, i);
-				}
+		X = face + texCoord.x, Y = texCoord.y;
+		return face;
+	}
 
-				for (auto &ifuture : futures)
-				{
-					int tmp = ifuture.get ();
-				}
-			} else if (loadAs == MAPPING::CUBIC && mapTo == MAPPING::MERCATOR) {
-				auto UVtoXYCoord = [](float U, float V, float &X, float &Y) {
-					float pitch = glm::radians (V*180.0f - 90);
-					float yaw = glm::radians (U*360.0f);
-					glm::vec3 front;
-					front.x = cos (yaw) * cos (pitch);
-					front.y = sin (pitch);
-					front.z = sin (yaw) * cos (pitch);
-
-					
-					float max = front[0];
-					uint32_t face = max > 0 ? 1 : 3; // +y = 0, +x = 1, +z = 2, -x = 3, -z = 4, -y = 5
-					glm::vec3 faceDirn = glm::vec3 (1, 0, 0); 
-					faceDirn *= (max > 0 ? 1 : -1);
-
-					for (uint32_t i = 1; i < 3; i++) {
-						if (abs (max) < abs (front[i])) {
-							max = front[i];
-							face = max > 0 ? (i == 1 ? 0 : 2) : (i == 1 ? 5 : 4);
-							// max > 0 -> +y & +z, if i = 1 i.e +y == 0 orif i = 2 i.e +z == 2; 
-							//		  !-> -y & -z, if i = 1 i.e -y == 5 orif i = 2 i.e -z == 4;
-
-							faceDirn = glm::vec3 (0, int (i == 1), int (i == 2)); 
-							faceDirn *= (max > 0 ? 1 : -1);
-						}
-					}
+	// One bilinear lookup, texels (x, y), (x + StepX, y), (x, y + 1), (x + StepX, y + 1) of the source
+	struct RemapTap
+	{
+		uint32_t Texel;  // source pixel index of (x, y)
+		int32_t StepX;   // 1, 0 when clamped to an edge, 1 - width where MERCATOR wraps around
+		uint16_t FX, FY; // weights of the right/lower texels, 1.15 fixed point
+	};
+	struct RemapTable
+	{
+		TEXTURE_2D::MAPPING From, To;
+		uint32_t SrcWidth, SrcHeight, DstWidth, DstHeight;
+		uint32_t RowStep; // source pixels between (x, y) and (x, y + 1), 0 for single row images
+		std::vector<RemapTap> Taps; // one per destination pixel
+	};
+	static constexpr float RemapWeightOne = 32768.0f;
+	static constexpr size_t MaxCachedRemapTables = 4;
+	static constexpr size_t RemapPixelsPerJob = 16384; // whole rows, at least one
 
-					front /= glm::dot (front, faceDirn);
-					front *= 0.5; // (-1, 1) -> (-0.5, 0.5)
-					front += glm::vec3 (0.5); // (-0.5, 0.5) -> (0, 1)
-					// find transition, +y(x, invert(z)) -> +x(invert(y), invert(z)) -> +z(invert(y), x) -> -x(invert(y), z) -> -z(invert(y), invert(x)) -> -y(z, invert(x))
-
-					glm::vec2 texCoord;
-					switch (face) {
-						case 0: texCoord = glm::vec2 (front.x, 1.0 - front.z);
-							break;
-						case 1: texCoord = glm::vec2 (1.0 - front.y, 1.0 - front.z);
-							break;
-						case 2: texCoord = glm::vec2 (front.x, front.y);
-							break;
-						case 3: texCoord = glm::vec2 (front.z, front.y);
-							break;
-						case 4: texCoord = glm::vec2 (1.0 - front.y, 1.0 - front.x);
-							break;
-						case 5: texCoord = glm::vec2 (front.z, 1.0 - front.x);
-							break;
-					}
+	// source position in pixels (texel centers at integers), 'lo'/'hi' limit the columns (a cube face), rows are clamped
+	static RemapTap MakeRemapTap (float px, float py, int32_t lo, int32_t hi, bool wrap_x, uint32_t src_width, uint32_t src_height)
+	{
+		RemapTap tap;
+		int32_t x0 = int32_t (std::floor (px)), y0 = int32_t (std::floor (py));
+		float fx = px - x0, fy = py - y0;
+		int32_t step_x = 1;
+		if (hi - lo < 2) {
+			x0 = lo, fx = 0, step_x = 0;
+		} else if (wrap_x) {
+			x0 = ((x0 - lo)%(hi - lo) + (hi - lo))%(hi - lo) + lo;
+			if (x0 == hi - 1)
+				step_x = lo - x0;
+		} else if (x0 < lo) {
+			x0 = lo, fx = 0;
+		} else if (x0 >= hi - 1) { // right texel has to exist, so step back and weight it fully
+			x0 = hi - 2, fx = 1;
+		}
+		if (y0 < 0) {
+			y0 = 0, fy = 0;
+		} else if (y0 >= int32_t (src_height) - 1) {
+			y0 = std::max (int32_t (src_height) - 2, 0), fy = src_height > 1 ? 1.0f : 0.0f;
+		}
+		tap.Texel = uint32_t (y0)*src_width + uint32_t (x0);
+		tap.StepX = step_x;
+		tap.FX = uint16_t (fx*RemapWeightOne + 0.5f), tap.FY = uint16_t (fy*RemapWeightOne + 0.5f);
+		return tap;
+	}
 
-					X = face + texCoord.x, Y = texCoord.y;
-				};
-				auto CubicToMercator = [&](uint32_t batch_num) {
-					// strips
-					const uint32_t total_batches = NumOfThreads;
-
-					uint32_t wid_x = width/total_batches + 1;
-					const uint32_t offset = batch_num*wid_x;
-					if (batch_num == total_batches - 1)
-						wid_x -= (total_batches*wid_x) % width;
-
-					float *cantainer = new float[channels];
-					for (uint32_t posY = 0; posY < height; posY++) {
-						float V = float (posY)/height;
-						for (uint32_t posX = 0; posX < wid_x; posX++) {
-							float U = float (posX + offset)/width;
-							float x, y;
-							UVtoXYCoord (U, V, x, y);
-							x /= 6;
-							pixelLoad (x, y, cantainer);
-							pixelStore (U, V, cantainer);
-						}
+	// Tables are shared with conversions still running, the least recently used one is dropped past MaxCachedRemapTables
+	static std::shared_ptr<const RemapTable> GetRemapTable (TEXTURE_2D::MAPPING from, TEXTURE_2D::MAPPING to, uint32_t src_width, uint32_t src_height, uint32_t dst_width, uint32_t dst_height)
+	{
+		static std::mutex s_RemapTablesMutex;
+		static std::vector<std::shared_ptr<const RemapTable>> s_RemapTables; // most recently used last
+		std::lock_guard lock (s_RemapTablesMutex);
+		for (size_t i = 0; i < s_RemapTables.size (); i++) {
+			const RemapTable &table = *s_RemapTables[i];
+			if (table.From == from && table.To == to && table.SrcWidth == src_width && table.SrcHeight == src_height && table.DstWidth == dst_width && table.DstHeight == dst_height) {
+				std::shared_ptr<const RemapTable> found = s_RemapTables[i];
+				s_RemapTables.erase (s_RemapTables.begin () + i);
+				s_RemapTables.push_back (found);
+				return found;
+			}
+		}
+
+		GLCORE_PROFILE_SCOPE ("GetRemapTable: build");
+		auto table = std::make_shared<RemapTable> ();
+		table->From = from, table->To = to;
+		table->SrcWidth = src_width, table->SrcHeight = src_height, table->DstWidth = dst_width, table->DstHeight = dst_height;
+		table->RowStep = src_height > 1 ? src_width : 0;
+		table->Taps.resize (size_t (dst_width)*dst_height);
+		GLCore::Utils::JobSystem::ParallelFor (dst_height, std::max<size_t> (1, RemapPixelsPerJob/dst_width), [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				RemapTap *taps = table->Taps.data () + y*dst_width;
+				for (uint32_t x = 0; x < dst_width; x++) {
+					if (from == TEXTURE_2D::MAPPING::MERCATOR) {
+						float U, V;
+						CubicXYToMercatorUV (6.0f*(x + 0.5f)/dst_width, (y + 0.5f)/dst_height, U, V);
+						taps[x] = MakeRemapTap (U*src_width - 0.5f, V*src_height - 0.5f, 0, int32_t (src_width), true, src_width, src_height);
+					} else { // only a face's own texels are blended, the one next to it in the strip is somewhere else on the sphere
+						float X, Y;
+						const uint32_t face = MercatorUVToCubicXY ((x + 0.5f)/dst_width, (y + 0.5f)/dst_height, X, Y);
+						// columns whose centers fall inside the face, as CubicXYToMercatorUV sees them
+						const int32_t lo = int32_t (std::ceil (face*src_width/6.0 - 0.5)), hi = int32_t (std::ceil ((face + 1)*src_width/6.0 - 0.5));
+						taps[x] = MakeRemapTap (X*src_width/6.0f - 0.5f, Y*src_height - 0.5f, lo, hi, false, src_width, src_height);
 					}
-					delete[] cantainer;
-					return 0;
-				};
+				}
+			}
+		});
+		s_RemapTables.push_back (table);
+		if (s_RemapTables.size () > MaxCachedRemapTables)
+			s_RemapTables.erase (s_RemapTables.begin ());
+		return table;
+	}
 
-				std::vector<std::future<int>> futures;
-				futures.resize (NumOfThreads);
+#ifdef HELPER_SSE2
+	template<typename T, uint32_t Channels>
+	static inline __m128 LoadTexel (const T *texel)
+	{
+		if constexpr (std::is_same<T, float>::value && Channels == 4)
+			return _mm_loadu_ps (texel);
+		else if constexpr (std::is_same<T, uint8_t>::value && Channels == 4) {
+			int32_t packed; memcpy (&packed, texel, 4);
+			const __m128i zero = _mm_setzero_si128 ();
+			return _mm_cvtepi32_ps (_mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (packed), zero), zero));
+		} else {
+			float lanes[4] = {};
+			for (uint32_t c = 0; c < Channels; c++)
+				lanes[c] = float (texel[c]);
+			return _mm_loadu_ps (lanes);
+		}
+	}
+	template<typename T, uint32_t Channels>
+	static inline void StoreTexel (T *texel, __m128 value)
+	{
+		if constexpr (std::is_same<T, float>::value && Channels == 4)
+			_mm_storeu_ps (texel, value);
+		else if constexpr (std::is_same<T, uint8_t>::value) {
+			const __m128i rounded = _mm_cvtps_epi32 (value); // round to nearest, saturated by the packs
+			const int32_t packed = _mm_cvtsi128_si32 (_mm_packus_epi16 (_mm_packs_epi32 (rounded, rounded), rounded));
+			memcpy (texel, &packed, Channels);
+		} else {
+			float lanes[4];
+			_mm_storeu_ps (lanes, value);
+			for (uint32_t c = 0; c < Channels; c++)
+				texel[c] = lanes[c];
+		}
+	}
+#endif
 
-				for (uint32_t i = 0; i < NumOfThreads; i++) {
-					futures[i] = std::async (CubicToMercator, i);
+	// The four texels of a tap are fetched by index (a gather), all channels of a pixel are blended at once
+	template<typename T, uint32_t Channels>
+	static void ApplyRemapTable (const RemapTable &table, const T *src, T *dst)
+	{
+		GLCore::Utils::JobSystem::ParallelFor (table.DstHeight, std::max<size_t> (1, RemapPixelsPerJob/table.DstWidth), [&](size_t begin, size_t end) {
+			const RemapTap *taps = table.Taps.data () + begin*table.DstWidth;
+			T *out = dst + begin*table.DstWidth*Channels;
+			for (size_t i = 0, count = (end - begin)*table.DstWidth; i < count; i++, out += Channels) {
+				const RemapTap &tap = taps[i];
+				const T *t00 = src + size_t (tap.Texel)*Channels, *t01 = t00 + tap.StepX*int32_t (Channels);
+				const T *t10 = t00 + size_t (table.RowStep)*Channels, *t11 = t10 + tap.StepX*int32_t (Channels);
+				const float fx = tap.FX*(1.0f/RemapWeightOne), fy = tap.FY*(1.0f/RemapWeightOne);
+			#ifdef HELPER_SSE2
+				const __m128 v00 = LoadTexel<T, Channels> (t00), v01 = LoadTexel<T, Channels> (t01);
+				const __m128 v10 = LoadTexel<T, Channels> (t10), v11 = LoadTexel<T, Channels> (t11);
+				const __m128 wx = _mm_set1_ps (fx);
+				const __m128 top = _mm_add_ps (v00, _mm_mul_ps (_mm_sub_ps (v01, v00), wx));
+				const __m128 bottom = _mm_add_ps (v10, _mm_mul_ps (_mm_sub_ps (v11, v10), wx));
+				StoreTexel<T, Channels> (out, _mm_add_ps (top, _mm_mul_ps (_mm_sub_ps (bottom, top), _mm_set1_ps (fy))));
+			#else
+				for (uint32_t c = 0; c < Channels; c++) {
+					const float top = t00[c] + (float (t01[c]) - t00[c])*fx, bottom = t10[c] + (float (t11[c]) - t10[c])*fx;
+					const float value = top + (bottom - top)*fy;
+					if constexpr (std::is_same<T, uint8_t>::value)
+						out[c] = T (std::min (std::max (value + 0.5f, 0.0f), 255.0f));
+					else
+						out[c] = value;
 				}
+			#endif
+			}
+		});
+	}
 
-				for (auto &ifuture : futures) {
-					int tmp = ifuture.get ();
-				}
-			} else {
-				LOG_ERROR ("loadAs = {0}, storeAs = {1}", int (loadAs), int (mapTo));
-				LOG_ASSERT (false, "loadAs and storeAs pair re-mapping not supported");
+	template<typename T>
+	static bool RemapImage (TEXTURE_2D::MAPPING from, TEXTURE_2D::MAPPING to, const T *src, uint32_t src_width, uint32_t src_height, uint8_t channels, T *dst, uint32_t dst_width, uint32_t dst_height)
+	{
+		GLCORE_PROFILE_FUNCTION ();
+		if (from == to || channels < 1 || channels > 4) {
+			LOG_ERROR ("loadAs = {0}, storeAs = {1}, channels = {2}", int (from), int (to), channels);
+			LOG_ASSERT (false, "loadAs and storeAs pair re-mapping not supported");
+			return false;
+		}
+		if (src_width == 0 || src_height == 0 || dst_width == 0 || dst_height == 0)
+			return true;
+		std::shared_ptr<const RemapTable> table = GetRemapTable (from, to, src_width, src_height, dst_width, dst_height);
+		switch (channels) {
+			case 1: ApplyRemapTable<T, 1> (*table, src, dst); break;
+			case 2: ApplyRemapTable<T, 2> (*table, src, dst); break;
+			case 3: ApplyRemapTable<T, 3> (*table, src, dst); break;
+			case 4: ApplyRemapTable<T, 4> (*table, src, dst); break;
+		}
+		return true;
+	}
+	bool TEXTURE_2D::Remap (MAPPING from, MAPPING to, const uint8_t *src, uint32_t src_width, uint32_t src_height, uint8_t channels, uint8_t *dst, uint32_t dst_width, uint32_t dst_height)
+	{
+		return RemapImage (from, to, src, src_width, src_height, channels, dst, dst_width, dst_height);
+	}
+	bool TEXTURE_2D::Remap (MAPPING from, MAPPING to, const float *src, uint32_t src_width, uint32_t src_height, uint8_t channels, float *dst, uint32_t dst_width, uint32_t dst_height)
+	{
+		return RemapImage (from, to, src, src_width, src_height, channels, dst, dst_width, dst_height);
+	}
+
+	std::optional<std::tuple<GLuint, glm::uint32_t, glm::uint32_t>> TEXTURE_2D::LoadFromDiskToGPU (const char *location, const MAPPING loadAs, const MAPPING mapTo)
+	{
+		std::string path = location;
+		int width, height, channels;
+		if (!stbi_info (path.c_str (), &width, &height, &channels)) {
+			path = GLCore::Utils::FileDialogs::OpenFile ("Image\0*.jpeg\0*.png\0*.bmp\0*.hdr\0*.psd\0*.tga\0*.gif\0*.pic\0*.psd\0*.pgm\0");
+			if (!stbi_info (path.c_str (), &width, &height, &channels)) {
+				LOG_ERROR ("Failed to load Image");
+				return {};
 			}
+		}
+		// Upload takes RGB(A) only, grey (+ alpha) is expanded
+		const int wanted_channels = channels == 1 ? 3 : channels == 2 ? 4 : channels;
+		const bool hdr = stbi_is_hdr (path.c_str ());
+
+		stbi_set_flip_vertically_on_load (1);
+		void *texData = hdr ? (void *)stbi_loadf (path.c_str (), &width, &height, &channels, wanted_channels)
+							: (void *)stbi_load (path.c_str (), &width, &height, &channels, wanted_channels);
+		if (!texData) {
+			LOG_ERROR ("Failed to load Image");
+			return {};
+		}
+		channels = wanted_channels;
 
-			delete[] texData;
-			texData = newTexData;
+		bool owned_by_stb = true; // the remapped copy is malloc'ed by us
+		if (loadAs != mapTo) {
+			const size_t bytes = size_t (width)*height*channels*(hdr ? sizeof (float) : sizeof (stbi_uc));
+			void *newTexData = malloc (bytes);
+			const bool remapped = hdr ? Remap (loadAs, mapTo, (const float *)texData, width, height, channels, (float *)newTexData, width, height)
+									  : Remap (loadAs, mapTo, (const stbi_uc *)texData, width, height, channels, (stbi_uc *)newTexData, width, height);
+			if (remapped) {
+				stbi_image_free (texData);
+				texData = newTexData;
+				owned_by_stb = false;
+			} else
+				free (newTexData);
 		}
-		GLuint textureID = Upload (texData, (uint32_t)width, (uint32_t)height, channels);
-		delete[] texData;
+		GLuint textureID;
+		if (hdr) // half floats are plenty for radiance, and filterable everywhere
+			textureID = Upload (texData, (uint32_t)width, (uint32_t)height, channels == 4 ? GL_RGBA16F : GL_RGB16F, channels == 4 ? GL_RGBA : GL_RGB, GL_FLOAT, GL_LINEAR, GL_NEAREST);
+		else
+			textureID = Upload ((const uint8_t *)texData, (uint32_t)width, (uint32_t)height, channels);
+		if (owned_by_stb)
+			stbi_image_free (texData);
+		else free (texData);
 		if (textureID > 0) {
 			return { {textureID, (uint32_t)width, (uint32_t)height} };
 		} else {
@@ -486,6 +489,27 @@ namespace Helper
 		}
 	}
 
+	GLuint TEXTURE_2D::Stream (GLCore::Utils::TextureStreamer &streamer, const std::string &location, const MAPPING loadAs, const MAPPING storeAs)
+	{
+		using namespace GLCore::Utils;
+		if (loadAs == storeAs)
+			return streamer.Acquire (location);
+		return streamer.Acquire (location, storeAs == MAPPING::CUBIC ? "cubic" : "mercator", [loadAs, storeAs](DecodedImage &image) {
+			if (image.IsHDR ()) {
+				std::vector<float> remapped (image.HDR.size ());
+				if (!Remap (loadAs, storeAs, image.HDR.data (), image.Width, image.Height, 4, remapped.data (), image.Width, image.Height))
+					return false;
+				image.HDR.swap (remapped);
+			} else {
+				std::vector<uint8_t> remapped (image.LDR.size ());
+				if (!Remap (loadAs, storeAs, image.LDR.data (), image.Width, image.Height, 4, remapped.data (), image.Width, image.Height))
+					return false;
+				image.LDR.swap (remapped);
+			}
+			return true;
+		});
+	}
+
 	namespace MATH
 	{
 		glm::mat3 MakeRotationX (float radians)
@@ -766,6 +790,225 @@ namespace Helper
 			}
 			return sum;
 		}
+
+	#ifdef HELPER_SSE2
+		// perm twice over as int32, so (ii + perm[jj]) never needs wrapping
+		static const std::array<int32_t, 512> s_Perm512 = [] {
+			std::array<int32_t, 512> table{};
+			for (uint32_t i = 0; i < 512; i++)
+				table[i] = perm[i & 255];
+			return table;
+		}();
+
+		static inline __m128 select_x4 (__m128 mask, __m128 a, __m128 b) { return _mm_or_ps (_mm_and_ps (mask, a), _mm_andnot_ps (mask, b)); }
+
+		// fastFloor on 4 lanes, including its int (x) - 1 for whole numbers
+		static inline __m128i fast_floor_x4 (__m128 v)
+		{
+			const __m128i truncated = _mm_cvttps_epi32 (v);
+			const __m128 less = _mm_cmplt_ps (_mm_cvtepi32_ps (truncated), v);
+			return _mm_add_epi32 (truncated, _mm_andnot_si128 (_mm_castps_si128 (less), _mm_set1_epi32 (-1)));
+		}
+
+		static inline __m128i perm_x4 (__m128i index)
+		{
+			alignas (16) int32_t lanes[4];
+			_mm_store_si128 ((__m128i *)lanes, index);
+			return _mm_setr_epi32 (s_Perm512[lanes[0]], s_Perm512[lanes[1]], s_Perm512[lanes[2]], s_Perm512[lanes[3]]);
+		}
+
+		// t^4*grad2 (hash, x, y), 0 outside the corner's radius
+		static inline __m128 corner_x4 (__m128 x, __m128 y, __m128i hash)
+		{
+			const __m128 low = _mm_castsi128_ps (_mm_cmplt_epi32 (_mm_and_si128 (hash, _mm_set1_epi32 (7)), _mm_set1_epi32 (4)));
+			const __m128 x2 = _mm_add_ps (x, x), y2 = _mm_add_ps (y, y);
+			__m128 grad = _mm_add_ps (select_x4 (low, x, y), select_x4 (low, y2, x2));
+			grad = _mm_xor_ps (grad, _mm_castsi128_ps (_mm_slli_epi32 (hash, 31))); // grad2 flips both on 'h & 1 != 0' (== h & 1)
+
+			__m128 t = _mm_sub_ps (_mm_sub_ps (_mm_set1_ps (0.5f), _mm_mul_ps (x, x)), _mm_mul_ps (y, y));
+			const __m128 inside = _mm_cmpge_ps (t, _mm_setzero_ps ());
+			t = _mm_mul_ps (t, t);
+			return _mm_and_ps (inside, _mm_mul_ps (_mm_mul_ps (t, t), grad));
+		}
+
+		// Snoise2 on 4 lanes
+		static inline __m128 snoise2_x4 (__m128 x, __m128 y)
+		{
+			const __m128 F2 = _mm_set1_ps (0.366025403f), G2 = _mm_set1_ps (0.211324865f);
+			const __m128i one = _mm_set1_epi32 (1), byte = _mm_set1_epi32 (255);
+
+			const __m128 s = _mm_mul_ps (_mm_add_ps (x, y), F2);
+			const __m128i i = fast_floor_x4 (_mm_add_ps (x, s)), j = fast_floor_x4 (_mm_add_ps (y, s));
+			const __m128 fi = _mm_cvtepi32_ps (i), fj = _mm_cvtepi32_ps (j);
+			const __m128 t = _mm_mul_ps (_mm_cvtepi32_ps (_mm_add_epi32 (i, j)), G2);
+			const __m128 x0 = _mm_sub_ps (x, _mm_sub_ps (fi, t)), y0 = _mm_sub_ps (y, _mm_sub_ps (fj, t));
+
+			const __m128i lower = _mm_castps_si128 (_mm_cmpgt_ps (x0, y0)); // (i1, j1) = (1, 0), else (0, 1)
+			const __m128i i1 = _mm_and_si128 (lower, one), j1 = _mm_andnot_si128 (lower, one);
+			const __m128 x1 = _mm_add_ps (_mm_sub_ps (x0, _mm_cvtepi32_ps (i1)), G2), y1 = _mm_add_ps (_mm_sub_ps (y0, _mm_cvtepi32_ps (j1)), G2);
+			const __m128 last = _mm_set1_ps (-1.0f + 2.0f*0.211324865f);
+			const __m128 x2 = _mm_add_ps (x0, last), y2 = _mm_add_ps (y0, last);
+
+			const __m128i ii = _mm_and_si128 (i, byte), jj = _mm_and_si128 (j, byte);
+			const __m128i h0 = perm_x4 (_mm_add_epi32 (ii, perm_x4 (jj)));
+			const __m128i h1 = perm_x4 (_mm_add_epi32 (_mm_add_epi32 (ii, i1), perm_x4 (_mm_add_epi32 (jj, j1))));
+			const __m128i h2 = perm_x4 (_mm_add_epi32 (_mm_add_epi32 (ii, one), perm_x4 (_mm_add_epi32 (jj, one))));
+
+			return _mm_add_ps (_mm_add_ps (corner_x4 (x0, y0, h0), corner_x4 (x1, y1, h1)), corner_x4 (x2, y2, h2));
+		}
+
+		// Octaves on 4 lanes, SIMPLEX is a single octave at amplitude 1
+		static inline __m128 fractal_x4 (const NoiseSettings &settings, int octaves, __m128 x, float y)
+		{
+			const __m128 sign = _mm_set1_ps (-0.0f);
+			__m128 sum = _mm_setzero_ps ();
+			float freq = settings.Freq, amplitude = 1.0f;
+			for (int o = 0; o < octaves; o++) {
+				__m128 n = _mm_mul_ps (snoise2_x4 (_mm_mul_ps (x, _mm_set1_ps (freq)), _mm_set1_ps (y*freq)), _mm_set1_ps (amplitude));
+				if (settings.Type == NOISE_TYP::TURBULANCE)
+					n = _mm_andnot_ps (sign, n);
+				sum = _mm_add_ps (sum, n);
+				freq *= settings.Lac;
+				amplitude *= settings.Gain;
+			}
+			return sum;
+		}
+	#endif
+
+		// Untiled row, consecutive integer steps from x_begin
+		static void evaluate_row (const NoiseSettings &settings, float x_begin, float y, uint32_t count, float *out)
+		{
+			const int octaves = settings.Type == NOISE_TYP::SIMPLEX ? 1 : std::max (settings.Octaves, 0);
+			uint32_t k = 0;
+		#ifdef HELPER_SSE2
+			const __m128 steps = _mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f);
+			for (; k + 8 <= count; k += 8) { // two independent dependency chains per step
+				const __m128 x_a = _mm_add_ps (_mm_set1_ps (x_begin + float (k)), steps);
+				const __m128 x_b = _mm_add_ps (_mm_set1_ps (x_begin + float (k + 4)), steps);
+				_mm_storeu_ps (out + k, fractal_x4 (settings, octaves, x_a, y));
+				_mm_storeu_ps (out + k + 4, fractal_x4 (settings, octaves, x_b, y));
+			}
+			if (k < count) {
+				alignas (16) float tail[8];
+				for (uint32_t t = 0; t < 8; t += 4)
+					_mm_store_ps (tail + t, fractal_x4 (settings, octaves, _mm_add_ps (_mm_set1_ps (x_begin + float (k + t)), steps), y));
+				for (uint32_t t = 0; k < count; t++, k++)
+					out[k] = tail[t];
+			}
+		#endif
+			for (; k < count; k++) {
+				const float x = x_begin + float (k);
+				switch (settings.Type) {
+					case NOISE_TYP::SIMPLEX:                out[k] = Snoise2 (x*settings.Freq, y*settings.Freq); break;
+					case NOISE_TYP::FRACTAL_BROWNIM_MOTION: out[k] = Fbm2 (x, y, settings.Freq, settings.Lac, settings.Gain, octaves); break;
+					case NOISE_TYP::TURBULANCE:             out[k] = Turbulance (x, y, settings.Freq, settings.Lac, settings.Gain, octaves); break;
+				}
+			}
+		}
+
+		void EvaluateRow (const NoiseSettings &settings, float x_begin, float y, uint32_t count, float *out)
+		{
+			if (settings.TileX == 0 && settings.TileY == 0) {
+				evaluate_row (settings, x_begin, y, count, out);
+				return;
+			}
+			// Seamless: F(x, y) cross-faded with F(x - TileX, y), F(x, y - TileY) and F(x - TileX, y - TileY),
+			// x, y wrapped into the tile, so both ends of a period see the same samples
+			const float period_x = float (settings.TileX), period_y = float (settings.TileY);
+			const float wrapped_y = period_y > 0 ? y - std::floor (y/period_y)*period_y : y;
+			const float v = period_y > 0 ? wrapped_y/period_y : 0.0f;
+
+			std::vector<float> scratch (size_t (count)*3);
+			float *shifted_x = scratch.data (), *shifted_y = shifted_x + count, *shifted_xy = shifted_y + count;
+			uint32_t k = 0;
+			while (k < count) { // segments of consecutive wrapped x
+				const float x = x_begin + float (k);
+				const float wrapped_x = period_x > 0 ? x - std::floor (x/period_x)*period_x : x;
+				const uint32_t segment = period_x > 0 ? std::min (count - k, uint32_t (std::ceil (period_x - wrapped_x))) : count - k;
+				evaluate_row (settings, wrapped_x, wrapped_y, segment, out + k);
+				if (period_x > 0)
+					evaluate_row (settings, wrapped_x - period_x, wrapped_y, segment, shifted_x + k);
+				if (period_y > 0)
+					evaluate_row (settings, wrapped_x, wrapped_y - period_y, segment, shifted_y + k);
+				if (period_x > 0 && period_y > 0)
+					evaluate_row (settings, wrapped_x - period_x, wrapped_y - period_y, segment, shifted_xy + k);
+
+				for (uint32_t s = 0; s < segment; s++) {
+					const float u = period_x > 0 ? (wrapped_x + float (s))/period_x : 0.0f;
+					float value = out[k + s]*(1 - u)*(1 - v);
+					if (period_x > 0)
+						value += shifted_x[k + s]*u*(1 - v);
+					if (period_y > 0)
+						value += shifted_y[k + s]*(1 - u)*v;
+					if (period_x > 0 && period_y > 0)
+						value += shifted_xy[k + s]*u*v;
+					out[k + s] = value;
+				}
+				k += std::max (segment, 1u);
+			}
+		}
+
+		glm::vec2 Evaluate (const NoiseSettings &settings, uint32_t width, uint32_t height, float *out)
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			std::mutex min_max_mutex;
+			glm::vec2 min_max (FLT_MAX, -FLT_MAX);
+			GLCore::Utils::JobSystem::ParallelFor (height, 4, [&](size_t begin, size_t end) {
+				glm::vec2 local (FLT_MAX, -FLT_MAX);
+				for (size_t Y = begin; Y < end; Y++) {
+					float *row = out + Y*width;
+					EvaluateRow (settings, 0.0f, float (Y), width, row);
+					for (uint32_t X = 0; X < width; X++)
+						local = glm::vec2 (std::min (local.x, row[X]), std::max (local.y, row[X]));
+				}
+				std::lock_guard lock (min_max_mutex);
+				min_max = glm::vec2 (std::min (min_max.x, local.x), std::max (min_max.y, local.y));
+			});
+			return min_max;
+		}
+
+		void EvaluateToPixels (const NoiseSettings &settings, uint32_t width, uint32_t height, const std::vector<glm::vec4> &gradient
+							   , uint32_t channels, uint8_t *out_pixels, glm::vec2 range)
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			LOG_ASSERT (gradient.size () >= 2 && (channels == 3 || channels == 4));
+
+			// gradient sampled once into a table, the per pixel work is an index and a copy
+			constexpr uint32_t LutSize = 1024;
+			std::vector<std::array<uint8_t, 4>> lut (LutSize);
+			for (uint32_t i = 0; i < LutSize; i++) {
+				const float factor = float (i)/(LutSize - 1);
+				const uint32_t region = std::min (uint32_t (factor*(gradient.size () - 1)), uint32_t (gradient.size () - 2));
+				const float local = factor*(gradient.size () - 1) - float (region);
+				const glm::vec4 color = glm::clamp (gradient[region] + (gradient[region + 1] - gradient[region])*local, glm::vec4 (0), glm::vec4 (1));
+				for (uint32_t c = 0; c < 4; c++)
+					lut[i][c] = uint8_t (255.999f*color[c]);
+			}
+			auto map_row = [&](const float *noise, uint8_t *pixels, glm::vec2 noise_range) {
+				const float scale = noise_range.y > noise_range.x ? (LutSize - 1)/(noise_range.y - noise_range.x) : 0.0f;
+				for (uint32_t X = 0; X < width; X++) {
+					const int32_t index = std::clamp (int32_t ((noise[X] - noise_range.x)*scale + 0.5f), 0, int32_t (LutSize - 1));
+					memcpy (pixels + size_t (X)*channels, lut[index].data (), channels);
+				}
+			};
+
+			if (range.x < range.y) { // fused, no float buffer
+				GLCore::Utils::JobSystem::ParallelFor (height, 4, [&](size_t begin, size_t end) {
+					std::vector<float> row (width);
+					for (size_t Y = begin; Y < end; Y++) {
+						EvaluateRow (settings, 0.0f, float (Y), width, row.data ());
+						map_row (row.data (), out_pixels + Y*width*channels, range);
+					}
+				});
+				return;
+			}
+			std::vector<float> noise (size_t (width)*height);
+			const glm::vec2 min_max = Evaluate (settings, width, height, noise.data ());
+			GLCore::Utils::JobSystem::ParallelFor (height, 16, [&](size_t begin, size_t end) {
+				for (size_t Y = begin; Y < end; Y++)
+					map_row (noise.data () + Y*width, out_pixels + Y*width*channels, min_max);
+			});
+		}
 	};
 	namespace ASSET_LOADER
 	{
@@ -774,6 +1017,7 @@ namespace Helper
 							 ,std::vector<uint32_t> &out_vertexIndices, std::vector<uint32_t> &out_uvIndices, std::vector<uint32_t> &out_normalIndices
 		)
 		{
+			GLCORE_PROFILE_FUNCTION ();
 			LOG_TRACE ("Loading OBJ file %s...\n", path);
 
 			out_vertexIndices.clear (), out_uvIndices.clear (), out_normalIndices.clear ();
@@ -839,6 +1083,7 @@ namespace Helper
 		}
 		bool LoadOBJ_meshOnly (const char *path, std::vector<std::pair<glm::vec3, glm::vec3>> &out_vertices, std::vector<uint32_t> &out_indices)
 		{
+			GLCORE_PROFILE_FUNCTION ();
 			std::vector<uint32_t> vertexIndices, uvIndices, normalIndices;
 			std::vector<glm::vec3> temp_vertices;
 			std::vector<glm::vec2> temp_uvs;
@@ -847,6 +1092,11 @@ namespace Helper
 				return false;
 			out_vertices.clear ();
 			out_vertices.resize (temp_vertices.size ());
+			if (vertexIndices.empty ()) { // no faces, a point cloud: 'vn' lines pair up with 'v' lines when there are as many
+				const bool has_normals = temp_normals.size () == temp_vertices.size ();
+				for (size_t i = 0; i < temp_vertices.size (); i++)
+					out_vertices[i] = std::make_pair (temp_vertices[i], has_normals ? temp_normals[i] : glm::vec3 (0));
+			}
 			for (size_t i = 0; i < vertexIndices.size (); i++) {
 				// this is quite waste of computation
 				// There's a near 100% chance that every vertIndex,nrmlIndex are twins across primitives
@@ -855,6 +1105,63 @@ namespace Helper
 				vertex = std::make_pair (temp_vertices[vertexIndices[i]], temp_normals[normalIndices[i]]);
 			}
 			out_indices = std::move (vertexIndices);
+			return true;
+		}
+		bool LoadPointCloud (const char *path, std::vector<std::pair<glm::vec3, glm::vec3>> &out_points)
+		{
+			GLCORE_PROFILE_FUNCTION ();
+			std::ifstream file (path, std::ios::binary | std::ios::ate);
+			if (!file.is_open ()) {
+				LOG_ERROR ("Cannot open file {0}", path);
+				return false;
+			}
+			std::string text (size_t (file.tellg ()), '\0');
+			file.seekg (0);
+			file.read (text.data (), text.size ());
+			file.close ();
+
+			// chunks end on a line break, each one is parsed on its own job and they're concatenated in order
+			constexpr size_t chunk_bytes = 4 << 20;
+			std::vector<size_t> chunk_begins{ 0 };
+			while (chunk_begins.back () + chunk_bytes < text.size ()) {
+				const size_t line_end = text.find ('\n', chunk_begins.back () + chunk_bytes);
+				if (line_end == std::string::npos)
+					break;
+				chunk_begins.push_back (line_end + 1);
+			}
+			chunk_begins.push_back (text.size ());
+			std::vector<std::vector<std::pair<glm::vec3, glm::vec3>>> chunks (chunk_begins.size () - 1);
+			GLCore::Utils::JobSystem::ParallelFor (chunks.size (), 1, [&](size_t begin, size_t end) {
+				for (size_t c = begin; c < end; c++) {
+					const char *cursor = text.c_str () + chunk_begins[c], *chunk_end = text.c_str () + chunk_begins[c + 1];
+					while (cursor < chunk_end) {
+						const char *line_end = (const char *)memchr (cursor, '\n', chunk_end - cursor);
+						if (!line_end)
+							line_end = chunk_end;
+						float values[6];
+						int count = 0;
+						for (const char *p = cursor; count < 6; count++) {
+							char *next;
+							values[count] = strtof (p, &next);
+							if (next == p || next > line_end)
+								break;
+							p = next;
+						}
+						if (count >= 3) // blank lines, comments and headers are skipped, columns past the normal ignored
+							chunks[c].push_back ({ glm::vec3 (values[0], values[1], values[2]), count >= 6 ? glm::vec3 (values[3], values[4], values[5]) : glm::vec3 (0) });
+						cursor = line_end + 1;
+					}
+				}
+			});
+			size_t point_count = 0;
+			for (auto &chunk : chunks)
+				point_count += chunk.size ();
+			out_points.clear ();
+			out_points.reserve (point_count);
+			for (auto &chunk : chunks)
+				out_points.insert (out_points.end (), chunk.begin (), chunk.end ());
+			LOG_INFO ("Point cloud loaded, {0} points", point_count);
+			return !out_points.empty ();
 		}
 		bool LoadOBJ_basic_VertexOnly (const char *path, std::vector<glm::vec3> &out_vertices, std::vector<glm::vec2> &out_uvs, std::vector<glm::vec3> &out_normals)
 		{
@@ -886,6 +1193,7 @@ namespace Helper
 				out_normals.push_back (normal);
 
 			}
+			return true;
 		}
 	}
 }
@@ -2,11 +2,14 @@
 #include <optional>
 #include <tuple>
 #include <string>
+#include <vector>
 #include <future>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 #include <type_traits>
 
+namespace GLCore { namespace Utils { class TextureStreamer; } }
+
 #define MIN(x,y) (x > y ? y :  x)
 #define MAX(x,y) (x > y ? x :  y)
 #define ABS(x)   (x > 0 ? x : -x)
@@ -34,11 +37,20 @@ namespace Helper
 		GLuint Upload (const void *data, uint32_t width, uint32_t height, GLenum internal_format, GLenum src_format, GLenum src_type, GLenum min_filter = GL_NEAREST, GLenum mag_filter = GL_NEAREST);
 		std::optional<std::tuple<GLuint, uint32_t, uint32_t>> LoadFromDiskToGPU ();
 		std::optional<std::tuple<GLuint, uint32_t, uint32_t>> LoadFromDiskToGPU (const char *location);
+		// loadAs != storeAs converts between the projections, .hdr files stay float (RGB(A)16F)
 		std::optional<std::tuple<GLuint, uint32_t, uint32_t>> LoadFromDiskToGPU (const char *location, const MAPPING loadAs, const MAPPING storeAs);
+		// MERCATOR <-> CUBIC (6 faces side by side) of channels interleaved pixels, bilinear filtered, false for any other pair.
+		// The source lookup of every destination pixel only depends on the sizes, it is computed once and cached; rows run in tiles on the JobSystem
+		bool Remap (MAPPING from, MAPPING to, const uint8_t *src, uint32_t src_width, uint32_t src_height, uint8_t channels, uint8_t *dst, uint32_t dst_width, uint32_t dst_height);
+		bool Remap (MAPPING from, MAPPING to, const float *src, uint32_t src_width, uint32_t src_height, uint8_t channels, float *dst, uint32_t dst_width, uint32_t dst_height);
+		// LoadFromDiskToGPU (location, loadAs, storeAs) without the stall, every frame: 'streamer' decodes and remaps on a worker, placeholder until uploaded
+		GLuint Stream (GLCore::Utils::TextureStreamer &streamer, const std::string &location, const MAPPING loadAs, const MAPPING storeAs);
 	}
 	namespace ASSET_LOADER
 	{
 		bool LoadOBJ_meshOnly (const char *path, std::vector<std::pair<glm::vec3, glm::vec3>> &out_verticeDatas, std::vector<uint32_t> &out_indices);
+		// .xyz: "x y z [nx ny nz]" per line, zero normals when a line has none, parsed in parallel chunks
+		bool LoadPointCloud (const char *path, std::vector<std::pair<glm::vec3, glm::vec3>> &out_points);
 		bool LoadOBJ_basic_VertexOnly (const char *path, std::vector<glm::vec3> &out_vertices, std::vector<glm::vec2> &out_uvs, std::vector<glm::vec3> &out_normals);
 	}
 	namespace MATH
@@ -70,130 +82,51 @@ namespace Helper
 		//Turbulance is turbulent fractal type noise
 		float Turbulance (float x, float y, float freq, float lac, float gain, int octaves);
 
+		// Batch evaluation: SSE2 (8 samples per step) where available, same values as the functions above (up to float rounding)
+		struct NoiseSettings
+		{
+			NOISE_TYP Type = NOISE_TYP::SIMPLEX;
+			float Freq = 0.01f, Lac = 2.0f, Gain = 0.5f;
+			int Octaves = 5;                 // ignored by SIMPLEX
+			uint32_t TileX = 0, TileY = 0;   // > 0: seamless with that period (in samples), 4 evaluations cross-faded
+		};
+		// out[k] = noise at (x_begin + k, y), k in [0, count), i.e. Fbm2 (x_begin + k, y, Freq, ...) for FRACTAL_BROWNIM_MOTION
+		void EvaluateRow (const NoiseSettings &settings, float x_begin, float y, uint32_t count, float *out);
+		// width*height samples at integer coords, rows run in parallel on the JobSystem, returns min/max
+		glm::vec2 Evaluate (const NoiseSettings &settings, uint32_t width, uint32_t height, float *out);
+		// Noise mapped through 'gradient' (equally spaced stops) into 8 bit pixels with 3 or 4 channels.
+		// range.x < range.y: normalized by that range in a single fused pass, otherwise by the actual min/max (needs a float buffer)
+		void EvaluateToPixels (const NoiseSettings &settings, uint32_t width, uint32_t height, const std::vector<glm::vec4> &gradient
+							   , uint32_t channels, uint8_t *out_pixels, glm::vec2 range = glm::vec2 (0));
+
 		// For Simplex Noise oly freq is required
 		template<typename channel_type = glm::vec3>
-		GLuint MakeTexture (uint32_t width, uint32_t height, NOISE_TYP noise_type, std::vector<channel_type> gradient, float freq = 0.01f, float lac = 2.0f, float gain = 0.5f, int octaves = 5)
+		GLuint MakeTexture (uint32_t width, uint32_t height, NOISE_TYP noise_type, std::vector<channel_type> gradient, float freq = 0.01f, float lac = 2.0f, float gain = 0.5f, int octaves = 5
+							, glm::vec2 range = glm::vec2 (0))
 		{
+			static_assert (std::is_same<channel_type, glm::vec3>::value || std::is_same<channel_type, glm::vec4>::value, "MakeTexture: gradient has to be vec3 or vec4");
 			if (gradient.size () < 2) {
 				gradient.insert (gradient.begin (), channel_type (0));
 			}
 			if (gradient.size () < 2) {
 				gradient.insert (gradient.end (), channel_type (1));
 			}
-			
-			uint8_t num_of_channels;
-			if (std::is_base_of<glm::vec3, channel_type> ()) {
-				num_of_channels = 3;
-			} 
-			else if (std::is_base_of<glm::vec4, channel_type> ()) {
-				num_of_channels = 4;
-			} else {
-				// num_of_channels = 0;
-				LOG_ASSERT (false);
+			constexpr uint32_t num_of_channels = sizeof (channel_type)/sizeof (float);
+
+			std::vector<glm::vec4> stops;
+			for (const channel_type &color : gradient) {
+				if constexpr (num_of_channels == 3)
+					stops.push_back (glm::vec4 (color, 1.0f));
+				else
+					stops.push_back (color);
 			}
 
-			static constexpr uint32_t NumOfThreads = 4; // Mine is quad core CPU (logical)
-			std::vector<float> noise_data;
-			noise_data.resize (width*height);
-
-			std::vector<std::future<glm::vec2>> futures;
-			futures.resize (NumOfThreads);
-
-			// Note Batch starts with 0;
-			auto func = [&](const uint32_t batch_num) -> glm::vec2 {
-					const uint32_t batches_size = NumOfThreads;
-
-					uint32_t wid_x = width/batches_size + 1;
-					const uint32_t offset = batch_num*wid_x;
-					if (batch_num == batches_size-1)
-						wid_x -= (batches_size*wid_x) % width;
-
-					float min_val = 1.0f, max_val = 0.0f;
-					for (uint32_t Y = 0; Y < height; Y++) {
-						for (uint32_t X = 0; X < wid_x; X++) {
-							uint32_t index = offset + X + (Y*width);
-							float noise;
-
-							switch (noise_type) {
-								case NOISE_TYP::SIMPLEX:
-									noise = Snoise2 ((X + offset)*freq, (Y)*freq);
-									break;
-								case NOISE_TYP::FRACTAL_BROWNIM_MOTION:
-									noise = Fbm2 (X + offset, Y, freq, lac, gain, octaves);
-									break;
-								case NOISE_TYP::TURBULANCE:
-									noise = Turbulance (X + offset, Y, freq, lac, gain, octaves);
-									break;
-								default:
-									LOG_ASSERT (false);
-							}
-
-							min_val = MIN (min_val, noise);
-							max_val = MAX (max_val, noise);
-
-							noise_data[index] = noise; // create greyscale
-						}
-					}
-
-					return glm::vec2 (min_val, max_val);
-				};
-			for (uint32_t i = 0; i < NumOfThreads; i++)
-			{
-				futures[i] = std::async (func, i);
-			}
-
-			glm::vec2 min_max = futures[0].get();
-			for (uint32_t i = 1; i < futures.size (); i++)
-			{
-				glm::vec2 _min_max = futures[i].get ();
-
-				min_max[0] = MIN (min_max[0], _min_max[0]);
-				min_max[1] = MAX (min_max[1], _min_max[1]);
-			}
-			
-			// uint8_t[sizeof (channel_type)/sizeof (float)]
-			std::vector<std::array<uint8_t, sizeof (channel_type)/sizeof (float)>> pixel_data;
-			pixel_data.resize (width*height);
-			
-			// returns dummy glm::vec2 (0) to reuse futures;
-			auto func2 = [&](const uint32_t batch_num) {
-				const uint32_t batches_size = NumOfThreads;
-
-				uint32_t wid_x = width/batches_size + 1;
-				const uint32_t offset = batch_num*wid_x;
-				if (batch_num == batches_size-1)
-					wid_x -= (batches_size*wid_x) % width;
-
-				for (uint32_t Y = 0; Y < height; Y++) {
-					for (uint32_t X = 0; X < wid_x; X++) {
-						uint32_t index = offset + X + (Y*width);
-						float factor = (noise_data[index] - min_max[0]) / (min_max[1] - min_max[0]);
-						channel_type color;
-						{
-							uint32_t region = std::min(uint32_t(factor*(gradient.size () - 1)), uint32_t (gradient.size () - 2));
-							float grad_del_wid = 1.0 / (gradient.size () - 1);
-							factor = MOD (factor, grad_del_wid)*(gradient.size () - 1);
-							color = gradient[region] + (gradient[region + 1] - gradient[region])*factor;
-						}
-						for (uint8_t i = 0; i < num_of_channels; i++)
-						{
-							pixel_data[index][i] = 255.999*color[i];
-						}
-					}
-				}
-
-				return glm::vec2 (0);
-			};
-
-			for (uint32_t i = 0; i < NumOfThreads; i++) {
-				futures[i] = std::async (func2, i);
-			}
-
-			for (uint32_t i = 1; i < futures.size (); i++) {
-				glm::vec2 _dummy = futures[i].get ();
-			}
+			NoiseSettings settings;
+			settings.Type = noise_type, settings.Freq = freq, settings.Lac = lac, settings.Gain = gain, settings.Octaves = octaves;
+			std::vector<uint8_t> pixel_data (size_t (width)*height*num_of_channels);
+			EvaluateToPixels (settings, width, height, stops, num_of_channels, pixel_data.data (), range);
 
-			return TEXTURE_2D::Upload ((uint8_t *)(pixel_data.data ()), width, height, num_of_channels);
+			return TEXTURE_2D::Upload (pixel_data.data (), width, height, num_of_channels);
 		}
 	};
 }
@@ -6,28 +6,57 @@ using namespace GLCore::Utils;
 const char *SqrShader_Base::s_default_sqr_shader_vert = R"(
 #version 440 core
 layout (location = 0) in vec3 in_Position;
-layout (location = 1) in vec3 in_Normal;
-layout (location = 2) in vec3 in_Color;
+layout (location = 1) in vec3 in_Normal; // only xy when octahedral encoded, use DecodeNormal ()
+layout (location = 2) in vec3 in_Color;  // only x (normalized K_h) when u_ColorIsScalar, use DecodeColor ()
 
 layout (location = 0) out vec3 p_Color;
+layout (location = 1) flat out int p_VertexID; // provoking (last) vertex of the triangle, for picking
 
 uniform mat4 u_ViewProjectionMat4;
-uniform mat4 u_ModelMat4;
+uniform mat4 u_ModelMat4; // also maps quantized positions back from the mesh AABB
+
+uniform int u_OctahedralNormals;
+uniform int u_ColorIsScalar;
+uniform int u_BlendColorCount;
+uniform vec3 u_BlendColors[16];
+uniform int u_PickableVertices; // 0 when gl_VertexID isn't a full mesh vertex (LODs)
+
+vec3 DecodeNormal()
+{
+	if (u_OctahedralNormals == 0)
+		return in_Normal;
+	vec3 n = vec3(in_Normal.xy, 1.0 - abs(in_Normal.x) - abs(in_Normal.y));
+	if (n.z < 0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1 : -1, n.y >= 0 ? 1 : -1);
+	return normalize(n);
+}
+vec3 DecodeColor()
+{
+	if (u_ColorIsScalar == 0)
+		return in_Color;
+	float ratio = clamp(in_Color.x, 0.0, 1.0) * float(u_BlendColorCount - 1);
+	int low = int(floor(ratio)), high = int(ceil(ratio));
+	return mix(u_BlendColors[low], u_BlendColors[high], ratio - float(low));
+}
 
 void main()
 {
 	gl_Position = u_ViewProjectionMat4 * u_ModelMat4 * vec4(in_Position, 1.0f);
-	p_Color = in_Color;
+	p_Color = DecodeColor();
+	p_VertexID = u_PickableVertices != 0 ? gl_VertexID : -1;
 })";
 const char *SqrShader_Base::s_default_sqr_shader_frag = R"(
 #version 440 core
 layout (location = 0) in vec3 p_Color;
+layout (location = 1) flat in int p_VertexID;
 
 layout (location = 0) out vec4 o_Color;
+layout (location = 1) out int o_VertexID; // integer attachment read back for hover picking
 
 void main()
 {
 	o_Color = vec4(p_Color,1.0);
+	o_VertexID = p_VertexID;
 })";
 
 SqrShader_Base::SqrShader_Base (const char *name, const char *discription
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <GLCore.h>
+#include <GLCoreUtils.h>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
 #include "Utilities/utility.h"
@@ -41,30 +42,71 @@ protected:
 
 		if (ImGui::Button ("Reload Square Shader", button_contentRegion))
 			ReloadSquareShader ();
+		if (m_SquareShaderBuild)
+			ImGui::TextDisabled ("Compiling... (the previous shader stays in use)");
+		else if (!m_SquareShaderError.empty ())
+			ImGui::TextColored (ImVec4 (1.0f, 0.4f, 0.4f, 1.0f), "%s", m_SquareShaderError.c_str ());
 	}
-	void ReloadSquareShader ()
+	// wait == false: builds in the background (see PollSquareShader), the current program is used until the new one linked
+	void ReloadSquareShader (bool wait = false)
 	{
-		std::optional<GLuint> shader_program = Helper::SHADER::CreateProgram (m_SquareShaderTXT_vert.data (), GL_VERTEX_SHADER, m_SquareShaderTXT_frag.data (), GL_FRAGMENT_SHADER);
-		if (shader_program.has_value ()) {
-			DeleteSquareShader ();
-			{// check whether last bound program is this, if yes then update it
-				// TODO: fix me
-				//GLuint last_program;
-				//glGetIntegerv (GL_CURRENT_PROGRAM, (GLint *)&last_program);
-				//if (m_SquareShaderProgID == last_program)
-					glUseProgram (shader_program.value ());
-			}
-			m_SquareShaderProgID = shader_program.value ();
-			OnSquareShaderReload ();
+		using namespace GLCore::Utils;
+		std::vector<ShaderStage> stages = { { GL_VERTEX_SHADER, m_SquareShaderTXT_vert.data () }, { GL_FRAGMENT_SHADER, m_SquareShaderTXT_frag.data () } };
+		if (m_SquareShaderBuild)
+			ShaderCompiler::Cancel (m_SquareShaderBuild);
+		m_SquareShaderBuild = 0;
+		if (wait) {
+			m_SquareShaderError.clear ();
+			if (GLuint program = ShaderCompiler::BuildNow (stages, &m_SquareShaderError))
+				install_square_shader (program);
+			else
+				LOG_ERROR ("{0}", m_SquareShaderError);
+			return;
 		}
+		m_SquareShaderBuild = ShaderCompiler::Build (std::move (stages));
+		RequestRedraw ();
+	}
+	// Swaps in a finished background build, call every OnUpdate (GL thread)
+	void PollSquareShader ()
+	{
+		using namespace GLCore::Utils;
+		if (!m_SquareShaderBuild)
+			return;
+		GLuint program = 0;
+		switch (ShaderCompiler::Poll (m_SquareShaderBuild, program, &m_SquareShaderError)) {
+			case ShaderCompiler::Status::Compiling:
+				RequestRedraw (); // keeps polling while idle
+				return;
+			case ShaderCompiler::Status::Ready:
+				m_SquareShaderError.clear ();
+				install_square_shader (program);
+				break;
+			case ShaderCompiler::Status::Failed:
+				LOG_ERROR ("{0}", m_SquareShaderError);
+				break;
+		}
+		m_SquareShaderBuild = 0;
 	}
 	void DeleteSquareShader ()
 	{
+		if (m_SquareShaderBuild) {
+			GLCore::Utils::ShaderCompiler::Cancel (m_SquareShaderBuild);
+			m_SquareShaderBuild = 0;
+		}
 		if (m_SquareShaderProgID) {
 			glDeleteProgram (m_SquareShaderProgID);
 			m_SquareShaderProgID = 0;
 		}
 	}
+private:
+	void install_square_shader (GLuint program)
+	{
+		if (m_SquareShaderProgID)
+			glDeleteProgram (m_SquareShaderProgID);
+		glUseProgram (program);
+		m_SquareShaderProgID = program;
+		OnSquareShaderReload ();
+	}
 
 	//////////////
 	// Structures
@@ -136,6 +178,8 @@ protected:
 	static const char *s_default_sqr_shader_vert;
 	static const char *s_default_sqr_shader_frag;
 	GLuint m_SquareShaderProgID = 0;
+	uint64_t m_SquareShaderBuild = 0;  // ShaderCompiler ticket of a reload in progress
+	std::string m_SquareShaderError;   // compiler/linker output of the last failed reload
 
 	Buffer m_SquareShaderTXT_vert, m_SquareShaderTXT_frag;
 private:
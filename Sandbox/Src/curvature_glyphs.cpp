@@ -0,0 +1,231 @@
+﻿#include "curvature_glyphs.h"
+#include <GLCore.h>
+#include <Utilities/utility.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+
+enum GLYPH_BINDING : GLuint
+{
+	POSITIONS = 0, // 3 floats per vertex (std430 would pad a vec3[])
+	NORMALS,       // surface normals, 3 floats
+	VECTORS,       // K(Xi), 3 floats
+	CELLS          // smallest visible vertex per screen cell, ~0u when empty
+};
+constexpr GLuint WorkGroupSize = 64;
+constexpr GLuint MaxWorkGroups = 65535;
+constexpr GLuint MaxBlendColors = 16;
+
+static const char *s_BinShader = R"(
+#version 440 core
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 0) readonly buffer Positions { float b_Positions[]; };
+layout (std430, binding = 1) readonly buffer Normals { float b_Normals[]; };
+layout (std430, binding = 3) buffer Cells { uint b_Cells[]; };
+
+layout (location = 0) uniform mat4 u_ViewProjection;
+layout (location = 1) uniform vec3 u_CameraPosition;
+layout (location = 2) uniform uint u_VertexCount;
+layout (location = 3) uniform uvec2 u_Cells;
+layout (location = 4) uniform vec2 u_Viewport;
+layout (location = 5) uniform float u_CellPixels;
+
+void main ()
+{
+	const uint stride = gl_NumWorkGroups.x*gl_WorkGroupSize.x;
+	for (uint vertex = gl_GlobalInvocationID.x; vertex < u_VertexCount; vertex += stride) {
+		const vec3 position = vec3 (b_Positions[vertex*3], b_Positions[vertex*3 + 1], b_Positions[vertex*3 + 2]);
+		const vec3 normal = vec3 (b_Normals[vertex*3], b_Normals[vertex*3 + 1], b_Normals[vertex*3 + 2]);
+		if (dot (normal, u_CameraPosition - position) < 0) // facing away, its arrow would be hidden by the mesh anyway
+			continue;
+		const vec4 clip = u_ViewProjection*vec4 (position, 1);
+		if (clip.w <= 0 || any (greaterThan (abs (clip.xyz), vec3 (clip.w))))
+			continue;
+		const vec2 pixel = (clip.xy/clip.w*0.5 + 0.5)*u_Viewport;
+		const uvec2 cell = min (uvec2 (pixel/u_CellPixels), u_Cells - 1);
+		atomicMin (b_Cells[cell.y*u_Cells.x + cell.x], vertex); // lowest index wins, stable while the camera moves within a cell
+	}
+})";
+
+static const char *s_GlyphVertexShader = R"(
+#version 440 core
+layout (std430, binding = 0) readonly buffer Positions { float b_Positions[]; };
+layout (std430, binding = 2) readonly buffer Vectors { float b_Vectors[]; };
+layout (std430, binding = 3) readonly buffer Cells { uint b_Cells[]; };
+
+layout (location = 0) uniform mat4 u_ViewProjection;
+layout (location = 1) uniform vec3 u_CameraPosition;
+layout (location = 2) uniform uint u_VertexCount;
+layout (location = 6) uniform uint u_Stride; // 0 = one instance per cell
+layout (location = 7) uniform float u_Length;
+layout (location = 8) uniform float u_InverseMaxMagnitude;
+layout (location = 9) uniform int u_BlendColorCount;
+layout (location = 10) uniform vec3 u_BlendColors[16];
+
+layout (location = 0) out vec3 p_Color;
+layout (location = 1) flat out int p_VertexID;
+
+void main ()
+{
+	const uint vertex = u_Stride == 0 ? b_Cells[gl_InstanceID] : uint (gl_InstanceID)*u_Stride;
+	p_VertexID = int (vertex);
+	if (vertex >= u_VertexCount) { // empty cell, both ends of every line outside the clip volume
+		gl_Position = vec4 (2, 2, 2, 1);
+		p_Color = vec3 (0);
+		return;
+	}
+	const vec3 base = vec3 (b_Positions[vertex*3], b_Positions[vertex*3 + 1], b_Positions[vertex*3 + 2]);
+	const vec3 K_Xi = vec3 (b_Vectors[vertex*3], b_Vectors[vertex*3 + 1], b_Vectors[vertex*3 + 2]);
+	const float magnitude = length (K_Xi), ratio = clamp (magnitude*u_InverseMaxMagnitude, 0.0, 1.0);
+	const vec3 direction = magnitude > 0 ? K_Xi/magnitude : vec3 (0);
+	const vec3 tip = base + direction*(u_Length*ratio);
+	// arrow head in the plane facing the camera: {base, tip}, {tip, barb}, {tip, barb}
+	vec3 side = cross (direction, tip - u_CameraPosition);
+	side = dot (side, side) > 0 ? normalize (side) : vec3 (0);
+	const vec3 back = tip - direction*(u_Length*ratio*0.25);
+	const uint corner = uint (gl_VertexID);
+	vec3 position = corner == 0 ? base : (corner == 1 || corner == 2 || corner == 4) ? tip
+		: back + side*(u_Length*ratio*(corner == 3 ? 0.12 : -0.12));
+	gl_Position = u_ViewProjection*vec4 (position, 1);
+
+	const float scaled = ratio*float (u_BlendColorCount - 1);
+	const int low = int (floor (scaled)), high = int (ceil (scaled));
+	p_Color = mix (u_BlendColors[low], u_BlendColors[high], scaled - float (low));
+})";
+
+static const char *s_GlyphFragmentShader = R"(
+#version 440 core
+layout (location = 0) in vec3 p_Color;
+layout (location = 1) flat in int p_VertexID;
+
+layout (location = 0) out vec4 o_Color;
+layout (location = 1) out int o_VertexID; // hovering an arrow picks its vertex
+
+void main ()
+{
+	o_Color = vec4 (p_Color, 1.0);
+	o_VertexID = p_VertexID;
+})";
+
+static void upload_ssbo (GLuint &buffer, size_t size, const void *data, GLenum usage)
+{
+	if (!buffer)
+		glGenBuffers (1, &buffer);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferData (GL_SHADER_STORAGE_BUFFER, std::max (size, size_t (4)), data, usage); // zero sized SSBOs can't be bound
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+bool CurvatureGlyphs::Init ()
+{
+	if (IsReady ())
+		return true;
+	if (!GLAD_GL_VERSION_4_3) {
+		LOG_WARN ("curvature glyphs need OpenGL 4.3");
+		return false;
+	}
+	std::optional<GLuint> draw = Helper::SHADER::CreateProgram (s_GlyphVertexShader, GL_VERTEX_SHADER, s_GlyphFragmentShader, GL_FRAGMENT_SHADER);
+	std::optional<GLuint> bin = Helper::SHADER::CreateProgram (s_BinShader, GL_COMPUTE_SHADER);
+	if (!draw.has_value () || !bin.has_value ()) {
+		if (draw.has_value ()) glDeleteProgram (draw.value ());
+		if (bin.has_value ()) glDeleteProgram (bin.value ());
+		return false;
+	}
+	m_DrawProgram = draw.value (), m_BinProgram = bin.value ();
+	glGenVertexArrays (1, &m_VertexArray);
+	return true;
+}
+
+void CurvatureGlyphs::Release ()
+{
+	if (m_DrawProgram) glDeleteProgram (m_DrawProgram);
+	if (m_BinProgram) glDeleteProgram (m_BinProgram);
+	m_DrawProgram = m_BinProgram = 0;
+	if (m_VertexArray)
+		glDeleteVertexArrays (1, &m_VertexArray);
+	m_VertexArray = 0;
+	GLuint buffers[] = { m_PositionsSSBO, m_NormalsSSBO, m_VectorsSSBO, m_CellsSSBO };
+	for (GLuint buffer : buffers)
+		if (buffer)
+			glDeleteBuffers (1, &buffer);
+	m_PositionsSSBO = m_NormalsSSBO = m_VectorsSSBO = m_CellsSSBO = 0;
+	m_VertexCount = m_CellCapacity = 0;
+}
+
+void CurvatureGlyphs::UploadMesh (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	std::vector<glm::vec3> positions (posn_and_normals.size ()), normals (posn_and_normals.size ());
+	for (size_t i = 0; i < posn_and_normals.size (); i++)
+		positions[i] = posn_and_normals[i].first, normals[i] = posn_and_normals[i].second;
+	m_VertexCount = posn_and_normals.size ();
+	upload_ssbo (m_PositionsSSBO, positions.size ()*sizeof (glm::vec3), positions.data (), GL_STATIC_DRAW);
+	upload_ssbo (m_NormalsSSBO, normals.size ()*sizeof (glm::vec3), normals.data (), GL_STATIC_DRAW);
+}
+
+void CurvatureGlyphs::UploadVectors (const std::vector<glm::vec3> &mean_curvature_normals)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	upload_ssbo (m_VectorsSSBO, mean_curvature_normals.size ()*sizeof (glm::vec3), mean_curvature_normals.data (), GL_DYNAMIC_DRAW);
+}
+
+uint32_t CurvatureGlyphs::Draw (const glm::mat4 &view_projection, const glm::vec3 &camera_position, glm::uvec2 viewport_size
+								, GLuint vectors_ssbo, float max_magnitude, float length, const std::vector<glm::vec3> &blend_colors, const Settings &settings)
+{
+	if (!vectors_ssbo)
+		vectors_ssbo = m_VectorsSSBO;
+	if (!IsReady () || m_VertexCount == 0 || !vectors_ssbo || blend_colors.empty ())
+		return 0;
+	GLCORE_PROFILE_FUNCTION ();
+	GLint last_program;
+	glGetIntegerv (GL_CURRENT_PROGRAM, &last_program);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, GLYPH_BINDING::POSITIONS, m_PositionsSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, GLYPH_BINDING::NORMALS, m_NormalsSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, GLYPH_BINDING::VECTORS, vectors_ssbo);
+
+	uint32_t instances, stride = 0;
+	if (settings.Mode == Sampling::ScreenDensity) {
+		const float cell_pixels = std::max (settings.CellPixels, 1.0f);
+		const glm::uvec2 cells = glm::max (glm::uvec2 (glm::ceil (glm::vec2 (viewport_size)/cell_pixels)), glm::uvec2 (1));
+		instances = cells.x*cells.y;
+		if (instances > m_CellCapacity) {
+			m_CellCapacity = instances;
+			upload_ssbo (m_CellsSSBO, m_CellCapacity*sizeof (GLuint), nullptr, GL_DYNAMIC_COPY);
+		}
+		const GLuint empty = ~0u;
+		glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_CellsSSBO);
+		glClearBufferSubData (GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, instances*sizeof (GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, &empty);
+		glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, GLYPH_BINDING::CELLS, m_CellsSSBO);
+
+		glUseProgram (m_BinProgram);
+		glUniformMatrix4fv (0, 1, GL_FALSE, glm::value_ptr (view_projection));
+		glUniform3fv (1, 1, glm::value_ptr (camera_position));
+		glUniform1ui (2, GLuint (m_VertexCount));
+		glUniform2ui (3, cells.x, cells.y);
+		glUniform2f (4, float (viewport_size.x), float (viewport_size.y));
+		glUniform1f (5, cell_pixels);
+		glDispatchCompute (GLuint (std::min ((m_VertexCount + WorkGroupSize - 1)/WorkGroupSize, size_t (MaxWorkGroups))), 1, 1);
+		glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+	} else {
+		stride = GLuint (std::max (settings.Stride, 1));
+		instances = uint32_t ((m_VertexCount + stride - 1)/stride);
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, GLYPH_BINDING::CELLS, m_PositionsSSBO); // unread, but something has to be bound
+	}
+
+	glUseProgram (m_DrawProgram);
+	glUniformMatrix4fv (0, 1, GL_FALSE, glm::value_ptr (view_projection));
+	glUniform3fv (1, 1, glm::value_ptr (camera_position));
+	glUniform1ui (2, GLuint (m_VertexCount));
+	glUniform1ui (6, stride);
+	glUniform1f (7, length);
+	glUniform1f (8, max_magnitude > 0 ? 1.0f/max_magnitude : 0.0f);
+	const GLsizei blend_count = GLsizei (std::min (blend_colors.size (), size_t (MaxBlendColors)));
+	glUniform1i (9, blend_count);
+	glUniform3fv (10, blend_count, glm::value_ptr (blend_colors[0]));
+	glBindVertexArray (m_VertexArray);
+	glDrawArraysInstanced (GL_LINES, 0, 6, GLsizei (instances));
+	glBindVertexArray (0);
+	glUseProgram (last_program);
+	return instances;
+}
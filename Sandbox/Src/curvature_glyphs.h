@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+// Vector field overlay of K(Xi): one instanced arrow (3 lines) per sampled vertex in a single draw call, positions and
+// vectors are read in the vertex shader straight from SSBOs, nothing per glyph goes through vertex attributes.
+// Sampling is either every Stride-th vertex, or one vertex per CellPixels^2 screen cell (picked by a compute pass that
+// bins the visible, camera facing vertices), so dense meshes don't turn into a solid carpet of arrows.
+// Needs OpenGL 4.3 (SSBOs + compute), glyphs write their vertex into the picking attachment like the mesh does.
+class CurvatureGlyphs
+{
+public:
+	enum class Sampling { Stride = 0, ScreenDensity };
+	struct Settings
+	{
+		Sampling Mode = Sampling::ScreenDensity;
+		int Stride = 1;
+		float CellPixels = 12;
+	};
+
+	CurvatureGlyphs () = default;
+	~CurvatureGlyphs () { Release (); }
+	CurvatureGlyphs (const CurvatureGlyphs &) = delete;
+	CurvatureGlyphs &operator= (const CurvatureGlyphs &) = delete;
+
+	// compiles the programs, false without OpenGL 4.3
+	bool Init ();
+	void Release ();
+	bool IsReady () const { return m_DrawProgram && m_BinProgram; }
+
+	// positions and surface normals (back facing vertices are skipped when binning), once per mesh
+	void UploadMesh (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals);
+	// K(Xi) of the CPU paths, the compute path's MeanCurvatureGPU::MeanCurvatureNormalsBuffer is passed to Draw directly
+	void UploadVectors (const std::vector<glm::vec3> &mean_curvature_normals);
+
+	// vectors_ssbo holds 3 floats per vertex, 0 = the last UploadVectors. Arrows are 'length' long at max_magnitude and
+	// colored along blend_colors by |K(Xi)|/max_magnitude. Returns the instances drawn (cells in ScreenDensity mode).
+	uint32_t Draw (const glm::mat4 &view_projection, const glm::vec3 &camera_position, glm::uvec2 viewport_size
+				   , GLuint vectors_ssbo, float max_magnitude, float length, const std::vector<glm::vec3> &blend_colors, const Settings &settings);
+private:
+	GLuint m_DrawProgram = 0, m_BinProgram = 0;
+	GLuint m_VertexArray = 0; // empty, core profile draws need one bound
+	GLuint m_PositionsSSBO = 0, m_NormalsSSBO = 0, m_VectorsSSBO = 0, m_CellsSSBO = 0;
+	size_t m_VertexCount = 0, m_CellCapacity = 0;
+};
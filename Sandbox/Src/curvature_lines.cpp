@@ -0,0 +1,346 @@
+﻿#include "curvature_lines.h"
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <glm/gtx/norm.hpp>
+using namespace GLCore::Utils;
+
+constexpr size_t VertexGrain = 1024;
+constexpr size_t TrianglesPerChunk = 1 << 14; // one segment buffer each, concatenated in chunk order so results don't depend on scheduling
+
+// orthonormal basis around a unit normal (Duff et al. 2017)
+static void tangent_frame (const glm::vec3 &n, glm::vec3 &t1, glm::vec3 &t2)
+{
+	const float sign = std::copysign (1.0f, n.z), a = -1/(sign + n.z), b = n.x*n.y*a;
+	t1 = { 1 + sign*n.x*n.x*a, sign*b, -sign*n.x };
+	t2 = { b, sign + n.y*n.y*a, -n.y };
+}
+
+void ComputePrincipalCurvatures (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings, PrincipalCurvatures &out_curvatures)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t vertex_count = posn_and_normals.size ();
+	PrincipalCurvatures &out = out_curvatures;
+	out.Normals.resize (vertex_count);
+	out.Max.resize (vertex_count), out.Min.resize (vertex_count);
+	out.MaxDirections.resize (vertex_count), out.MinDirections.resize (vertex_count);
+	out.MaxExtremality.resize (vertex_count), out.MinExtremality.resize (vertex_count);
+	auto position = [&](uint32_t v) -> const glm::vec3 & { return posn_and_normals[v].first; };
+
+	// 1. normals, {v, ring[i-1], ring[i]} is counter clock-wise
+	JobSystem::ParallelFor (vertex_count, VertexGrain, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			const uint32_t *ring = rings.RingOf (v);
+			glm::vec3 normal (0);
+			for (uint32_t i = 1; i < rings.RingSize (v); i++)
+				normal += glm::cross (position (ring[i - 1]) - position (uint32_t (v)), position (ring[i]) - position (uint32_t (v)));
+			const float length = glm::length (normal);
+			// the file's normals settle which side is out whatever the winding
+			const float side = glm::dot (normal, posn_and_normals[v].second) < 0 ? -1.0f : 1.0f;
+			out.Normals[v] = length > 0 ? side*normal/length : posn_and_normals[v].second;
+		}
+	});
+
+	// 2. second fundamental form of every incident triangle, averaged in the vertex's tangent frame by area
+	JobSystem::ParallelFor (vertex_count, VertexGrain, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			const uint32_t *ring = rings.RingOf (v);
+			glm::vec3 t1, t2;
+			tangent_frame (out.Normals[v], t1, t2);
+			float a = 0, b = 0, c = 0, area_sum = 0; // [a b; b c] in {t1, t2}
+			for (uint32_t i = 1; i < rings.RingSize (v); i++) {
+				const uint32_t corners[3] = { uint32_t (v), ring[i - 1], ring[i] };
+				const glm::vec3 p[3] = { position (corners[0]), position (corners[1]), position (corners[2]) };
+				const glm::vec3 face_normal = glm::cross (p[1] - p[0], p[2] - p[0]);
+				const float twice_area = glm::length (face_normal);
+				if (twice_area <= 0)
+					continue;
+				const glm::vec3 u = glm::normalize (p[2] - p[1]), w = glm::cross (face_normal/twice_area, u);
+				// least squares: II (e.u, e.w) = (dn.u, dn.w) along every edge, II = [e f; f g]
+				double m[3][3] = {}, r[3] = {};
+				for (int k = 0; k < 3; k++) {
+					const int from = (k + 1)%3, to = (k + 2)%3;
+					const glm::vec3 edge = p[to] - p[from], dn = out.Normals[corners[to]] - out.Normals[corners[from]];
+					const double eu = glm::dot (edge, u), ew = glm::dot (edge, w), du = glm::dot (dn, u), dw = glm::dot (dn, w);
+					m[0][0] += eu*eu, m[0][1] += eu*ew, m[1][1] += eu*eu + ew*ew, m[1][2] += eu*ew, m[2][2] += ew*ew;
+					r[0] += du*eu, r[1] += du*ew + dw*eu, r[2] += dw*ew;
+				}
+				m[1][0] = m[0][1], m[2][1] = m[1][2];
+				// Cramer's rule, m[0][2] = m[2][0] = 0
+				const double det = m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1]) - m[0][1]*(m[1][0]*m[2][2]);
+				if (std::abs (det) < 1e-30)
+					continue;
+				const double e = (r[0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1]) - m[0][1]*(r[1]*m[2][2] - m[1][2]*r[2]))/det
+					, f = (m[0][0]*(r[1]*m[2][2] - m[1][2]*r[2]) - r[0]*(m[1][0]*m[2][2]))/det
+					, g = (m[0][0]*(m[1][1]*r[2] - r[1]*m[2][1]) - m[0][1]*(m[1][0]*r[2]) + r[0]*(m[1][0]*m[2][1]))/det;
+				// t1, t2 projected onto the face, close enough while neighbouring normals are
+				const float x1 = glm::dot (t1, u), y1 = glm::dot (t1, w), x2 = glm::dot (t2, u), y2 = glm::dot (t2, w);
+				const float weight = twice_area*0.5f;
+				a += weight*float (e*x1*x1 + 2*f*x1*y1 + g*y1*y1);
+				b += weight*float (e*x1*x2 + f*(x1*y2 + y1*x2) + g*y1*y2);
+				c += weight*float (e*x2*x2 + 2*f*x2*y2 + g*y2*y2);
+				area_sum += weight;
+			}
+			if (area_sum > 0)
+				a /= area_sum, b /= area_sum, c /= area_sum;
+			const float mean = (a + c)*0.5f, deviation = std::sqrt ((a - c)*(a - c)*0.25f + b*b), angle = 0.5f*std::atan2 (2*b, a - c);
+			out.Max[v] = mean + deviation, out.Min[v] = mean - deviation;
+			out.MaxDirections[v] = std::cos (angle)*t1 + std::sin (angle)*t2;
+			out.MinDirections[v] = glm::cross (out.Normals[v], out.MaxDirections[v]);
+		}
+	});
+
+	// 3. gradients of both curvatures (linear over every triangle, area weighted), along their own directions
+	JobSystem::ParallelFor (vertex_count, VertexGrain, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			const uint32_t *ring = rings.RingOf (v);
+			glm::vec3 max_gradient (0), min_gradient (0);
+			float area_sum = 0;
+			for (uint32_t i = 1; i < rings.RingSize (v); i++) {
+				const uint32_t corners[3] = { uint32_t (v), ring[i - 1], ring[i] };
+				const glm::vec3 p[3] = { position (corners[0]), position (corners[1]), position (corners[2]) };
+				const glm::vec3 face_normal = glm::cross (p[1] - p[0], p[2] - p[0]);
+				const float twice_area = glm::length (face_normal);
+				if (twice_area <= 0)
+					continue;
+				// grad f = sum f_k (n x e_k)/(2 A), e_k the edge opposite corner k; times the area it's weighted with
+				const glm::vec3 n = face_normal/twice_area;
+				for (int k = 0; k < 3; k++) {
+					const glm::vec3 rotated_edge = glm::cross (n, p[(k + 2)%3] - p[(k + 1)%3])*0.5f;
+					max_gradient += out.Max[corners[k]]*rotated_edge;
+					min_gradient += out.Min[corners[k]]*rotated_edge;
+				}
+				area_sum += twice_area*0.5f;
+			}
+			out.MaxExtremality[v] = area_sum > 0 ? glm::dot (max_gradient, out.MaxDirections[v])/area_sum : 0;
+			out.MinExtremality[v] = area_sum > 0 ? glm::dot (min_gradient, out.MinDirections[v])/area_sum : 0;
+		}
+	});
+}
+
+// Cut of one triangle edge, named after the edge so both triangles sharing it agree
+struct LineSegment
+{
+	uint64_t Edges[2];
+	glm::vec3 Points[2];
+	uint32_t Line; // level index, or levels + type for ridges/valleys
+};
+static inline uint64_t edge_key (uint32_t a, uint32_t b) { return a < b ? uint64_t (a) << 32 | b : uint64_t (b) << 32 | a; }
+
+// Triangles in fixed chunks, 'cut (triangle, segments)' appends whatever the triangle contributes
+template<typename CutFn>
+static std::vector<LineSegment> cut_triangles (size_t triangle_count, CutFn cut)
+{
+	std::vector<std::vector<LineSegment>> chunks ((triangle_count + TrianglesPerChunk - 1)/TrianglesPerChunk);
+	JobSystem::ParallelFor (chunks.size (), 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			const size_t last = std::min (triangle_count, (c + 1)*TrianglesPerChunk);
+			for (size_t t = c*TrianglesPerChunk; t < last; t++)
+				cut (t, chunks[c]);
+		}
+	});
+	size_t segment_count = 0;
+	for (const auto &chunk : chunks)
+		segment_count += chunk.size ();
+	std::vector<LineSegment> segments;
+	segments.reserve (segment_count);
+	for (const auto &chunk : chunks)
+		segments.insert (segments.end (), chunk.begin (), chunk.end ());
+	return segments;
+}
+
+// Chains segments meeting at an edge, 'describe (line, polyline)' fills in type and level
+template<typename DescribeFn>
+static void stitch_segments (const std::vector<LineSegment> &segments, CurvatureLines &out_lines, DescribeFn describe)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t end_count = segments.size ()*2;
+	// ends sorted by (line, edge), ends with the same key are joined pairwise (two unless the mesh is non-manifold)
+	std::vector<uint32_t> ends (end_count);
+	for (size_t i = 0; i < end_count; i++)
+		ends[i] = uint32_t (i);
+	auto key_less = [&](uint32_t x, uint32_t y) {
+		const LineSegment &a = segments[x/2], &b = segments[y/2];
+		return a.Line != b.Line ? a.Line < b.Line : a.Edges[x%2] != b.Edges[y%2] ? a.Edges[x%2] < b.Edges[y%2] : x < y;
+	};
+	std::sort (ends.begin (), ends.end (), key_less);
+	std::vector<int64_t> partner (end_count, -1);
+	for (size_t i = 0; i + 1 < end_count; i++) {
+		const uint32_t x = ends[i], y = ends[i + 1];
+		if (segments[x/2].Line == segments[y/2].Line && segments[x/2].Edges[x%2] == segments[y/2].Edges[y%2] && x/2 != y/2)
+			partner[x] = y, partner[y] = x, i++;
+	}
+
+	// segments in line order, so polylines come out sorted by line
+	std::vector<uint32_t> order (segments.size ());
+	for (size_t i = 0; i < order.size (); i++)
+		order[i] = uint32_t (i);
+	std::stable_sort (order.begin (), order.end (), [&](uint32_t a, uint32_t b) { return segments[a].Line < segments[b].Line; });
+	std::vector<uint8_t> visited (segments.size (), 0);
+	for (const uint32_t s : order) {
+		if (visited[s])
+			continue;
+		// walk back to where the polyline starts, unless it closes on itself
+		uint32_t start = s, back_end = 0;
+		for (uint32_t current = s, exit = 0;;) {
+			const int64_t next = partner[current*2 + exit];
+			if (next < 0) {
+				start = current, back_end = exit;
+				break;
+			}
+			if (uint32_t (next/2) == s) { // closed
+				start = s, back_end = 0;
+				break;
+			}
+			current = uint32_t (next/2), exit = 1 - uint32_t (next%2);
+		}
+
+		CurvatureLines::Polyline polyline;
+		polyline.First = uint32_t (out_lines.Points.size ());
+		out_lines.Points.push_back (segments[start].Points[back_end]);
+		for (uint32_t current = start, exit = 1 - back_end;;) {
+			visited[current] = 1;
+			out_lines.Points.push_back (segments[current].Points[exit]);
+			const int64_t next = partner[current*2 + exit];
+			if (next < 0 || visited[next/2])
+				break;
+			current = uint32_t (next/2), exit = 1 - uint32_t (next%2);
+		}
+		polyline.Count = uint32_t (out_lines.Points.size ()) - polyline.First;
+		describe (segments[s].Line, polyline);
+		out_lines.Polylines.push_back (polyline);
+	}
+}
+
+void ExtractIsolines (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices
+					  , const std::vector<float> &values, const std::vector<float> &levels, CurvatureLines &out_lines)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	if (values.size () != posn_and_normals.size () || levels.empty ())
+		return;
+	// always interpolated from the lower vertex index, both triangles of an edge get the exact same point
+	auto crossing = [&](uint32_t a, uint32_t b, float level) {
+		if (a > b)
+			std::swap (a, b);
+		const float t = (level - values[a])/(values[b] - values[a]);
+		return glm::mix (posn_and_normals[a].first, posn_and_normals[b].first, t);
+	};
+	std::vector<LineSegment> segments = cut_triangles (indices.size ()/3, [&](size_t t, std::vector<LineSegment> &out_segments) {
+		const uint32_t corners[3] = { indices[t*3], indices[t*3 + 1], indices[t*3 + 2] };
+		const float v[3] = { values[corners[0]], values[corners[1]], values[corners[2]] };
+		const float lowest = std::min (v[0], std::min (v[1], v[2])), highest = std::max (v[0], std::max (v[1], v[2]));
+		for (uint32_t l = 0; l < levels.size (); l++) {
+			const float level = levels[l];
+			if (level <= lowest || level > highest) // every corner on the same side (corners at the level count as above)
+				continue;
+			LineSegment segment;
+			segment.Line = l;
+			int cuts = 0;
+			for (int k = 0; k < 3; k++) {
+				const int next = (k + 1)%3;
+				if ((v[k] >= level) != (v[next] >= level)) {
+					segment.Edges[cuts] = edge_key (corners[k], corners[next]);
+					segment.Points[cuts] = crossing (corners[k], corners[next], level);
+					cuts++;
+				}
+			}
+			if (cuts == 2)
+				out_segments.push_back (segment);
+		}
+	});
+	stitch_segments (segments, out_lines, [&](uint32_t line, CurvatureLines::Polyline &polyline) {
+		polyline.Type = CurvatureLineType::Isoline;
+		polyline.Level = levels[line];
+	});
+}
+
+void ExtractRidgesAndValleys (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices
+							  , const PrincipalCurvatures &curvatures, float strength, bool ridges, bool valleys, CurvatureLines &out_lines)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t vertex_count = posn_and_normals.size ();
+	if (curvatures.VertexCount () != vertex_count || vertex_count == 0 || !(ridges || valleys))
+		return;
+	double sum = 0;
+	std::mutex mutex_merge;
+	JobSystem::ParallelFor (vertex_count, VertexGrain*16, [&](size_t begin, size_t end) {
+		double local_sum = 0;
+		for (size_t v = begin; v < end; v++)
+			local_sum += std::max (std::abs (curvatures.Max[v]), std::abs (curvatures.Min[v]));
+		std::lock_guard lock (mutex_merge);
+		sum += local_sum;
+	});
+	const float threshold = strength*float (sum/vertex_count);
+
+	// Zero crossing of the extremality along edge {a, b}, with b's direction flipped to agree with a's. Only looks at the
+	// edge itself (lower index first), so both of its triangles agree. Ridges are maxima: the extremality goes from + to -
+	// walking along the direction; valleys minima of kappa_2.
+	auto crossing = [&](uint32_t a, uint32_t b, bool ridge, glm::vec3 &out_point) {
+		if (a > b)
+			std::swap (a, b);
+		const std::vector<glm::vec3> &directions = ridge ? curvatures.MaxDirections : curvatures.MinDirections;
+		const std::vector<float> &extremality = ridge ? curvatures.MaxExtremality : curvatures.MinExtremality;
+		const float e_a = extremality[a], e_b = glm::dot (directions[a], directions[b]) < 0 ? -extremality[b] : extremality[b];
+		if ((e_a >= 0) == (e_b >= 0))
+			return false;
+		const float along = glm::dot (posn_and_normals[b].first - posn_and_normals[a].first, directions[a]);
+		if ((ridge ? e_a - e_b : e_b - e_a)*along <= 0)
+			return false;
+		const float t = e_a/(e_a - e_b);
+		const float kappa_max = glm::mix (curvatures.Max[a], curvatures.Max[b], t), kappa_min = glm::mix (curvatures.Min[a], curvatures.Min[b], t);
+		if (ridge ? kappa_max < threshold || kappa_max <= std::abs (kappa_min) : -kappa_min < threshold || -kappa_min <= std::abs (kappa_max))
+			return false;
+		out_point = glm::mix (posn_and_normals[a].first, posn_and_normals[b].first, t);
+		return true;
+	};
+	std::vector<LineSegment> segments = cut_triangles (indices.size ()/3, [&](size_t t, std::vector<LineSegment> &out_segments) {
+		const uint32_t corners[3] = { indices[t*3], indices[t*3 + 1], indices[t*3 + 2] };
+		for (int type = 0; type < 2; type++) {
+			const bool ridge = type == 0;
+			if (ridge ? !ridges : !valleys)
+				continue;
+			LineSegment segment;
+			segment.Line = uint32_t (ridge ? CurvatureLineType::Ridge : CurvatureLineType::Valley);
+			int cuts = 0;
+			for (int k = 0; k < 3; k++) {
+				glm::vec3 point;
+				if (crossing (corners[k], corners[(k + 1)%3], ridge, point)) {
+					if (cuts < 2)
+						segment.Edges[cuts] = edge_key (corners[k], corners[(k + 1)%3]), segment.Points[cuts] = point;
+					cuts++;
+				}
+			}
+			if (cuts == 2) // directions twist inside the triangle when it's 1 or 3, no consistent line through it
+				out_segments.push_back (segment);
+		}
+	});
+	stitch_segments (segments, out_lines, [&](uint32_t line, CurvatureLines::Polyline &polyline) {
+		polyline.Type = CurvatureLineType (line);
+		polyline.Level = 0;
+	});
+}
+
+bool WriteCurvatureLinesOBJ (const char *path, const CurvatureLines &lines)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	FILE *file = fopen (path, "w");
+	if (file == NULL)
+		return false;
+	const char *type_names[] = { "isoline", "ridge", "valley" };
+	for (const glm::vec3 &point : lines.Points)
+		fprintf (file, "v %f %f %f\n", point.x, point.y, point.z);
+	for (size_t i = 0; i < lines.Polylines.size (); i++) {
+		const CurvatureLines::Polyline &polyline = lines.Polylines[i];
+		if (polyline.Type == CurvatureLineType::Isoline)
+			fprintf (file, "o isoline_%zu_%g\n", i, polyline.Level);
+		else fprintf (file, "o %s_%zu\n", type_names[uint32_t (polyline.Type)], i);
+		fprintf (file, "l");
+		for (uint32_t p = 0; p < polyline.Count; p++)
+			fprintf (file, " %u", polyline.First + p + 1);
+		fprintf (file, "\n");
+	}
+	fclose (file);
+	return true;
+}
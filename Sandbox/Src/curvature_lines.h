@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+#include "mean_curvature.h"
+
+// Per vertex curvature tensor (Rusinkiewicz 2004: every incident triangle fits the second fundamental form to how the
+// normals change along its edges), positive where the surface bends away from the normal (convex, outward normals).
+struct PrincipalCurvatures
+{
+	std::vector<glm::vec3> Normals; // area weighted, on the side of the mesh's own normals (counter clock-wise faces without them)
+	std::vector<float> Max, Min;    // kappa_1 >= kappa_2
+	std::vector<glm::vec3> MaxDirections, MinDirections; // unit, tangent, either sign
+	// derivative of the curvature along its own direction, zero on ridges (Max) and valleys (Min); sign follows the direction's
+	std::vector<float> MaxExtremality, MinExtremality;
+
+	size_t VertexCount () const { return Max.size (); }
+};
+void ComputePrincipalCurvatures (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings, PrincipalCurvatures &out_curvatures);
+
+enum class CurvatureLineType : uint32_t
+{
+	Isoline = 0, // values == Level
+	Ridge,       // maximum of kappa_1 along its direction, kappa_1 > |kappa_2|
+	Valley       // minimum of kappa_2 along its direction, -kappa_2 > |kappa_1|
+};
+
+// Polylines in Points[First .. First + Count), closed ones repeat their first point at the end. Sorted by type, then level.
+struct CurvatureLines
+{
+	struct Polyline
+	{
+		uint32_t First, Count;
+		CurvatureLineType Type;
+		float Level; // iso value, 0 for ridges/valleys
+	};
+	std::vector<glm::vec3> Points;
+	std::vector<Polyline> Polylines;
+
+	void Clear () { Points.clear (), Polylines.clear (); }
+};
+
+// Marching triangles over 'values' (one per vertex) at every level, appended to out_lines. Triangles are cut in parallel
+// into per-job segment buffers, segments sharing an edge are then stitched into polylines.
+void ExtractIsolines (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices
+					  , const std::vector<float> &values, const std::vector<float> &levels, CurvatureLines &out_lines);
+// Zero crossings of the extremalities, kept where |kappa| is at least 'strength' times its mean over the mesh
+void ExtractRidgesAndValleys (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices
+							  , const PrincipalCurvatures &curvatures, float strength, bool ridges, bool valleys, CurvatureLines &out_lines);
+
+// Wavefront OBJ, one object of 'l' elements per polyline
+bool WriteCurvatureLinesOBJ (const char *path, const CurvatureLines &lines);
@@ -0,0 +1,212 @@
+﻿#include "heightfield.h"
+#include <cmath>
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+#include <Utilities/utility.h>
+using namespace GLCore::Utils;
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+	#define HEIGHTFIELD_SSE2
+	#include <emmintrin.h>
+#endif
+
+// vertices handed to a job at once, rounded to whole rows
+constexpr size_t ParallelGrain = 1024;
+
+static size_t rows_per_job (uint32_t width) { return std::max<size_t> (1, ParallelGrain/std::max (width, 1u)); }
+
+Heightfield HeightfieldFromNoise (const Helper::Noise::NoiseSettings &noise, uint32_t width, uint32_t depth, float spacing, float height_scale)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	Heightfield heightfield;
+	heightfield.Width = width, heightfield.Depth = depth, heightfield.Spacing = spacing;
+	heightfield.Origin = -0.5f*spacing*glm::vec2 (std::max (width, 1u) - 1, std::max (depth, 1u) - 1);
+	heightfield.Heights.resize (heightfield.VertexCount ());
+
+	Helper::Noise::NoiseSettings per_sample = noise; // rows are evaluated at integer sample coords
+	per_sample.Freq *= spacing;
+	JobSystem::ParallelFor (depth, rows_per_job (width), [&](size_t begin, size_t end) {
+		for (size_t z = begin; z < end; z++) {
+			float *row = heightfield.Heights.data () + z*width;
+			Helper::Noise::EvaluateRow (per_sample, 0.0f, float (z), width, row);
+			for (uint32_t x = 0; x < width; x++)
+				row[x] *= height_scale;
+		}
+	});
+	return heightfield;
+}
+
+void HeightfieldToMesh (const Heightfield &heightfield, std::vector<std::pair<glm::vec3, glm::vec3>> &out_posn_and_normals, std::vector<GLuint> *out_indices)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const uint32_t width = heightfield.Width, depth = heightfield.Depth;
+	out_posn_and_normals.resize (heightfield.VertexCount ());
+	if (out_indices)
+		out_indices->resize (width > 1 && depth > 1 ? size_t (width - 1)*(depth - 1)*6 : 0);
+
+	JobSystem::ParallelFor (depth, rows_per_job (width), [&](size_t begin, size_t end) {
+		for (uint32_t z = uint32_t (begin); z < end; z++) {
+			const uint32_t z0 = z > 0 ? z - 1 : z, z1 = z + 1 < depth ? z + 1 : z;
+			for (uint32_t x = 0; x < width; x++) {
+				const uint32_t x0 = x > 0 ? x - 1 : x, x1 = x + 1 < width ? x + 1 : x;
+				// one sided at the borders
+				const float dh_dx = x1 > x0 ? (heightfield.At (x1, z) - heightfield.At (x0, z))/((x1 - x0)*heightfield.Spacing) : 0.0f;
+				const float dh_dz = z1 > z0 ? (heightfield.At (x, z1) - heightfield.At (x, z0))/((z1 - z0)*heightfield.Spacing) : 0.0f;
+				out_posn_and_normals[size_t (z)*width + x] = { heightfield.Position (x, z), glm::normalize (glm::vec3 (-dh_dx, 1.0f, -dh_dz)) };
+			}
+			if (!out_indices || z + 1 >= depth)
+				continue;
+			GLuint *quads = out_indices->data () + size_t (z)*(width - 1)*6;
+			for (uint32_t x = 0; x + 1 < width; x++, quads += 6) {
+				const GLuint a = z*width + x, b = a + 1, c = a + width, d = c + 1;
+				quads[0] = a, quads[1] = b, quads[2] = d;
+				quads[3] = a, quads[4] = d, quads[5] = c;
+			}
+		}
+	});
+}
+
+// The one-ring of (x, z) in fan order, {Ring[t], Ring[t + 1], (x, z)} is triangle t
+static constexpr int32_t RingDX[6] = { 1, 1, 0, -1, -1,  0 };
+static constexpr int32_t RingDZ[6] = { 0, 1, 1,  0, -1, -1 };
+static constexpr uint32_t FullRing = 0x3F; // bit t: triangle t is inside the grid
+
+// Lane ops, the stencil below is written once for a single vertex (float) and for 4 neighbouring vertices of a row (__m128)
+template<typename V> static inline V vload (const float *p);
+template<> inline float vload<float> (const float *p) { return *p; }
+static inline float vsplat (float a, float) { return a; }
+static inline float vadd (float a, float b) { return a + b; }
+static inline float vsub (float a, float b) { return a - b; }
+static inline float vmul (float a, float b) { return a*b; }
+static inline float vdiv (float a, float b) { return a/b; }
+static inline float vsqrt (float a) { return std::sqrt (a); }
+static inline bool vge0 (float a) { return a >= 0; }
+static inline bool vand (bool a, bool b) { return a && b; }
+static inline float vselect (bool mask, float a, float b) { return mask ? a : b; }
+static inline void vstore (float *p, float a) { *p = a; }
+#ifdef HEIGHTFIELD_SSE2
+template<> inline __m128 vload<__m128> (const float *p) { return _mm_loadu_ps (p); }
+static inline __m128 vsplat (float a, __m128) { return _mm_set1_ps (a); }
+static inline __m128 vadd (__m128 a, __m128 b) { return _mm_add_ps (a, b); }
+static inline __m128 vsub (__m128 a, __m128 b) { return _mm_sub_ps (a, b); }
+static inline __m128 vmul (__m128 a, __m128 b) { return _mm_mul_ps (a, b); }
+static inline __m128 vdiv (__m128 a, __m128 b) { return _mm_div_ps (a, b); }
+static inline __m128 vsqrt (__m128 a) { return _mm_sqrt_ps (a); }
+static inline __m128 vge0 (__m128 a) { return _mm_cmpge_ps (a, _mm_setzero_ps ()); }
+static inline __m128 vand (__m128 a, __m128 b) { return _mm_and_ps (a, b); }
+static inline __m128 vselect (__m128 mask, __m128 a, __m128 b) { return _mm_or_ps (_mm_and_ps (mask, a), _mm_andnot_ps (mask, b)); }
+static inline void vstore (float *p, __m128 a) { _mm_storeu_ps (p, a); }
+#endif
+
+// vertex_mean_curvature_normal of mean_curvature.cpp with e = Q - X = (dx*spacing, dh, dz*spacing): the XZ parts of every edge, dot and
+// cross product are constants of the grid, only the dh terms vary. A triangle always has twice_area >= spacing^2, none is degenerate
+template<typename V>
+static inline void stencil_mean_curvature_normal (const V dh[6], float spacing, uint32_t triangles, V out_K[3])
+{
+	const V zero = vsplat (0.0f, dh[0]);
+	V sigma_x = zero, sigma_y = zero, sigma_z = zero, A_mixed = zero;
+	for (uint32_t i = 0; i < 6; i++) {
+		const uint32_t t = (i + 4)%6, q = t, r = (t + 1)%6; // from (-1, -1), where BuildVertexRings starts a closed fan
+		if (!(triangles & (1u << t)))
+			continue;
+		const float qx = RingDX[q]*spacing, qz = RingDZ[q]*spacing, rx = RingDX[r]*spacing, rz = RingDZ[r]*spacing;
+		const V qy = dh[q], ry = dh[r];
+
+		const V cross_x = vsub (vmul (qy, vsplat (rz, qy)), vmul (ry, vsplat (qz, qy)));
+		const V cross_z = vsub (vmul (ry, vsplat (qx, qy)), vmul (qy, vsplat (rx, qy)));
+		const float cross_y = qz*rx - qx*rz;
+		const V twice_area = vsqrt (vadd (vadd (vmul (cross_x, cross_x), vmul (cross_z, cross_z)), vsplat (cross_y*cross_y, qy)));
+		const V dot_qr = vadd (vmul (qy, ry), vsplat (qx*rx + qz*rz, qy)); // cos_X, only sign matters
+		const V pXQ2 = vadd (vmul (qy, qy), vsplat (qx*qx + qz*qz, qy)), pXR2 = vadd (vmul (ry, ry), vsplat (rx*rx + rz*rz, qy));
+		// (R - Q).(X - Q) and (Q - R).(X - R) kept apart from pXQ2/pXR2, the constant spacing^2 terms would cancel in float
+		const V dh_rq = vsub (ry, qy);
+		const V cot_Q = vdiv (vsub (vsplat (qx*(qx - rx) + qz*(qz - rz), qy), vmul (qy, dh_rq)), twice_area);
+		const V cot_R = vdiv (vadd (vsplat (rx*(rx - qx) + rz*(rz - qz), qy), vmul (ry, dh_rq)), twice_area);
+
+		// cot_Q*(X - R) + cot_R*(X - Q)
+		sigma_x = vsub (sigma_x, vadd (vmul (cot_Q, vsplat (rx, qy)), vmul (cot_R, vsplat (qx, qy))));
+		sigma_y = vsub (sigma_y, vadd (vmul (cot_Q, ry), vmul (cot_R, qy)));
+		sigma_z = vsub (sigma_z, vadd (vmul (cot_Q, vsplat (rz, qy)), vmul (cot_R, vsplat (qz, qy))));
+
+		const V A_voronoi = vmul (vadd (vmul (pXR2, cot_Q), vmul (pXQ2, cot_R)), vsplat (0.125f, qy));
+		const V A_obtuse = vmul (twice_area, vsplat (0.25f, qy)), A_elsewhere = vmul (twice_area, vsplat (0.125f, qy));
+		const auto non_obtuse = vand (vand (vge0 (cot_Q), vge0 (cot_R)), vge0 (dot_qr));
+		A_mixed = vadd (A_mixed, vselect (non_obtuse, A_voronoi, vselect (vge0 (dot_qr), A_elsewhere, A_obtuse)));
+	}
+	const V scale = vdiv (vsplat (0.5f, zero), A_mixed);
+	out_K[0] = vmul (sigma_x, scale), out_K[1] = vmul (sigma_y, scale), out_K[2] = vmul (sigma_z, scale);
+}
+
+// 'lanes' neighbouring vertices of a row, starting at v, all with a full ring
+template<typename V>
+static inline void interior_vertices (const float *heights, uint32_t width, size_t v, float spacing, glm::vec3 *out_normals, float *out_values)
+{
+	constexpr uint32_t lanes = sizeof (V)/sizeof (float);
+	const V center = vload<V> (heights + v);
+	V dh[6];
+	for (uint32_t q = 0; q < 6; q++)
+		dh[q] = vsub (vload<V> (heights + v + ptrdiff_t (RingDZ[q])*width + RingDX[q]), center);
+	V K[3];
+	stencil_mean_curvature_normal (dh, spacing, FullRing, K);
+	vstore (out_values + v, vmul (vsqrt (vadd (vadd (vmul (K[0], K[0]), vmul (K[1], K[1])), vmul (K[2], K[2]))), vsplat (0.5f, center)));
+
+	float k[3][lanes];
+	vstore (k[0], K[0]), vstore (k[1], K[1]), vstore (k[2], K[2]);
+	for (uint32_t l = 0; l < lanes; l++)
+		out_normals[v + l] = glm::vec3 (k[0][l], k[1][l], k[2][l]);
+}
+
+// a vertex on the border, only the triangles with all corners inside the grid
+static void border_vertex (const Heightfield &heightfield, uint32_t x, uint32_t z, glm::vec3 &out_normal, float &out_value)
+{
+	bool inside[6];
+	float dh[6];
+	for (uint32_t q = 0; q < 6; q++) {
+		const int64_t nx = int64_t (x) + RingDX[q], nz = int64_t (z) + RingDZ[q];
+		inside[q] = nx >= 0 && nx < heightfield.Width && nz >= 0 && nz < heightfield.Depth;
+		dh[q] = inside[q] ? heightfield.At (uint32_t (nx), uint32_t (nz)) - heightfield.At (x, z) : 0.0f;
+	}
+	uint32_t triangles = 0;
+	for (uint32_t t = 0; t < 6; t++)
+		if (inside[t] && inside[(t + 1)%6])
+			triangles |= 1u << t;
+	if (triangles == 0) { // grid is a single row/column
+		out_normal = glm::vec3 (0), out_value = 0;
+		return;
+	}
+	float K[3];
+	stencil_mean_curvature_normal (dh, heightfield.Spacing, triangles, K);
+	out_normal = glm::vec3 (K[0], K[1], K[2]);
+	out_value = glm::length (out_normal)*0.5f;
+}
+
+void HeightfieldMeanCurvature (const Heightfield &heightfield, std::vector<glm::vec3> &out_mean_curvature_normals, std::vector<float> &out_mean_curvature_values)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const uint32_t width = heightfield.Width, depth = heightfield.Depth;
+	out_mean_curvature_normals.resize (heightfield.VertexCount ());
+	out_mean_curvature_values.resize (heightfield.VertexCount ());
+	const float *heights = heightfield.Heights.data ();
+	glm::vec3 *normals = out_mean_curvature_normals.data ();
+	float *values = out_mean_curvature_values.data ();
+
+	JobSystem::ParallelFor (depth, rows_per_job (width), [&](size_t begin, size_t end) {
+		for (uint32_t z = uint32_t (begin); z < end; z++) {
+			const size_t row = size_t (z)*width;
+			if (z == 0 || z + 1 == depth || width < 3) {
+				for (uint32_t x = 0; x < width; x++)
+					border_vertex (heightfield, x, z, normals[row + x], values[row + x]);
+				continue;
+			}
+			border_vertex (heightfield, 0, z, normals[row], values[row]);
+			uint32_t x = 1;
+		#ifdef HEIGHTFIELD_SSE2
+			for (; x + 4 < width; x += 4)
+				interior_vertices<__m128> (heights, width, row + x, heightfield.Spacing, normals, values);
+		#endif
+			for (; x + 1 < width; x++)
+				interior_vertices<float> (heights, width, row + x, heightfield.Spacing, normals, values);
+			border_vertex (heightfield, width - 1, z, normals[row + width - 1], values[row + width - 1]);
+		}
+	});
+}
@@ -0,0 +1,32 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+namespace Helper { namespace Noise { struct NoiseSettings; } }
+
+// Regular grid displaced along Y, connectivity is implicit: sample (x, z) sits at (Origin.x + x*Spacing, Heights[z*Width + x], Origin.y + z*Spacing)
+// and every quad is split along its (x, z)-(x + 1, z + 1) diagonal, same triangles as Procedural::NoiseGrid
+struct Heightfield
+{
+	uint32_t Width = 0, Depth = 0; // samples along X and Z
+	float Spacing = 1.0f;
+	glm::vec2 Origin = glm::vec2 (0); // XZ of sample (0, 0)
+	std::vector<float> Heights;       // row major, one row per z
+
+	size_t VertexCount () const { return size_t (Width)*Depth; }
+	float At (uint32_t x, uint32_t z) const { return Heights[size_t (z)*Width + x]; }
+	glm::vec3 Position (uint32_t x, uint32_t z) const { return glm::vec3 (Origin.x + x*Spacing, At (x, z), Origin.y + z*Spacing); }
+};
+
+// width x depth samples centred on the origin, 'noise' is evaluated at world XZ (Freq is per world unit, TileX/TileY stay in samples)
+// so the same terrain comes out at any resolution, heights are noise*height_scale
+Heightfield HeightfieldFromNoise (const Helper::Noise::NoiseSettings &noise, uint32_t width, uint32_t depth, float spacing, float height_scale);
+
+// Explicit mesh for drawing or for the generic pipeline, normals from central differences, out_indices may be null
+void HeightfieldToMesh (const Heightfield &heightfield, std::vector<std::pair<glm::vec3, glm::vec3>> &out_posn_and_normals, std::vector<GLuint> *out_indices = nullptr);
+
+// Same K(Xi) and K_h = |K(Xi)|/2 as MeanCurvatureKernel gives for HeightfieldToMesh's mesh, without rings or indices:
+// the one-ring is a fixed 6 neighbour stencil, interior rows run 4 vertices at a time (SSE2), borders use the part of the stencil inside the grid.
+// Edges are built from height differences and exact XZ offsets, so fine grids come out closer to the surface than from rounded float positions
+void HeightfieldMeanCurvature (const Heightfield &heightfield, std::vector<glm::vec3> &out_mean_curvature_normals, std::vector<float> &out_mean_curvature_values);
@@ -1,279 +1,511 @@
-﻿#include <iomanip>
+﻿#include "mean_curvature.h"
+#include <iomanip>
+#include <algorithm>
 #include <limits>
 #include <glm/gtx/norm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <fstream>
 #include <mutex>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
 #include <GLCore.h>
+#include <GLCoreUtils.h>
 #include <GLCore/Core/Input.h>
 #include <Utilities/utility.h>
 using namespace GLCore;
 using namespace GLCore::Utils;
 
-bool MeanCurvatureCalculate (const char *debug_filename
-							 , const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, std::vector<glm::vec3> &curvature_diffuse_color
-							 , std::vector<glm::vec3> &mean_curvature_normals, std::vector<float> &mean_curvature_values
-							 , const std::vector<glm::vec3> &blend_betweencolors
-							 , const bool trackOutput, float *save_min_mean_curvature = nullptr, float *save_max_mean_curvature = nullptr)
+// elements handed to a job at once, vertices are cheap so keep the batches big
+constexpr size_t ParallelGrain = 1024;
+
+void BuildVertexRings (size_t vertex_count, const std::vector<GLuint> &indices, VertexRings &out_rings)
 {
-	float max_curvature = -std::numeric_limits<float>::max ();
-	float min_curvature = std::numeric_limits<float>::max ();
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t num_triangles = indices.size ()/3; // note: we are assuming model is made up of triangles, so grps of 3
 
-	std::vector<glm::vec3> array_K_Xi;
-	array_K_Xi.resize (posn_and_normals.size ());
-	std::vector<float> array_K_h; // mean curvature value
-	array_K_h.resize (posn_and_normals.size ());
+	// 1. count triangles around every vertex
+	std::unique_ptr<std::atomic<uint32_t>[]> incident (new std::atomic<uint32_t>[vertex_count]);
+	JobSystem::ParallelFor (vertex_count, ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++)
+			incident[v].store (0, std::memory_order_relaxed);
+	});
+	JobSystem::ParallelFor (num_triangles, ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t i = begin*3; i < end*3; i++)
+			if (indices[i] < vertex_count)
+				incident[indices[i]].fetch_add (1, std::memory_order_relaxed);
+	});
 
-#if MODE_DEBUG
-	const char *fn = debug_filename != nullptr ? debug_filename : "curvatureResults.txt";
-	std::ofstream ofs (fn);
-	if (ofs.bad ()) {
-		std::cout << "File creation error - " << fn << '\n';
-		__debugbreak ();
+	// 2. every vertex gets (num_triangles + 1) slots, enough for an open fan, closed fan repeats it's start instead
+	std::vector<uint32_t> fan_offsets (vertex_count + 1);
+	fan_offsets[0] = 0;
+	for (size_t v = 0; v < vertex_count; v++) {
+		fan_offsets[v + 1] = fan_offsets[v] + incident[v].load (std::memory_order_relaxed);
+		incident[v].store (0, std::memory_order_relaxed); // reused as scatter cursor
 	}
-	std::mutex mutex_ofs;
-#endif
 
-	std::mutex mutex_curvature_push, mutex_cout, sync_lock, another_sync_lock;
-	std::condition_variable barrier; std::unique_lock synced_lock (sync_lock);
-	bool first_to_reach_access_it = true;
+	// 3. scatter {next, prev} of every corner, (in anticlockwise iteration) to the corner's vertex
+	std::vector<uint32_t> fan_pairs (size_t (fan_offsets[vertex_count])*2);
+	JobSystem::ParallelFor (num_triangles, ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t grp = begin*3; grp < end*3; grp += 3) {
+			for (uint32_t i_mod_3 = 0; i_mod_3 < 3; i_mod_3++) {
+				GLuint vertex = indices[grp + i_mod_3];
+				if (vertex >= vertex_count)
+					continue;
+				size_t slot = fan_offsets[vertex] + incident[vertex].fetch_add (1, std::memory_order_relaxed);
+				fan_pairs[slot*2 + 0] = indices[grp + ((i_mod_3 + 1)%3)];
+				fan_pairs[slot*2 + 1] = indices[grp + ((i_mod_3 + 2)%3)];
+			}
+		}
+	});
+	incident.reset ();
 
-	std::atomic<size_t> vertices_processed = 0;
-	if (trackOutput)
-		std::cout << "index | A_mixed | curvature Kh |    K(Xi)\n";
-	auto mean_curvature_func = [&](const uint32_t start, const uint32_t stride) {
+	// 4. chain pairs into a fan, scatter order is non-deterministic so start is picked canonically
+	//    0-----0 - - 0 <-to_find_this
+	//          ^-is_common_vertex
+	std::vector<uint32_t> ring_capacity (fan_pairs.size ()/2 + vertex_count);
+	std::vector<uint32_t> ring_sizes (vertex_count);
+	JobSystem::ParallelFor (vertex_count, ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			uint32_t *pairs = fan_pairs.data () + size_t (fan_offsets[v])*2;
+			uint32_t *ring = ring_capacity.data () + fan_offsets[v] + v;
+			const uint32_t num_pairs = fan_offsets[v + 1] - fan_offsets[v];
+			if (num_pairs == 0) {
+				ring_sizes[v] = 0;
+				continue;
+			}
+			// open fan starts at the pair no one leads into, closed fan at it's smallest index
+			uint32_t open_start = num_pairs, closed_start = 0;
+			for (uint32_t i = 0; i < num_pairs; i++) {
+				bool has_predecessor = false;
+				for (uint32_t j = 0; j < num_pairs && !has_predecessor; j++)
+					has_predecessor = pairs[j*2 + 1] == pairs[i*2];
+				if (!has_predecessor && (open_start == num_pairs || pairs[i*2] < pairs[open_start*2]))
+					open_start = i;
+				if (pairs[i*2] < pairs[closed_start*2])
+					closed_start = i;
+			}
+			const uint32_t start = open_start < num_pairs ? open_start : closed_start;
+			std::swap (pairs[0], pairs[start*2]), std::swap (pairs[1], pairs[start*2 + 1]);
 
-		std::ostringstream cout_stream;
-	#if MODE_DEBUG
-		std::ostringstream out_stream;
-		out_stream << std::fixed << std::setprecision (8);
-	#endif
+			uint32_t size = 0;
+			ring[size++] = pairs[0];
+			ring[size++] = pairs[1];
+			for (uint32_t placed = 1; placed < num_pairs; placed++) { // forward chain extension
+				uint32_t found = num_pairs;
+				for (uint32_t j = placed; j < num_pairs; j++) {
+					if (pairs[j*2] == ring[size - 1]) { // found shared vertex
+						found = j;
+						break;
+					}
+				}
+				if (found == num_pairs) // non-manifold, rest of the pairs belong to some other fan
+					break;
+				std::swap (pairs[placed*2], pairs[found*2]), std::swap (pairs[placed*2 + 1], pairs[found*2 + 1]);
+				ring[size++] = pairs[placed*2 + 1]; // extend ring
+			}
+			ring_sizes[v] = size;
+		}
+	});
+
+	// 5. compact
+	out_rings.Offsets.resize (vertex_count + 1);
+	out_rings.Offsets[0] = 0;
+	for (size_t v = 0; v < vertex_count; v++)
+		out_rings.Offsets[v + 1] = out_rings.Offsets[v] + ring_sizes[v];
+	out_rings.Ring.resize (out_rings.Offsets[vertex_count]);
+	JobSystem::ParallelFor (vertex_count, ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++)
+			std::copy_n (ring_capacity.data () + fan_offsets[v] + v, ring_sizes[v], out_rings.Ring.data () + out_rings.Offsets[v]);
+	});
+}
+
+// K(Xi) and A_mixed of one vertex over its one-ring, K_h = |K(Xi)|/2
+static inline glm::vec3 vertex_mean_curvature_normal (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, size_t curr_indice
+													  , const uint32_t *ring, uint32_t ring_size, float &out_A_mixed)
+{
+	//      /\X
+	//     /  \
+	//   Q/____\R
+	float A_mixed = 0;
+
+	glm::vec3 sigma_mean_curvature_normal_operator = glm::vec3 (0);
+	const glm::vec3 X = posn_and_normals[curr_indice].first;
+	for (uint32_t i = 1; i < ring_size; i++) {
+		const glm::vec3 Q = posn_and_normals[ring[i-1]].first, R = posn_and_normals[ring[i]].first;
+		const glm::vec3 XQ_diff = X - Q, XR_diff = X - R;
+		// |e1 x e2| is twice the triangle's area whichever corner it's taken at, so cot(∠) = (e1.e2)/|e1 x e2|
+		const float twice_area = glm::length (glm::cross (XQ_diff, XR_diff));
+		if (twice_area <= 0) // degenerate △
+			continue;
+		const float cot_Q = glm::dot (R - Q, X - Q)/twice_area
+			, cot_R = glm::dot (Q - R, X - R)/twice_area
+			, cos_X = glm::dot (XQ_diff, XR_diff); // only sign matters
+		const float pXR2 = glm::length2 (XR_diff), pXQ2 = glm::length2 (XQ_diff);
 
-		for (size_t curr_indice = start; curr_indice < posn_and_normals.size (); curr_indice += stride, vertices_processed++) // repeat for every vertex
+		// every △ contributes to the operator, only area is split by type
+		sigma_mean_curvature_normal_operator += cot_Q*XR_diff +  cot_R*XQ_diff;
+
+		if (cot_Q >= 0 && cot_R >= 0 && cos_X >= 0) { // Non-obtuse △, voronoi region stays inside
+			float A_voronoi = (pXR2*cot_Q + pXQ2*cot_R)*0.125; // (1/8)*((X-R)^2 * cotf(∠Q)  +  (X-Q)^2 * cotf(∠R))
+			A_mixed += A_voronoi;
+		} else {
+			float Area_T = twice_area*0.5;
+			if (cos_X < 0) // obtuse at X
+				A_mixed += Area_T*0.5;
+			else
+				A_mixed += Area_T*0.25;
+		}
+	}
+	out_A_mixed = A_mixed;
+	return A_mixed > 0 ? (sigma_mean_curvature_normal_operator)*float (1.0/(2.0*A_mixed)) : glm::vec3 (0); // all △ degenerate
+}
+
+void MeanCurvatureKernel (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings
+						  , std::vector<glm::vec3> &out_mean_curvature_normals, std::vector<float> &out_mean_curvature_values
+						  , std::vector<float> *out_A_mixed)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t vertex_count = posn_and_normals.size ();
+	out_mean_curvature_normals.resize (vertex_count);
+	out_mean_curvature_values.resize (vertex_count);
+	if (out_A_mixed)
+		out_A_mixed->resize (vertex_count);
+
+	JobSystem::ParallelFor (vertex_count, ParallelGrain, [&](size_t begin, size_t end) {
+		for (size_t curr_indice = begin; curr_indice < end; curr_indice++) // repeat for every vertex
 		{
-			if (!trackOutput && curr_indice % (stride+1) == 0) {
-				mutex_cout.lock ();
-				std::cout << "\r  vertices_processed: " << vertices_processed << " out_of: " << posn_and_normals.size ();
-				mutex_cout.unlock ();
+			const uint32_t *ring = rings.RingOf (curr_indice);
+			const uint32_t ring_size = rings.RingSize (curr_indice);
+			if (ring_size == 0) {
+				glm::vec3 vec = posn_and_normals[curr_indice].first;
+				LOG_WARN_LIMITED (1000, "vertice with empty ring: {3}, [{0}, {1}, {2}]", vec.x, vec.y, vec.z, curr_indice);
+				out_mean_curvature_normals[curr_indice] = glm::vec3 (0);
+				out_mean_curvature_values[curr_indice] = 0;
+				if (out_A_mixed)
+					(*out_A_mixed)[curr_indice] = 0;
+				continue;
 			}
 
-		#if MODE_DEBUG
-			out_stream << "\nIDX: " << curr_indice << '\n';
-		#endif
-
-			glm::vec3 K_Xi = glm::vec3 (0);
-			{
-				std::vector<uint32_t> ring;
-				{
-					std::vector<uint32_t> indices_of_neighbouring_vertives; // bucket of neighboring vertices
-
-					for (size_t i = 0; i < indices.size (); i++) { // Scan for associated primitives
-						if (indices[i] == curr_indice) {
-							uint32_t i_mod_3 = (i % 3),
-								grp = i - i_mod_3;// note: we are assuming model is made up of triangles, so grps of 3
-							indices_of_neighbouring_vertives.push_back (indices[grp + ((i_mod_3 + 1)%3)]); // for anticlockwise iteration
-							indices_of_neighbouring_vertives.push_back (indices[grp + ((i_mod_3 + 2)%3)]); // for anticlockwise iteration
-						}
-					}
-					//LOG_ASSERT (indices_of_neighbouring_vertives.empty ());
-					if (indices_of_neighbouring_vertives.empty ()) {
-						glm::vec3 vec = posn_and_normals[curr_indice].first;
-						LOG_WARN ("vertice with empty ring: {3}, [{0}, {1}, {2}]", vec.x, vec.y, vec.z, curr_indice);
-						continue;
-					}
+			float A_mixed;
+			glm::vec3 K_Xi = vertex_mean_curvature_normal (posn_and_normals, curr_indice, ring, ring_size, A_mixed);
 
-					ring.push_back (indices_of_neighbouring_vertives[0]);
-					ring.push_back (indices_of_neighbouring_vertives[1]);
-					bool keep_adding = true;
-					while (keep_adding && !indices_of_neighbouring_vertives.empty ()) {
-						keep_adding = false;
-
-						// forward chain extension
-						// 0-----0 - - 0 <-to_find_this
-						//       ^-is_common_vertex
-						for (auto itr = indices_of_neighbouring_vertives.begin (); itr != indices_of_neighbouring_vertives.end (); itr += 2) { // every odd position
-							if (ring.back () == *itr) { // found shared vertex
-								ring.push_back (*(itr+1)); // extend ring
-								indices_of_neighbouring_vertives.erase (itr+1);
-								indices_of_neighbouring_vertives.erase (itr);
-								keep_adding = true;
-								break;
-							}
-						}
-						// backward chain extension
-						// to_find_this->0 - - 0-----0
-						// is_common_vertex ---^
-						for (size_t i = 1; i < indices_of_neighbouring_vertives.size (); i += 2) { // every odd position
-							if (ring.front () == indices_of_neighbouring_vertives[i]) { // found shared vertex
-								ring.insert (ring.begin (), indices_of_neighbouring_vertives[i-1]); // extend ring
-								auto itr = indices_of_neighbouring_vertives.begin () + (i-1);
-								indices_of_neighbouring_vertives.erase (itr+1);
-								indices_of_neighbouring_vertives.erase (itr);
-								keep_adding = true;
-								break;
-							}
-						}
+			out_mean_curvature_normals[curr_indice] = K_Xi;
+			out_mean_curvature_values[curr_indice] = glm::length (K_Xi)*0.5;
+			if (out_A_mixed)
+				(*out_A_mixed)[curr_indice] = A_mixed;
+		}
+	});
+}
 
-					}
-				}
+float MeanCurvatureAtVertex (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings, size_t vertex
+							 , glm::vec3 &out_mean_curvature_normal, float &out_A_mixed)
+{
+	out_mean_curvature_normal = vertex_mean_curvature_normal (posn_and_normals, vertex, rings.RingOf (vertex), rings.RingSize (vertex), out_A_mixed);
+	return glm::length (out_mean_curvature_normal)*0.5f;
+}
 
+// Vertices a BFS has reached, keys stamped with the generation of the search so clearing is free. Sized by the
+// neighbourhood instead of the mesh, one per job is reused for all of its vertices.
+class VisitedSet
+{
+public:
+	void Clear ()
+	{
+		m_Size = 0;
+		if (++m_Generation == 0) { // wrapped, stale stamps could match again
+			std::fill (m_Stamps.begin (), m_Stamps.end (), 0);
+			m_Generation = 1;
+		}
+	}
+	// false when already there
+	bool Insert (uint32_t key)
+	{
+		if ((m_Size + 1)*2 > m_Keys.size ())
+			grow ();
+		const size_t mask = m_Keys.size () - 1;
+		for (size_t slot = (key*0x9E3779B1u) & mask;; slot = (slot + 1) & mask) {
+			if (m_Stamps[slot] != m_Generation) {
+				m_Keys[slot] = key, m_Stamps[slot] = m_Generation;
+				m_Size++;
+				return true;
+			}
+			if (m_Keys[slot] == key)
+				return false;
+		}
+	}
+private:
+	void grow ()
+	{
+		std::vector<uint32_t> keys, stamps;
+		keys.swap (m_Keys), stamps.swap (m_Stamps);
+		const uint32_t generation = m_Generation;
+		m_Keys.resize (MAX (keys.size ()*2, size_t (256)));
+		m_Stamps.assign (m_Keys.size (), 0);
+		m_Generation = 1, m_Size = 0;
+		for (size_t i = 0; i < keys.size (); i++)
+			if (stamps[i] == generation)
+				Insert (keys[i]);
+	}
+private:
+	std::vector<uint32_t> m_Keys, m_Stamps;
+	uint32_t m_Generation = 1;
+	size_t m_Size = 0;
+};
 
-			#if MODE_DEBUG
-				out_stream << "RING[i] {index, coordinate}:\n";
-				for (auto val : ring)
-					out_stream << ' ' << '{' << std::setw (5) << val << ' ' << posn_and_normals[val].first << '}' << '\n';
-			#endif
-
-				auto angle_between_edges = [&](uint32_t curr_vertex_index, uint32_t other1_vertex_index, uint32_t other2_vertex_index) -> float {
-					glm::vec3 edge1 = glm::normalize (posn_and_normals[other1_vertex_index].first - posn_and_normals[curr_vertex_index].first);
-					glm::vec3 edge2 = glm::normalize (posn_and_normals[other2_vertex_index].first - posn_and_normals[curr_vertex_index].first);
-					float e1e2sin_theta = glm::length (glm::cross (edge1, edge2));
-					return asinf (MIN (1.0, e1e2sin_theta));
-				};
-				auto cotf = [](float angle_in_rad) -> float { return (angle_in_rad < glm::half_pi<float> ()) ? tanf (glm::half_pi<float> () - angle_in_rad) : -tanf (angle_in_rad - glm::half_pi<float> ()); };
-				auto sqr = [](float val) -> float { return val*val; };
-				//      /\X
-				//     /  \
-				//   Q/____\R
-				float A_mixed = 0;
-			
-				glm::vec3 sigma_mean_curvature_normal_operator = glm::vec3 (0);
-				for (uint32_t i = 1; i < ring.size (); i++) {
-					float Q = angle_between_edges (ring[i-1], ring[i], curr_indice)
-						, R = angle_between_edges (ring[i], curr_indice, ring[i-1])
-						, X = angle_between_edges (curr_indice, ring[i], ring[i-1]);
-					float pXR2, pXQ2, cot_Q, cot_R;
-					glm::vec3 XR_diff, XQ_diff;
-					{
-						XQ_diff = posn_and_normals[curr_indice].first - posn_and_normals[ring[i-1]].first;
-						XR_diff = posn_and_normals[curr_indice].first - posn_and_normals[ring[i]].first;
-						cot_Q = cotf (Q), cot_R = cotf (R);
-						pXR2 = glm::length2 (XR_diff), pXQ2 = glm::length2 (XQ_diff), cot_Q, cot_R;
-					}
+float MeanCurvatureMultiScale (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings
+							   , const std::vector<glm::vec3> &mean_curvature_normals, const std::vector<float> &A_mixed, const MultiScaleCurvatureSettings &settings
+							   , std::vector<std::vector<glm::vec3>> &out_mean_curvature_normals, std::vector<std::vector<float>> &out_mean_curvature_values)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t vertex_count = posn_and_normals.size ();
+	const size_t scale_count = MIN (settings.Scales.size (), size_t (MultiScaleCurvatureSettings::MaxScales));
+	out_mean_curvature_normals.resize (scale_count);
+	out_mean_curvature_values.resize (scale_count);
+	for (size_t s = 0; s < scale_count; s++)
+		out_mean_curvature_normals[s].resize (vertex_count), out_mean_curvature_values[s].resize (vertex_count);
+	if (scale_count == 0 || vertex_count == 0)
+		return 0;
 
-					if (Q < glm::half_pi<float> () && R < glm::half_pi<float> () && X < glm::half_pi<float> ()) { // Acute △
-						
-						float A_voronoi = (pXR2*cot_Q + pXQ2*cot_R)*0.125; // (1/8)*((X-R)^2 * cotf(∠Q)  +  (X-Q)^2 * cotf(∠R))
-						
-						A_mixed += A_voronoi;
-
-						glm::vec3 mean_curvature_normal_operator_for_curr_tri
-							= cot_Q*XR_diff +  cot_R*XQ_diff;
-
-					#if MODE_DEBUG
-						out_stream << "{Q,R}[" << Q <<' '<< R << "] vor:" << A_voronoi << '\n';
-					#endif
-						
-						sigma_mean_curvature_normal_operator += mean_curvature_normal_operator_for_curr_tri;
-					
-					} else {
-						float Area_T = (pXR2*cot_Q/sqr (sinf (R)) + pXQ2*cot_R/sqr (sinf (Q)))*0.5;
-						if (X >= glm::half_pi<float> ()) {
-							float val = Area_T*0.5;
-							A_mixed += val;
-						#if MODE_DEBUG
-							out_stream << "T/2:" << val << '\n';
-						#endif
-						} else {
-							float val = Area_T*0.25;
-							A_mixed += val;
-						#if MODE_DEBUG
-							out_stream << "T/4:" << val << '\n';
-						#endif
-						}
-					}
+	// integrated operator per vertex, what the neighbourhoods sum up
+	std::vector<glm::vec3> integrated (vertex_count);
+	double edge_length_sum = 0;
+	size_t edge_count = 0;
+	std::mutex mutex_merge;
+	JobSystem::ParallelFor (vertex_count, ParallelGrain, [&](size_t begin, size_t end) {
+		double local_length = 0;
+		size_t local_count = 0;
+		for (size_t v = begin; v < end; v++) {
+			integrated[v] = A_mixed[v]*mean_curvature_normals[v];
+			const uint32_t *ring = rings.RingOf (v);
+			uint32_t ring_size = rings.RingSize (v);
+			if (ring_size > 1 && ring[0] == ring[ring_size - 1]) // closed fan repeats its start
+				ring_size--;
+			for (uint32_t i = 0; i < ring_size; i++)
+				local_length += glm::length (posn_and_normals[ring[i]].first - posn_and_normals[v].first);
+			local_count += ring_size;
+		}
+		std::lock_guard lock (mutex_merge);
+		edge_length_sum += local_length, edge_count += local_count;
+	});
+	const float mean_edge_length = edge_count ? float (edge_length_sum/edge_count) : 0.0f;
 
-				}
-				K_Xi = (sigma_mean_curvature_normal_operator)*float (1.0/(2.0*A_mixed));
+	// scales as a metric the BFS compares against: ring count, or squared (Euclidean) distance to the centre
+	const bool by_radius = settings.Neighbourhood == CurvatureNeighbourhood::Radius;
+	float limits[MultiScaleCurvatureSettings::MaxScales], max_limit = 0;
+	for (size_t s = 0; s < scale_count; s++) {
+		const float scale = MAX (settings.Scales[s], 0.0f);
+		limits[s] = by_radius ? (scale*mean_edge_length)*(scale*mean_edge_length) : std::floor (scale);
+		max_limit = MAX (max_limit, limits[s]);
+	}
+
+	JobSystem::ParallelFor (vertex_count, ParallelGrain/4, [&](size_t begin, size_t end) {
+		VisitedSet visited;
+		std::vector<uint32_t> frontier, next_frontier;
+		for (size_t v = begin; v < end; v++) {
+			glm::vec3 sum_integrated[MultiScaleCurvatureSettings::MaxScales];
+			float sum_area[MultiScaleCurvatureSettings::MaxScales];
+			for (size_t s = 0; s < scale_count; s++)
+				sum_integrated[s] = glm::vec3 (0), sum_area[s] = 0;
+			auto gather = [&](uint32_t u, float metric) {
+				for (size_t s = 0; s < scale_count; s++)
+					if (metric <= limits[s])
+						sum_integrated[s] += integrated[u], sum_area[s] += A_mixed[u];
+			};
 
-				if (trackOutput) {
-					cout_stream << std::setw (4) << curr_indice << ' ' << A_mixed << ' ';
+			const glm::vec3 center = posn_and_normals[v].first;
+			visited.Clear ();
+			visited.Insert (uint32_t (v));
+			gather (uint32_t (v), 0);
+			frontier.assign (1, uint32_t (v));
+			// one frontier (ring) at a time, a radius neighbourhood stops growing once a frontier is entirely outside
+			for (uint32_t ring = 1; !frontier.empty () && (by_radius || ring <= max_limit); ring++) {
+				next_frontier.clear ();
+				for (const uint32_t u : frontier) {
+					const uint32_t *neighbours = rings.RingOf (u);
+					for (uint32_t i = 0; i < rings.RingSize (u); i++) {
+						const uint32_t w = neighbours[i];
+						if (!visited.Insert (w))
+							continue;
+						const float metric = by_radius ? glm::length2 (posn_and_normals[w].first - center) : float (ring);
+						if (metric > max_limit)
+							continue;
+						gather (w, metric);
+						next_frontier.push_back (w);
+					}
 				}
-			#if MODE_DEBUG
-				out_stream << "A_mixed: " << A_mixed;
-			#endif
+				std::swap (frontier, next_frontier);
 			}
-			float K_h = glm::length (K_Xi)*0.5;
-
-			mutex_curvature_push.lock ();
-			array_K_Xi[curr_indice] = K_Xi;
-			array_K_h[curr_indice] = K_h;
-			max_curvature = MAX (K_h, max_curvature);
-			min_curvature = MIN (K_h, min_curvature);
-			mutex_curvature_push.unlock ();
-			if (trackOutput)
-				cout_stream << K_h << ' ' << K_Xi << '\n';
-
-		#if MODE_DEBUG
-			out_stream << " mean_curvature: " << K_h << " K(Xi) " << K_Xi << "\ncurrvertex: " << posn_and_normals[curr_indice].first << " normal: " << posn_and_normals[curr_indice].second << '\n';
-		#endif
-		}
-		{ // brain blown away
-			barrier.notify_all ();
-			another_sync_lock.lock ();
-			if (vertices_processed < posn_and_normals.size ()) { // not changing the owner thread, other threads skips it
-				barrier.wait (synced_lock, [&] { return vertices_processed >= posn_and_normals.size (); });
-				if (!trackOutput)
-					std::cout << "\r  vertices_processed: " << vertices_processed << " out_of: " << posn_and_normals.size () << '\n';
-				else
-					std::cout << "\nresulting mean_curvatures{max: " << max_curvature << ", min: " << min_curvature << "}\n\n";
-				synced_lock.unlock ();
+
+			for (size_t s = 0; s < scale_count; s++) {
+				const glm::vec3 K_Xi = sum_area[s] > 0 ? sum_integrated[s]/sum_area[s] : glm::vec3 (0);
+				out_mean_curvature_normals[s][v] = K_Xi;
+				out_mean_curvature_values[s][v] = glm::length (K_Xi)*0.5f;
 			}
-			std::cout << cout_stream.str ();
-			another_sync_lock.unlock ();
 		}
+	});
+	return mean_edge_length;
+}
 
-		float min_max_curvature_diff = (max_curvature - min_curvature);
-	#if MODE_DEBUG
+template<typename ValidFn>
+static MeanCurvatureStatistics compute_statistics (const std::vector<float> &mean_curvature_values, ValidFn valid_value)
+{
+	float max_curvature = -std::numeric_limits<float>::max ();
+	float min_curvature = std::numeric_limits<float>::max ();
+	double sum = 0, sum_of_squares = 0;
+	size_t valid = 0;
+	std::mutex mutex_merge;
 
-		mutex_ofs.lock ();
-		if (first_to_reach_access_it) {
-			ofs << "mean_curvatures{max: " << max_curvature << ", min: " << min_curvature << "}\n\n";
-			first_to_reach_access_it = false;
+	JobSystem::ParallelFor (mean_curvature_values.size (), ParallelGrain*16, [&](size_t begin, size_t end) {
+		float local_max = -std::numeric_limits<float>::max ();
+		float local_min = std::numeric_limits<float>::max ();
+		double local_sum = 0, local_sum_of_squares = 0;
+		size_t local_valid = 0;
+		for (size_t i = begin; i < end; i++) {
+			if (!valid_value (i))
+				continue;
+			float K_h = mean_curvature_values[i];
+			local_max = MAX (K_h, local_max);
+			local_min = MIN (K_h, local_min);
+			local_sum += K_h, local_sum_of_squares += double (K_h)*K_h;
+			local_valid++;
 		}
-		ofs << out_stream.str ();
-		mutex_ofs.unlock ();
-	#endif
-
-		//for (size_t i = start; i < array_K_Xi.size (); i += stride) {
-		//	curvature_diffuse_color[i] = -glm::normalize(array_K_Xi[i]);
-		//}
-		auto blend = [](float ratio, const std::vector<glm::vec3> &blend_between) -> glm::vec3 {
-			ratio *= (blend_between.size () - 1);
-			float low_contri = std::floor (ratio);
-			float high_contri = std::ceil (ratio);
-			int low = low_contri;
-			int high = high_contri;
-			return low_contri*blend_between[low] + high_contri*blend_between[high];
-		};
-		for (size_t i = start; i < array_K_Xi.size (); i += stride) {
-			float ratio = array_K_h[i];
-			ratio -= min_curvature;
-			ratio /= min_max_curvature_diff;
-
-			curvature_diffuse_color[i] = blend (ratio, blend_betweencolors);
-		};
+		std::lock_guard lock (mutex_merge);
+		max_curvature = MAX (local_max, max_curvature);
+		min_curvature = MIN (local_min, min_curvature);
+		sum += local_sum, sum_of_squares += local_sum_of_squares;
+		valid += local_valid;
+	});
+
+	MeanCurvatureStatistics stats;
+	stats.ValidVertices = valid;
+	if (valid > 0) { // the +-FLT_MAX seeds would leak into ranges, slider limits and color mapping
+		stats.Min = min_curvature, stats.Max = max_curvature;
+		double mean = sum/valid;
+		stats.Mean = float (mean);
+		stats.StdDev = float (std::sqrt (MAX (0.0, sum_of_squares/valid - mean*mean)));
+	}
+	return stats;
+}
+MeanCurvatureStatistics MeanCurvatureComputeStatistics (const std::vector<float> &mean_curvature_values, const VertexRings &rings)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	return compute_statistics (mean_curvature_values, [&](size_t i) { return rings.RingSize (i) != 0; }); // empty rings never got a value
+}
+MeanCurvatureStatistics MeanCurvatureComputeStatistics (const std::vector<float> &mean_curvature_values)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	return compute_statistics (mean_curvature_values, [](size_t) { return true; });
+}
+
+void MeanCurvatureColorMap (const std::vector<float> &mean_curvature_values, float min_mean_curvature, float max_mean_curvature
+							, const std::vector<glm::vec3> &blend_betweencolors, CurvatureColorOutput out_colors)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const float min_max_curvature_diff = (max_mean_curvature - min_mean_curvature);
+
+	auto blend = [](float ratio, const std::vector<glm::vec3> &blend_between) -> glm::vec3 {
+		ratio *= (blend_between.size () - 1);
+		int low = int (std::floor (ratio));
+		int high = int (std::ceil (ratio));
+		return glm::mix (blend_between[low], blend_between[high], ratio - low);
 	};
-#define USE_MT 1
-#if USE_MT
-	std::vector<std::thread> threads;
-	threads.reserve (std::thread::hardware_concurrency () - 1);
-	for (uint32_t i = 1; i < std::thread::hardware_concurrency (); i++)
-		threads.push_back (std::thread (mean_curvature_func, i, std::thread::hardware_concurrency ()));
-	mean_curvature_func (0, std::thread::hardware_concurrency ());
-	for (std::thread &ref : threads)
-		ref.join ();
+	JobSystem::ParallelFor (mean_curvature_values.size (), ParallelGrain*4, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			float ratio = mean_curvature_values[i];
+			ratio -= min_mean_curvature;
+			ratio = min_max_curvature_diff > 0 ? ratio/min_max_curvature_diff : 0.0f;
+			ratio = glm::clamp (ratio, 0.0f, 1.0f);
+
+			switch (out_colors.Format) {
+				case ColorFormat::FLOAT3:
+					((glm::vec3 *)out_colors.Data)[i] = blend (ratio, blend_betweencolors); break;
+				case ColorFormat::UNORM8:
+					((uint32_t *)out_colors.Data)[i] = glm::packUnorm4x8 (glm::vec4 (blend (ratio, blend_betweencolors), 1.0f)); break;
+				case ColorFormat::HALF_SCALAR:
+					((uint16_t *)out_colors.Data)[i] = glm::packHalf1x16 (ratio); break;
+			}
+		}
+	});
+}
+
+bool MeanCurvatureCalculate (const char *debug_filename
+							 , const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, CurvatureColorOutput curvature_diffuse_color
+							 , std::vector<glm::vec3> &mean_curvature_normals, std::vector<float> &mean_curvature_values
+							 , const std::vector<glm::vec3> &blend_betweencolors
+							 , const bool trackOutput, float *save_min_mean_curvature, float *save_max_mean_curvature
+							 , MeanCurvaturePhaseTimings *save_timings)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	using clock = std::chrono::steady_clock;
+	auto elapsed_ms = [](clock::time_point since) { return std::chrono::duration<double, std::milli> (clock::now () - since).count (); };
+	MeanCurvaturePhaseTimings timings;
+
+	auto phase_start = clock::now ();
+	VertexRings rings;
+	BuildVertexRings (posn_and_normals.size (), indices, rings);
+	timings.Adjacency = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	std::vector<float> array_A_mixed;
+#if MODE_DEBUG
+	constexpr bool keep_A_mixed = true;
 #else
-	mean_curvature_func (0, 1);
+	const bool keep_A_mixed = trackOutput;
 #endif
+	MeanCurvatureKernel (posn_and_normals, rings, mean_curvature_normals, mean_curvature_values, keep_A_mixed ? &array_A_mixed : nullptr);
+	timings.Kernel = elapsed_ms (phase_start);
+
+	phase_start = clock::now ();
+	MeanCurvatureStatistics stats = MeanCurvatureComputeStatistics (mean_curvature_values, rings);
+	timings.Statistics = elapsed_ms (phase_start);
+	if (stats.ValidVertices == 0)
+		LOG_WARN ("MeanCurvatureCalculate: no vertex has a one-ring, every value is 0");
+
+	phase_start = clock::now ();
+	MeanCurvatureColorMap (mean_curvature_values, stats.Min, stats.Max, blend_betweencolors, curvature_diffuse_color);
+	timings.ColorMapping = elapsed_ms (phase_start);
+
+	if (trackOutput) {
+		std::ostringstream cout_stream;
+		cout_stream << "index | A_mixed | curvature Kh |    K(Xi)\n";
+		for (size_t i = 0; i < posn_and_normals.size (); i++)
+			if (rings.RingSize (i) > 0)
+				cout_stream << std::setw (4) << i << ' ' << array_A_mixed[i] << ' ' << mean_curvature_values[i] << ' ' << mean_curvature_normals[i] << '\n';
+		cout_stream << "\nresulting mean_curvatures{max: " << stats.Max << ", min: " << stats.Min << "}\n\n";
+		std::cout << cout_stream.str ();
+	} else {
+		std::cout << "\r  vertices_processed: " << posn_and_normals.size () << " out_of: " << posn_and_normals.size ()
+			<< " {adjacency: " << timings.Adjacency << "ms, kernel: " << timings.Kernel << "ms}\n";
+	}
+
 #if MODE_DEBUG
-	ofs.close ();
+	{
+		const char *fn = debug_filename != nullptr && debug_filename[0] != '\0' ? debug_filename : "curvatureResults.txt";
+		std::ofstream ofs (fn);
+		if (ofs.bad ()) {
+			LOG_ERROR ("File creation error - {0}", fn);
+			GLCORE_DEBUGBREAK ();
+		}
+		ofs << std::fixed << std::setprecision (8);
+		ofs << "mean_curvatures{max: " << stats.Max << ", min: " << stats.Min << "}\n\n";
+		for (size_t curr_indice = 0; curr_indice < posn_and_normals.size (); curr_indice++) {
+			ofs << "\nIDX: " << curr_indice << '\n';
+			ofs << "RING[i] {index, coordinate}:\n";
+			for (uint32_t i = 0; i < rings.RingSize (curr_indice); i++) {
+				uint32_t val = rings.RingOf (curr_indice)[i];
+				ofs << ' ' << '{' << std::setw (5) << val << ' ' << posn_and_normals[val].first << '}' << '\n';
+			}
+			ofs << "A_mixed: " << array_A_mixed[curr_indice];
+			ofs << " mean_curvature: " << mean_curvature_values[curr_indice] << " K(Xi) " << mean_curvature_normals[curr_indice] << "\ncurrvertex: " << posn_and_normals[curr_indice].first << " normal: " << posn_and_normals[curr_indice].second << '\n';
+		}
+	}
 #endif
-	mean_curvature_normals = std::move (array_K_Xi), mean_curvature_values = std::move (array_K_h);
-	if (save_min_mean_curvature)
-		*save_min_mean_curvature = min_curvature;
+
 	if (save_min_mean_curvature)
-		*save_max_mean_curvature = max_curvature;
+		*save_min_mean_curvature = stats.Min;
+	if (save_max_mean_curvature)
+		*save_max_mean_curvature = stats.Max;
+	if (save_timings)
+		*save_timings = timings;
 	return true;
-}
\ No newline at end of file
+}
@@ -1,6 +1,102 @@
-﻿
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+#include "mesh_formats.h"
+
+// One-ring of every vertex in CSR layout, Ring[Offsets[v] .. Offsets[v+1]) are neighbours of v in fan order,
+// i.e. {ring[i-1], ring[i], v} is a triangle around v (a closed fan repeats its first vertex at the end)
+struct VertexRings
+{
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Ring;
+
+	size_t VertexCount () const { return Offsets.empty () ? 0 : Offsets.size () - 1; }
+	uint32_t RingSize (size_t vertex) const { return Offsets[vertex + 1] - Offsets[vertex]; }
+	const uint32_t *RingOf (size_t vertex) const { return Ring.data () + Offsets[vertex]; }
+};
+
+struct MeanCurvatureStatistics
+{
+	float Min = 0, Max = 0, Mean = 0, StdDev = 0; // all 0 when ValidVertices is 0
+	size_t ValidVertices = 0; // vertices with a non-empty ring
+};
+
+// Where MeanCurvatureColorMap writes, one entry of Format per vertex, may point straight into mapped GL memory
+struct CurvatureColorOutput
+{
+	CurvatureColorOutput (glm::vec3 *colors) : Data (colors), Format (ColorFormat::FLOAT3) {}
+	CurvatureColorOutput (void *data, ColorFormat format) : Data (data), Format (format) {}
+
+	void *Data;
+	ColorFormat Format;
+};
+
+// wall-clock milli-seconds spent in each phase of MeanCurvatureCalculate
+struct MeanCurvaturePhaseTimings
+{
+	double Adjacency = 0, Kernel = 0, Statistics = 0, ColorMapping = 0;
+};
+
+// Phases, each one runs in parallel over GLCore::Utils::JobSystem
+void BuildVertexRings (size_t vertex_count, const std::vector<GLuint> &indices, VertexRings &out_rings);
+void MeanCurvatureKernel (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings
+						  , std::vector<glm::vec3> &out_mean_curvature_normals, std::vector<float> &out_mean_curvature_values
+						  , std::vector<float> *out_A_mixed = nullptr);
+// Same as the kernel for a single vertex (returns K_h), for inspecting values without keeping per vertex A_mixed around
+float MeanCurvatureAtVertex (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings, size_t vertex
+							 , glm::vec3 &out_mean_curvature_normal, float &out_A_mixed);
+
+// Curvature over neighbourhoods wider than the one-ring, for noisy scans: the integrated operator A_mixed*K(Xi) of every vertex
+// in reach is summed and divided by their total area. Noise cancels across the neighbourhood, bumps smaller than it fade.
+enum class CurvatureNeighbourhood
+{
+	Rings, // vertices at most Scale edges away (0 = the one-ring estimate itself)
+	Radius // vertices within Scale mean edge lengths, reached through vertices that are within it too. The distance is the
+	       // Euclidean one to the centre, not geodesic: connectivity keeps the other side of a thin part out, but a fold back
+	       // within reach still counts
+};
+struct MultiScaleCurvatureSettings
+{
+	CurvatureNeighbourhood Neighbourhood = CurvatureNeighbourhood::Rings;
+	std::vector<float> Scales = { 0, 1, 2, 4 };
+
+	static constexpr uint32_t MaxScales = 8;
+};
+// One BFS per vertex out to the largest scale feeds every scale at once, out_*[s] holds the results of Scales[s].
+// Needs the kernel's K(Xi) and A_mixed, returns the mean edge length Radius scales are measured in.
+float MeanCurvatureMultiScale (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings
+							   , const std::vector<glm::vec3> &mean_curvature_normals, const std::vector<float> &A_mixed, const MultiScaleCurvatureSettings &settings
+							   , std::vector<std::vector<glm::vec3>> &out_mean_curvature_normals, std::vector<std::vector<float>> &out_mean_curvature_values);
+
+MeanCurvatureStatistics MeanCurvatureComputeStatistics (const std::vector<float> &mean_curvature_values, const VertexRings &rings);
+// Every value counts (results without one-rings, point clouds)
+MeanCurvatureStatistics MeanCurvatureComputeStatistics (const std::vector<float> &mean_curvature_values);
+// out_colors must hold mean_curvature_values.size () entries, HALF_SCALAR stores the normalized value and skips blending
+void MeanCurvatureColorMap (const std::vector<float> &mean_curvature_values, float min_mean_curvature, float max_mean_curvature
+							, const std::vector<glm::vec3> &blend_betweencolors, CurvatureColorOutput out_colors);
+inline void MeanCurvatureColorMap (const std::vector<float> &mean_curvature_values, float min_mean_curvature, float max_mean_curvature
+								   , const std::vector<glm::vec3> &blend_betweencolors, std::vector<glm::vec3> &out_colors)
+{
+	out_colors.resize (mean_curvature_values.size ());
+	MeanCurvatureColorMap (mean_curvature_values, min_mean_curvature, max_mean_curvature, blend_betweencolors, out_colors.data ());
+}
+
+// curvature_diffuse_color must hold posn_and_normals.size () entries
 bool MeanCurvatureCalculate (const char *debug_filename
-							 , const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, std::vector<glm::vec3> &curvature_diffuse_color
+							 , const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, CurvatureColorOutput curvature_diffuse_color
 							 , std::vector<glm::vec3> &mean_curvature_normals, std::vector<float> &mean_curvature_values
 							 , const std::vector<glm::vec3> &blend_betweencolors
-							 , const bool trackOutput = true, float *save_min_mean_curvature = nullptr, float *save_max_mean_curvature = nullptr);
\ No newline at end of file
+							 , const bool trackOutput = true, float *save_min_mean_curvature = nullptr, float *save_max_mean_curvature = nullptr
+							 , MeanCurvaturePhaseTimings *save_timings = nullptr);
+inline bool MeanCurvatureCalculate (const char *debug_filename
+									, const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, std::vector<glm::vec3> &curvature_diffuse_color
+									, std::vector<glm::vec3> &mean_curvature_normals, std::vector<float> &mean_curvature_values
+									, const std::vector<glm::vec3> &blend_betweencolors
+									, const bool trackOutput = true, float *save_min_mean_curvature = nullptr, float *save_max_mean_curvature = nullptr
+									, MeanCurvaturePhaseTimings *save_timings = nullptr)
+{
+	curvature_diffuse_color.resize (posn_and_normals.size ());
+	return MeanCurvatureCalculate (debug_filename, posn_and_normals, indices, curvature_diffuse_color.data (), mean_curvature_normals, mean_curvature_values
+								   , blend_betweencolors, trackOutput, save_min_mean_curvature, save_max_mean_curvature, save_timings);
+}
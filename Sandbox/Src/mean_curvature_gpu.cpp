@@ -0,0 +1,478 @@
+﻿#include "mean_curvature_gpu.h"
+#include <GLCore.h>
+#include <Utilities/utility.h>
+#include <cfloat>
+#include <cmath>
+
+// Buffer bindings shared by both programs
+enum SSBO_BINDING : GLuint
+{
+	POSN_AND_NORMALS = 0, // float positions as 32-bit words, mesh VBO or m_PositionsSSBO (std430 would pad a vec3[])
+	RING_OFFSETS,
+	RING,
+	VALUES,               // K_h
+	NORMALS,              // K(Xi)
+	MIN_MAX,              // K_h min/max as uint bits (K_h >= 0, so float order == uint order)
+	BLEND_COLORS,
+	COLORS,               // mesh color VBO as 32-bit words, any ColorFormat
+	PARENT_VALUES,        // LOD averaging: previous level (K_h for level 1), children come through RING_OFFSETS/RING
+	PARENT_WEIGHTS,
+	WEIGHTS
+};
+constexpr GLuint WorkGroupSize = 64;
+constexpr GLuint MaxWorkGroups = 65535; // minimum GL guarantees for x, shaders loop over the rest
+
+static const char *s_KernelShader = R"(
+#version 440 core
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 0) readonly buffer PosnAndNormals { uint b_PosnAndNormals[]; };
+layout (std430, binding = 1) readonly buffer RingOffsets { uint b_RingOffsets[]; };
+layout (std430, binding = 2) readonly buffer Ring { uint b_Ring[]; };
+layout (std430, binding = 3) writeonly buffer Values { float b_Values[]; };
+layout (std430, binding = 4) writeonly buffer Normals { float b_Normals[]; };
+layout (std430, binding = 5) buffer MinMax { uint b_MinMax[2]; };
+
+layout (location = 0) uniform uint u_VertexCount;
+layout (location = 1) uniform uint u_VertexStride; // in 32-bit words
+
+vec3 Position (uint vertex)
+{
+	const uint base = vertex*u_VertexStride;
+	return uintBitsToFloat (uvec3 (b_PosnAndNormals[base + 0], b_PosnAndNormals[base + 1], b_PosnAndNormals[base + 2]));
+}
+
+// same operator as MeanCurvatureKernel (mean_curvature.cpp), keep them in sync
+void main ()
+{
+	const uint stride = gl_NumWorkGroups.x*gl_WorkGroupSize.x;
+	for (uint curr = gl_GlobalInvocationID.x; curr < u_VertexCount; curr += stride) {
+		const uint ring_begin = b_RingOffsets[curr], ring_end = b_RingOffsets[curr + 1];
+		const vec3 X = Position (curr);
+
+		float A_mixed = 0;
+		vec3 sigma_mean_curvature_normal_operator = vec3 (0);
+		for (uint i = ring_begin + 1; i < ring_end; i++) {
+			const vec3 Q = Position (b_Ring[i - 1]), R = Position (b_Ring[i]);
+			const vec3 XQ_diff = X - Q, XR_diff = X - R;
+			const float twice_area = length (cross (XQ_diff, XR_diff));
+			if (twice_area <= 0)
+				continue;
+			const float cot_Q = dot (R - Q, X - Q)/twice_area
+				, cot_R = dot (Q - R, X - R)/twice_area
+				, cos_X = dot (XQ_diff, XR_diff);
+
+			sigma_mean_curvature_normal_operator += cot_Q*XR_diff + cot_R*XQ_diff;
+
+			if (cot_Q >= 0 && cot_R >= 0 && cos_X >= 0)
+				A_mixed += (dot (XR_diff, XR_diff)*cot_Q + dot (XQ_diff, XQ_diff)*cot_R)*0.125;
+			else
+				A_mixed += twice_area*(cos_X < 0 ? 0.25 : 0.125);
+		}
+		const vec3 K_Xi = A_mixed > 0 ? sigma_mean_curvature_normal_operator/(2.0*A_mixed) : vec3 (0);
+		const float K_h = length (K_Xi)*0.5;
+
+		b_Values[curr] = K_h;
+		b_Normals[curr*3 + 0] = K_Xi.x, b_Normals[curr*3 + 1] = K_Xi.y, b_Normals[curr*3 + 2] = K_Xi.z;
+		if (ring_end > ring_begin) {
+			atomicMin (b_MinMax[0], floatBitsToUint (K_h));
+			atomicMax (b_MinMax[1], floatBitsToUint (K_h));
+		}
+	}
+})";
+
+static const char *s_ColorShader = R"(
+#version 440 core
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 3) readonly buffer Values { float b_Values[]; };
+layout (std430, binding = 5) readonly buffer MinMax { uint b_MinMax[2]; };
+layout (std430, binding = 6) readonly buffer BlendColors { float b_BlendColors[]; };
+layout (std430, binding = 7) writeonly buffer Colors { uint b_Colors[]; };
+
+layout (location = 0) uniform uint u_VertexCount;
+layout (location = 1) uniform uint u_BlendColorCount;
+layout (location = 2) uniform uint u_ColorFormat; // ColorFormat (mesh_formats.h)
+
+vec3 BlendColor (uint i)
+{
+	return vec3 (b_BlendColors[i*3 + 0], b_BlendColors[i*3 + 1], b_BlendColors[i*3 + 2]);
+}
+
+float Ratio (uint vertex)
+{
+	const float min_mean_curvature = uintBitsToFloat (b_MinMax[0]);
+	const float min_max_curvature_diff = uintBitsToFloat (b_MinMax[1]) - min_mean_curvature;
+	const float ratio = b_Values[vertex] - min_mean_curvature;
+	return clamp (min_max_curvature_diff > 0 ? ratio/min_max_curvature_diff : 0.0, 0.0, 1.0);
+}
+
+// same mapping as MeanCurvatureColorMap (mean_curvature.cpp)
+void main ()
+{
+	const uint stride = gl_NumWorkGroups.x*gl_WorkGroupSize.x;
+	if (u_ColorFormat == 2) { // HALF_SCALAR, two vertices share a word
+		for (uint pair = gl_GlobalInvocationID.x; pair < (u_VertexCount + 1)/2; pair += stride)
+			b_Colors[pair] = packHalf2x16 (vec2 (Ratio (pair*2), pair*2 + 1 < u_VertexCount ? Ratio (pair*2 + 1) : 0.0));
+		return;
+	}
+	for (uint curr = gl_GlobalInvocationID.x; curr < u_VertexCount; curr += stride) {
+		const float ratio = Ratio (curr)*float (u_BlendColorCount - 1);
+		const uint low = uint (floor (ratio)), high = uint (ceil (ratio));
+		const vec3 color = mix (BlendColor (low), BlendColor (high), ratio - float (low));
+		if (u_ColorFormat == 1) // UNORM8
+			b_Colors[curr] = packUnorm4x8 (vec4 (color, 1.0));
+		else b_Colors[curr*3 + 0] = floatBitsToUint (color.x), b_Colors[curr*3 + 1] = floatBitsToUint (color.y), b_Colors[curr*3 + 2] = floatBitsToUint (color.z);
+	}
+})";
+
+// one level of AverageFullToLOD (mesh_lod.cpp) as a gather, every vertex sums the previous level's vertices merged into it
+static const char *s_LODAverageShader = R"(
+#version 440 core
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 1) readonly buffer ChildOffsets { uint b_ChildOffsets[]; };
+layout (std430, binding = 2) readonly buffer Children { uint b_Children[]; };
+layout (std430, binding = 3) writeonly buffer Values { float b_Values[]; };
+layout (std430, binding = 8) readonly buffer ParentValues { float b_ParentValues[]; };
+layout (std430, binding = 9) readonly buffer ParentWeights { uint b_ParentWeights[]; };
+layout (std430, binding = 10) writeonly buffer Weights { uint b_Weights[]; };
+
+layout (location = 0) uniform uint u_VertexCount;
+layout (location = 1) uniform bool u_ParentIsFullMesh; // every full mesh vertex weighs 1, ParentWeights isn't read
+
+void main ()
+{
+	const uint stride = gl_NumWorkGroups.x*gl_WorkGroupSize.x;
+	for (uint curr = gl_GlobalInvocationID.x; curr < u_VertexCount; curr += stride) {
+		float sum = 0;
+		uint weight = 0;
+		for (uint i = b_ChildOffsets[curr]; i < b_ChildOffsets[curr + 1]; i++) {
+			const uint child = b_Children[i], child_weight = u_ParentIsFullMesh ? 1u : b_ParentWeights[child];
+			sum += b_ParentValues[child]*float (child_weight);
+			weight += child_weight;
+		}
+		b_Values[curr] = weight > 0 ? sum/float (weight) : 0.0;
+		b_Weights[curr] = weight;
+	}
+})";
+
+static GLuint WorkGroupsFor (size_t count)
+{
+	return GLuint (MIN ((count + WorkGroupSize - 1)/WorkGroupSize, size_t (MaxWorkGroups)));
+}
+
+bool MeanCurvatureGPU::Init ()
+{
+	if (IsReady ())
+		return true;
+	if (!GLAD_GL_VERSION_4_3) {
+		LOG_WARN ("compute shaders need OpenGL 4.3, mean curvature stays on the CPU");
+		return false;
+	}
+	std::optional<GLuint> kernel = Helper::SHADER::CreateProgram (s_KernelShader, GL_COMPUTE_SHADER);
+	std::optional<GLuint> color = Helper::SHADER::CreateProgram (s_ColorShader, GL_COMPUTE_SHADER);
+	std::optional<GLuint> lod_average = Helper::SHADER::CreateProgram (s_LODAverageShader, GL_COMPUTE_SHADER);
+	if (!kernel.has_value () || !color.has_value () || !lod_average.has_value ()) {
+		if (kernel.has_value ()) glDeleteProgram (kernel.value ());
+		if (color.has_value ()) glDeleteProgram (color.value ());
+		if (lod_average.has_value ()) glDeleteProgram (lod_average.value ());
+		return false;
+	}
+	m_KernelProgram = kernel.value (), m_ColorProgram = color.value (), m_LODAverageProgram = lod_average.value ();
+
+	glGenBuffers (1, &m_MinMaxSSBO);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_MinMaxSSBO);
+	glBufferData (GL_SHADER_STORAGE_BUFFER, sizeof (GLuint[2]), nullptr, GL_DYNAMIC_READ);
+	glGenBuffers (1, &m_BlendSSBO);
+	glGenQueries (3, m_TimerQueries);
+	return true;
+}
+
+void MeanCurvatureGPU::Release ()
+{
+	if (m_KernelProgram) glDeleteProgram (m_KernelProgram);
+	if (m_ColorProgram) glDeleteProgram (m_ColorProgram);
+	if (m_LODAverageProgram) glDeleteProgram (m_LODAverageProgram);
+	m_KernelProgram = m_ColorProgram = m_LODAverageProgram = 0;
+	release_lods ();
+
+	GLuint buffers[] = { m_OffsetsSSBO, m_RingSSBO, m_ValuesSSBO, m_NormalsSSBO, m_MinMaxSSBO, m_BlendSSBO, m_PositionsSSBO };
+	for (GLuint buffer : buffers)
+		if (buffer)
+			glDeleteBuffers (1, &buffer);
+	m_OffsetsSSBO = m_RingSSBO = m_ValuesSSBO = m_NormalsSSBO = m_MinMaxSSBO = m_BlendSSBO = m_PositionsSSBO = 0;
+	if (m_TimerQueries[0])
+		glDeleteQueries (3, m_TimerQueries);
+	m_TimerQueries[0] = m_TimerQueries[1] = m_TimerQueries[2] = 0;
+	m_VertexCount = 0, m_MeshGeneration = 0, m_BlendColorCount = 0;
+}
+
+static void upload_ssbo (GLuint &buffer, size_t size, const void *data, GLenum usage)
+{
+	if (!buffer)
+		glGenBuffers (1, &buffer);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, buffer);
+	glBufferData (GL_SHADER_STORAGE_BUFFER, MAX (size, size_t (4)), data, usage); // zero sized SSBOs can't be bound
+}
+
+void MeanCurvatureGPU::UploadAdjacency (const VertexRings &rings, uint64_t mesh_generation)
+{
+	release_lods ();
+	m_BlendColorCount = 0; // no results for this mesh yet
+	m_VertexCount = rings.VertexCount ();
+	m_MeshGeneration = mesh_generation;
+	upload_ssbo (m_OffsetsSSBO, rings.Offsets.size ()*sizeof (uint32_t), rings.Offsets.data (), GL_STATIC_DRAW);
+	upload_ssbo (m_RingSSBO, rings.Ring.size ()*sizeof (uint32_t), rings.Ring.data (), GL_STATIC_DRAW);
+	upload_ssbo (m_ValuesSSBO, m_VertexCount*sizeof (float), nullptr, GL_DYNAMIC_COPY);
+	upload_ssbo (m_NormalsSSBO, m_VertexCount*sizeof (glm::vec3), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MeanCurvatureGPU::release_lods ()
+{
+	for (LODLevel &level : m_LODLevels) {
+		GLuint buffers[] = { level.ChildOffsetsSSBO, level.ChildrenSSBO, level.ValuesSSBO, level.WeightsSSBO };
+		glDeleteBuffers (4, buffers);
+	}
+	m_LODLevels.clear ();
+}
+
+void MeanCurvatureGPU::UploadLODs (const std::vector<MeshLOD> &lods)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	release_lods ();
+	std::vector<uint32_t> offsets, children;
+	size_t parent_count = m_VertexCount;
+	for (const MeshLOD &lod : lods) {
+		if (lod.ParentToLOD.size () != parent_count) {
+			LOG_WARN ("LOD chain doesn't match the uploaded mesh, LOD colors stay on the CPU");
+			release_lods ();
+			return;
+		}
+		// counting sort of the previous level's vertices by the vertex they merged into
+		const size_t count = lod.Vertices.size ();
+		offsets.assign (count + 1, 0);
+		for (uint32_t parent : lod.ParentToLOD)
+			offsets[parent + 1]++;
+		for (size_t v = 0; v < count; v++)
+			offsets[v + 1] += offsets[v];
+		children.resize (parent_count);
+		std::vector<uint32_t> next (offsets.begin (), offsets.end () - 1);
+		for (size_t c = 0; c < parent_count; c++)
+			children[next[lod.ParentToLOD[c]]++] = uint32_t (c);
+
+		LODLevel level;
+		level.VertexCount = count;
+		upload_ssbo (level.ChildOffsetsSSBO, offsets.size ()*sizeof (uint32_t), offsets.data (), GL_STATIC_DRAW);
+		upload_ssbo (level.ChildrenSSBO, children.size ()*sizeof (uint32_t), children.data (), GL_STATIC_DRAW);
+		upload_ssbo (level.ValuesSSBO, count*sizeof (float), nullptr, GL_DYNAMIC_COPY);
+		upload_ssbo (level.WeightsSSBO, count*sizeof (uint32_t), nullptr, GL_DYNAMIC_COPY);
+		m_LODLevels.push_back (level);
+		parent_count = count;
+	}
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void MeanCurvatureGPU::SetVertexFormat (const MeshVertexFormat &format, const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals)
+{
+	m_Format = format;
+	if (format.Position == PositionFormat::FLOAT3) {
+		if (m_PositionsSSBO)
+			glDeleteBuffers (1, &m_PositionsSSBO);
+		m_PositionsSSBO = 0;
+		return;
+	}
+	std::vector<glm::vec3> positions (posn_and_normals.size ());
+	for (size_t i = 0; i < positions.size (); i++)
+		positions[i] = posn_and_normals[i].first;
+	if (!m_PositionsSSBO)
+		glGenBuffers (1, &m_PositionsSSBO);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_PositionsSSBO);
+	glBufferData (GL_SHADER_STORAGE_BUFFER, MAX (positions.size ()*sizeof (glm::vec3), size_t (4)), positions.data (), GL_STATIC_DRAW);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+bool MeanCurvatureGPU::Calculate (GLuint posn_and_normals_vbo, GLuint colors_vbo, GLintptr colors_offset, const std::vector<glm::vec3> &blend_betweencolors
+								  , float *save_min_mean_curvature, float *save_max_mean_curvature, MeanCurvaturePhaseTimings *save_timings)
+{
+	if (!IsReady () || m_VertexCount == 0 || !posn_and_normals_vbo || !colors_vbo || blend_betweencolors.empty ())
+		return false;
+	if (m_Format.Position != PositionFormat::FLOAT3 && !m_PositionsSSBO)
+		return false;
+	GLCORE_PROFILE_FUNCTION ();
+
+	GLint last_program;
+	glGetIntegerv (GL_CURRENT_PROGRAM, &last_program);
+
+	const GLuint min_max_reset[2] = { 0x7F800000u /*+inf*/, 0u };
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_MinMaxSSBO);
+	glBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, sizeof (min_max_reset), min_max_reset);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_BlendSSBO);
+	glBufferData (GL_SHADER_STORAGE_BUFFER, blend_betweencolors.size ()*sizeof (glm::vec3), blend_betweencolors.data (), GL_DYNAMIC_DRAW);
+	m_BlendColorCount = GLuint (blend_betweencolors.size ());
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::POSN_AND_NORMALS, m_PositionsSSBO ? m_PositionsSSBO : posn_and_normals_vbo);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::RING_OFFSETS, m_OffsetsSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::RING, m_RingSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::VALUES, m_ValuesSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::NORMALS, m_NormalsSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::MIN_MAX, m_MinMaxSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::BLEND_COLORS, m_BlendSSBO);
+	glBindBufferRange (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::COLORS, colors_vbo, colors_offset, GLsizeiptr ((m_VertexCount*m_Format.ColorStride () + 3)/4*4));
+
+	glQueryCounter (m_TimerQueries[0], GL_TIMESTAMP);
+	glUseProgram (m_KernelProgram);
+	glUniform1ui (0, GLuint (m_VertexCount));
+	glUniform1ui (1, m_PositionsSSBO ? 3 : m_Format.StaticStride ()/4);
+	glDispatchCompute (WorkGroupsFor (m_VertexCount), 1, 1);
+
+	glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glQueryCounter (m_TimerQueries[1], GL_TIMESTAMP);
+	glUseProgram (m_ColorProgram);
+	glUniform1ui (0, GLuint (m_VertexCount));
+	glUniform1ui (1, GLuint (blend_betweencolors.size ()));
+	glUniform1ui (2, GLuint (m_Format.Color));
+	const size_t color_items = m_Format.Color == ColorFormat::HALF_SCALAR ? (m_VertexCount + 1)/2 : m_VertexCount;
+	glDispatchCompute (WorkGroupsFor (color_items), 1, 1);
+	glQueryCounter (m_TimerQueries[2], GL_TIMESTAMP);
+
+	// colors are sourced as vertex attributes next, results may be read back
+	glMemoryBarrier (GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	glUseProgram (GLuint (last_program));
+
+	if (save_min_mean_curvature || save_max_mean_curvature) {
+		GLuint min_max[2];
+		glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_MinMaxSSBO);
+		glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, sizeof (min_max), min_max);
+		glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+		float min_max_f[2];
+		memcpy (min_max_f, min_max, sizeof (min_max_f));
+		if (min_max_f[0] > min_max_f[1]) // no vertex had a one-ring, the reset values are still there
+			min_max_f[0] = min_max_f[1] = 0;
+		if (save_min_mean_curvature) *save_min_mean_curvature = min_max_f[0];
+		if (save_max_mean_curvature) *save_max_mean_curvature = min_max_f[1];
+	}
+	if (save_timings) {
+		GLuint64 timestamps[3] = { 0, 0, 0 };
+		for (uint32_t i = 0; i < 3; i++)
+			glGetQueryObjectui64v (m_TimerQueries[i], GL_QUERY_RESULT, &timestamps[i]);
+		save_timings->Adjacency = 0, save_timings->Statistics = 0; // adjacency is reused, min/max is part of the kernel
+		save_timings->Kernel = (timestamps[1] - timestamps[0])*1e-6;
+		save_timings->ColorMapping = (timestamps[2] - timestamps[1])*1e-6;
+	}
+	return true;
+}
+
+bool MeanCurvatureGPU::CalculateLODColors (const std::vector<GLuint> &lod_colors_vbos)
+{
+	if (!IsReady () || m_VertexCount == 0 || m_BlendColorCount == 0 || m_LODLevels.empty () || lod_colors_vbos.size () != m_LODLevels.size ())
+		return false;
+	GLCORE_PROFILE_FUNCTION ();
+
+	GLint last_program;
+	glGetIntegerv (GL_CURRENT_PROGRAM, &last_program);
+	// min/max and blend colors are still the last Calculate's, the full mesh range like write_lod_colors on the CPU
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::MIN_MAX, m_MinMaxSSBO);
+	glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::BLEND_COLORS, m_BlendSSBO);
+
+	GLuint parent_values = m_ValuesSSBO, parent_weights = m_ValuesSSBO; // the full mesh has no weights buffer, never read
+	for (size_t l = 0; l < m_LODLevels.size (); l++) {
+		const LODLevel &level = m_LODLevels[l];
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::RING_OFFSETS, level.ChildOffsetsSSBO);
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::RING, level.ChildrenSSBO);
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::VALUES, level.ValuesSSBO);
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::PARENT_VALUES, parent_values);
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::PARENT_WEIGHTS, parent_weights);
+		glBindBufferBase (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::WEIGHTS, level.WeightsSSBO);
+		glUseProgram (m_LODAverageProgram);
+		glUniform1ui (0, GLuint (level.VertexCount));
+		glUniform1i (1, l == 0);
+		glDispatchCompute (WorkGroupsFor (level.VertexCount), 1, 1);
+		glMemoryBarrier (GL_SHADER_STORAGE_BARRIER_BIT); // read by the color mapping and the next level
+
+		glBindBufferRange (GL_SHADER_STORAGE_BUFFER, SSBO_BINDING::COLORS, lod_colors_vbos[l], 0, GLsizeiptr ((level.VertexCount*m_Format.ColorStride () + 3)/4*4));
+		glUseProgram (m_ColorProgram);
+		glUniform1ui (0, GLuint (level.VertexCount));
+		glUniform1ui (1, m_BlendColorCount);
+		glUniform1ui (2, GLuint (m_Format.Color));
+		glDispatchCompute (WorkGroupsFor (m_Format.Color == ColorFormat::HALF_SCALAR ? (level.VertexCount + 1)/2 : level.VertexCount), 1, 1);
+		parent_values = level.ValuesSSBO, parent_weights = level.WeightsSSBO;
+	}
+	glMemoryBarrier (GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+	glUseProgram (GLuint (last_program));
+	return true;
+}
+
+void MeanCurvatureGPU::ReadBack (std::vector<float> &out_mean_curvature_values, std::vector<glm::vec3> &out_mean_curvature_normals) const
+{
+	out_mean_curvature_values.resize (m_VertexCount);
+	out_mean_curvature_normals.resize (m_VertexCount);
+	if (m_VertexCount == 0)
+		return;
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_ValuesSSBO);
+	glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, m_VertexCount*sizeof (float), out_mean_curvature_values.data ());
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_NormalsSSBO);
+	glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, 0, m_VertexCount*sizeof (glm::vec3), out_mean_curvature_normals.data ());
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+}
+bool MeanCurvatureGPU::ReadBackVertex (size_t vertex, float &out_mean_curvature_value, glm::vec3 &out_mean_curvature_normal) const
+{
+	if (vertex >= m_VertexCount)
+		return false;
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_ValuesSSBO);
+	glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, vertex*sizeof (float), sizeof (float), &out_mean_curvature_value);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, m_NormalsSSBO);
+	glGetBufferSubData (GL_SHADER_STORAGE_BUFFER, vertex*sizeof (glm::vec3), sizeof (glm::vec3), &out_mean_curvature_normal);
+	glBindBuffer (GL_SHADER_STORAGE_BUFFER, 0);
+	return true;
+}
+
+// Magnitude of the K(Xi) sum before cancellation, sum |cot_Q*(X - R)| + |cot_R*(X - Q)| over 2*A_mixed,
+// same one-ring walk as the kernels. Summing n terms in float is off by up to ~n*FLT_EPSILON times this.
+static float operator_magnitude (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const uint32_t *ring, uint32_t ring_size, size_t vertex)
+{
+	const glm::vec3 X = posn_and_normals[vertex].first;
+	float A_mixed = 0, magnitude = 0;
+	for (uint32_t i = 1; i < ring_size; i++) {
+		const glm::vec3 Q = posn_and_normals[ring[i - 1]].first, R = posn_and_normals[ring[i]].first;
+		const glm::vec3 XQ_diff = X - Q, XR_diff = X - R;
+		const float twice_area = glm::length (glm::cross (XQ_diff, XR_diff));
+		if (twice_area <= 0)
+			continue;
+		const float cot_Q = glm::dot (R - Q, X - Q)/twice_area, cot_R = glm::dot (Q - R, X - R)/twice_area, cos_X = glm::dot (XQ_diff, XR_diff);
+		magnitude += std::abs (cot_Q)*glm::length (XR_diff) + std::abs (cot_R)*glm::length (XQ_diff);
+		if (cot_Q >= 0 && cot_R >= 0 && cos_X >= 0)
+			A_mixed += (glm::dot (XR_diff, XR_diff)*cot_Q + glm::dot (XQ_diff, XQ_diff)*cot_R)*0.125f;
+		else
+			A_mixed += twice_area*(cos_X < 0 ? 0.25f : 0.125f);
+	}
+	return A_mixed > 0 ? magnitude/(2*A_mixed) : 0.0f;
+}
+
+MeanCurvatureGPUValidation ValidateMeanCurvatureGPU (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings
+													 , const std::vector<float> &cpu_values, const std::vector<glm::vec3> &cpu_normals
+													 , const std::vector<float> &gpu_values, const std::vector<glm::vec3> &gpu_normals, float max_mean_curvature)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	MeanCurvatureGPUValidation validation;
+	validation.SizesMatch = gpu_values.size () == cpu_values.size () && gpu_normals.size () == cpu_normals.size ()
+		&& cpu_normals.size () == cpu_values.size () && rings.VertexCount () == cpu_values.size () && posn_and_normals.size () == cpu_values.size ();
+	if (!validation.SizesMatch)
+		return validation;
+	const float scale = MAX (max_mean_curvature, 1e-6f);
+	auto error = [](float e) { return std::isfinite (e) ? e : FLT_MAX; }; // NaN would slip through every comparison
+	for (size_t i = 0; i < cpu_values.size (); i++) {
+		validation.MaxValueError = MAX (validation.MaxValueError, error (std::abs (cpu_values[i] - gpu_values[i])/scale));
+		float normal_error = error (glm::length (cpu_normals[i] - gpu_normals[i])/(2*scale)); // |K(Xi)| = 2 K_h
+		if (normal_error > MeanCurvatureGPUValidation::Tolerance) {
+			const float rounding = rings.RingSize (i)*FLT_EPSILON*operator_magnitude (posn_and_normals, rings.RingOf (i), rings.RingSize (i), i)/(2*scale);
+			if (normal_error <= rounding + MeanCurvatureGPUValidation::Tolerance)
+				validation.IllConditioned++, normal_error = 0;
+		}
+		validation.MaxNormalError = MAX (validation.MaxNormalError, normal_error);
+	}
+	return validation;
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+#include "mean_curvature.h"
+#include "mesh_lod.h"
+
+// Compute shader version of MeanCurvatureKernel + MeanCurvatureColorMap, works straight on the mesh's GL buffers:
+// positions are read from the interleaved {position, normal} VBO, colors are written into the color VBO (see SetVertexFormat).
+// Adjacency (VertexRings) only depends on topology, so it's uploaded once per mesh and reused by every run.
+class MeanCurvatureGPU
+{
+public:
+	MeanCurvatureGPU () = default;
+	~MeanCurvatureGPU () { Release (); }
+	MeanCurvatureGPU (const MeanCurvatureGPU &) = delete;
+	MeanCurvatureGPU &operator= (const MeanCurvatureGPU &) = delete;
+
+	// compiles the programs, false if compute shaders aren't available
+	bool Init ();
+	void Release ();
+	bool IsReady () const { return m_KernelProgram && m_ColorProgram; }
+
+	// mesh_generation identifies the mesh the rings belong to, bump it on every (re)load: vertex counts alone can match.
+	// Drops the LOD chain of the previous mesh, UploadLODs again after it
+	void UploadAdjacency (const VertexRings &rings, uint64_t mesh_generation);
+	// ParentToLOD maps of the mesh's chain as child lists, for CalculateLODColors
+	void UploadLODs (const std::vector<MeshLOD> &lods);
+	// layout of the VBOs passed to Calculate, a quantized position VBO isn't read at all:
+	// curvature (2nd derivative) amplifies 16 bit quantization way too much, so a float copy of the positions is kept instead
+	void SetVertexFormat (const MeshVertexFormat &format, const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals);
+	bool HasAdjacencyFor (uint64_t mesh_generation) const { return m_MeshGeneration == mesh_generation && m_VertexCount > 0; }
+
+	// min/max K_h are the only thing read back (8 bytes), timings are GPU time from timestamp queries
+	// colors are written at colors_offset (must be GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT aligned)
+	bool Calculate (GLuint posn_and_normals_vbo, GLuint colors_vbo, GLintptr colors_offset, const std::vector<glm::vec3> &blend_betweencolors
+					, float *save_min_mean_curvature = nullptr, float *save_max_mean_curvature = nullptr, MeanCurvaturePhaseTimings *save_timings = nullptr);
+
+	// Colors of every uploaded LOD from the last Calculate's K_h, averaged like AverageFullToLOD, nothing is read back.
+	// lod_colors_vbos[l] is level l + 1's color VBO (at offset 0), false if the chain isn't uploaded or sizes differ
+	bool CalculateLODColors (const std::vector<GLuint> &lod_colors_vbos);
+
+	// SSBOs stay valid until the next UploadAdjacency, K(Xi) is vec3 packed as 3 floats
+	GLuint MeanCurvatureValuesBuffer () const { return m_ValuesSSBO; }
+	GLuint MeanCurvatureNormalsBuffer () const { return m_NormalsSSBO; }
+
+	// Reads results back, for validation against the CPU path
+	void ReadBack (std::vector<float> &out_mean_curvature_values, std::vector<glm::vec3> &out_mean_curvature_normals) const;
+	// one vertex (16 bytes), for the hover tooltip, false if vertex is outside the last uploaded mesh
+	bool ReadBackVertex (size_t vertex, float &out_mean_curvature_value, glm::vec3 &out_mean_curvature_normal) const;
+private:
+	void release_lods ();
+
+	GLuint m_KernelProgram = 0, m_ColorProgram = 0, m_LODAverageProgram = 0;
+	GLuint m_OffsetsSSBO = 0, m_RingSSBO = 0, m_ValuesSSBO = 0, m_NormalsSSBO = 0, m_MinMaxSSBO = 0, m_BlendSSBO = 0;
+	GLuint m_PositionsSSBO = 0; // only for quantized position VBOs
+	GLuint m_TimerQueries[3] = { 0, 0, 0 }; // GL_TIMESTAMP before kernel, before colors, after colors
+	size_t m_VertexCount = 0;
+	uint64_t m_MeshGeneration = 0;
+	GLuint m_BlendColorCount = 0; // of the last Calculate, CalculateLODColors maps with the same colors
+	struct LODLevel
+	{
+		GLuint ChildOffsetsSSBO = 0, ChildrenSSBO = 0; // previous level's vertices grouped by the vertex they merged into
+		GLuint ValuesSSBO = 0, WeightsSSBO = 0;        // average K_h, number of full mesh vertices averaged
+		size_t VertexCount = 0;
+	};
+	std::vector<LODLevel> m_LODLevels;
+	MeshVertexFormat m_Format;
+};
+
+// Compute results against MeanCurvatureKernel's, errors are relative to the K_h range (max_mean_curvature)
+// so flat regions (K_h ~ 0) don't blow them up. Shared by the Sandbox's "Validate vs CPU" and Benchmark --gpu.
+// K(Xi) of a one-ring of slivers (UV sphere poles: cotangents ~1e3 over areas ~1e-9) is a sum that cancels down to
+// rounding noise in float on both sides, so its difference only counts past what rounding of that sum can explain.
+struct MeanCurvatureGPUValidation
+{
+	static constexpr float Tolerance = 1e-3f;
+	float MaxValueError = 0, MaxNormalError = 0;
+	size_t IllConditioned = 0; // vertices whose K(Xi) difference is over Tolerance but within rounding of their sum
+	bool SizesMatch = false;   // a failed or short readback fails without comparing
+
+	bool Passed () const { return SizesMatch && MaxValueError <= Tolerance && MaxNormalError <= Tolerance; }
+};
+MeanCurvatureGPUValidation ValidateMeanCurvatureGPU (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const VertexRings &rings
+													 , const std::vector<float> &cpu_values, const std::vector<glm::vec3> &cpu_normals
+													 , const std::vector<float> &gpu_values, const std::vector<glm::vec3> &gpu_normals, float max_mean_curvature);
@@ -0,0 +1,611 @@
+﻿#include "mesh_bvh.h"
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <glm/gtx/norm.hpp>
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+	#define MESH_BVH_SSE2
+	#include <emmintrin.h>
+#endif
+using namespace GLCore::Utils;
+
+constexpr uint32_t BinCount = 16;                   // SAH candidates per axis
+constexpr uint32_t ParallelBinTriangles = 1 << 16;  // bigger nodes are binned on the job system
+constexpr uint32_t MinSubtreeTriangles = 1 << 12;   // below this a subtree isn't worth a job of its own
+constexpr float TraversalCost = 4.0f;               // relative to one ray-triangle test, fuller leaves: half the nodes, same ray times
+
+struct BVHBox
+{
+	glm::vec3 Min = glm::vec3 (FLT_MAX), Max = glm::vec3 (-FLT_MAX);
+
+	void Grow (const glm::vec3 &p) { Min = glm::min (Min, p), Max = glm::max (Max, p); }
+	void Grow (const BVHBox &box) { Min = glm::min (Min, box.Min), Max = glm::max (Max, box.Max); }
+	glm::vec3 Center () const { return (Min + Max)*0.5f; }
+	float HalfArea () const
+	{
+		const glm::vec3 extent = glm::max (Max - Min, glm::vec3 (0));
+		return extent.x*extent.y + extent.y*extent.z + extent.z*extent.x;
+	}
+};
+
+struct BVHBin
+{
+	BVHBox Bounds;
+	uint32_t Count = 0;
+};
+
+// Partitioned in place until every leaf is a range of them, bounds travel along so binning reads memory in order
+struct BVHReference
+{
+	BVHBox Bounds;
+	uint32_t Triangle;
+};
+
+// references [Begin .. End) still to be split, Nodes[Node] already holds their bounds
+struct PendingNode
+{
+	uint32_t Node, Begin, End, Depth;
+	BVHBox Centroids;
+};
+
+struct SplitChoice
+{
+	int Axis = -1; // -1 -> centroids don't spread along any axis
+	uint32_t Bin = 0; // bins below go left
+	float Origin = 0, Scale = 0;
+	float Cost = FLT_MAX;
+	BVHBox Left, Right;
+};
+
+// Same expression for binning and partitioning, a triangle has to land on the same side of the split both times
+static inline uint32_t bin_of (float centroid, float origin, float scale)
+{
+	return uint32_t (std::min (int (BinCount) - 1, std::max (0, int ((centroid - origin)*scale))));
+}
+
+static void bin_triangles (const BVHReference *references, uint32_t begin, uint32_t end, int axis, float origin, float scale, BVHBin (&bins)[BinCount])
+{
+	for (uint32_t i = begin; i < end; i++) {
+		const BVHBox &bounds = references[i].Bounds;
+		BVHBin &bin = bins[bin_of ((bounds.Min[axis] + bounds.Max[axis])*0.5f, origin, scale)];
+		bin.Bounds.Grow (bounds);
+		bin.Count++;
+	}
+}
+
+// Bins along the axis the centroids spread the most, scores the BinCount - 1 planes between bins
+static SplitChoice find_split (const BVHReference *references, const PendingNode &node, float node_half_area, bool parallel)
+{
+	SplitChoice best;
+	const glm::vec3 extent = node.Centroids.Max - node.Centroids.Min;
+	const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+	if (extent[axis] <= 0)
+		return best;
+	const float origin = node.Centroids.Min[axis], scale = float (BinCount)/extent[axis];
+
+	BVHBin bins[BinCount];
+	if (parallel) {
+		std::mutex mutex;
+		JobSystem::ParallelFor (node.End - node.Begin, ParallelBinTriangles/8, [&](size_t begin, size_t end) {
+			BVHBin local[BinCount];
+			bin_triangles (references, node.Begin + uint32_t (begin), node.Begin + uint32_t (end), axis, origin, scale, local);
+			std::lock_guard lock (mutex);
+			for (uint32_t b = 0; b < BinCount; b++)
+				bins[b].Bounds.Grow (local[b].Bounds), bins[b].Count += local[b].Count;
+		});
+	} else bin_triangles (references, node.Begin, node.End, axis, origin, scale, bins);
+
+	// right side sweep first, every plane is then scored on the way back
+	float right_cost[BinCount];
+	uint32_t right_count[BinCount];
+	BVHBox right;
+	uint32_t count = 0;
+	for (uint32_t b = BinCount - 1; b > 0; b--) {
+		right.Grow (bins[b].Bounds);
+		count += bins[b].Count;
+		right_count[b] = count, right_cost[b] = count ? right.HalfArea ()*float (count) : 0.0f;
+	}
+	BVHBox left;
+	count = 0;
+	for (uint32_t b = 1; b < BinCount; b++) {
+		left.Grow (bins[b - 1].Bounds);
+		count += bins[b - 1].Count;
+		if (!count || !right_count[b])
+			continue;
+		const float cost = left.HalfArea ()*float (count) + right_cost[b];
+		if (cost < best.Cost)
+			best.Axis = axis, best.Bin = b, best.Cost = cost;
+	}
+	if (best.Axis < 0)
+		return best;
+	best.Origin = origin, best.Scale = scale;
+	for (uint32_t b = 0; b < BinCount; b++)
+		(b < best.Bin ? best.Left : best.Right).Grow (bins[b].Bounds);
+	best.Cost = TraversalCost + best.Cost/std::max (node_half_area, FLT_MIN);
+	return best;
+}
+
+// Moves the triangles of the left side to the front of the range, returns where the right side starts
+static uint32_t partition_triangles (BVHReference *references, const PendingNode &node, const SplitChoice &split, BVHBox &left_centroids, BVHBox &right_centroids)
+{
+	uint32_t i = node.Begin, j = node.End;
+	while (i < j) {
+		const BVHBox &bounds = references[i].Bounds;
+		const glm::vec3 centroid = bounds.Center ();
+		if (bin_of ((bounds.Min[split.Axis] + bounds.Max[split.Axis])*0.5f, split.Origin, split.Scale) < split.Bin) {
+			left_centroids.Grow (centroid);
+			i++;
+		} else {
+			right_centroids.Grow (centroid);
+			std::swap (references[i], references[--j]);
+		}
+	}
+	return i;
+}
+
+// Splits 'root' until every range is a leaf. With out_subtrees ranges of at most subtree_triangles are handed back
+// instead (their node stays a placeholder), they are built on their own afterwards.
+static void build_nodes (BVHReference *references, std::vector<MeshBVH::Node> &nodes, const PendingNode &root, uint32_t subtree_triangles, std::vector<PendingNode> *out_subtrees)
+{
+	std::vector<PendingNode> stack = { root };
+	while (!stack.empty ()) {
+		const PendingNode node = stack.back ();
+		stack.pop_back ();
+		const uint32_t count = node.End - node.Begin;
+		if (out_subtrees && count <= subtree_triangles) {
+			out_subtrees->push_back (node);
+			continue;
+		}
+		BVHBox bounds;
+		bounds.Min = nodes[node.Node].Min, bounds.Max = nodes[node.Node].Max;
+
+		SplitChoice split;
+		const bool depth_left = node.Depth + 1 < MeshBVH::MaxDepth;
+		if (count > 1 && depth_left)
+			split = find_split (references, node, bounds.HalfArea (), out_subtrees && count >= ParallelBinTriangles);
+		if (count == 1 || !depth_left || (count <= MeshBVH::MaxLeafTriangles && (split.Axis < 0 || split.Cost >= float (count)))) {
+			nodes[node.Node].First = node.Begin, nodes[node.Node].Count = count;
+			continue;
+		}
+
+		PendingNode left = { 0, node.Begin, 0, node.Depth + 1, BVHBox () }, right = { 0, 0, node.End, node.Depth + 1, BVHBox () };
+		BVHBox left_bounds, right_bounds;
+		if (split.Axis >= 0) {
+			left.End = right.Begin = partition_triangles (references, node, split, left.Centroids, right.Centroids);
+			left_bounds = split.Left, right_bounds = split.Right;
+		} else { // every centroid in one spot, halves by count
+			left.End = right.Begin = node.Begin + count/2;
+			left.Centroids = right.Centroids = node.Centroids;
+			for (uint32_t i = left.Begin; i < left.End; i++)
+				left_bounds.Grow (references[i].Bounds);
+			for (uint32_t i = right.Begin; i < right.End; i++)
+				right_bounds.Grow (references[i].Bounds);
+		}
+
+		left.Node = uint32_t (nodes.size ()), right.Node = left.Node + 1;
+		nodes.resize (nodes.size () + 2);
+		nodes[node.Node].First = left.Node, nodes[node.Node].Count = 0;
+		nodes[left.Node].Min = left_bounds.Min, nodes[left.Node].Max = left_bounds.Max;
+		nodes[right.Node].Min = right_bounds.Min, nodes[right.Node].Max = right_bounds.Max;
+		stack.push_back (right);
+		stack.push_back (left);
+	}
+}
+
+void BuildMeshBVH (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, MeshBVH &out_bvh)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	out_bvh = MeshBVH ();
+	out_bvh.Positions.resize (posn_and_normals.size ());
+	JobSystem::ParallelFor (posn_and_normals.size (), 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++)
+			out_bvh.Positions[v] = posn_and_normals[v].first;
+	});
+	const uint32_t triangle_count = uint32_t (indices.size ()/3);
+	if (!triangle_count)
+		return;
+
+	std::vector<BVHReference> references (triangle_count);
+	BVHBox root_bounds, root_centroids;
+	std::mutex mutex;
+	JobSystem::ParallelFor (triangle_count, 1 << 14, [&](size_t begin, size_t end) {
+		BVHBox bounds, centroids;
+		for (size_t t = begin; t < end; t++) {
+			BVHReference &reference = references[t];
+			for (int corner = 0; corner < 3; corner++)
+				reference.Bounds.Grow (out_bvh.Positions[indices[3*t + corner]]);
+			reference.Triangle = uint32_t (t);
+			bounds.Grow (reference.Bounds);
+			centroids.Grow (reference.Bounds.Center ());
+		}
+		std::lock_guard lock (mutex);
+		root_bounds.Grow (bounds);
+		root_centroids.Grow (centroids);
+	});
+
+	// top of the tree on this thread (big nodes still bin in parallel), then ~8 subtrees per thread, each a job of its own
+	const uint32_t subtree_triangles = std::max (MinSubtreeTriangles, triangle_count/(8*JobSystem::Concurrency ()));
+	std::vector<MeshBVH::Node> top (1);
+	top[0].Min = root_bounds.Min, top[0].Max = root_bounds.Max;
+	std::vector<PendingNode> subtrees;
+	build_nodes (references.data (), top, { 0, 0, triangle_count, 0, root_centroids }, subtree_triangles, &subtrees);
+	std::sort (subtrees.begin (), subtrees.end (), [](const PendingNode &a, const PendingNode &b) { return a.End - a.Begin > b.End - b.Begin; });
+
+	std::vector<std::vector<MeshBVH::Node>> subtree_nodes (subtrees.size ());
+	JobSystem::ParallelFor (subtrees.size (), 1, [&](size_t begin, size_t end) {
+		for (size_t s = begin; s < end; s++) {
+			std::vector<MeshBVH::Node> &nodes = subtree_nodes[s];
+			nodes.reserve (2*size_t (subtrees[s].End - subtrees[s].Begin)/MeshBVH::MaxLeafTriangles + 1);
+			nodes.push_back (top[subtrees[s].Node]);
+			PendingNode root = subtrees[s];
+			root.Node = 0;
+			build_nodes (references.data (), nodes, root, 0, nullptr);
+		}
+	});
+
+	// subtree roots replace their placeholders, the rest is appended after the top nodes
+	std::vector<size_t> subtree_base (subtrees.size ());
+	size_t node_count = top.size ();
+	for (size_t s = 0; s < subtrees.size (); s++)
+		subtree_base[s] = node_count, node_count += subtree_nodes[s].size () - 1;
+	out_bvh.Nodes.resize (node_count);
+	std::copy (top.begin (), top.end (), out_bvh.Nodes.begin ());
+	JobSystem::ParallelFor (subtrees.size (), 1, [&](size_t begin, size_t end) {
+		for (size_t s = begin; s < end; s++) {
+			const std::vector<MeshBVH::Node> &nodes = subtree_nodes[s];
+			for (size_t i = 0; i < nodes.size (); i++) {
+				MeshBVH::Node node = nodes[i];
+				if (!node.IsLeaf ())
+					node.First = uint32_t (subtree_base[s] + node.First - 1);
+				out_bvh.Nodes[i ? subtree_base[s] + i - 1 : subtrees[s].Node] = node;
+			}
+		}
+	});
+
+	out_bvh.Triangles.resize (triangle_count);
+	out_bvh.TriangleIDs.resize (triangle_count);
+	JobSystem::ParallelFor (triangle_count, 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const size_t t = out_bvh.TriangleIDs[i] = references[i].Triangle;
+			out_bvh.Triangles[i] = { indices[3*t], indices[3*t + 1], indices[3*t + 2] };
+		}
+	});
+}
+
+void RefitMeshBVH (MeshBVH &bvh, const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	if (posn_and_normals.size () != bvh.Positions.size ()) {
+		LOG_ERROR ("RefitMeshBVH: {0} vertices, the BVH was built over {1}", posn_and_normals.size (), bvh.Positions.size ());
+		return;
+	}
+	JobSystem::ParallelFor (posn_and_normals.size (), 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++)
+			bvh.Positions[v] = posn_and_normals[v].first;
+	});
+	JobSystem::ParallelFor (bvh.Nodes.size (), 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t n = begin; n < end; n++) {
+			MeshBVH::Node &node = bvh.Nodes[n];
+			if (!node.IsLeaf ())
+				continue;
+			BVHBox bounds;
+			for (uint32_t i = node.First; i < node.First + node.Count; i++)
+				for (int corner = 0; corner < 3; corner++)
+					bounds.Grow (bvh.Positions[bvh.Triangles[i][corner]]);
+			node.Min = bounds.Min, node.Max = bounds.Max;
+		}
+	});
+	// children are stored after their parent
+	for (size_t n = bvh.Nodes.size (); n-- > 0;) {
+		MeshBVH::Node &node = bvh.Nodes[n];
+		if (node.IsLeaf ())
+			continue;
+		const MeshBVH::Node &left = bvh.Nodes[node.First], &right = bvh.Nodes[node.First + 1];
+		node.Min = glm::min (left.Min, right.Min), node.Max = glm::max (left.Max, right.Max);
+	}
+}
+
+// Ray in the form the slab test wants it, zero direction components become huge (not infinite) inverses so 0*inv stays finite
+struct BVHRay
+{
+	glm::vec3 Origin, Direction, Inverse;
+#ifdef MESH_BVH_SSE2
+	__m128 OriginLanes, InverseLanes;
+#endif
+	BVHRay (const glm::vec3 &origin, const glm::vec3 &direction) : Origin (origin), Direction (direction)
+	{
+		for (int axis = 0; axis < 3; axis++)
+			Inverse[axis] = std::abs (direction[axis]) > 1e-30f ? 1.0f/direction[axis] : std::copysign (1e30f, direction[axis]);
+	#ifdef MESH_BVH_SSE2
+		OriginLanes = _mm_setr_ps (origin.x, origin.y, origin.z, origin.z);
+		InverseLanes = _mm_setr_ps (Inverse.x, Inverse.y, Inverse.z, Inverse.z);
+	#endif
+	}
+};
+
+static inline bool ray_box (const MeshBVH::Node &node, const BVHRay &ray, float t_max, float &out_t_near)
+{
+#ifdef MESH_BVH_SSE2
+	// all 3 slabs at once, lane 3 (First/Count in memory) is replaced by z so it can't take part
+	const __m128 min = _mm_loadu_ps (&node.Min.x), max = _mm_loadu_ps (&node.Max.x);
+	const __m128 t0 = _mm_mul_ps (_mm_sub_ps (_mm_shuffle_ps (min, min, _MM_SHUFFLE (2, 2, 1, 0)), ray.OriginLanes), ray.InverseLanes);
+	const __m128 t1 = _mm_mul_ps (_mm_sub_ps (_mm_shuffle_ps (max, max, _MM_SHUFFLE (2, 2, 1, 0)), ray.OriginLanes), ray.InverseLanes);
+	__m128 t_near = _mm_min_ps (t0, t1), t_far = _mm_max_ps (t0, t1);
+	t_near = _mm_max_ps (t_near, _mm_shuffle_ps (t_near, t_near, _MM_SHUFFLE (1, 0, 3, 2)));
+	t_near = _mm_max_ps (t_near, _mm_shuffle_ps (t_near, t_near, _MM_SHUFFLE (2, 3, 0, 1)));
+	t_far = _mm_min_ps (t_far, _mm_shuffle_ps (t_far, t_far, _MM_SHUFFLE (1, 0, 3, 2)));
+	t_far = _mm_min_ps (t_far, _mm_shuffle_ps (t_far, t_far, _MM_SHUFFLE (2, 3, 0, 1)));
+	out_t_near = std::max (_mm_cvtss_f32 (t_near), 0.0f);
+	return out_t_near <= std::min (_mm_cvtss_f32 (t_far), t_max);
+#else
+	const glm::vec3 t0 = (node.Min - ray.Origin)*ray.Inverse, t1 = (node.Max - ray.Origin)*ray.Inverse;
+	const glm::vec3 t_near = glm::min (t0, t1), t_far = glm::max (t0, t1);
+	out_t_near = std::max (std::max (t_near.x, t_near.y), std::max (t_near.z, 0.0f));
+	return out_t_near <= std::min (std::min (t_far.x, t_far.y), std::min (t_far.z, t_max));
+#endif
+}
+
+// Moller-Trumbore, hits in (0, t_max) on either side
+static inline bool ray_triangle (const BVHRay &ray, const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c, float t_max, float &out_t, glm::vec2 &out_uv)
+{
+	const glm::vec3 e1 = b - a, e2 = c - a, p = glm::cross (ray.Direction, e2);
+	const float det = glm::dot (e1, p);
+	if (det == 0)
+		return false;
+	const float inv_det = 1.0f/det;
+	const glm::vec3 s = ray.Origin - a;
+	const float u = glm::dot (s, p)*inv_det;
+	if (u < 0 || u > 1)
+		return false;
+	const glm::vec3 q = glm::cross (s, e1);
+	const float v = glm::dot (ray.Direction, q)*inv_det;
+	if (v < 0 || u + v > 1)
+		return false;
+	const float t = glm::dot (e2, q)*inv_det;
+	if (t <= 0 || t >= t_max)
+		return false;
+	out_t = t, out_uv = { u, v };
+	return true;
+}
+
+static void fill_hit (const MeshBVH &bvh, uint32_t leaf_triangle, float distance, const glm::vec2 &uv, MeshBVHHit &out_hit)
+{
+	out_hit.Distance = distance;
+	out_hit.Triangle = bvh.TriangleIDs[leaf_triangle];
+	out_hit.Vertices = bvh.Triangles[leaf_triangle];
+	out_hit.Barycentric = uv;
+}
+
+// traversal stacks hold the farther child of every level on the way down, with how far it is
+struct BVHStackEntry
+{
+	uint32_t Node;
+	float Distance;
+};
+
+bool RaycastMeshBVH (const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, MeshBVHHit &out_hit, float max_distance)
+{
+	float t_near;
+	const BVHRay ray (origin, direction);
+	if (bvh.Empty () || !ray_box (bvh.Nodes[0], ray, max_distance, t_near))
+		return false;
+
+	BVHStackEntry stack[MeshBVH::MaxDepth];
+	uint32_t stack_size = 0, node_index = 0;
+	float t_max = max_distance;
+	uint32_t hit_triangle = UINT32_MAX;
+	glm::vec2 hit_uv;
+	for (;;) {
+		const MeshBVH::Node &node = bvh.Nodes[node_index];
+		if (node.IsLeaf ()) {
+			for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+				const glm::uvec3 &triangle = bvh.Triangles[i];
+				if (ray_triangle (ray, bvh.Positions[triangle.x], bvh.Positions[triangle.y], bvh.Positions[triangle.z], t_max, t_max, hit_uv))
+					hit_triangle = i, fill_hit (bvh, i, t_max, hit_uv, out_hit);
+			}
+		} else {
+			float near_left, near_right;
+			const bool left = ray_box (bvh.Nodes[node.First], ray, t_max, near_left);
+			const bool right = ray_box (bvh.Nodes[node.First + 1], ray, t_max, near_right);
+			if (left && right) {
+				const bool left_first = near_left <= near_right;
+				stack[stack_size++] = { node.First + uint32_t (left_first), left_first ? near_right : near_left };
+				node_index = node.First + uint32_t (!left_first);
+				continue;
+			}
+			if (left || right) {
+				node_index = node.First + uint32_t (right);
+				continue;
+			}
+		}
+		// a hit found meanwhile may have moved past what's left on the stack
+		while (stack_size && stack[stack_size - 1].Distance > t_max)
+			stack_size--;
+		if (!stack_size)
+			break;
+		node_index = stack[--stack_size].Node;
+	}
+	return hit_triangle != UINT32_MAX;
+}
+
+uint32_t RaycastMeshBVH4 (const MeshBVH &bvh, const glm::vec3 origins[4], const glm::vec3 directions[4], MeshBVHHit out_hits[4], float max_distance)
+{
+#ifdef MESH_BVH_SSE2
+	if (bvh.Empty ())
+		return 0;
+	// one lane per ray
+	__m128 origin[3], direction[3], inverse[3];
+	for (int axis = 0; axis < 3; axis++) {
+		alignas (16) float o[4], d[4], inv[4];
+		for (int r = 0; r < 4; r++) {
+			const BVHRay ray (origins[r], directions[r]);
+			o[r] = ray.Origin[axis], d[r] = ray.Direction[axis], inv[r] = ray.Inverse[axis];
+		}
+		origin[axis] = _mm_load_ps (o), direction[axis] = _mm_load_ps (d), inverse[axis] = _mm_load_ps (inv);
+	}
+	__m128 t_max = _mm_set1_ps (max_distance);
+	const __m128 zero = _mm_setzero_ps (), one = _mm_set1_ps (1.0f);
+	alignas (16) float hit_u[4], hit_v[4];
+	uint32_t hit_triangle[4] = { UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX };
+	const glm::vec3 mean_direction = directions[0] + directions[1] + directions[2] + directions[3];
+
+	// nodes are tested when popped, a node is entered if any ray's interval still reaches it
+	uint32_t stack[MeshBVH::MaxDepth + 1];
+	uint32_t stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size) {
+		const MeshBVH::Node &node = bvh.Nodes[stack[--stack_size]];
+		__m128 t_near = zero, t_far = t_max;
+		for (int axis = 0; axis < 3; axis++) {
+			const __m128 t0 = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (node.Min[axis]), origin[axis]), inverse[axis]);
+			const __m128 t1 = _mm_mul_ps (_mm_sub_ps (_mm_set1_ps (node.Max[axis]), origin[axis]), inverse[axis]);
+			t_near = _mm_max_ps (t_near, _mm_min_ps (t0, t1));
+			t_far = _mm_min_ps (t_far, _mm_max_ps (t0, t1));
+		}
+		if (!_mm_movemask_ps (_mm_cmple_ps (t_near, t_far)))
+			continue;
+		if (!node.IsLeaf ()) { // nearer child (along the packet's mean direction) on top
+			const MeshBVH::Node &left = bvh.Nodes[node.First], &right = bvh.Nodes[node.First + 1];
+			const bool left_first = glm::dot ((right.Min + right.Max) - (left.Min + left.Max), mean_direction) >= 0;
+			stack[stack_size++] = node.First + uint32_t (left_first);
+			stack[stack_size++] = node.First + uint32_t (!left_first);
+			continue;
+		}
+		for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+			const glm::uvec3 &triangle = bvh.Triangles[i];
+			const glm::vec3 &a = bvh.Positions[triangle.x], e1 = bvh.Positions[triangle.y] - a, e2 = bvh.Positions[triangle.z] - a;
+			const __m128 e1x = _mm_set1_ps (e1.x), e1y = _mm_set1_ps (e1.y), e1z = _mm_set1_ps (e1.z);
+			const __m128 e2x = _mm_set1_ps (e2.x), e2y = _mm_set1_ps (e2.y), e2z = _mm_set1_ps (e2.z);
+			// p = direction x e2, det = e1.p
+			const __m128 px = _mm_sub_ps (_mm_mul_ps (direction[1], e2z), _mm_mul_ps (direction[2], e2y));
+			const __m128 py = _mm_sub_ps (_mm_mul_ps (direction[2], e2x), _mm_mul_ps (direction[0], e2z));
+			const __m128 pz = _mm_sub_ps (_mm_mul_ps (direction[0], e2y), _mm_mul_ps (direction[1], e2x));
+			const __m128 det = _mm_add_ps (_mm_add_ps (_mm_mul_ps (e1x, px), _mm_mul_ps (e1y, py)), _mm_mul_ps (e1z, pz));
+			const __m128 inv_det = _mm_div_ps (one, det);
+			// s = origin - a, u = s.p/det, q = s x e1, v = direction.q/det, t = e2.q/det
+			const __m128 sx = _mm_sub_ps (origin[0], _mm_set1_ps (a.x)), sy = _mm_sub_ps (origin[1], _mm_set1_ps (a.y)), sz = _mm_sub_ps (origin[2], _mm_set1_ps (a.z));
+			const __m128 u = _mm_mul_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (sx, px), _mm_mul_ps (sy, py)), _mm_mul_ps (sz, pz)), inv_det);
+			const __m128 qx = _mm_sub_ps (_mm_mul_ps (sy, e1z), _mm_mul_ps (sz, e1y));
+			const __m128 qy = _mm_sub_ps (_mm_mul_ps (sz, e1x), _mm_mul_ps (sx, e1z));
+			const __m128 qz = _mm_sub_ps (_mm_mul_ps (sx, e1y), _mm_mul_ps (sy, e1x));
+			const __m128 v = _mm_mul_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (direction[0], qx), _mm_mul_ps (direction[1], qy)), _mm_mul_ps (direction[2], qz)), inv_det);
+			const __m128 t = _mm_mul_ps (_mm_add_ps (_mm_add_ps (_mm_mul_ps (e2x, qx), _mm_mul_ps (e2y, qy)), _mm_mul_ps (e2z, qz)), inv_det);
+			__m128 hit = _mm_cmpneq_ps (det, zero);
+			hit = _mm_and_ps (hit, _mm_and_ps (_mm_cmpge_ps (u, zero), _mm_cmpge_ps (v, zero)));
+			hit = _mm_and_ps (hit, _mm_cmple_ps (_mm_add_ps (u, v), one));
+			hit = _mm_and_ps (hit, _mm_and_ps (_mm_cmpgt_ps (t, zero), _mm_cmplt_ps (t, t_max)));
+			const int mask = _mm_movemask_ps (hit);
+			if (!mask)
+				continue;
+			t_max = _mm_or_ps (_mm_and_ps (hit, t), _mm_andnot_ps (hit, t_max));
+			alignas (16) float lane_u[4], lane_v[4];
+			_mm_store_ps (lane_u, u), _mm_store_ps (lane_v, v);
+			for (int r = 0; r < 4; r++)
+				if (mask & (1 << r))
+					hit_triangle[r] = i, hit_u[r] = lane_u[r], hit_v[r] = lane_v[r];
+		}
+	}
+	alignas (16) float distances[4];
+	_mm_store_ps (distances, t_max);
+	uint32_t hits = 0;
+	for (int r = 0; r < 4; r++) {
+		out_hits[r] = MeshBVHHit ();
+		if (hit_triangle[r] == UINT32_MAX)
+			continue;
+		fill_hit (bvh, hit_triangle[r], distances[r], { hit_u[r], hit_v[r] }, out_hits[r]);
+		hits |= 1u << r;
+	}
+	return hits;
+#else
+	uint32_t hits = 0;
+	for (int r = 0; r < 4; r++) {
+		out_hits[r] = MeshBVHHit ();
+		if (RaycastMeshBVH (bvh, origins[r], directions[r], out_hits[r], max_distance))
+			hits |= 1u << r;
+	}
+	return hits;
+#endif
+}
+
+static inline float box_distance_squared (const MeshBVH::Node &node, const glm::vec3 &point)
+{
+	const glm::vec3 outside = glm::max (glm::max (node.Min - point, point - node.Max), glm::vec3 (0));
+	return glm::dot (outside, outside);
+}
+
+int32_t NearestVertexMeshBVH (const MeshBVH &bvh, const glm::vec3 &point, float max_distance)
+{
+	float best = max_distance < std::sqrt (FLT_MAX) ? max_distance*max_distance : FLT_MAX;
+	if (bvh.Empty () || box_distance_squared (bvh.Nodes[0], point) > best)
+		return -1;
+
+	BVHStackEntry stack[MeshBVH::MaxDepth];
+	uint32_t stack_size = 0, node_index = 0;
+	int32_t nearest = -1;
+	for (;;) {
+		const MeshBVH::Node &node = bvh.Nodes[node_index];
+		if (node.IsLeaf ()) {
+			for (uint32_t i = node.First; i < node.First + node.Count; i++)
+				for (int corner = 0; corner < 3; corner++) {
+					const uint32_t vertex = bvh.Triangles[i][corner];
+					const float distance = glm::length2 (bvh.Positions[vertex] - point);
+					if (distance < best || (distance == best && nearest < 0))
+						best = distance, nearest = int32_t (vertex);
+				}
+		} else {
+			const float left = box_distance_squared (bvh.Nodes[node.First], point), right = box_distance_squared (bvh.Nodes[node.First + 1], point);
+			const bool left_first = left <= right;
+			const float near = left_first ? left : right, far = left_first ? right : left;
+			if (far <= best)
+				stack[stack_size++] = { node.First + uint32_t (left_first), far };
+			if (near <= best) {
+				node_index = node.First + uint32_t (!left_first);
+				continue;
+			}
+		}
+		while (stack_size && stack[stack_size - 1].Distance > best)
+			stack_size--;
+		if (!stack_size)
+			break;
+		node_index = stack[--stack_size].Node;
+	}
+	return nearest;
+}
+
+void QueryBoxMeshBVH (const MeshBVH &bvh, const glm::vec3 &min, const glm::vec3 &max, std::vector<uint32_t> &out_triangles)
+{
+	out_triangles.clear ();
+	auto overlaps = [&](const glm::vec3 &box_min, const glm::vec3 &box_max) {
+		return glm::all (glm::lessThanEqual (box_min, max)) && glm::all (glm::lessThanEqual (min, box_max));
+	};
+	if (bvh.Empty () || !overlaps (bvh.Nodes[0].Min, bvh.Nodes[0].Max))
+		return;
+
+	uint32_t stack[MeshBVH::MaxDepth];
+	uint32_t stack_size = 0, node_index = 0;
+	for (;;) {
+		const MeshBVH::Node &node = bvh.Nodes[node_index];
+		if (node.IsLeaf ()) {
+			for (uint32_t i = node.First; i < node.First + node.Count; i++) {
+				const glm::uvec3 &triangle = bvh.Triangles[i];
+				const glm::vec3 &a = bvh.Positions[triangle.x], &b = bvh.Positions[triangle.y], &c = bvh.Positions[triangle.z];
+				if (overlaps (glm::min (a, glm::min (b, c)), glm::max (a, glm::max (b, c))))
+					out_triangles.push_back (bvh.TriangleIDs[i]);
+			}
+		} else {
+			const MeshBVH::Node &left = bvh.Nodes[node.First], &right = bvh.Nodes[node.First + 1];
+			const bool enter_left = overlaps (left.Min, left.Max), enter_right = overlaps (right.Min, right.Max);
+			if (enter_left && enter_right)
+				stack[stack_size++] = node.First + 1;
+			if (enter_left || enter_right) {
+				node_index = node.First + uint32_t (!enter_left);
+				continue;
+			}
+		}
+		if (!stack_size)
+			break;
+		node_index = stack[--stack_size];
+	}
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+#include <vector>
+#include <cfloat>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+// Bounding volume hierarchy over the triangles of a mesh, for CPU side ray picking, nearest vertex and region queries.
+// Binned SAH build, subtrees are built in parallel on the job system. Nodes are 32 bytes, the children of an interior
+// node are adjacent and always stored after it (a reverse walk visits children before parents, see RefitMeshBVH).
+// Triangles are copied in leaf order, positions in the source vertex order (triangles keep the source vertex indices),
+// queries don't touch the source mesh.
+struct MeshBVH
+{
+	struct Node
+	{
+		glm::vec3 Min; uint32_t First; // interior: children are Nodes[First], Nodes[First + 1], leaf: Triangles[First .. First + Count)
+		glm::vec3 Max; uint32_t Count; // 0 for interior nodes
+
+		bool IsLeaf () const { return Count != 0; }
+	};
+	std::vector<Node> Nodes;           // Nodes[0] is the root, empty for an empty mesh
+	std::vector<glm::uvec3> Triangles; // vertex indices
+	std::vector<uint32_t> TriangleIDs; // Triangles[i] is triangle TriangleIDs[i] of the source index buffer
+	std::vector<glm::vec3> Positions;  // same vertex order as the source mesh
+
+	static constexpr uint32_t MaxLeafTriangles = 8; // bigger leaves only past MaxDepth
+	static constexpr uint32_t MaxDepth = 64;        // bounds the traversal stacks
+
+	bool Empty () const { return Nodes.empty (); }
+};
+
+struct MeshBVHHit
+{
+	float Distance = FLT_MAX; // along the ray, in units of its (not normalized) direction
+	uint32_t Triangle = 0;    // source triangle, its vertices are indices[3*Triangle ..]
+	glm::uvec3 Vertices = glm::uvec3 (0);
+	glm::vec2 Barycentric = glm::vec2 (0); // weights of Vertices[1] and Vertices[2]
+};
+
+void BuildMeshBVH (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, MeshBVH &out_bvh);
+// Vertices moved, topology didn't: bounds are recomputed, the tree is kept (rebuild after large deformations, queries slow down)
+void RefitMeshBVH (MeshBVH &bvh, const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals);
+
+// Closest hit in (0, max_distance], both triangle sides count
+bool RaycastMeshBVH (const MeshBVH &bvh, const glm::vec3 &origin, const glm::vec3 &direction, MeshBVHHit &out_hit, float max_distance = FLT_MAX);
+// 4 rays traversed together (coherent rays: pixel blocks, brush samples), returns a mask of the rays that hit
+uint32_t RaycastMeshBVH4 (const MeshBVH &bvh, const glm::vec3 origins[4], const glm::vec3 directions[4], MeshBVHHit out_hits[4], float max_distance = FLT_MAX);
+// Vertex of any triangle closest to 'point', -1 if none within max_distance
+int32_t NearestVertexMeshBVH (const MeshBVH &bvh, const glm::vec3 &point, float max_distance = FLT_MAX);
+// Source triangles whose bounding box overlaps [min, max], in leaf order
+void QueryBoxMeshBVH (const MeshBVH &bvh, const glm::vec3 &min, const glm::vec3 &max, std::vector<uint32_t> &out_triangles);
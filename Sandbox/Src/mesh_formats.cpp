@@ -0,0 +1,108 @@
+﻿#include "mesh_formats.h"
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+
+glm::mat4 PositionDequantize::Matrix () const
+{
+	return glm::scale (glm::translate (glm::mat4 (1.0f), Offset), Scale);
+}
+
+static uint32_t PackOctahedral (glm::vec3 normal)
+{
+	const float l1_norm = std::abs (normal.x) + std::abs (normal.y) + std::abs (normal.z);
+	if (!(l1_norm > 0)) // degenerate/unreferenced vertices have no normal, +Z instead of NaN
+		return glm::packSnorm2x16 (glm::vec2 (0));
+	normal /= l1_norm;
+	glm::vec2 encoded (normal.x, normal.y);
+	if (normal.z < 0) // fold the lower hemisphere over the diagonals
+		encoded = (1.0f - glm::abs (glm::vec2 (normal.y, normal.x)))*glm::vec2 (normal.x >= 0 ? 1 : -1, normal.y >= 0 ? 1 : -1);
+	return glm::packSnorm2x16 (encoded);
+}
+
+PositionDequantize PackStaticVertices (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const MeshVertexFormat &format, std::vector<uint8_t> &out_packed)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	PositionDequantize dequantize;
+	if (format.Position == PositionFormat::UNORM16 && !posn_and_normals.empty ()) {
+		glm::vec3 min (posn_and_normals[0].first), max (min);
+		for (const auto &[posn, normal] : posn_and_normals)
+			min = glm::min (min, posn), max = glm::max (max, posn);
+		dequantize.Offset = min;
+		dequantize.Scale = glm::max (max - min, glm::vec3 (1e-20f)); // flat axis
+	}
+
+	const uint32_t stride = format.StaticStride (), normal_offset = format.PositionSize ();
+	out_packed.resize (posn_and_normals.size ()*stride);
+	GLCore::Utils::JobSystem::ParallelFor (posn_and_normals.size (), 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			uint8_t *vertex = out_packed.data () + i*stride;
+			const auto &[posn, normal] = posn_and_normals[i];
+			if (format.Position == PositionFormat::FLOAT3) {
+				memcpy (vertex, &posn, sizeof (glm::vec3));
+			} else {
+				glm::vec3 relative = glm::clamp ((posn - dequantize.Offset)/dequantize.Scale, 0.0f, 1.0f);
+				uint16_t quantized[4] = { uint16_t (relative.x*65535.0f + 0.5f), uint16_t (relative.y*65535.0f + 0.5f), uint16_t (relative.z*65535.0f + 0.5f), 0 };
+				memcpy (vertex, quantized, sizeof (quantized));
+			}
+
+			uint32_t packed_normal;
+			switch (format.Normal) {
+				case NormalFormat::FLOAT3:
+					memcpy (vertex + normal_offset, &normal, sizeof (glm::vec3)); continue;
+				case NormalFormat::INT_2_10_10_10:
+					packed_normal = glm::packSnorm3x10_1x2 (glm::vec4 (normal, 0)); break;
+				case NormalFormat::OCTAHEDRAL16:
+					packed_normal = PackOctahedral (normal); break;
+			}
+			memcpy (vertex + normal_offset, &packed_normal, sizeof (packed_normal));
+		}
+	});
+	return dequantize;
+}
+
+GLenum PackIndices (const std::vector<GLuint> &indices, size_t vertex_count, const MeshVertexFormat &format, std::vector<uint8_t> &out_packed)
+{
+	if (format.SmallIndices && vertex_count <= 0x10000) {
+		out_packed.resize (indices.size ()*sizeof (uint16_t));
+		uint16_t *packed = (uint16_t *)out_packed.data ();
+		for (size_t i = 0; i < indices.size (); i++)
+			packed[i] = uint16_t (indices[i]);
+		return GL_UNSIGNED_SHORT;
+	}
+	out_packed.resize (indices.size ()*sizeof (GLuint));
+	memcpy (out_packed.data (), indices.data (), out_packed.size ());
+	return GL_UNSIGNED_INT;
+}
+
+void SetStaticVertexAttributes (const MeshVertexFormat &format)
+{
+	const GLsizei stride = format.StaticStride ();
+	const void *normal_offset = (void *)(uintptr_t (format.PositionSize ()));
+	if (format.Position == PositionFormat::FLOAT3)
+		glVertexAttribPointer (0, 3, GL_FLOAT, GL_FALSE, stride, (void *)0);
+	else glVertexAttribPointer (0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void *)0);
+
+	switch (format.Normal) {
+		case NormalFormat::FLOAT3:
+			glVertexAttribPointer (1, 3, GL_FLOAT, GL_FALSE, stride, normal_offset); break;
+		case NormalFormat::INT_2_10_10_10:
+			glVertexAttribPointer (1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, normal_offset); break;
+		case NormalFormat::OCTAHEDRAL16:
+			glVertexAttribPointer (1, 2, GL_SHORT, GL_TRUE, stride, normal_offset); break;
+	}
+}
+
+void SetColorVertexAttribute (const MeshVertexFormat &format, GLintptr offset)
+{
+	switch (format.Color) {
+		case ColorFormat::FLOAT3:
+			glVertexAttribPointer (2, 3, GL_FLOAT, GL_FALSE, format.ColorStride (), (void *)offset); break;
+		case ColorFormat::UNORM8:
+			glVertexAttribPointer (2, 4, GL_UNSIGNED_BYTE, GL_TRUE, format.ColorStride (), (void *)offset); break;
+		case ColorFormat::HALF_SCALAR:
+			glVertexAttribPointer (2, 1, GL_HALF_FLOAT, GL_FALSE, format.ColorStride (), (void *)offset); break;
+	}
+}
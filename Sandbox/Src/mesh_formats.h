@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+// Vertex layouts a mesh can be uploaded with, FLOAT3 everywhere is the original uncompressed layout.
+// The {position, normal} VBO is interleaved, colors live in their own (streamed) VBO.
+enum class PositionFormat
+{
+	FLOAT3,  // 12 bytes
+	UNORM16  // 8 bytes (x, y, z, padding), relative to the mesh AABB, see PositionDequantize
+};
+enum class NormalFormat
+{
+	FLOAT3,         // 12 bytes
+	INT_2_10_10_10, // 4 bytes, GL_INT_2_10_10_10_REV normalized
+	OCTAHEDRAL16    // 4 bytes, 2x snorm16 octahedral map, shader decodes (see base.cpp)
+};
+enum class ColorFormat
+{
+	FLOAT3,     // 12 bytes
+	UNORM8,     // 4 bytes, RGBA8 normalized
+	HALF_SCALAR // 2 bytes, normalized K_h as half float, shader maps it through the blend colors
+};
+
+struct MeshVertexFormat
+{
+	PositionFormat Position = PositionFormat::FLOAT3;
+	NormalFormat Normal = NormalFormat::FLOAT3;
+	ColorFormat Color = ColorFormat::FLOAT3;
+	bool SmallIndices = true; // GL_UNSIGNED_SHORT indices whenever the vertex count allows it
+
+	uint32_t PositionSize () const { return Position == PositionFormat::FLOAT3 ? 12 : 8; }
+	uint32_t StaticStride () const { return PositionSize () + (Normal == NormalFormat::FLOAT3 ? 12 : 4); }
+	uint32_t ColorStride () const { return Color == ColorFormat::FLOAT3 ? 12 : Color == ColorFormat::UNORM8 ? 4 : 2; }
+	bool operator== (const MeshVertexFormat &other) const
+	{
+		return Position == other.Position && Normal == other.Normal && Color == other.Color && SmallIndices == other.SmallIndices;
+	}
+	bool operator!= (const MeshVertexFormat &other) const { return !(*this == other); }
+
+	static MeshVertexFormat Compact () { return { PositionFormat::UNORM16, NormalFormat::INT_2_10_10_10, ColorFormat::UNORM8, true }; }
+};
+
+// stored UNORM16 position -> object space, position = Offset + Scale*stored (identity for FLOAT3)
+struct PositionDequantize
+{
+	glm::vec3 Offset = glm::vec3 (0), Scale = glm::vec3 (1);
+
+	glm::mat4 Matrix () const;
+};
+
+// out_packed holds posn_and_normals.size ()*format.StaticStride () bytes
+PositionDequantize PackStaticVertices (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const MeshVertexFormat &format, std::vector<uint8_t> &out_packed);
+// returns the GL index type the indices were packed as
+GLenum PackIndices (const std::vector<GLuint> &indices, size_t vertex_count, const MeshVertexFormat &format, std::vector<uint8_t> &out_packed);
+
+// attribute 0 (position) and 1 (normal) from the VBO bound to GL_ARRAY_BUFFER
+void SetStaticVertexAttributes (const MeshVertexFormat &format);
+// attribute 2 (color) from the VBO bound to GL_ARRAY_BUFFER, starting at offset
+void SetColorVertexAttribute (const MeshVertexFormat &format, GLintptr offset);
@@ -0,0 +1,219 @@
+﻿#include "mesh_lod.h"
+#include <numeric>
+#include <algorithm>
+#include <mutex>
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+using namespace GLCore::Utils;
+
+// symmetric 4x4 {a, b, c, d} plane quadric, upper triangle
+struct Quadric
+{
+	double Q[10] = {};
+
+	void AddPlane (glm::dvec3 n, double d, double weight)
+	{
+		const double p[4] = { n.x, n.y, n.z, d };
+		for (uint32_t r = 0, i = 0; r < 4; r++)
+			for (uint32_t c = r; c < 4; c++)
+				Q[i++] += weight*p[r]*p[c];
+	}
+	// minimizer of v^T Q v, false if (nearly) singular, ie. flat or straight regions
+	bool Optimal (glm::dvec3 &out) const
+	{
+		const glm::dmat3 A (Q[0], Q[1], Q[2], Q[1], Q[4], Q[5], Q[2], Q[5], Q[7]);
+		const double det = glm::determinant (A);
+		const double scale = Q[0] + Q[4] + Q[7];
+		if (std::abs (det) <= 1e-9*scale*scale*scale)
+			return false;
+		out = glm::inverse (A)*(-glm::dvec3 (Q[3], Q[6], Q[8]));
+		return true;
+	}
+};
+
+// one clustering step: src -> dst on a grid of cell_size starting at origin, returns the max distance a vertex moved
+static float cluster_vertices (const std::vector<std::pair<glm::vec3, glm::vec3>> &src_vertices, const std::vector<GLuint> &src_indices
+							   , glm::vec3 origin, float cell_size, MeshLOD &dst)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t vertex_count = src_vertices.size (), triangle_count = src_indices.size ()/3;
+
+	// 21 bits per axis
+	std::vector<uint64_t> keys (vertex_count);
+	JobSystem::ParallelFor (vertex_count, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			glm::uvec3 cell = glm::uvec3 (glm::clamp ((src_vertices[i].first - origin)/cell_size, glm::vec3 (0), glm::vec3 ((1 << 21) - 1)));
+			keys[i] = (uint64_t (cell.x) << 42) | (uint64_t (cell.y) << 21) | uint64_t (cell.z);
+		}
+	});
+	std::vector<uint32_t> order (vertex_count);
+	std::iota (order.begin (), order.end (), 0);
+	{
+		GLCORE_PROFILE_SCOPE ("sort into cells");
+		std::sort (order.begin (), order.end (), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+	}
+	std::vector<uint32_t> cell_begin;
+	dst.ParentToLOD.resize (vertex_count);
+	for (size_t j = 0; j < vertex_count; j++) {
+		if (j == 0 || keys[order[j]] != keys[order[j - 1]])
+			cell_begin.push_back (uint32_t (j));
+		dst.ParentToLOD[order[j]] = uint32_t (cell_begin.size () - 1);
+	}
+	const size_t cell_count = cell_begin.size ();
+	cell_begin.push_back (uint32_t (vertex_count));
+
+	// vertex -> triangles (CSR), quadrics are rebuilt per cell instead of being stored per vertex (memory on huge meshes)
+	std::vector<uint32_t> offsets (vertex_count + 1, 0), triangles_of_vertex (triangle_count*3);
+	for (size_t i = 0; i < triangle_count*3; i++)
+		offsets[src_indices[i] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++)
+		offsets[v + 1] += offsets[v];
+	{
+		std::vector<uint32_t> cursor (offsets.begin (), offsets.end () - 1);
+		for (size_t i = 0; i < triangle_count*3; i++)
+			triangles_of_vertex[cursor[src_indices[i]]++] = uint32_t (i/3);
+	}
+
+	dst.Vertices.resize (cell_count);
+	float max_moved = 0;
+	std::mutex mutex_merge;
+	JobSystem::ParallelFor (cell_count, 1024, [&](size_t begin, size_t end) {
+		float local_max_moved = 0;
+		for (size_t cell = begin; cell < end; cell++) {
+			Quadric quadric;
+			glm::dvec3 mean (0);
+			glm::vec3 normal (0);
+			for (uint32_t j = cell_begin[cell]; j < cell_begin[cell + 1]; j++) {
+				const uint32_t v = order[j];
+				mean += glm::dvec3 (src_vertices[v].first);
+				normal += src_vertices[v].second;
+				for (uint32_t t = offsets[v]; t < offsets[v + 1]; t++) {
+					const GLuint *corners = &src_indices[size_t (triangles_of_vertex[t])*3];
+					const glm::dvec3 a (src_vertices[corners[0]].first), b (src_vertices[corners[1]].first), c (src_vertices[corners[2]].first);
+					glm::dvec3 n = glm::cross (b - a, c - a);
+					const double twice_area = glm::length (n);
+					if (twice_area <= 0)
+						continue;
+					n /= twice_area;
+					quadric.AddPlane (n, -glm::dot (n, a), twice_area*0.5);
+				}
+			}
+			const uint32_t members = cell_begin[cell + 1] - cell_begin[cell];
+			mean /= double (members);
+
+			// fall back to the mean when the optimum is undefined or leaves the cell's neighbourhood
+			glm::dvec3 position;
+			const glm::dvec3 cell_min = glm::dvec3 (origin) + glm::floor ((mean - glm::dvec3 (origin))/double (cell_size))*double (cell_size);
+			if (!quadric.Optimal (position) || glm::any (glm::lessThan (position, cell_min - 0.5*cell_size)) || glm::any (glm::greaterThan (position, cell_min + 1.5*cell_size)))
+				position = mean;
+
+			const float normal_length = glm::length (normal);
+			dst.Vertices[cell] = { glm::vec3 (position), normal_length > 0 ? normal/normal_length : glm::vec3 (0, 0, 1) };
+			for (uint32_t j = cell_begin[cell]; j < cell_begin[cell + 1]; j++)
+				local_max_moved = std::max (local_max_moved, glm::distance (src_vertices[order[j]].first, glm::vec3 (position)));
+		}
+		std::lock_guard lock (mutex_merge);
+		max_moved = std::max (max_moved, local_max_moved);
+	});
+
+	// remap triangles, drop collapsed ones and duplicates (same corners, same winding)
+	std::vector<glm::uvec3> triangles (triangle_count);
+	JobSystem::ParallelFor (triangle_count, 4096, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			glm::uvec3 tri (dst.ParentToLOD[src_indices[t*3]], dst.ParentToLOD[src_indices[t*3 + 1]], dst.ParentToLOD[src_indices[t*3 + 2]]);
+			if (tri.x == tri.y || tri.y == tri.z || tri.z == tri.x) {
+				triangles[t] = glm::uvec3 (UINT32_MAX);
+				continue;
+			}
+			while (tri.x > tri.y || tri.x > tri.z) // rotate smallest first, keeps winding
+				tri = glm::uvec3 (tri.y, tri.z, tri.x);
+			triangles[t] = tri;
+		}
+	});
+	auto less = [](const glm::uvec3 &a, const glm::uvec3 &b) { return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z; };
+	std::sort (triangles.begin (), triangles.end (), less);
+	triangles.erase (std::unique (triangles.begin (), triangles.end ()), triangles.end ());
+	if (!triangles.empty () && triangles.back ().x == UINT32_MAX)
+		triangles.pop_back ();
+
+	dst.Indices.resize (triangles.size ()*3);
+	memcpy (dst.Indices.data (), triangles.data (), dst.Indices.size ()*sizeof (GLuint));
+	return max_moved;
+}
+
+void BuildLODChain (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices
+					, std::vector<MeshLOD> &out_lods, uint32_t max_levels, size_t min_triangles)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	out_lods.clear ();
+	if (indices.size ()/3 <= min_triangles)
+		return;
+
+	glm::vec3 min (posn_and_normals[0].first);
+	for (const auto &[posn, normal] : posn_and_normals)
+		min = glm::min (min, posn);
+	// first grid ~2 edges wide, from a sample of the triangles
+	double edge_sum = 0;
+	const size_t sampled = std::min (indices.size ()/3, size_t (65536));
+	for (size_t t = 0; t < sampled; t++)
+		edge_sum += glm::distance (posn_and_normals[indices[t*3]].first, posn_and_normals[indices[t*3 + 1]].first);
+	float cell_size = float (2*edge_sum/sampled);
+	if (!(cell_size > 0))
+		return;
+
+	float error = 0;
+	for (uint32_t level = 1; level <= max_levels; level++, cell_size *= 2) {
+		const std::vector<std::pair<glm::vec3, glm::vec3>> &src_vertices = level == 1 ? posn_and_normals : out_lods.back ().Vertices;
+		const std::vector<GLuint> &src_indices = level == 1 ? indices : out_lods.back ().Indices;
+
+		MeshLOD lod;
+		lod.CellSize = cell_size;
+		error += cluster_vertices (src_vertices, src_indices, min, cell_size, lod);
+		lod.GeometricError = error;
+		const bool progressed = lod.Indices.size () < src_indices.size ()*8/10;
+		const bool too_coarse = lod.Indices.size ()/3 < min_triangles;
+		if (!progressed || too_coarse)
+			break;
+		out_lods.push_back (std::move (lod));
+	}
+}
+
+uint32_t SelectLOD (const std::vector<MeshLOD> &lods, float distance, float fov_y_radians, float viewport_height, float max_pixel_error)
+{
+	// world units per pixel at 'distance'
+	const float world_per_pixel = 2*std::max (distance, 1e-6f)*std::tan (fov_y_radians*0.5f)/std::max (viewport_height, 1.0f);
+	uint32_t level = 0;
+	for (uint32_t l = 0; l < lods.size (); l++)
+		if (lods[l].GeometricError <= max_pixel_error*world_per_pixel)
+			level = l + 1;
+	return level;
+}
+
+template<typename T>
+void TransferLODToFull (const std::vector<MeshLOD> &lods, uint32_t level, const std::vector<T> &lod_values, size_t full_vertex_count, std::vector<T> &out_full_values)
+{
+	out_full_values.resize (full_vertex_count);
+	JobSystem::ParallelFor (full_vertex_count, 4096, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			out_full_values[i] = lod_values[FullToLOD (lods, level, uint32_t (i))];
+	});
+}
+template void TransferLODToFull<float> (const std::vector<MeshLOD> &, uint32_t, const std::vector<float> &, size_t, std::vector<float> &);
+template void TransferLODToFull<glm::vec3> (const std::vector<MeshLOD> &, uint32_t, const std::vector<glm::vec3> &, size_t, std::vector<glm::vec3> &);
+
+void AverageFullToLOD (const std::vector<MeshLOD> &lods, uint32_t level, const std::vector<float> &full_values, std::vector<float> &out_lod_values)
+{
+	// level by level, weighted by how many full vertices each one carries
+	std::vector<double> sums (full_values.begin (), full_values.end ());
+	std::vector<uint32_t> weights (full_values.size (), 1);
+	for (uint32_t l = 0; l < level; l++) {
+		std::vector<double> next_sums (lods[l].Vertices.size (), 0);
+		std::vector<uint32_t> next_weights (lods[l].Vertices.size (), 0);
+		for (size_t v = 0; v < sums.size (); v++)
+			next_sums[lods[l].ParentToLOD[v]] += sums[v], next_weights[lods[l].ParentToLOD[v]] += weights[v];
+		sums = std::move (next_sums), weights = std::move (next_weights);
+	}
+	out_lod_values.resize (sums.size ());
+	for (size_t v = 0; v < sums.size (); v++)
+		out_lod_values[v] = weights[v] ? float (sums[v]/weights[v]) : 0.0f;
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+// One level of detail, Vertices/Indices form a regular mesh (renderable, usable by the curvature pipeline).
+// ParentToLOD maps every vertex of the previous level (the full mesh for level 1) to the vertex it was merged into.
+struct MeshLOD
+{
+	std::vector<std::pair<glm::vec3, glm::vec3>> Vertices; // {vertex_position, vertex_normal}
+	std::vector<GLuint> Indices;
+	std::vector<uint32_t> ParentToLOD;
+	float CellSize = 0;       // clustering grid of this level
+	float GeometricError = 0; // object space bound on how far a full mesh vertex moved
+};
+
+// Quadric error metric vertex clustering (Lindstrom 2000) on nested grids, level i+1 clusters level i on a grid twice as coarse
+// (~1/4 of the vertices for surfaces). Every step runs on the job system, apart from sorting vertices into cells.
+// out_lods[0] is level 1, the full mesh is level 0 and isn't copied.
+void BuildLODChain (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices
+					, std::vector<MeshLOD> &out_lods, uint32_t max_levels = 6, size_t min_triangles = 256);
+
+// Coarsest level whose geometric error projects to at most max_pixel_error pixels at 'distance' (0 = full mesh)
+uint32_t SelectLOD (const std::vector<MeshLOD> &lods, float distance, float fov_y_radians, float viewport_height, float max_pixel_error);
+
+// full mesh vertex -> vertex of 'level' (1 based), composes the ParentToLOD maps
+inline uint32_t FullToLOD (const std::vector<MeshLOD> &lods, uint32_t level, uint32_t full_vertex)
+{
+	for (uint32_t l = 0; l < level; l++)
+		full_vertex = lods[l].ParentToLOD[full_vertex];
+	return full_vertex;
+}
+
+// Per vertex values of 'level' copied back onto every full mesh vertex that merged into them
+template<typename T>
+void TransferLODToFull (const std::vector<MeshLOD> &lods, uint32_t level, const std::vector<T> &lod_values, size_t full_vertex_count, std::vector<T> &out_full_values);
+// Average of the full mesh values merged into each vertex of 'level'
+void AverageFullToLOD (const std::vector<MeshLOD> &lods, uint32_t level, const std::vector<float> &full_values, std::vector<float> &out_lod_values);
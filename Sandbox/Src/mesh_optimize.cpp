@@ -0,0 +1,283 @@
+﻿#include "mesh_optimize.h"
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+using namespace GLCore::Utils;
+
+VertexCacheStats SimulateVertexCache (const std::vector<GLuint> &indices, size_t vertex_count, uint32_t cache_size)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	VertexCacheStats stats;
+	if (indices.empty () || vertex_count == 0)
+		return stats;
+	// a vertex is in the FIFO while fewer than cache_size misses happened since it was loaded
+	std::vector<uint64_t> loaded_at (vertex_count, 0);
+	uint64_t misses = 0;
+	for (GLuint index : indices) {
+		if (loaded_at[index] == 0 || misses - loaded_at[index] >= cache_size)
+			loaded_at[index] = ++misses;
+	}
+	stats.ACMR = double (misses)/double (indices.size ()/3);
+	stats.ATVR = double (misses)/double (vertex_count);
+	return stats;
+}
+
+// 21 bits per axis interleaved
+static uint64_t morton_code (glm::uvec3 cell)
+{
+	auto spread = [](uint64_t x) {
+		x &= 0x1fffff;
+		x = (x | x << 32) & 0x1f00000000ffffull;
+		x = (x | x << 16) & 0x1f0000ff0000ffull;
+		x = (x | x << 8) & 0x100f00f00f00f00full;
+		x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+		x = (x | x << 2) & 0x1249249249249249ull;
+		return x;
+	};
+	return spread (cell.x) | spread (cell.y) << 1 | spread (cell.z) << 2;
+}
+
+void SortTrianglesSpatially (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, std::vector<GLuint> &indices)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t triangle_count = indices.size ()/3;
+	if (triangle_count == 0)
+		return;
+	glm::vec3 min (posn_and_normals[0].first), max (min);
+	for (const auto &[posn, normal] : posn_and_normals)
+		min = glm::min (min, posn), max = glm::max (max, posn);
+	const glm::vec3 scale = float ((1 << 21) - 1)/glm::max (max - min, glm::vec3 (1e-20f));
+
+	std::vector<std::pair<uint64_t, uint32_t>> keys (triangle_count);
+	JobSystem::ParallelFor (triangle_count, 4096, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++) {
+			const glm::vec3 centroid = (posn_and_normals[indices[t*3]].first + posn_and_normals[indices[t*3 + 1]].first + posn_and_normals[indices[t*3 + 2]].first)/3.0f;
+			keys[t] = { morton_code (glm::uvec3 ((centroid - min)*scale)), uint32_t (t) };
+		}
+	});
+	std::sort (keys.begin (), keys.end ());
+	std::vector<GLuint> sorted (indices.size ());
+	JobSystem::ParallelFor (triangle_count, 4096, [&](size_t begin, size_t end) {
+		for (size_t t = begin; t < end; t++)
+			std::copy_n (&indices[size_t (keys[t].second)*3], 3, &sorted[t*3]);
+	});
+	indices = std::move (sorted);
+}
+
+// Tipsify on one meshlet, vertices are renamed to local ids first (<= MaxVertices)
+static void tipsify_meshlet (GLuint *indices, uint32_t index_count, uint32_t cache_size)
+{
+	constexpr uint32_t max_vertices = MeshletMesh::MaxVertices, max_triangles = MeshletMesh::MaxTriangles;
+	const uint32_t triangle_count = index_count/3;
+	GLuint vertices[max_vertices];
+	uint8_t local[max_triangles*3];
+	uint32_t vertex_count = 0;
+	for (uint32_t i = 0; i < index_count; i++) {
+		uint32_t v = uint32_t (std::find (vertices, vertices + vertex_count, indices[i]) - vertices);
+		if (v == vertex_count)
+			vertices[vertex_count++] = indices[i];
+		local[i] = uint8_t (v);
+	}
+
+	// vertex -> triangles (CSR)
+	uint32_t offsets[max_vertices + 1] = {}, live[max_vertices] = {}, triangles_of_vertex[max_triangles*3];
+	for (uint32_t i = 0; i < index_count; i++)
+		live[local[i]]++;
+	for (uint32_t v = 0; v < vertex_count; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+	{
+		uint32_t cursor[max_vertices];
+		std::copy (offsets, offsets + vertex_count, cursor);
+		for (uint32_t i = 0; i < index_count; i++)
+			triangles_of_vertex[cursor[local[i]]++] = i/3;
+	}
+
+	uint32_t cache_time[max_vertices] = {}, time = cache_size + 1;
+	bool emitted[max_triangles] = {};
+	uint32_t dead_end[max_triangles*3], dead_end_size = 0;
+	uint32_t candidates[max_triangles*3];
+	GLuint reordered[max_triangles*3];
+	uint32_t written = 0, cursor = 1;
+	int32_t fanning = 0;
+	while (fanning >= 0) {
+		uint32_t candidate_count = 0;
+		for (uint32_t t = offsets[fanning]; t < offsets[fanning + 1]; t++) {
+			const uint32_t triangle = triangles_of_vertex[t];
+			if (emitted[triangle])
+				continue;
+			emitted[triangle] = true;
+			for (uint32_t c = 0; c < 3; c++) {
+				const uint32_t v = local[triangle*3 + c];
+				reordered[written++] = vertices[v];
+				dead_end[dead_end_size++] = v;
+				candidates[candidate_count++] = v;
+				live[v]--;
+				if (time - cache_time[v] > cache_size)
+					cache_time[v] = time++;
+			}
+		}
+
+		// next fanning vertex: the candidate that stays in cache longest while its triangles are emitted
+		int32_t best = -1, best_priority = -1;
+		for (uint32_t i = 0; i < candidate_count; i++) {
+			const uint32_t v = candidates[i];
+			if (live[v] == 0)
+				continue;
+			int32_t priority = 0;
+			if (time - cache_time[v] + 2*live[v] <= cache_size)
+				priority = int32_t (time - cache_time[v]);
+			if (priority > best_priority)
+				best = int32_t (v), best_priority = priority;
+		}
+		if (best < 0) { // dead end, most recent vertex with live triangles, otherwise the next one in order
+			while (dead_end_size > 0 && best < 0) {
+				const uint32_t v = dead_end[--dead_end_size];
+				if (live[v] > 0)
+					best = int32_t (v);
+			}
+			while (best < 0 && cursor < vertex_count) {
+				if (live[cursor] > 0)
+					best = int32_t (cursor);
+				cursor++;
+			}
+		}
+		fanning = best;
+	}
+	std::copy (reordered, reordered + triangle_count*3, indices);
+}
+
+void OptimizeMeshletVertexCache (MeshletMesh &meshlets, uint32_t cache_size)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	JobSystem::ParallelFor (meshlets.Meshlets.size (), 256, [&](size_t begin, size_t end) {
+		for (size_t m = begin; m < end; m++)
+			tipsify_meshlet (&meshlets.Indices[meshlets.Meshlets[m].FirstIndex], meshlets.Meshlets[m].IndexCount, cache_size);
+	});
+}
+
+void OptimizeMeshletOverdraw (MeshletMesh &meshlets, glm::vec3 mesh_center)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	// how far a meshlet sits along its own normal, the highest ones face outwards from the mesh
+	std::vector<float> score (meshlets.Meshlets.size ());
+	JobSystem::ParallelFor (meshlets.Meshlets.size (), 4096, [&](size_t begin, size_t end) {
+		for (size_t m = begin; m < end; m++)
+			score[m] = glm::dot (meshlets.Meshlets[m].Center - mesh_center, meshlets.Meshlets[m].ConeAxis);
+	});
+	std::vector<uint32_t> order (meshlets.Meshlets.size ());
+	std::iota (order.begin (), order.end (), 0);
+	std::stable_sort (order.begin (), order.end (), [&](uint32_t a, uint32_t b) { return score[a] > score[b]; });
+
+	std::vector<Meshlet> sorted (order.size ());
+	for (size_t m = 0, first_index = 0; m < order.size (); m++) {
+		sorted[m] = meshlets.Meshlets[order[m]];
+		sorted[m].FirstIndex = uint32_t (first_index);
+		first_index += sorted[m].IndexCount;
+	}
+	std::vector<GLuint> indices (meshlets.Indices.size ());
+	JobSystem::ParallelFor (order.size (), 1024, [&](size_t begin, size_t end) {
+		for (size_t m = begin; m < end; m++) {
+			const Meshlet &source = meshlets.Meshlets[order[m]];
+			std::copy_n (&meshlets.Indices[source.FirstIndex], source.IndexCount, &indices[sorted[m].FirstIndex]);
+		}
+	});
+	meshlets.Meshlets = std::move (sorted);
+	meshlets.Indices = std::move (indices);
+}
+
+void OptimizeVertexFetch (std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, std::vector<GLuint> &indices, std::vector<uint32_t> &out_remap)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	out_remap.assign (posn_and_normals.size (), UINT32_MAX);
+	uint32_t next = 0;
+	for (GLuint &index : indices) {
+		if (out_remap[index] == UINT32_MAX)
+			out_remap[index] = next++;
+		index = out_remap[index];
+	}
+	for (uint32_t &new_index : out_remap) // unreferenced vertices go last
+		if (new_index == UINT32_MAX)
+			new_index = next++;
+	ApplyVertexRemap (posn_and_normals, out_remap);
+}
+
+void ApplyVertexRemap (std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<uint32_t> &remap)
+{
+	std::vector<std::pair<glm::vec3, glm::vec3>> remapped (posn_and_normals.size ());
+	JobSystem::ParallelFor (remap.size (), 4096, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++)
+			remapped[remap[v]] = posn_and_normals[v];
+	});
+	posn_and_normals = std::move (remapped);
+}
+
+uint64_t HashMesh (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, uint32_t options)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	// FNV-1a over 32 bit words, fast enough next to the parsing it saves
+	auto hash_words = [](uint64_t hash, const uint32_t *words, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			hash = (hash ^ words[i])*0x100000001b3ull;
+		return hash;
+	};
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = hash_words (hash, &options, 1);
+	hash = hash_words (hash, (const uint32_t *)posn_and_normals.data (), posn_and_normals.size ()*sizeof (posn_and_normals[0])/sizeof (uint32_t));
+	hash = hash_words (hash, indices.data (), indices.size ());
+	return hash;
+}
+
+// file layout: header, vertex remap, meshlets, meshlet indices (already remapped)
+struct MeshOptimizationHeader
+{
+	char Magic[4] = { 'M', 'O', 'P', 'T' };
+	uint32_t Version = 1;
+	uint64_t MeshHash = 0;
+	uint64_t VertexCount = 0, IndexCount = 0, MeshletCount = 0;
+};
+
+bool SaveMeshOptimization (const std::string &path, uint64_t mesh_hash, const std::vector<uint32_t> &vertex_remap, const MeshletMesh &meshlets)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	std::ofstream ofs (path, std::ios::binary);
+	if (!ofs) {
+		LOG_WARN ("Cannot write mesh optimization cache - {0}", path);
+		return false;
+	}
+	MeshOptimizationHeader header;
+	header.MeshHash = mesh_hash;
+	header.VertexCount = vertex_remap.size (), header.IndexCount = meshlets.Indices.size (), header.MeshletCount = meshlets.Meshlets.size ();
+	ofs.write ((const char *)&header, sizeof (header));
+	ofs.write ((const char *)vertex_remap.data (), vertex_remap.size ()*sizeof (uint32_t));
+	ofs.write ((const char *)meshlets.Meshlets.data (), meshlets.Meshlets.size ()*sizeof (Meshlet));
+	ofs.write ((const char *)meshlets.Indices.data (), meshlets.Indices.size ()*sizeof (GLuint));
+	return bool (ofs);
+}
+
+bool LoadMeshOptimization (const std::string &path, uint64_t mesh_hash, size_t vertex_count, size_t index_count, std::vector<uint32_t> &out_vertex_remap, MeshletMesh &out_meshlets)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	std::ifstream ifs (path, std::ios::binary);
+	if (!ifs)
+		return false;
+	MeshOptimizationHeader header, expected;
+	ifs.read ((char *)&header, sizeof (header));
+	if (!ifs || memcmp (header.Magic, expected.Magic, sizeof (header.Magic)) != 0 || header.Version != expected.Version
+		|| header.MeshHash != mesh_hash || header.VertexCount != vertex_count || header.IndexCount != index_count)
+		return false;
+
+	out_vertex_remap.resize (vertex_count);
+	out_meshlets.Meshlets.resize (header.MeshletCount);
+	out_meshlets.Indices.resize (index_count);
+	ifs.read ((char *)out_vertex_remap.data (), vertex_count*sizeof (uint32_t));
+	ifs.read ((char *)out_meshlets.Meshlets.data (), header.MeshletCount*sizeof (Meshlet));
+	ifs.read ((char *)out_meshlets.Indices.data (), index_count*sizeof (GLuint));
+	if (!ifs) {
+		LOG_WARN ("Truncated mesh optimization cache - {0}", path);
+		out_meshlets.Meshlets.clear (), out_meshlets.Indices.clear ();
+		return false;
+	}
+	return true;
+}
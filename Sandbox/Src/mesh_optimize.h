@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+#include "meshlets.h"
+
+// FIFO post-transform cache size Tipsify optimizes for and the statistics are simulated with
+constexpr uint32_t VertexCacheSize = 16;
+
+struct VertexCacheStats
+{
+	double ACMR = 0; // average cache miss ratio, vertex shader runs per triangle (0.5 is ideal for large regular meshes)
+	double ATVR = 0; // average transform to vertex ratio, vertex shader runs per vertex (1 is ideal)
+};
+VertexCacheStats SimulateVertexCache (const std::vector<GLuint> &indices, size_t vertex_count, uint32_t cache_size = VertexCacheSize);
+
+// Morton order of triangle centroids, gives BuildMeshlets (which clusters within blocks of consecutive triangles) coherent blocks
+void SortTrianglesSpatially (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, std::vector<GLuint> &indices);
+// Tipsify (Sander, Nehab, Barczak 2007) on the triangles of every meshlet, in parallel.
+// Meshlets are small enough that a local run is as good as a global one, and ranges stay where they are
+void OptimizeMeshletVertexCache (MeshletMesh &meshlets, uint32_t cache_size = VertexCacheSize);
+// Outward facing meshlets first (same paper), so they occlude the rest of the mesh early on.
+// Spatially adjacent meshlets may no longer be adjacent in the index buffer, so culling merges fewer draws
+void OptimizeMeshletOverdraw (MeshletMesh &meshlets, glm::vec3 mesh_center);
+// Renumbers vertices in first use order of 'indices' (GPU vertex fetch and CPU kernel locality), out_remap is old -> new
+void OptimizeVertexFetch (std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, std::vector<GLuint> &indices, std::vector<uint32_t> &out_remap);
+void ApplyVertexRemap (std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<uint32_t> &remap);
+
+// Optimization results are cached next to the mesh file (<mesh>.opt), keyed by a hash of the loaded (unoptimized) mesh
+uint64_t HashMesh (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, uint32_t options);
+bool SaveMeshOptimization (const std::string &path, uint64_t mesh_hash, const std::vector<uint32_t> &vertex_remap, const MeshletMesh &meshlets);
+bool LoadMeshOptimization (const std::string &path, uint64_t mesh_hash, size_t vertex_count, size_t index_count, std::vector<uint32_t> &out_vertex_remap, MeshletMesh &out_meshlets);
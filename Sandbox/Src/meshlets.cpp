@@ -0,0 +1,189 @@
+﻿#include "meshlets.h"
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+using namespace GLCore::Utils;
+
+// triangles clustered by one job, meshlets never cross a block so blocks can be built independently
+constexpr size_t TrianglesPerBlock = 1 << 15;
+
+struct MeshletBlock
+{
+	std::vector<Meshlet> Meshlets; // FirstIndex relative to the block
+	std::vector<GLuint> Indices;
+};
+
+static void compute_bounds (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const GLuint *indices, uint32_t index_count, Meshlet &meshlet)
+{
+	glm::vec3 min (posn_and_normals[indices[0]].first), max (min);
+	glm::vec3 normal_sum (0);
+	for (uint32_t i = 0; i < index_count; i += 3) {
+		const glm::vec3 &a = posn_and_normals[indices[i]].first, &b = posn_and_normals[indices[i + 1]].first, &c = posn_and_normals[indices[i + 2]].first;
+		min = glm::min (min, glm::min (a, glm::min (b, c)));
+		max = glm::max (max, glm::max (a, glm::max (b, c)));
+		glm::vec3 normal = glm::cross (b - a, c - a);
+		float length = glm::length (normal);
+		if (length > 0)
+			normal_sum += normal/length;
+	}
+	meshlet.Center = (min + max)*0.5f;
+	meshlet.Radius = 0;
+	for (uint32_t i = 0; i < index_count; i++)
+		meshlet.Radius = std::max (meshlet.Radius, glm::distance (meshlet.Center, posn_and_normals[indices[i]].first));
+
+	// cone around the average face normal, cutoff = sin of the largest deviation (as in meshoptimizer)
+	meshlet.ConeAxis = glm::vec3 (0, 0, 1), meshlet.ConeCutoff = 1;
+	const float axis_length = glm::length (normal_sum);
+	if (axis_length <= 0)
+		return;
+	meshlet.ConeAxis = normal_sum/axis_length;
+	float min_dot = 1;
+	for (uint32_t i = 0; i < index_count; i += 3) {
+		const glm::vec3 &a = posn_and_normals[indices[i]].first, &b = posn_and_normals[indices[i + 1]].first, &c = posn_and_normals[indices[i + 2]].first;
+		glm::vec3 normal = glm::cross (b - a, c - a);
+		float length = glm::length (normal);
+		if (length > 0)
+			min_dot = std::min (min_dot, glm::dot (normal/length, meshlet.ConeAxis));
+	}
+	if (min_dot > 0.1f) // wider than ~84 degrees is never entirely back-facing
+		meshlet.ConeCutoff = std::sqrt (1 - min_dot*min_dot);
+}
+
+void BuildMeshlets (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, MeshletMesh &out_meshlets)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	out_meshlets.Meshlets.clear ();
+	out_meshlets.Indices.clear ();
+	const size_t triangle_count = indices.size ()/3, vertex_count = posn_and_normals.size ();
+	if (triangle_count == 0)
+		return;
+
+	// vertex -> triangles (CSR)
+	std::vector<uint32_t> offsets (vertex_count + 1, 0), triangles_of_vertex (triangle_count*3);
+	for (size_t i = 0; i < triangle_count*3; i++)
+		offsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertex_count; v++)
+		offsets[v + 1] += offsets[v];
+	{
+		std::vector<uint32_t> cursor (offsets.begin (), offsets.end () - 1);
+		for (size_t i = 0; i < triangle_count*3; i++)
+			triangles_of_vertex[cursor[indices[i]]++] = uint32_t (i/3);
+	}
+
+	const size_t block_count = (triangle_count + TrianglesPerBlock - 1)/TrianglesPerBlock;
+	std::vector<MeshletBlock> blocks (block_count);
+	std::vector<uint32_t> claimed (triangle_count, UINT32_MAX); // meshlet (within the block) a triangle went to, or the one that queued it
+
+	JobSystem::ParallelFor (block_count, 1, [&](size_t block_begin, size_t block_end) {
+		std::vector<uint32_t> queue;
+		for (size_t block_index = block_begin; block_index < block_end; block_index++) {
+			MeshletBlock &block = blocks[block_index];
+			const uint32_t first = uint32_t (block_index*TrianglesPerBlock), last = uint32_t (std::min (triangle_count, (block_index + 1)*TrianglesPerBlock));
+			std::vector<bool> assigned (last - first, false);
+
+			for (uint32_t seed = first; seed < last; seed++) {
+				if (assigned[seed - first])
+					continue;
+				const uint32_t meshlet_id = uint32_t (block.Meshlets.size ());
+				GLuint vertices[MeshletMesh::MaxVertices];
+				uint32_t vertex_used = 0, triangles = 0;
+				const uint32_t first_index = uint32_t (block.Indices.size ());
+
+				queue.clear ();
+				queue.push_back (seed), claimed[seed] = meshlet_id;
+				for (size_t head = 0; head < queue.size () && triangles < MeshletMesh::MaxTriangles; head++) {
+					const uint32_t triangle = queue[head];
+					const GLuint *corners = &indices[size_t (triangle)*3];
+					uint32_t new_vertices = 0;
+					for (uint32_t c = 0; c < 3; c++)
+						new_vertices += std::find (vertices, vertices + vertex_used, corners[c]) == vertices + vertex_used;
+					if (vertex_used + new_vertices > MeshletMesh::MaxVertices)
+						continue; // left for a later meshlet
+					for (uint32_t c = 0; c < 3; c++) {
+						if (std::find (vertices, vertices + vertex_used, corners[c]) == vertices + vertex_used)
+							vertices[vertex_used++] = corners[c];
+						block.Indices.push_back (corners[c]);
+					}
+					assigned[triangle - first] = true;
+					triangles++;
+
+					for (uint32_t c = 0; c < 3; c++) {
+						for (uint32_t t = offsets[corners[c]]; t < offsets[corners[c] + 1]; t++) {
+							const uint32_t neighbour = triangles_of_vertex[t];
+							if (neighbour < first || neighbour >= last || assigned[neighbour - first] || claimed[neighbour] == meshlet_id)
+								continue;
+							claimed[neighbour] = meshlet_id;
+							queue.push_back (neighbour);
+						}
+					}
+				}
+				Meshlet meshlet;
+				meshlet.FirstIndex = first_index;
+				meshlet.IndexCount = uint32_t (block.Indices.size ()) - first_index;
+				compute_bounds (posn_and_normals, &block.Indices[first_index], meshlet.IndexCount, meshlet);
+				block.Meshlets.push_back (meshlet);
+			}
+		}
+	});
+
+	size_t total_meshlets = 0;
+	for (const MeshletBlock &block : blocks)
+		total_meshlets += block.Meshlets.size ();
+	out_meshlets.Meshlets.reserve (total_meshlets);
+	out_meshlets.Indices.reserve (indices.size ());
+	for (const MeshletBlock &block : blocks) {
+		const uint32_t base = uint32_t (out_meshlets.Indices.size ());
+		for (Meshlet meshlet : block.Meshlets) {
+			meshlet.FirstIndex += base;
+			out_meshlets.Meshlets.push_back (meshlet);
+		}
+		out_meshlets.Indices.insert (out_meshlets.Indices.end (), block.Indices.begin (), block.Indices.end ());
+	}
+}
+
+MeshletCullStats CullMeshlets (const MeshletMesh &meshlets, const MeshletCullParams &params, std::vector<uint8_t> &scratch_visibility, DrawElementsIndirectCommand *out_commands)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const std::vector<Meshlet> &list = meshlets.Meshlets;
+	scratch_visibility.resize (list.size ());
+
+	// Gribb-Hartmann, planes point inwards
+	glm::vec4 planes[6];
+	const glm::mat4 &m = params.ViewProjection;
+	const glm::vec4 row0 (m[0][0], m[1][0], m[2][0], m[3][0]), row1 (m[0][1], m[1][1], m[2][1], m[3][1])
+		, row2 (m[0][2], m[1][2], m[2][2], m[3][2]), row3 (m[0][3], m[1][3], m[2][3], m[3][3]);
+	planes[0] = row3 + row0, planes[1] = row3 - row0;
+	planes[2] = row3 + row1, planes[3] = row3 - row1;
+	planes[4] = row3 + row2, planes[5] = row3 - row2;
+	for (glm::vec4 &plane : planes)
+		plane /= glm::length (glm::vec3 (plane));
+
+	JobSystem::ParallelFor (list.size (), 2048, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const Meshlet &meshlet = list[i];
+			bool visible = true;
+			if (params.Frustum)
+				for (uint32_t p = 0; p < 6 && visible; p++)
+					visible = glm::dot (glm::vec3 (planes[p]), meshlet.Center) + planes[p].w >= -meshlet.Radius;
+			if (visible && params.BackfaceCones && meshlet.ConeCutoff < 1) {
+				const glm::vec3 view = meshlet.Center - params.CameraPosition;
+				visible = glm::dot (view, meshlet.ConeAxis) < meshlet.ConeCutoff*glm::length (view) + meshlet.Radius;
+			}
+			scratch_visibility[i] = visible;
+		}
+	});
+
+	// compaction, meshlets are contiguous in the index buffer so runs of visible ones become one draw
+	MeshletCullStats stats;
+	for (size_t i = 0; i < list.size (); i++) {
+		if (!scratch_visibility[i])
+			continue;
+		stats.VisibleMeshlets++;
+		stats.VisibleTriangles += list[i].IndexCount/3;
+		if (stats.Commands > 0 && i > 0 && scratch_visibility[i - 1]) {
+			out_commands[stats.Commands - 1].Count += list[i].IndexCount;
+			continue;
+		}
+		out_commands[stats.Commands++] = { list[i].IndexCount, 1, list[i].FirstIndex, 0, 0 };
+	}
+	return stats;
+}
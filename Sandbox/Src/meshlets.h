@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+// Small cluster of triangles that is culled as a whole, its triangles are Indices[FirstIndex .. FirstIndex + IndexCount)
+struct Meshlet
+{
+	glm::vec3 Center; float Radius;        // bounding sphere
+	glm::vec3 ConeAxis; float ConeCutoff;  // normal cone, ConeCutoff = 1 -> normals too spread to ever be back-facing
+	uint32_t FirstIndex, IndexCount;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> Meshlets;
+	std::vector<GLuint> Indices; // same triangles as the source index buffer, reordered so every meshlet is contiguous
+
+	static constexpr uint32_t MaxVertices = 64, MaxTriangles = 124;
+};
+
+// Layout glMultiDrawElementsIndirect expects
+struct DrawElementsIndirectCommand
+{
+	GLuint Count, InstanceCount, FirstIndex;
+	GLint BaseVertex;
+	GLuint BaseInstance;
+};
+
+struct MeshletCullParams
+{
+	glm::mat4 ViewProjection;
+	glm::vec3 CameraPosition;
+	bool Frustum = true;
+	bool BackfaceCones = true; // only valid for consistently (counter clock-wise) wound meshes
+};
+
+struct MeshletCullStats
+{
+	size_t VisibleMeshlets = 0, VisibleTriangles = 0, Commands = 0;
+};
+
+// Greedy clustering over shared-vertex adjacency, runs on the job system over independent blocks of triangles
+void BuildMeshlets (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const std::vector<GLuint> &indices, MeshletMesh &out_meshlets);
+
+// Tests every meshlet in parallel, adjacent visible meshlets are merged into one command.
+// out_commands needs room for meshlets.Meshlets.size () commands (worst case), may point into mapped GL memory
+MeshletCullStats CullMeshlets (const MeshletMesh &meshlets, const MeshletCullParams &params, std::vector<uint8_t> &scratch_visibility, DrawElementsIndirectCommand *out_commands);
@@ -0,0 +1,327 @@
+﻿#include "point_cloud.h"
+#include <GLCore.h>
+#include <GLCoreUtils.h>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <glm/gtx/norm.hpp>
+using namespace GLCore::Utils;
+
+constexpr size_t ParallelLevelPoints = 1 << 16; // cells at least this big are split on a job of their own
+constexpr size_t FitBatch = 1 << 10;            // consecutive points (tree order) per job, their neighbourhoods overlap
+
+struct KDBox
+{
+	glm::vec3 Min = glm::vec3 (FLT_MAX), Max = glm::vec3 (-FLT_MAX);
+
+	void Grow (const glm::vec3 &p) { Min = glm::min (Min, p), Max = glm::max (Max, p); }
+	void Grow (const KDBox &box) { Min = glm::min (Min, box.Min), Max = glm::max (Max, box.Max); }
+	uint32_t LongestAxis () const
+	{
+		const glm::vec3 extent = Max - Min;
+		return extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2) : (extent.y >= extent.z ? 1 : 2);
+	}
+};
+
+void BuildPointKDTree (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, PointKDTree &out_tree)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t point_count = posn_and_normals.size ();
+	out_tree.Nodes.clear ();
+	out_tree.Points.resize (point_count);
+	out_tree.Depth = 0;
+	while ((size_t (PointKDTree::LeafSize) << out_tree.Depth) < point_count)
+		out_tree.Depth++;
+	if (point_count == 0)
+		return;
+	out_tree.Nodes.resize (out_tree.LeafCount () - 1);
+
+	KDBox root;
+	std::mutex root_mutex;
+	JobSystem::ParallelFor (point_count, 1 << 16, [&](size_t begin, size_t end) {
+		KDBox box;
+		for (size_t i = begin; i < end; i++) {
+			out_tree.Points[i] = { posn_and_normals[i].first, uint32_t (i) };
+			box.Grow (posn_and_normals[i].first);
+		}
+		std::scoped_lock lock (root_mutex);
+		root.Grow (box);
+	});
+
+	// cells of the level being split, their children's cells are cut at the split plane
+	std::vector<KDBox> cells (1, root), child_cells;
+	for (uint32_t level = 0; level < out_tree.Depth; level++) {
+		const size_t level_nodes = size_t (1) << level;
+		child_cells.resize (level_nodes*2);
+		const size_t grain = std::max<size_t> (1, (ParallelLevelPoints << level)/point_count);
+		JobSystem::ParallelFor (level_nodes, grain, [&](size_t begin, size_t end) {
+			for (size_t j = begin; j < end; j++) {
+				PointKDTree::Point *first = out_tree.Points.data () + out_tree.RangeBegin (level, j)
+					, *mid = out_tree.Points.data () + out_tree.RangeBegin (level + 1, j*2 + 1)
+					, *last = out_tree.Points.data () + out_tree.RangeBegin (level, j + 1);
+				const uint32_t axis = cells[j].LongestAxis ();
+				std::nth_element (first, mid, last, [axis](const PointKDTree::Point &a, const PointKDTree::Point &b) { return a.Position[axis] < b.Position[axis]; });
+
+				PointKDTree::Node &node = out_tree.Nodes[level_nodes - 1 + j];
+				node.Axis = axis;
+				node.Split = mid->Position[axis];
+				child_cells[j*2] = child_cells[j*2 + 1] = cells[j];
+				child_cells[j*2].Max[axis] = child_cells[j*2 + 1].Min[axis] = node.Split;
+			}
+		});
+		std::swap (cells, child_cells);
+	}
+}
+
+// k closest so far, sorted, insertion is cheap at the sizes kNN is used with
+struct NeighbourList
+{
+	uint32_t Count = 0, K = 0;
+	float Distance2[PointCloudCurvatureSettings::MaxNeighbours];
+	uint32_t Point[PointCloudCurvatureSettings::MaxNeighbours]; // into PointKDTree::Points
+
+	float Bound () const { return Count < K ? FLT_MAX : Distance2[K - 1]; }
+	void Insert (float distance2, uint32_t point)
+	{
+		if (distance2 >= Bound ())
+			return;
+		uint32_t i = Count < K ? Count++ : K - 1;
+		for (; i > 0 && Distance2[i - 1] > distance2; i--)
+			Distance2[i] = Distance2[i - 1], Point[i] = Point[i - 1];
+		Distance2[i] = distance2, Point[i] = point;
+	}
+};
+
+static void scan_leaf (const PointKDTree &tree, size_t leaf, const glm::vec3 &point, NeighbourList &list)
+{
+	const size_t end = tree.RangeBegin (tree.Depth, leaf + 1);
+	for (size_t i = tree.RangeBegin (tree.Depth, leaf); i < end; i++)
+		list.Insert (glm::distance2 (tree.Points[i].Position, point), uint32_t (i));
+}
+
+// 'skip_leaf' has already been scanned, the batched queries start at their own leaf so most of the tree is pruned right away
+static void k_nearest (const PointKDTree &tree, const glm::vec3 &point, NeighbourList &list, size_t skip_leaf = SIZE_MAX)
+{
+	if (tree.Points.empty ())
+		return;
+	// Node within its level, Offset per axis from the point to the cell (only the split planes crossed so far), Distance2 its length squared
+	struct Entry { uint32_t Level, Node; glm::vec3 Offset; float Distance2; };
+	Entry stack[64];
+	uint32_t stack_size = 0;
+	stack[stack_size++] = { 0, 0, glm::vec3 (0), 0 };
+	while (stack_size) {
+		const Entry entry = stack[--stack_size];
+		if (entry.Distance2 >= list.Bound ())
+			continue;
+		if (entry.Level == tree.Depth) {
+			if (entry.Node != skip_leaf)
+				scan_leaf (tree, entry.Node, point, list);
+			continue;
+		}
+		const PointKDTree::Node &node = tree.Nodes[(size_t (1) << entry.Level) - 1 + entry.Node];
+		const float offset = point[node.Axis] - node.Split;
+		const uint32_t near_child = entry.Node*2 + (offset >= 0 ? 1 : 0);
+		// far one first, so the near one is popped next; crossing the plane replaces the offset along its axis (Arya & Mount)
+		Entry far_entry = { entry.Level + 1, near_child ^ 1, entry.Offset, entry.Distance2 - entry.Offset[node.Axis]*entry.Offset[node.Axis] + offset*offset };
+		far_entry.Offset[node.Axis] = offset;
+		stack[stack_size++] = far_entry;
+		stack[stack_size++] = { entry.Level + 1, near_child, entry.Offset, entry.Distance2 };
+	}
+}
+
+uint32_t PointKDTreeNearest (const PointKDTree &tree, const glm::vec3 &point, uint32_t k, uint32_t *out_indices, float *out_distances_squared)
+{
+	NeighbourList list;
+	list.K = std::min (k, PointCloudCurvatureSettings::MaxNeighbours);
+	if (list.K == 0)
+		return 0;
+	k_nearest (tree, point, list);
+	for (uint32_t i = 0; i < list.Count; i++) {
+		out_indices[i] = tree.Points[list.Point[i]].Index;
+		if (out_distances_squared)
+			out_distances_squared[i] = list.Distance2[i];
+	}
+	return list.Count;
+}
+
+// Smallest eigenvector of a symmetric 3x3 (cyclic Jacobi), the normal of a neighbourhood's covariance
+static glm::dvec3 smallest_eigenvector (double a[3][3])
+{
+	double v[3][3] = { {1,0,0}, {0,1,0}, {0,0,1} };
+	for (int sweep = 0; sweep < 16; sweep++) {
+		const double off = a[0][1]*a[0][1] + a[0][2]*a[0][2] + a[1][2]*a[1][2];
+		if (off < 1e-24*(a[0][0]*a[0][0] + a[1][1]*a[1][1] + a[2][2]*a[2][2]) || off == 0)
+			break;
+		for (int p = 0; p < 2; p++) for (int q = p + 1; q < 3; q++) {
+			if (a[p][q] == 0)
+				continue;
+			const double theta = (a[q][q] - a[p][p])/(2*a[p][q])
+				, t = (theta >= 0 ? 1 : -1)/(std::abs (theta) + std::sqrt (theta*theta + 1))
+				, c = 1/std::sqrt (t*t + 1), s = t*c;
+			for (int r = 0; r < 3; r++) { // A = A J
+				const double arp = a[r][p], arq = a[r][q];
+				a[r][p] = c*arp - s*arq, a[r][q] = s*arp + c*arq;
+			}
+			for (int r = 0; r < 3; r++) { // A = J^T A
+				const double apr = a[p][r], aqr = a[q][r];
+				a[p][r] = c*apr - s*aqr, a[q][r] = s*apr + c*aqr;
+			}
+			for (int r = 0; r < 3; r++) {
+				const double vrp = v[r][p], vrq = v[r][q];
+				v[r][p] = c*vrp - s*vrq, v[r][q] = s*vrp + c*vrq;
+			}
+		}
+	}
+	const int smallest = a[0][0] <= a[1][1] ? (a[0][0] <= a[2][2] ? 0 : 2) : (a[1][1] <= a[2][2] ? 1 : 2);
+	return { v[0][smallest], v[1][smallest], v[2][smallest] };
+}
+
+// Solves the (symmetric positive definite) normal equations in place, false when they're (nearly) singular
+template<int N>
+static bool cholesky_solve (double a[N][N], double b[N])
+{
+	double scale = 0;
+	for (int i = 0; i < N; i++)
+		scale = std::max (scale, a[i][i]);
+	for (int j = 0; j < N; j++) {
+		double d = a[j][j];
+		for (int k = 0; k < j; k++)
+			d -= a[j][k]*a[j][k];
+		if (!(d > 1e-10*scale))
+			return false;
+		a[j][j] = std::sqrt (d);
+		for (int i = j + 1; i < N; i++) {
+			double s = a[i][j];
+			for (int k = 0; k < j; k++)
+				s -= a[i][k]*a[j][k];
+			a[i][j] = s/a[j][j];
+		}
+	}
+	for (int i = 0; i < N; i++) { // L y = b
+		for (int k = 0; k < i; k++)
+			b[i] -= a[i][k]*b[k];
+		b[i] /= a[i][i];
+	}
+	for (int i = N - 1; i >= 0; i--) { // L^T x = y
+		for (int k = i + 1; k < N; k++)
+			b[i] -= a[k][i]*b[k];
+		b[i] /= a[i][i];
+	}
+	return true;
+}
+
+// Weighted least-squares fit of 'basis' (monomials in x, y) to z, returns the coefficients or false
+template<int N, typename BasisFn>
+static bool fit_height (const glm::dvec3 *local, const double *weights, uint32_t count, BasisFn basis, double out_coefficients[N])
+{
+	double ata[N][N] = {}, b[N];
+	for (int i = 0; i < N; i++)
+		out_coefficients[i] = 0;
+	for (uint32_t m = 0; m < count; m++) {
+		basis (local[m].x, local[m].y, b);
+		for (int i = 0; i < N; i++) {
+			const double wb = weights[m]*b[i];
+			for (int j = 0; j <= i; j++)
+				ata[i][j] += wb*b[j];
+			out_coefficients[i] += wb*local[m].z;
+		}
+	}
+	for (int i = 0; i < N; i++) for (int j = i + 1; j < N; j++)
+		ata[i][j] = ata[j][i];
+	return cholesky_solve<N> (ata, out_coefficients);
+}
+
+size_t PointCloudCurvature (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const PointKDTree &tree, const PointCloudCurvatureSettings &settings
+							, std::vector<glm::vec3> &out_mean_curvature_normals, std::vector<float> &out_mean_curvature_values
+							, std::vector<float> *out_gaussian_curvature_values)
+{
+	GLCORE_PROFILE_FUNCTION ();
+	const size_t point_count = posn_and_normals.size ();
+	out_mean_curvature_normals.assign (point_count, glm::vec3 (0));
+	out_mean_curvature_values.assign (point_count, 0.0f);
+	if (out_gaussian_curvature_values)
+		out_gaussian_curvature_values->assign (point_count, 0.0f);
+	if (tree.Points.size () != point_count || point_count == 0)
+		return 0;
+	const uint32_t k = uint32_t (std::min<size_t> (point_count, std::clamp (settings.Neighbours, 6u, PointCloudCurvatureSettings::MaxNeighbours)));
+	const bool jet = settings.Fit == PointCloudFit::Jet;
+	if (k < (jet ? 6u : 3u))
+		return 0;
+
+	std::atomic<size_t> fitted = 0;
+	// in tree order: a batch is a handful of neighbouring leaves, which its queries keep revisiting
+	JobSystem::ParallelFor (point_count, FitBatch, [&](size_t begin, size_t end) {
+		NeighbourList list;
+		glm::dvec3 local[PointCloudCurvatureSettings::MaxNeighbours];
+		double weights[PointCloudCurvatureSettings::MaxNeighbours];
+		size_t batch_fitted = 0;
+		for (size_t i = begin; i < end; i++) {
+			const PointKDTree::Point &point = tree.Points[i];
+			const glm::dvec3 p = point.Position;
+			list.Count = 0, list.K = k;
+			const size_t own_leaf = (((i + 1) << tree.Depth) - 1)/point_count; // RangeBegin (Depth, leaf) <= i
+			scan_leaf (tree, own_leaf, point.Position, list);
+			k_nearest (tree, point.Position, list, own_leaf);
+
+			// frame: normal of the cloud, or of the neighbourhood
+			glm::dvec3 normal = posn_and_normals[point.Index].second;
+			const double normal_length = glm::length (normal);
+			if (settings.EstimateNormals || !(normal_length > 1e-12)) {
+				glm::dvec3 centroid (0);
+				for (uint32_t m = 0; m < list.Count; m++)
+					centroid += glm::dvec3 (tree.Points[list.Point[m]].Position);
+				centroid /= double (list.Count);
+				double covariance[3][3] = {};
+				for (uint32_t m = 0; m < list.Count; m++) {
+					const glm::dvec3 d = glm::dvec3 (tree.Points[list.Point[m]].Position) - centroid;
+					for (int r = 0; r < 3; r++) for (int c = 0; c < 3; c++)
+						covariance[r][c] += d[r]*d[c];
+				}
+				const glm::dvec3 estimated = smallest_eigenvector (covariance);
+				normal = normal_length > 1e-12 && glm::dot (estimated, normal) < 0 ? -estimated : estimated;
+			}
+			else normal /= normal_length;
+			// orthonormal basis around the normal (Duff et al. 2017)
+			const double sign = std::copysign (1.0, normal.z), a = -1/(sign + normal.z), b = normal.x*normal.y*a;
+			const glm::dvec3 t1 (1 + sign*normal.x*normal.x*a, sign*b, -sign*normal.x), t2 (b, sign + normal.y*normal.y*a, -normal.y);
+
+			// coordinates in units of the neighbourhood's radius keep the normal equations conditioned whatever the cloud's scale
+			const double h = std::sqrt (double (list.Distance2[list.Count - 1]));
+			if (!(h > 0))
+				continue;
+			for (uint32_t m = 0; m < list.Count; m++) {
+				const glm::dvec3 d = (glm::dvec3 (tree.Points[list.Point[m]].Position) - p)/h;
+				local[m] = { glm::dot (d, t1), glm::dot (d, t2), glm::dot (d, normal) };
+				weights[m] = std::exp (-2*glm::length2 (d));
+			}
+
+			double fx = 0, fy = 0, fxx, fxy, fyy;
+			if (jet) {
+				double c[6];
+				if (!fit_height<6> (local, weights, list.Count, [](double x, double y, double *out) { out[0] = 1, out[1] = x, out[2] = y, out[3] = x*x, out[4] = x*y, out[5] = y*y; }, c))
+					continue;
+				fx = c[1], fy = c[2], fxx = 2*c[3]/h, fxy = c[4]/h, fyy = 2*c[5]/h;
+			}
+			else {
+				double c[3];
+				if (!fit_height<3> (local, weights, list.Count, [](double x, double y, double *out) { out[0] = x*x, out[1] = x*y, out[2] = y*y; }, c))
+					continue;
+				fxx = 2*c[0]/h, fxy = c[1]/h, fyy = 2*c[2]/h;
+			}
+			// curvatures of the graph z = f(x, y) at the origin, H > 0 bends towards the normal
+			const double g = 1 + fx*fx + fy*fy
+				, H = ((1 + fy*fy)*fxx - 2*fx*fy*fxy + (1 + fx*fx)*fyy)/(2*g*std::sqrt (g))
+				, K = (fxx*fyy - fxy*fxy)/(g*g);
+			// K(Xi) of the mesh kernel points away from the side the surface bends to
+			const glm::dvec3 surface_normal = glm::normalize (normal - fx*t1 - fy*t2);
+			out_mean_curvature_values[point.Index] = float (std::abs (H));
+			out_mean_curvature_normals[point.Index] = glm::vec3 (-2*H*surface_normal);
+			if (out_gaussian_curvature_values)
+				(*out_gaussian_curvature_values)[point.Index] = float (K);
+			batch_fitted++;
+		}
+		fitted += batch_fitted;
+	});
+	return fitted;
+}
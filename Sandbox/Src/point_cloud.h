@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// Balanced k-d tree over a point cloud. Every level splits its cells at the median along their longest side, so the tree
+// is complete and implicit: inner node i has children 2i + 1 and 2i + 2, the points of node j of level l are
+// Points[RangeBegin (l, j) .. RangeBegin (l, j + 1)). Levels are built one after the other, the cells of a level in parallel.
+struct PointKDTree
+{
+	struct Node
+	{
+		float Split;   // points of the left child are <= Split along Axis, the right child's >= Split
+		uint32_t Axis;
+	};
+	struct Point
+	{
+		glm::vec3 Position;
+		uint32_t Index; // in the source cloud
+	};
+	std::vector<Node> Nodes;   // LeafCount () - 1 inner nodes
+	std::vector<Point> Points; // tree order, every leaf is a contiguous range
+	uint32_t Depth = 0;        // level of the leaves, they aren't stored
+
+	static constexpr uint32_t LeafSize = 16; // leaves hold LeafSize/2 .. LeafSize points
+
+	uint32_t LeafCount () const { return 1u << Depth; }
+	size_t RangeBegin (uint32_t level, size_t node_in_level) const { return size_t ((uint64_t (node_in_level)*Points.size ()) >> level); }
+};
+
+enum class PointCloudFit
+{
+	Quadric, // z = a x^2 + b xy + c y^2 over the tangent plane of the point's normal (trusts the normal, 3 unknowns)
+	Jet      // osculating 2-jet z = c0 + c1 x + c2 y + c3 x^2 + c4 xy + c5 y^2, tolerates noisy normals (6 unknowns)
+};
+
+struct PointCloudCurvatureSettings
+{
+	uint32_t Neighbours = 16; // k nearest, the point itself included, 6 .. MaxNeighbours
+	PointCloudFit Fit = PointCloudFit::Jet;
+	bool EstimateNormals = false; // PCA normals of the neighbourhood even where the cloud has its own (zero normals always get one)
+
+	static constexpr uint32_t MaxNeighbours = 64;
+};
+
+void BuildPointKDTree (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, PointKDTree &out_tree);
+
+// k nearest points (cloud indices) of 'point', closest first, returns how many were found (k unless the cloud is smaller)
+uint32_t PointKDTreeNearest (const PointKDTree &tree, const glm::vec3 &point, uint32_t k, uint32_t *out_indices, float *out_distances_squared = nullptr);
+
+// kNN of every point in batches of neighbouring points (tree order), then a Gaussian weighted least-squares fit of the
+// surface over its neighbours. Same conventions as the mesh kernel: K_h = |H|, K(Xi) = 2 H n (n the fitted surface normal).
+// Points whose fit fails (degenerate neighbourhoods) get 0, returns how many were fitted.
+size_t PointCloudCurvature (const std::vector<std::pair<glm::vec3, glm::vec3>> &posn_and_normals, const PointKDTree &tree, const PointCloudCurvatureSettings &settings
+							, std::vector<glm::vec3> &out_mean_curvature_normals, std::vector<float> &out_mean_curvature_values
+							, std::vector<float> *out_gaussian_curvature_values = nullptr);
@@ -1,4 +1,10 @@
 -- OpenGL-Sandbox
+newoption
+{
+    trigger     = "profile",
+    description = "Compile GLCore instrumentation in (any configuration)"
+}
+
 workspace "Assignment"
     architecture "x64"
     startproject "Sandbox"
@@ -14,6 +20,11 @@ workspace "Assignment"
         "MultiProcessorCompile"
     }
 
+    -- premake5 vs2019 --profile, records GLCORE_PROFILE_* scopes into a chrome trace
+    filter "options:profile"
+        defines "GLCORE_PROFILE=1"
+    filter {}
+
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
 -- Include directories relative to solution
@@ -34,4 +45,5 @@ group "Dependencies"
 group ""
 
 include "OpenGL-Laboratory" -- includeexternal for upcoming workspace/solutions
-include "Sandbox"
\ No newline at end of file
+include "Sandbox"
+include "Benchmark"
\ No newline at end of file